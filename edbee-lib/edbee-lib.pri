@@ -25,7 +25,14 @@ SOURCES += \
     $$PWD/edbee/io/baseplistparser.cpp \
     $$PWD/edbee/io/jsonparser.cpp \
     $$PWD/edbee/io/keymapparser.cpp \
+    $$PWD/edbee/io/textdocumentfollower.cpp \
+    $$PWD/edbee/io/textdocumentjournal.cpp \
+    $$PWD/edbee/io/textdocumentloader.cpp \
+    $$PWD/edbee/io/textdocumentsaver.cpp \
+    $$PWD/edbee/io/textdocumentscopesserializer.cpp \
     $$PWD/edbee/io/textdocumentserializer.cpp \
+    $$PWD/edbee/io/textdocumentsessionsnapshot.cpp \
+    $$PWD/edbee/io/textlexercache.cpp \
     $$PWD/edbee/io/tmlanguageparser.cpp \
     $$PWD/edbee/io/tmthemeparser.cpp \
     $$PWD/edbee/lexers/grammartextlexer.cpp \
@@ -39,9 +46,12 @@ SOURCES += \
     $$PWD/edbee/models/changes/textchangewithcaret.cpp \
     $$PWD/edbee/models/chardocument/chartextbuffer.cpp \
     $$PWD/edbee/models/chardocument/chartextdocument.cpp \
+    $$PWD/edbee/models/chardocument/mappedtextbuffer.cpp \
+    $$PWD/edbee/models/chardocument/ropetextbuffer.cpp \
     $$PWD/edbee/models/dynamicvariables.cpp \
     $$PWD/edbee/models/textautocompleteprovider.cpp \
     $$PWD/edbee/models/textbuffer.cpp \
+    $$PWD/edbee/models/textbuffersnapshot.cpp \
     $$PWD/edbee/models/textdocument.cpp \
     $$PWD/edbee/models/textdocumentfilter.cpp \
     $$PWD/edbee/models/textdocumentscopes.cpp \
@@ -50,6 +60,7 @@ SOURCES += \
     $$PWD/edbee/models/texteditorkeymap.cpp \
     $$PWD/edbee/models/textgrammar.cpp \
     $$PWD/edbee/models/textlexer.cpp \
+    $$PWD/edbee/models/textlexerscheduler.cpp \
     $$PWD/edbee/models/textlinedata.cpp \
     $$PWD/edbee/models/textrange.cpp \
     $$PWD/edbee/models/textsearcher.cpp \
@@ -59,10 +70,14 @@ SOURCES += \
     $$PWD/edbee/texteditorwidget.cpp \
     $$PWD/edbee/util/cascadingqvariantmap.cpp \
     $$PWD/edbee/util/gapvector.h \
+    $$PWD/edbee/util/hash64.cpp \
+    $$PWD/edbee/util/linediff.cpp \
     $$PWD/edbee/util/lineending.cpp \
+    $$PWD/edbee/util/lineoffsettree.cpp \
     $$PWD/edbee/util/lineoffsetvector.cpp \
     $$PWD/edbee/util/mem/debug_allocs.cpp \
     $$PWD/edbee/util/mem/debug_new.cpp \
+    $$PWD/edbee/util/newlinescanner.cpp \
     $$PWD/edbee/util/rangelineiterator.cpp \
     $$PWD/edbee/util/rangesetlineiterator.cpp \
     $$PWD/edbee/util/regexp.cpp \
@@ -70,6 +85,9 @@ SOURCES += \
     $$PWD/edbee/util/test.cpp \
     $$PWD/edbee/util/textcodec.cpp \
     $$PWD/edbee/util/textcodecdetector.cpp \
+    $$PWD/edbee/util/textrope.cpp \
+    $$PWD/edbee/util/unicodetranscoder.cpp \
+    $$PWD/edbee/util/utf8validator.cpp \
     $$PWD/edbee/util/util.cpp \
     $$PWD/edbee/views/accessibletexteditorwidget.cpp \
     $$PWD/edbee/views/components/texteditorautocompletecomponent.cpp \
@@ -109,7 +127,14 @@ HEADERS += \
     $$PWD/edbee/io/baseplistparser.h \
     $$PWD/edbee/io/jsonparser.h \
     $$PWD/edbee/io/keymapparser.h \
+    $$PWD/edbee/io/textdocumentfollower.h \
+    $$PWD/edbee/io/textdocumentjournal.h \
+    $$PWD/edbee/io/textdocumentloader.h \
+    $$PWD/edbee/io/textdocumentsaver.h \
+    $$PWD/edbee/io/textdocumentscopesserializer.h \
     $$PWD/edbee/io/textdocumentserializer.h \
+    $$PWD/edbee/io/textdocumentsessionsnapshot.h \
+    $$PWD/edbee/io/textlexercache.h \
     $$PWD/edbee/io/tmlanguageparser.h \
     $$PWD/edbee/io/tmthemeparser.h \
     $$PWD/edbee/lexers/grammartextlexer.h \
@@ -123,9 +148,12 @@ HEADERS += \
     $$PWD/edbee/models/changes/textchangewithcaret.h \
     $$PWD/edbee/models/chardocument/chartextbuffer.h \
     $$PWD/edbee/models/chardocument/chartextdocument.h \
+    $$PWD/edbee/models/chardocument/mappedtextbuffer.h \
+    $$PWD/edbee/models/chardocument/ropetextbuffer.h \
     $$PWD/edbee/models/dynamicvariables.h \
     $$PWD/edbee/models/textautocompleteprovider.h \
     $$PWD/edbee/models/textbuffer.h \
+    $$PWD/edbee/models/textbuffersnapshot.h \
     $$PWD/edbee/models/textdocument.h \
     $$PWD/edbee/models/textdocumentfilter.h \
     $$PWD/edbee/models/textdocumentscopes.h \
@@ -134,6 +162,7 @@ HEADERS += \
     $$PWD/edbee/models/texteditorkeymap.h \
     $$PWD/edbee/models/textgrammar.h \
     $$PWD/edbee/models/textlexer.h \
+    $$PWD/edbee/models/textlexerscheduler.h \
     $$PWD/edbee/models/textlinedata.h \
     $$PWD/edbee/models/textrange.h \
     $$PWD/edbee/models/textsearcher.h \
@@ -142,11 +171,15 @@ HEADERS += \
     $$PWD/edbee/texteditorcontroller.h \
     $$PWD/edbee/texteditorwidget.h \
     $$PWD/edbee/util/cascadingqvariantmap.h \
+    $$PWD/edbee/util/hash64.h \
+    $$PWD/edbee/util/linediff.h \
     $$PWD/edbee/util/lineending.h \
+    $$PWD/edbee/util/lineoffsettree.h \
     $$PWD/edbee/util/lineoffsetvector.h \
     $$PWD/edbee/util/logging.h \
     $$PWD/edbee/util/mem/debug_allocs.h \
     $$PWD/edbee/util/mem/debug_new.h \
+    $$PWD/edbee/util/newlinescanner.h \
     $$PWD/edbee/util/rangelineiterator.h \
     $$PWD/edbee/util/rangesetlineiterator.h \
     $$PWD/edbee/util/regexp.h \
@@ -154,6 +187,9 @@ HEADERS += \
     $$PWD/edbee/util/test.h \
     $$PWD/edbee/util/textcodec.h \
     $$PWD/edbee/util/textcodecdetector.h \
+    $$PWD/edbee/util/textrope.h \
+    $$PWD/edbee/util/unicodetranscoder.h \
+    $$PWD/edbee/util/utf8validator.h \
     $$PWD/edbee/util/util.h \
     $$PWD/edbee/views/accessibletexteditorwidget.h \
     $$PWD/edbee/views/components/texteditorautocompletecomponent.h \
@@ -128,7 +128,7 @@ static bool areAllLinesCommented(TextDocument* doc, TextRange& range, const QLis
             continue;
         }
 
-        // directly search in the raw data pointer buffer to prevent QString creation
+        // directly search in the buffer data to prevent QString creation
         size_t offset = doc->offsetFromLine(line);
 
         // iterate over all line definitions
@@ -141,7 +141,8 @@ static bool areAllLinesCommented(TextDocument* doc, TextRange& range, const QLis
             RegExp* commentStartRegExp = def->commentStartRegExp();
 
             /// toggle the found flag if a comment is found and break
-            if (commentStartRegExp->indexIn(buf->rawDataPointer(), offset, offset+ doc->lineLength(line) - 1) != std::string::npos) {
+            size_t length = doc->lineLength(line) - 1;
+            if (commentStartRegExp->indexIn(buf->rangeDataPointer(offset, length), 0, length) != std::string::npos) {
                 found = true;
                 break;
             }
@@ -168,7 +169,7 @@ static void removeLineComment(TextDocument* doc, TextRange& range, const QList<C
     RangeLineIterator itr(doc, range);
     while (itr.hasNext()) {
 
-        // directly search in the raw data pointer buffer to prevent QString creation
+        // directly search in the buffer data to prevent QString creation
         size_t line = itr.next();
         size_t offset = doc->offsetFromLine(line);
 
@@ -180,9 +181,10 @@ static void removeLineComment(TextDocument* doc, TextRange& range, const QList<C
             RegExp* regExp = def->removeCommentStartRegeExp();
 
             // perform a regexp to extract the comment that needs to be removed
-            if (regExp->indexIn(buf->rawDataPointer(), offset, offset + doc->lineLength(line)) != std::string::npos) {
+            size_t length = doc->lineLength(line);
+            if (regExp->indexIn(buf->rangeDataPointer(offset, length), 0, length) != std::string::npos) {
                 // remove the found regexp and goto the next line
-                doc->replace(regExp->pos(1), regExp->len(1), "");
+                doc->replace(offset + regExp->pos(1), regExp->len(1), "");
                 break;
             }
         }
@@ -201,7 +203,7 @@ static void insertLineComments(TextDocument* doc, TextRange& range, const QStrin
     // iterate over all lines and build all ranges
     RangeLineIterator itr(doc, range);
     while (itr.hasNext()) {
-        // directly search in the raw data pointer buffer to prevent QString creation
+        // directly search in the buffer data to prevent QString creation
         size_t line = itr.next();
         size_t offset = doc->offsetFromLine(line);
         size_t lineLength = doc->lineLengthWithoutNewline(line);
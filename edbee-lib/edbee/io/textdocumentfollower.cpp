@@ -0,0 +1,231 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentfollower.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextCodec>
+#include <QTimer>
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textdocument.h"
+#include "edbee/models/textundostack.h"
+#include "edbee/util/textcodec.h"
+#include "edbee/util/textcodecdetector.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const int DefaultInterval = 250;                 ///< The default poll interval in milliseconds
+static const qint64 MaxReadSize = 4 * 1024 * 1024;      ///< The maximum number of bytes appended per poll, the rest is appended in the next event loop iteration
+
+
+/// Returns the identity of the given file. A file that's replaced (for example by a log rotation) gets another identity.
+/// This is the device and inode of the file, on Windows the creation time
+/// @param fileName the name of the file
+/// @return the identity, an empty string if the file doesn't exist
+static QString fileIdentity(const QString& fileName)
+{
+#ifdef Q_OS_WIN
+    QFileInfo info(fileName);
+    if (!info.exists()) { return QString(); }
+    return QString::number(info.birthTime().toMSecsSinceEpoch());
+#else
+    struct stat fileStat;
+    if (::stat(QFile::encodeName(fileName).constData(), &fileStat) != 0) { return QString(); }
+    return QStringLiteral("%1:%2").arg(static_cast<quint64>(fileStat.st_dev)).arg(static_cast<quint64>(fileStat.st_ino));
+#endif
+}
+
+
+/// Constructs the follower
+/// @param textDocument the document to append the file data to
+/// @param parent the parent of this object
+TextDocumentFollower::TextDocumentFollower(TextDocument* textDocument, QObject* parent)
+    : QObject(parent)
+    , textDocumentRef_(textDocument)
+    , file_(nullptr)
+    , decoder_(nullptr)
+    , timer_(new QTimer(this))
+    , interval_(DefaultInterval)
+    , maximumLineCount_(0)
+    , position_(0)
+    , pendingCarriageReturn_(false)
+{
+    connect(timer_, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+
+/// Stops following
+TextDocumentFollower::~TextDocumentFollower()
+{
+    closeFile();
+}
+
+
+/// Starts following the given file. The data is decoded with the encoding of the document
+/// @param fileName the name of the file to follow
+/// @param position the position in the file from which the data is appended. The default (-1) is the current end
+///                 of the file, for a document that already contains the file (loaded with TextDocumentSerializer
+///                 or TextDocumentLoader)
+/// @return true on success. On failure errorString() contains the reason
+bool TextDocumentFollower::follow(const QString& fileName, qint64 position)
+{
+    stop();
+    errorString_.clear();
+    fileName_ = fileName;
+    if (!openFile(position)) { return false; }
+    timer_->start(interval_);
+    return true;
+}
+
+
+/// Stops following the file
+void TextDocumentFollower::stop()
+{
+    timer_->stop();
+    closeFile();
+}
+
+
+/// Sets the poll interval
+/// @param interval the interval in milliseconds
+void TextDocumentFollower::setInterval(int interval)
+{
+    interval_ = interval;
+    if (timer_->isActive()) { timer_->start(interval_); }
+}
+
+
+/// Reads the new data of the file and appends it to the document.
+/// This is called by the timer, but can also be called directly (for example when a file watcher reports a change)
+/// @return false if the file couldn't be read
+bool TextDocumentFollower::poll()
+{
+    if (!file_) { return false; }
+
+    // a file that's replaced by another file (a log rotation), or that's smaller than the read position (truncated).
+    // A missing file isn't followed again yet (a log rotation moves the file, before the new file is created)
+    QString identity = fileIdentity(fileName_);
+    if (!identity.isEmpty() && (identity != fileIdentity_ || QFileInfo(fileName_).size() < position_)) {
+        if (!openFile(0)) {
+            stop();
+            return false;
+        }
+        bool undoCollectionEnabled = textDocumentRef_->isUndoCollectionEnabled();
+        textDocumentRef_->setUndoCollectionEnabled(false);
+        textDocumentRef_->buffer()->replaceText(0, textDocumentRef_->length(), QString());
+        textDocumentRef_->setUndoCollectionEnabled(undoCollectionEnabled);
+        textDocumentRef_->textUndoStack()->clear();
+        emit restarted();
+    }
+
+    qint64 available = file_->size() - position_;
+    if (available <= 0) { return true; }
+    qint64 readSize = qMin(available, MaxReadSize);
+    if (!file_->seek(position_)) {
+        errorString_ = file_->errorString();
+        return false;
+    }
+    QByteArray bytes = file_->read(readSize);
+    if (bytes.isEmpty()) {
+        errorString_ = file_->errorString();
+        return false;
+    }
+    position_ += bytes.size();
+
+    QString text;
+    if (pendingCarriageReturn_) {
+        text.append(QChar('\r'));
+        pendingCarriageReturn_ = false;
+    }
+    decoder_->toUnicode(bytes.constData(), static_cast<int>(bytes.size()), text);
+    appendText(text);
+
+    if (available > readSize) {
+        QMetaObject::invokeMethod(this, "poll", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+
+/// Opens the file and creates a new decoder
+/// @param position the position to start reading from (-1 is the end of the file)
+bool TextDocumentFollower::openFile(qint64 position)
+{
+    closeFile();
+    QFile* file = new QFile(fileName_);
+    if (!file->open(QIODevice::ReadOnly)) {
+        errorString_ = file->errorString();
+        delete file;
+        return false;
+    }
+    file_ = file;
+    fileIdentity_ = fileIdentity(fileName_);
+    position_ = position < 0 ? file_->size() : qMin(position, file_->size());
+
+    TextCodec* codec = textDocumentRef_->encoding();
+    if (!codec) { codec = TextCodecDetector::globalPreferedCodec(); }
+    decoder_ = codec->makeTextDecoder(position_ > 0 ? QTextCodec::IgnoreHeader : QTextCodec::DefaultConversion);
+    pendingCarriageReturn_ = false;
+    return true;
+}
+
+
+/// Closes the file and deletes the decoder
+void TextDocumentFollower::closeFile()
+{
+    delete decoder_;
+    decoder_ = nullptr;
+    delete file_;
+    file_ = nullptr;
+}
+
+
+/// Appends the decoded text to the document, without undo records (the undo records of the document stay valid)
+void TextDocumentFollower::appendText(QString text)
+{
+    // a '\r' at the end can be the start of a "\r\n", it's appended with the next read
+    if (text.endsWith(QChar('\r'))) {
+        pendingCarriageReturn_ = true;
+        text.chop(1);
+    }
+    if (text.contains(QChar('\r'))) {
+        text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+    if (text.isEmpty()) { return; }
+
+    // the document makes line data changes for the buffer change, these aren't recorded either
+    bool undoCollectionEnabled = textDocumentRef_->isUndoCollectionEnabled();
+    textDocumentRef_->setUndoCollectionEnabled(false);
+    textDocumentRef_->buffer()->appendText(text);
+    removeLeadingLines();
+    textDocumentRef_->setUndoCollectionEnabled(undoCollectionEnabled);
+
+    emit appended(static_cast<size_t>(text.length()));
+}
+
+
+/// Removes the first lines when the document has more lines than the maximum line count.
+/// Removing the first lines moves the complete text of the buffer, that's why the lines are removed in batches:
+/// the document can grow to the maximum line count plus a quarter, before it's truncated to the maximum line count.
+/// The scopes of the remaining lines are kept (see TextDocument::removeLeadingText), so these lines aren't lexed again.
+/// The offsets of the undo records are invalid after removing the lines, so the undo stack is cleared
+void TextDocumentFollower::removeLeadingLines()
+{
+    if (!maximumLineCount_) { return; }
+    size_t lineCount = textDocumentRef_->lineCount();
+    if (lineCount <= maximumLineCount_ + maximumLineCount_ / 4) { return; }
+
+    textDocumentRef_->removeLeadingText(textDocumentRef_->offsetFromLine(lineCount - maximumLineCount_));
+    textDocumentRef_->textUndoStack()->clear();
+}
+
+
+} // edbee
@@ -0,0 +1,95 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QObject>
+#include <QString>
+
+class QFile;
+class QTimer;
+
+namespace edbee {
+
+class TextDecoder;
+class TextDocument;
+
+
+/// Follows a growing file (like a log file), by appending the new data of the file to the document.
+///
+/// The file is polled with a timer. The new bytes are decoded with the encoding of the document, the decoder
+/// is kept between the reads, so a character split over two reads is decoded correctly. The text is appended
+/// to the buffer, without undo records. Appending only invalidates the scopes of the last line, so the lexer
+/// continues from its last scoped offset.
+///
+/// With a maximum line count the document is a rolling window: the first lines are removed when the document
+/// grows too large. This is done in batches (a quarter of the maximum), and the scopes of the remaining lines
+/// are kept (see TextDocument::removeLeadingText).
+///
+/// When the file is truncated or replaced (for example by a log rotation) the document is cleared, and the
+/// new file is followed from the start. A replaced file is detected by its identity (inode or creation time).
+///
+/// Appending keeps the undo records of the document valid. Removing the first lines or clearing the document
+/// moves the text of these records, so the undo stack is cleared then.
+///
+/// To keep the view at the end of the document, see TextEditorController::setFollowEnd.
+class EDBEE_EXPORT TextDocumentFollower : public QObject
+{
+Q_OBJECT
+
+public:
+    TextDocumentFollower(TextDocument* textDocument, QObject* parent = nullptr);
+    virtual ~TextDocumentFollower();
+
+    bool follow(const QString& fileName, qint64 position = -1);
+    void stop();
+    bool isFollowing() const { return file_ != nullptr; }
+
+    /// The poll interval in milliseconds
+    int interval() const { return interval_; }
+    void setInterval(int interval);
+
+    /// The maximum number of lines of the document. 0 means unlimited
+    size_t maximumLineCount() const { return maximumLineCount_; }
+    void setMaximumLineCount(size_t lineCount) { maximumLineCount_ = lineCount; }
+
+    /// The position in the file up to which the data has been read
+    qint64 position() const { return position_; }
+
+    QString fileName() const { return fileName_; }
+    TextDocument* textDocument() const { return textDocumentRef_; }
+    QString errorString() const { return errorString_; }
+
+public slots:
+    bool poll();
+
+signals:
+    /// Emitted after text has been appended to the document
+    void appended(size_t length);
+
+    /// Emitted when the file has been truncated or replaced, after the document has been cleared
+    void restarted();
+
+private:
+    bool openFile(qint64 position);
+    void closeFile();
+    void appendText(QString text);
+    void removeLeadingLines();
+
+    TextDocument* textDocumentRef_;     ///< The document the file is appended to
+    QString fileName_;                  ///< The name of the followed file
+    QFile* file_;                       ///< The followed file (nullptr when not following)
+    QString fileIdentity_;              ///< The identity of the followed file (to detect a replaced file)
+    TextDecoder* decoder_;              ///< The decoder, which keeps incomplete characters between reads
+    QTimer* timer_;                     ///< The poll timer
+    int interval_;                      ///< The poll interval in milliseconds
+    size_t maximumLineCount_;           ///< The maximum number of lines (0 is unlimited)
+    qint64 position_;                   ///< The position in the file up to which the data has been read
+    bool pendingCarriageReturn_;        ///< Did the last read end with a '\r' (which isn't appended yet)?
+    QString errorString_;               ///< The last error
+};
+
+
+} // edbee
@@ -0,0 +1,529 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentjournal.h"
+
+#include <QFile>
+#include <QStringView>
+#include <QTimer>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textdocument.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+// The journal file starts with a header:
+//   "EDBJ"  version (uint8)  flags (uint8)  base length (uint64)  base hash (uint64)
+// followed by records:
+//   type (uint8)  offset (varint)  length (varint)  byte count (varint)  UTF-8 text  checksum (uint32)
+// All integers are little endian. A record with an invalid checksum (a partial write) ends the journal.
+
+static const char JournalMagic[] = "EDBJ";
+static const quint8 JournalVersion = 1;
+static const int HeaderSize = 4 + 1 + 1 + 8 + 8;
+static const quint8 FlagFullText = 1;               ///< The records contain the complete text (the base is an empty document)
+static const quint8 RecordReplace = 1;              ///< Replaces a range of the document
+static const size_t CompactChunkSize = 1024 * 1024; ///< The maximum number of characters of a record written by compaction
+
+static const int DefaultFlushInterval = 1000;
+static const int DefaultFlushSize = 64 * 1024;
+static const qint64 DefaultCompactSize = 16 * 1024 * 1024;
+
+
+/// Appends an unsigned integer in 7-bit groups (the high bit marks a next group)
+static void appendVarint(QByteArray& target, quint64 value)
+{
+    while (value >= 0x80) {
+        target.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    target.append(static_cast<char>(value));
+}
+
+
+/// Reads an integer written by appendVarint
+/// @return false when the data ends before the integer
+static bool readVarint(const uchar*& data, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        uchar byte = *data++;
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+
+
+/// Appends a little endian integer of the given number of bytes
+static void appendFixed(QByteArray& target, quint64 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        target.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+
+/// Reads a little endian integer of the given number of bytes
+static quint64 readFixed(const uchar* data, int bytes)
+{
+    quint64 value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<quint64>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+
+/// The FNV-1a checksum of a record
+static quint32 recordChecksum(const char* data, qsizetype length)
+{
+    quint32 hash = 2166136261u;
+    for (qsizetype i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<uchar>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+
+/// The 64 bit FNV-1a hash of the text of the document. This identifies the base of the journal
+static quint64 documentHash(TextDocument* document)
+{
+    quint64 hash = 14695981039346656037ull;
+    TextBuffer* buffer = document->buffer();
+    for (const TextBufferSpan& span : buffer->spans(0, buffer->length())) {
+        for (size_t i = 0; i < span.length; ++i) {
+            hash = (hash ^ span.data[i].unicode()) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+
+/// Appends the header of a journal
+static void appendHeader(QByteArray& target, quint8 flags, quint64 baseLength, quint64 baseHash)
+{
+    target.append(JournalMagic, 4);
+    target.append(static_cast<char>(JournalVersion));
+    target.append(static_cast<char>(flags));
+    appendFixed(target, baseLength, 8);
+    appendFixed(target, baseHash, 8);
+}
+
+
+/// Appends a replace record
+static void appendRecord(QByteArray& target, size_t offset, size_t length, const QChar* text, size_t textLength)
+{
+    qsizetype start = target.size();
+    QByteArray bytes = QStringView(text, static_cast<qsizetype>(textLength)).toUtf8();
+    target.append(static_cast<char>(RecordReplace));
+    appendVarint(target, offset);
+    appendVarint(target, length);
+    appendVarint(target, static_cast<quint64>(bytes.size()));
+    target.append(bytes);
+    appendFixed(target, recordChecksum(target.constData() + start, target.size() - start), 4);
+}
+
+
+/// Returns the name of the file that's used while compacting the journal
+static QString compactFileName(const QString& fileName)
+{
+    return fileName + QStringLiteral(".tmp");
+}
+
+
+/// Returns the name of the journal file to recover. When the journal is missing, the compacted journal is used
+/// (this only happens when a crash occured directly after compaction)
+static QString recoveryFileName(const QString& fileName)
+{
+    if (!QFile::exists(fileName) && QFile::exists(compactFileName(fileName))) {
+        return compactFileName(fileName);
+    }
+    return fileName;
+}
+
+
+//=====================================================
+
+
+/// Constructs the journal. Journaling starts with start()
+/// @param textDocument the document to journal
+/// @param fileName the name of the journal file
+/// @param parent the parent of this object
+TextDocumentJournal::TextDocumentJournal(TextDocument* textDocument, const QString& fileName, QObject* parent)
+    : QObject(parent)
+    , textDocumentRef_(textDocument)
+    , fileName_(fileName)
+    , file_(nullptr)
+    , flushTimer_(nullptr)
+    , flushInterval_(DefaultFlushInterval)
+    , flushSize_(DefaultFlushSize)
+    , compactSize_(DefaultCompactSize)
+    , journalSize_(0)
+    , recoveredSize_(0)
+    , hasPendingEdit_(false)
+    , editOffset_(0)
+    , editLength_(0)
+{
+    flushTimer_ = new QTimer(this);
+    flushTimer_->setSingleShot(true);
+    connect(flushTimer_, &QTimer::timeout, this, &TextDocumentJournal::flush);
+}
+
+
+/// Writes the pending changes and closes the journal. (The journal file is kept)
+TextDocumentJournal::~TextDocumentJournal()
+{
+    stop();
+}
+
+
+/// Returns true if the journal file exists and contains changes
+bool TextDocumentJournal::hasRecoveryData() const
+{
+    QFile file(recoveryFileName(fileName_));
+    return file.exists() && file.size() > HeaderSize;
+}
+
+
+/// Replays the journal file on the document.
+/// The document must contain the text of the last full save (the base of the journal) or it must contain
+/// a compacted journal. The changes are applied as normal (undoable) changes of the document.
+/// When journaling is started after recovering, the journal file is continued.
+/// @return true if the journal is replayed. On failure errorString() contains the reason
+bool TextDocumentJournal::recover()
+{
+    errorString_.clear();
+    if (isActive()) {
+        errorString_ = QStringLiteral("The journal is active");
+        return false;
+    }
+
+    QFile file(recoveryFileName(fileName_));
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    const uchar* begin = reinterpret_cast<const uchar*>(data.constData());
+    const uchar* end = begin + data.size();
+    if (data.size() < HeaderSize || data.left(4) != QByteArray(JournalMagic, 4) || begin[4] != JournalVersion) {
+        errorString_ = QStringLiteral("Invalid journal file");
+        return false;
+    }
+    quint8 flags = begin[5];
+    if (flags & FlagFullText) {
+        textDocumentRef_->replace(0, textDocumentRef_->length(), QString());
+    } else if (readFixed(begin + 6, 8) != textDocumentRef_->length() || readFixed(begin + 14, 8) != documentHash(textDocumentRef_)) {
+        errorString_ = QStringLiteral("The journal doesn't belong to the document");
+        return false;
+    }
+
+    // replay the records, until the end or until an incomplete record
+    const uchar* pos = begin + HeaderSize;
+    while (pos < end) {
+        const uchar* record = pos;
+        quint64 offset = 0, length = 0, byteCount = 0;
+        if (*pos++ != RecordReplace) { break; }
+        if (!readVarint(pos, end, offset) || !readVarint(pos, end, length) || !readVarint(pos, end, byteCount)) { break; }
+        if (byteCount + 4 > static_cast<quint64>(end - pos)) { break; }
+        const char* text = reinterpret_cast<const char*>(pos);
+        pos += byteCount;
+        if (readFixed(pos, 4) != recordChecksum(reinterpret_cast<const char*>(record), pos - record)) { break; }
+        pos += 4;
+        if (offset + length > textDocumentRef_->length()) { break; }
+
+        textDocumentRef_->replace(offset, length, QString::fromUtf8(text, static_cast<qsizetype>(byteCount)));
+        recoveredSize_ = pos - begin;
+    }
+    if (!recoveredSize_) { recoveredSize_ = HeaderSize; }
+
+    // continue a compacted journal in the journal file
+    if (file.fileName() != fileName_) {
+        QFile::remove(fileName_);
+        QFile::rename(file.fileName(), fileName_);
+    }
+    return true;
+}
+
+
+/// Starts journaling the changes of the document.
+/// The current document is the base of the journal: it should be equal to the saved file.
+/// (After recover() the recovered journal is continued)
+/// @return true on success. On failure errorString() contains the reason
+bool TextDocumentJournal::start()
+{
+    errorString_.clear();
+    if (isActive()) { return true; }
+
+    if (recoveredSize_) {
+        file_ = new QFile(fileName_);
+        if (!file_->open(QIODevice::ReadWrite) || !file_->resize(recoveredSize_) || !file_->seek(recoveredSize_)) {
+            errorString_ = file_->errorString();
+            close();
+            return false;
+        }
+        journalSize_ = recoveredSize_;
+        recoveredSize_ = 0;
+    } else if (!open(false)) {
+        return false;
+    }
+
+    connect(textDocumentRef_, &TextDocument::textChanged, this, &TextDocumentJournal::textChanged, Qt::DirectConnection);
+    return true;
+}
+
+
+/// Writes the pending changes and stops journaling. The journal file is kept
+/// (a pending high surrogate is written too, it can't be completed anymore)
+void TextDocumentJournal::stop()
+{
+    if (!isActive()) { return; }
+    if (hasPendingEdit_) { addPendingEdit(); }
+    flush();
+    disconnect(textDocumentRef_, &TextDocument::textChanged, this, &TextDocumentJournal::textChanged);
+    close();
+}
+
+
+/// Restarts the journal with the current document as base. Call this method after the document is saved
+/// @return true on success
+bool TextDocumentJournal::markSaved()
+{
+    errorString_.clear();
+    if (!isActive()) { return true; }
+    close();
+    return open(false);
+}
+
+
+/// Writes the pending changes to the journal file and syncs it to disk.
+/// A high surrogate at the end of the pending edit is kept until the next change or until the journal is stopped (see addPendingEdit).
+/// The journal is compacted when it's too large
+/// @return true on success
+bool TextDocumentJournal::flush()
+{
+    flushTimer_->stop();
+    if (!isActive()) { return true; }
+    if (hasPendingEdit_) { addPendingEdit(true); }
+    if (pendingBytes_.isEmpty()) { return true; }
+
+    bool result = writeBytes(file_, pendingBytes_) && sync(file_);
+    journalSize_ += pendingBytes_.size();
+    pendingBytes_.clear();
+
+    // compact the journal when it's larger than the document
+    if (result && compactSize_ > 0 && journalSize_ >= compactSize_ && static_cast<size_t>(journalSize_) > 2 * textDocumentRef_->length()) {
+        result = compact();
+    }
+    return result;
+}
+
+
+/// Replaces the journal with a journal that contains the complete text of the document.
+/// The new journal is written to a separate file, which replaces the journal when it's complete
+/// @return true on success
+bool TextDocumentJournal::compact()
+{
+    errorString_.clear();
+    if (!isActive()) { return false; }
+
+    // the pending changes are part of the text
+    flushTimer_->stop();
+    hasPendingEdit_ = false;
+    editText_.clear();
+    pendingBytes_.clear();
+
+    QFile compactFile(compactFileName(fileName_));
+    if (!compactFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString_ = compactFile.errorString();
+        return false;
+    }
+    QByteArray bytes;
+    appendHeader(bytes, FlagFullText, 0, 0);
+    TextBuffer* buffer = textDocumentRef_->buffer();
+    size_t length = buffer->length();
+    for (size_t offset = 0; offset < length; ) {
+        // UTF-8 can't encode half of a surrogate pair, a pair is never cut
+        size_t chunkLength = qMin(CompactChunkSize, length - offset);
+        if (offset + chunkLength < length && chunkLength > 1 && buffer->charAt(offset + chunkLength - 1).isHighSurrogate()) {
+            --chunkLength;
+        }
+
+        // a chunk can be split by the gap of the buffer
+        QVector<TextBufferSpan> spans = buffer->spans(offset, chunkLength);
+        if (spans.size() == 1) {
+            appendRecord(bytes, offset, 0, spans.first().data, chunkLength);
+        } else {
+            QString text = buffer->textPart(offset, chunkLength);
+            appendRecord(bytes, offset, 0, text.constData(), chunkLength);
+        }
+        offset += chunkLength;
+        if (!writeBytes(&compactFile, bytes)) { return false; }
+        bytes.clear();
+    }
+    if (!writeBytes(&compactFile, bytes) || !sync(&compactFile)) { return false; }
+    qint64 size = compactFile.size();
+    compactFile.close();
+
+    // replace the journal, and continue it
+    disconnect(textDocumentRef_, &TextDocument::textChanged, this, &TextDocumentJournal::textChanged);
+    close();
+    QFile::remove(fileName_);
+    if (!QFile::rename(compactFileName(fileName_), fileName_)) {
+        errorString_ = QStringLiteral("Unable to replace the journal file");
+        return false;
+    }
+    recoveredSize_ = size;
+    return start();
+}
+
+
+/// Stops journaling and removes the journal file. Call this method when the document is closed normally
+void TextDocumentJournal::discard()
+{
+    if (isActive()) {
+        disconnect(textDocumentRef_, &TextDocument::textChanged, this, &TextDocumentJournal::textChanged);
+        close();
+    }
+    recoveredSize_ = 0;
+    QFile::remove(fileName_);
+    QFile::remove(compactFileName(fileName_));
+}
+
+
+/// Collects a change of the document. Consecutive typing (and deleting typed text) is merged to a single record
+void TextDocumentJournal::textChanged(edbee::TextBufferChange change, QString oldText)
+{
+    Q_UNUSED(oldText);
+    if (hasPendingEdit_) {
+        size_t pendingEnd = editOffset_ + static_cast<size_t>(editText_.length());
+        if (change.length() == 0 && change.offset() == pendingEnd) {
+            editText_.append(change.newText(), static_cast<qsizetype>(change.newTextLength()));
+        } else if (change.newTextLength() == 0 && change.offset() >= editOffset_ && change.offset() + change.length() == pendingEnd) {
+            editText_.chop(static_cast<qsizetype>(change.length()));
+        } else {
+            addPendingEdit();
+        }
+    }
+    if (!hasPendingEdit_) {
+        editOffset_ = change.offset();
+        editLength_ = change.length();
+        editText_ = QString(change.newText(), static_cast<qsizetype>(change.newTextLength()));
+        hasPendingEdit_ = true;
+    }
+
+    if (pendingBytes_.size() + editText_.length() >= flushSize_) {
+        flush();
+    } else if (!flushTimer_->isActive()) {
+        flushTimer_->start(flushInterval_);
+    }
+}
+
+
+/// Creates a new journal file, with the current document as base
+/// @param fullText should the journal contain the complete text? (else the document is the base)
+bool TextDocumentJournal::open(bool fullText)
+{
+    Q_ASSERT(!file_);
+    file_ = new QFile(fileName_);
+    if (!file_->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString_ = file_->errorString();
+        close();
+        return false;
+    }
+
+    QByteArray header;
+    if (fullText) {
+        appendHeader(header, FlagFullText, 0, 0);
+    } else {
+        appendHeader(header, 0, textDocumentRef_->length(), documentHash(textDocumentRef_));
+    }
+    if (!writeBytes(file_, header) || !sync(file_)) {
+        close();
+        return false;
+    }
+    journalSize_ = header.size();
+    recoveredSize_ = 0;
+    return true;
+}
+
+
+/// Closes the journal file (the pending changes are discarded)
+void TextDocumentJournal::close()
+{
+    flushTimer_->stop();
+    hasPendingEdit_ = false;
+    editText_.clear();
+    pendingBytes_.clear();
+    delete file_;
+    file_ = nullptr;
+    journalSize_ = 0;
+}
+
+
+/// Encodes the pending edit to the pending bytes
+/// @param keepHighSurrogate when the text ends with a high surrogate, this character stays pending.
+/// UTF-8 can't encode half of a surrogate pair, and the low surrogate can be appended by the next change.
+/// A pending high surrogate is only written with a change that can't be merged, or when the journal is stopped
+void TextDocumentJournal::addPendingEdit(bool keepHighSurrogate)
+{
+    qsizetype length = editText_.length();
+    if (keepHighSurrogate && length > 0 && editText_.at(length - 1).isHighSurrogate()) {
+        if (length > 1 || editLength_ > 0) {
+            appendRecord(pendingBytes_, editOffset_, editLength_, editText_.constData(), static_cast<size_t>(length - 1));
+            editOffset_ += static_cast<size_t>(length - 1);
+            editLength_ = 0;
+            editText_ = editText_.right(1);
+        }
+        return;
+    }
+    appendRecord(pendingBytes_, editOffset_, editLength_, editText_.constData(), static_cast<size_t>(editText_.length()));
+    hasPendingEdit_ = false;
+    editText_.clear();
+}
+
+
+/// Writes the bytes to the given file
+/// @return false on failure (errorString_ contains the reason)
+bool TextDocumentJournal::writeBytes(QFile* file, const QByteArray& bytes)
+{
+    if (file->write(bytes) != bytes.size()) {
+        errorString_ = file->errorString();
+        return false;
+    }
+    return true;
+}
+
+
+/// Flushes the file and syncs it to disk
+/// @return false on failure (errorString_ contains the reason)
+bool TextDocumentJournal::sync(QFile* file)
+{
+    if (!file->flush()) {
+        errorString_ = file->errorString();
+        return false;
+    }
+#if defined(Q_OS_WIN)
+    if (_commit(file->handle()) != 0) {
+#else
+    if (::fsync(file->handle()) != 0) {
+#endif
+        errorString_ = QStringLiteral("Unable to sync the journal file");
+        return false;
+    }
+    return true;
+}
+
+
+} // edbee
@@ -0,0 +1,102 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QFile;
+class QTimer;
+
+namespace edbee {
+
+class TextBufferChange;
+class TextDocument;
+
+
+/// An append-only crash-recovery journal of a textdocument.
+///
+/// Instead of saving the complete document periodically, every change of the document text is appended
+/// to the journal file in a compact binary form. The journal starts at the last full save of the document:
+/// after a crash the document is loaded from the saved file, and recover() replays the journal.
+/// The I/O of the journal is proportional to the edits, not to the size of the document.
+///
+/// The changes are collected in memory and written (and synced to disk) in batches: when flushSize() bytes
+/// are collected or flushInterval() milliseconds after the first collected change.
+/// When the journal becomes larger than compactSize() (and larger than the document) it's compacted:
+/// it's replaced by a journal with the complete text, which doesn't depend on the saved file anymore.
+///
+/// ~~~~
+/// journal->recover();     // (optional) when the document was loaded after a crash
+/// journal->start();       // start journaling the changes
+/// ...
+/// journal->markSaved();   // after saving the document
+/// ...
+/// journal->discard();     // when the document is closed normally
+/// ~~~~
+class EDBEE_EXPORT TextDocumentJournal : public QObject
+{
+Q_OBJECT
+
+public:
+    TextDocumentJournal(TextDocument* textDocument, const QString& fileName, QObject* parent = nullptr);
+    virtual ~TextDocumentJournal();
+
+    bool hasRecoveryData() const;
+    bool recover();
+
+    bool start();
+    void stop();
+    bool markSaved();
+    bool flush();
+    bool compact();
+    void discard();
+
+    bool isActive() const { return file_ != nullptr; }
+    qint64 journalSize() const { return journalSize_ + pendingBytes_.size(); }
+
+    int flushInterval() const { return flushInterval_; }
+    void setFlushInterval(int msecs) { flushInterval_ = msecs; }
+    int flushSize() const { return flushSize_; }
+    void setFlushSize(int bytes) { flushSize_ = bytes; }
+    qint64 compactSize() const { return compactSize_; }
+    void setCompactSize(qint64 bytes) { compactSize_ = bytes; }
+
+    QString fileName() const { return fileName_; }
+    TextDocument* textDocument() const { return textDocumentRef_; }
+    QString errorString() const { return errorString_; }
+
+protected slots:
+    void textChanged(edbee::TextBufferChange change, QString oldText);
+
+private:
+    bool open(bool fullText);
+    void close();
+    void addPendingEdit(bool keepHighSurrogate = false);
+    bool writeBytes(QFile* file, const QByteArray& bytes);
+    bool sync(QFile* file);
+
+    TextDocument* textDocumentRef_;     ///< The journaled document
+    QString fileName_;                  ///< The name of the journal file
+    QFile* file_;                       ///< The journal file, while journaling
+    QTimer* flushTimer_;                ///< Flushes the pending changes
+    QString errorString_;               ///< The last error
+
+    int flushInterval_;                 ///< The maximum time (msecs) a change stays in memory
+    int flushSize_;                     ///< The number of pending bytes that forces a flush
+    qint64 compactSize_;                ///< The minimal journal size for compaction
+    qint64 journalSize_;                ///< The number of bytes written to the journal file
+    qint64 recoveredSize_;              ///< The size of the valid part of the journal, after recovering it (0 when not recovered)
+
+    QByteArray pendingBytes_;           ///< The encoded records that aren't written yet
+    bool hasPendingEdit_;               ///< Is there an edit that isn't encoded yet? (consecutive edits are merged)
+    size_t editOffset_;                 ///< The offset of the pending edit
+    size_t editLength_;                 ///< The number of replaced characters of the pending edit
+    QString editText_;                  ///< The new text of the pending edit
+};
+
+} // edbee
@@ -0,0 +1,373 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentloader.h"
+
+#include <atomic>
+
+#include <QFile>
+#include <QIODevice>
+#include <QMutexLocker>
+#include <QTextCodec>
+#include <QThread>
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textdocument.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/util/lineending.h"
+#include "edbee/util/textcodec.h"
+#include "edbee/util/textcodecdetector.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const qint64 FirstBlockSize = 16 * 1024;             ///< The size of the first block. Small, to show the first screen fast
+static const qint64 BlockSize = 256 * 1024;                 ///< The size of the other blocks
+static const size_t DefaultBatchSize = 512 * 1024;          ///< The default number of characters appended per event loop iteration
+static const size_t MinimumBatchSize = 1024;                ///< The minimal batch size
+static const qint64 DetectSize = 8;                         ///< The minimal number of bytes to detect the encoding (else the preferred codec is used)
+
+
+/// Translates the windows line endings to '\n'
+static void translateLineEndings(QString& text)
+{
+    if (text.contains('\r')) {
+        text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+}
+
+
+//=====================================================
+
+
+/// The background thread that reads and decodes the device of the loader.
+/// The decoded blocks are added to the pending blocks of the loader, which are published in the gui thread
+class TextDocumentLoaderThread : public QThread
+{
+public:
+    TextDocumentLoaderThread(TextDocumentLoader* loader)
+        : loaderRef_(loader)
+        , stopRequested_(false)
+    {
+    }
+
+    /// Requests the thread to stop. (Use wait to wait for it)
+    void requestStop() { stopRequested_ = true; }
+
+protected:
+    virtual void run();
+    void addBlock(const QString& text, qint64 bytes, TextCodec* codec, const LineEnding* lineEnding, const QString& errorString, bool finished);
+
+private:
+    TextDocumentLoader* loaderRef_;          ///< The loader
+    std::atomic<bool> stopRequested_;        ///< Is a stop requested
+};
+
+
+/// Reads the device in blocks.
+/// The last character of every block is held back and prepended to the next block. This way a "\r\n" is never split,
+/// and the last block always contains text (so the final change of the document is never empty)
+void TextDocumentLoaderThread::run()
+{
+    QIODevice* ioDevice = loaderRef_->ioDeviceRef_;
+    TextCodec* codec = nullptr;
+    TextDecoder* decoder = nullptr;
+    const LineEnding* lineEnding = nullptr;
+    QString errorString;
+    QString remaining;
+    QByteArray bytes;
+    qint64 bytesTotal = 0;
+    qint64 blockSize = FirstBlockSize;
+
+    while (!stopRequested_) {
+        bytes.resize(static_cast<int>(blockSize));
+        qint64 bytesRead = ioDevice->read(bytes.data(), blockSize);
+        if (bytesRead < 0) { errorString = ioDevice->errorString(); }
+        if (bytesRead <= 0) break;
+        bytesTotal += bytesRead;
+
+        // the first block is used to detect the encoding
+        if (!codec) {
+            if (bytesRead > DetectSize) {
+                TextCodecDetector codecDetector(bytes.constData(), static_cast<size_t>(bytesRead));
+                codec = codecDetector.detectCodec();
+            } else {
+                codec = TextCodecDetector::globalPreferedCodec();
+            }
+            Q_ASSERT(codec);
+            decoder = codec->makeTextDecoder();
+        }
+
+        QString text = remaining;
+        decoder->toUnicode(bytes.constData(), static_cast<int>(bytesRead), text);
+        if (!lineEnding) {
+            lineEnding = LineEnding::detect(text);
+        }
+
+        // hold back the last character (or surrogate pair), a '\r' can be followed by a '\n' in the next block
+        translateLineEndings(text);
+        qsizetype holdBack = text.isEmpty() ? 0 : 1;
+        if (text.length() > 1 && text.at(text.length() - 1).isLowSurrogate() && text.at(text.length() - 2).isHighSurrogate()) { holdBack = 2; }
+        remaining = text.right(holdBack);
+        text.chop(holdBack);
+
+        addBlock(text, bytesTotal, codec, lineEnding, QString(), false);
+        blockSize = BlockSize;
+    }
+    delete decoder;
+
+    translateLineEndings(remaining);
+    addBlock(remaining, bytesTotal, codec, lineEnding, errorString, true);
+}
+
+
+/// Adds a decoded block to the pending blocks and requests the loader to publish them
+void TextDocumentLoaderThread::addBlock(const QString& text, qint64 bytes, TextCodec* codec, const LineEnding* lineEnding, const QString& errorString, bool finished)
+{
+    if (stopRequested_) return;
+
+    bool requestPublish = false;
+    {
+        QMutexLocker locker(&loaderRef_->mutex_);
+        if (!text.isEmpty() || finished) {
+            TextDocumentLoadedBlock block;
+            block.text = text;
+            block.bytes = bytes;
+            loaderRef_->pendingBlocks_.enqueue(block);
+        }
+        loaderRef_->pendingCodecRef_ = codec;
+        loaderRef_->pendingLineEndingRef_ = lineEnding;
+        loaderRef_->pendingErrorString_ = errorString;
+        loaderRef_->threadFinished_ = finished;
+        requestPublish = !loaderRef_->publishRequested_;
+        loaderRef_->publishRequested_ = true;
+    }
+
+    if (requestPublish) {
+        QMetaObject::invokeMethod(loaderRef_, "publishLoadedBlocks", Qt::QueuedConnection);
+    }
+}
+
+
+//=====================================================
+
+
+/// Constructs the loader
+/// @param textDocument the document to load the file into
+/// @param parent the parent of this object
+TextDocumentLoader::TextDocumentLoader(TextDocument* textDocument, QObject* parent)
+    : QObject(parent)
+    , textDocumentRef_(textDocument)
+    , ioDeviceRef_(nullptr)
+    , file_(nullptr)
+    , closeDevice_(false)
+    , batchSize_(DefaultBatchSize)
+    , loading_(false)
+    , undoCollectionEnabled_(true)
+    , lexerSuspended_(false)
+    , loadedBytes_(0)
+    , totalBytes_(0)
+    , thread_(nullptr)
+    , pendingCodecRef_(nullptr)
+    , pendingLineEndingRef_(nullptr)
+    , threadFinished_(false)
+    , publishRequested_(false)
+{
+}
+
+
+/// Stops the loading (without emitting the finished signal)
+TextDocumentLoader::~TextDocumentLoader()
+{
+    if (loading_) {
+        stopThread();
+        TextLexer* lexer = textDocumentRef_->textLexer();
+        if (lexer) { lexer->setSuspended(lexerSuspended_); }
+        textDocumentRef_->setUndoCollectionEnabled(undoCollectionEnabled_);
+        if (closeDevice_) { ioDeviceRef_->close(); }
+    }
+    delete file_;
+}
+
+
+/// Starts loading the given device. The text is appended to the end of the document.
+/// This method returns directly, the finished signal is emitted when the complete device is loaded.
+/// The device must not be used by the caller while it's loaded.
+/// @param ioDevice the device to load. When it isn't open, it's opened (and closed after loading)
+/// @return true if the loading is started. On failure errorString() contains the reason
+bool TextDocumentLoader::load(QIODevice* ioDevice)
+{
+    errorString_.clear();
+    if (loading_) {
+        errorString_ = QStringLiteral("The loader is already loading");
+        return false;
+    }
+
+    closeDevice_ = false;
+    if (!ioDevice->isOpen()) {
+        if (!ioDevice->open(QIODevice::ReadOnly)) {
+            errorString_ = ioDevice->errorString();
+            return false;
+        }
+        closeDevice_ = true;
+    }
+    ioDeviceRef_ = ioDevice;
+    totalBytes_ = ioDevice->isSequential() ? 0 : ioDevice->size();
+    loadedBytes_ = 0;
+
+    pendingBlocks_.clear();
+    pendingCodecRef_ = nullptr;
+    pendingLineEndingRef_ = nullptr;
+    pendingErrorString_.clear();
+    threadFinished_ = false;
+    publishRequested_ = false;
+
+    // suspend the undo collection and the lexer
+    undoCollectionEnabled_ = textDocumentRef_->isUndoCollectionEnabled();
+    textDocumentRef_->setUndoCollectionEnabled(false);
+    TextLexer* lexer = textDocumentRef_->textLexer();
+    if (lexer) {
+        lexerSuspended_ = lexer->isSuspended();
+        lexer->setSuspended(true);
+    }
+
+    loading_ = true;
+    thread_ = new TextDocumentLoaderThread(this);
+    thread_->start(QThread::LowPriority);
+    return true;
+}
+
+
+/// Starts loading the given file
+/// @param fileName the name of the file to load
+/// @return true if the loading is started. On failure errorString() contains the reason
+bool TextDocumentLoader::load(const QString& fileName)
+{
+    if (loading_) {
+        errorString_ = QStringLiteral("The loader is already loading");
+        return false;
+    }
+    delete file_;
+    file_ = new QFile(fileName);
+    return load(file_);
+}
+
+
+/// Cancels the loading. The already loaded text stays in the document.
+/// The finished signal is emitted (with success false)
+void TextDocumentLoader::cancel()
+{
+    if (!loading_) return;
+    stopThread();
+    errorString_ = QStringLiteral("Loading canceled");
+    finish();
+}
+
+
+/// Blocks until the complete device is loaded and appends all loaded text
+void TextDocumentLoader::waitForFinished()
+{
+    if (!thread_) return;
+    thread_->wait();
+    while (loading_) {
+        publishLoadedBlocks();
+    }
+}
+
+
+/// Sets the maximum number of characters that are appended in a single event loop iteration
+void TextDocumentLoader::setBatchSize(size_t size)
+{
+    batchSize_ = qMax(size, MinimumBatchSize);
+}
+
+
+/// Appends a batch of loaded blocks to the document.
+/// When more blocks are pending, the next batch is appended in the next event loop iteration
+void TextDocumentLoader::publishLoadedBlocks()
+{
+    QString text;
+    qint64 bytes = -1;
+    TextCodec* codec = nullptr;
+    const LineEnding* lineEnding = nullptr;
+    bool finished = false;
+    bool more = false;
+    {
+        QMutexLocker locker(&mutex_);
+        publishRequested_ = false;
+        if (!loading_) return;
+
+        while (!pendingBlocks_.isEmpty() && (text.isEmpty() || static_cast<size_t>(text.length() + pendingBlocks_.head().text.length()) <= batchSize_)) {
+            TextDocumentLoadedBlock block = pendingBlocks_.dequeue();
+            text.append(block.text);
+            bytes = block.bytes;
+        }
+        codec = pendingCodecRef_;
+        lineEnding = pendingLineEndingRef_;
+        finished = threadFinished_ && pendingBlocks_.isEmpty();
+        more = !pendingBlocks_.isEmpty();
+        publishRequested_ = more;
+        if (finished) { errorString_ = pendingErrorString_; }
+    }
+
+    if (finished) {
+        if (!codec) { codec = TextCodecDetector::globalPreferedCodec(); }
+        if (!lineEnding) { lineEnding = LineEnding::get(LineEnding::UnixType); }
+
+        // resume the lexer before the last change, so the visible lines are lexed when they are repainted
+        TextLexer* lexer = textDocumentRef_->textLexer();
+        if (lexer) { lexer->setSuspended(lexerSuspended_); }
+    }
+    if (codec) { textDocumentRef_->setEncoding(codec); }
+    if (lineEnding) { textDocumentRef_->setLineEnding(lineEnding); }
+
+    if (!text.isEmpty()) {
+        textDocumentRef_->buffer()->appendText(text);
+    }
+    if (bytes >= 0) {
+        loadedBytes_ = bytes;
+        emit progress(loadedBytes_, totalBytes_);
+    }
+
+    if (finished) {
+        finish();
+    } else if (more) {
+        QMetaObject::invokeMethod(this, "publishLoadedBlocks", Qt::QueuedConnection);
+    }
+}
+
+
+/// Stops and deletes the thread
+void TextDocumentLoader::stopThread()
+{
+    if (!thread_) return;
+    thread_->requestStop();
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+
+    QMutexLocker locker(&mutex_);
+    pendingBlocks_.clear();
+}
+
+
+/// Restores the state of the document and emits the finished signal
+void TextDocumentLoader::finish()
+{
+    stopThread();
+
+    TextLexer* lexer = textDocumentRef_->textLexer();
+    if (lexer) { lexer->setSuspended(lexerSuspended_); }
+    textDocumentRef_->setUndoCollectionEnabled(undoCollectionEnabled_);
+
+    if (closeDevice_) { ioDeviceRef_->close(); }
+    ioDeviceRef_ = nullptr;
+    closeDevice_ = false;
+    loading_ = false;
+
+    emit finished(errorString_.isEmpty());
+}
+
+
+} // edbee
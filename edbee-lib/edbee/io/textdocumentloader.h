@@ -0,0 +1,102 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+
+class QFile;
+class QIODevice;
+
+namespace edbee {
+
+class LineEnding;
+class TextCodec;
+class TextDocument;
+class TextDocumentLoaderThread;
+
+
+/// A block of text, read and decoded by the loader thread
+struct TextDocumentLoadedBlock {
+    QString text;       ///< The decoded text (with "\r\n" translated to "\n")
+    qint64 bytes;       ///< The number of bytes of the file read until (and including) this block
+};
+
+
+/// Loads a file asynchronously into a textdocument.
+///
+/// A background thread reads and decodes the file. The decoded text is appended to the end
+/// of the document in batches of (at most) batchSize() characters, a single batch per event loop
+/// iteration. Every batch is a normal change of the document, so the editor can render and scroll
+/// the already loaded part of the document while the rest of the file is loaded.
+///
+/// While loading, the undo collection and the lexer of the document are suspended.
+/// Both are restored when the loading is finished (or canceled).
+/// The encoding and line ending are detected like the TextDocumentSerializer does.
+class EDBEE_EXPORT TextDocumentLoader : public QObject
+{
+Q_OBJECT
+
+public:
+    TextDocumentLoader(TextDocument* textDocument, QObject* parent = nullptr);
+    virtual ~TextDocumentLoader();
+
+    bool load(QIODevice* ioDevice);
+    bool load(const QString& fileName);
+    void cancel();
+
+    bool isLoading() const { return loading_; }
+    void waitForFinished();
+
+    size_t batchSize() const { return batchSize_; }
+    void setBatchSize(size_t size);
+
+    qint64 loadedBytes() const { return loadedBytes_; }
+    qint64 totalBytes() const { return totalBytes_; }
+
+    TextDocument* textDocument() const { return textDocumentRef_; }
+    QString errorString() const { return errorString_; }
+
+signals:
+    void progress(qint64 loadedBytes, qint64 totalBytes);
+    void finished(bool success);
+
+protected slots:
+    void publishLoadedBlocks();
+
+private:
+    void stopThread();
+    void finish();
+
+    friend class TextDocumentLoaderThread;
+
+    TextDocument* textDocumentRef_;          ///< The document the file is loaded into
+    QIODevice* ioDeviceRef_;                 ///< The device that's loaded
+    QFile* file_;                            ///< The file, when loading a file by name
+    bool closeDevice_;                       ///< Should the device be closed after loading?
+    size_t batchSize_;                       ///< The maximum number of characters appended per event loop iteration
+    bool loading_;                           ///< Is the loader loading?
+    bool undoCollectionEnabled_;             ///< The undo collection state before loading
+    bool lexerSuspended_;                    ///< The lexer state before loading
+    qint64 loadedBytes_;                     ///< The number of bytes appended to the document
+    qint64 totalBytes_;                      ///< The size of the device
+    QString errorString_;                    ///< The last error
+
+    TextDocumentLoaderThread* thread_;       ///< The background reader
+
+    // the results of the thread, that aren't published yet (protected by the mutex)
+    QMutex mutex_;                           ///< The mutex for the loaded blocks
+    QQueue<TextDocumentLoadedBlock> pendingBlocks_; ///< The loaded blocks
+    TextCodec* pendingCodecRef_;             ///< The detected encoding
+    const LineEnding* pendingLineEndingRef_; ///< The detected line ending
+    QString pendingErrorString_;             ///< The read error
+    bool threadFinished_;                    ///< Is the thread finished?
+    bool publishRequested_;                  ///< Is a publish call already pending?
+};
+
+} // edbee
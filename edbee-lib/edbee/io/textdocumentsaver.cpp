@@ -0,0 +1,205 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentsaver.h"
+
+#include <QIODevice>
+#include <QSaveFile>
+#include <QThread>
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textdocument.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// The background thread that writes the snapshot of the saver
+class TextDocumentSaverThread : public QThread
+{
+public:
+    TextDocumentSaverThread(TextDocumentSaver* saver, quint64 generation)
+        : saverRef_(saver)
+        , generation_(generation)
+    {
+    }
+
+protected:
+    /// Writes the snapshot and notifies the saver (in its own thread)
+    virtual void run()
+    {
+        saverRef_->serializer_.saveSnapshotWithoutOpening(saverRef_->ioDeviceRef_, saverRef_->snapshot_, saverRef_->codecRef_, saverRef_->lineEndingRef_);
+        QMetaObject::invokeMethod(saverRef_, "threadFinished", Qt::QueuedConnection, Q_ARG(quint64, generation_));
+    }
+
+private:
+    TextDocumentSaver* saverRef_;            ///< The saver
+    quint64 generation_;                     ///< The save this thread writes
+};
+
+
+//=====================================================
+
+
+/// Constructs the saver
+/// @param textDocument the document to save
+/// @param parent the parent of this object
+TextDocumentSaver::TextDocumentSaver(TextDocument* textDocument, QObject* parent)
+    : QObject(parent)
+    , textDocumentRef_(textDocument)
+    , ioDeviceRef_(nullptr)
+    , file_(nullptr)
+    , closeDevice_(false)
+    , saving_(false)
+    , generation_(0)
+    , serializer_(textDocument)
+    , codecRef_(nullptr)
+    , lineEndingRef_(nullptr)
+    , thread_(nullptr)
+{
+}
+
+
+/// Stops the saving (without emitting the finished signal)
+/// A file that's saved by name is left untouched
+TextDocumentSaver::~TextDocumentSaver()
+{
+    if (saving_) {
+        stopThread();
+        if (closeDevice_) { ioDeviceRef_->close(); }
+    }
+    delete file_;   // discards the written data when it isn't committed
+}
+
+
+/// Starts saving the document to the given device.
+/// This method returns directly, the finished signal is emitted when the complete document is written.
+/// The device must not be used by the caller while it's written.
+/// @param ioDevice the device to write. When it isn't open, it's opened (and closed after saving)
+/// @return true if the saving is started. On failure errorString() contains the reason
+bool TextDocumentSaver::save(QIODevice* ioDevice)
+{
+    errorString_.clear();
+    if (saving_) {
+        errorString_ = QStringLiteral("The saver is already saving");
+        return false;
+    }
+
+    closeDevice_ = false;
+    if (!ioDevice->isOpen()) {
+        if (!ioDevice->open(QIODevice::WriteOnly)) {
+            errorString_ = ioDevice->errorString();
+            return false;
+        }
+        closeDevice_ = true;
+    }
+    ioDeviceRef_ = ioDevice;
+
+    // the snapshot is taken in this thread, the thread only uses the snapshot
+    snapshot_ = textDocumentRef_->buffer()->snapshot();
+    codecRef_ = textDocumentRef_->encoding();
+    lineEndingRef_ = textDocumentRef_->lineEnding();
+
+    saving_ = true;
+    ++generation_;
+    serializer_.resetStopRequest();
+    thread_ = new TextDocumentSaverThread(this, generation_);
+    thread_->start(QThread::LowPriority);
+    return true;
+}
+
+
+/// Starts saving the document to the given file
+/// The document is written to a temporary file, which replaces the file when the save succeeds.
+/// A canceled or failed save leaves the file untouched.
+/// @param fileName the name of the file to write
+/// @return true if the saving is started. On failure errorString() contains the reason
+bool TextDocumentSaver::save(const QString& fileName)
+{
+    if (saving_) {
+        errorString_ = QStringLiteral("The saver is already saving");
+        return false;
+    }
+    delete file_;
+    file_ = new QSaveFile(fileName);
+    if (!file_->open(QIODevice::WriteOnly)) {
+        errorString_ = file_->errorString();
+        delete file_;
+        file_ = nullptr;
+        return false;
+    }
+    if (!save(file_)) {
+        delete file_;
+        file_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+
+/// Cancels the saving. The finished signal is emitted (with success false)
+void TextDocumentSaver::cancel()
+{
+    if (!saving_) return;
+    stopThread();
+    errorString_ = QStringLiteral("Saving canceled");
+    finish();
+}
+
+
+/// Blocks until the complete document is written
+void TextDocumentSaver::waitForFinished()
+{
+    if (!thread_) return;
+    thread_->wait();
+    threadFinished(generation_);
+}
+
+
+/// Called when the thread is finished
+/// @param generation the save the thread has written. The (queued) notification of an earlier save is ignored
+void TextDocumentSaver::threadFinished(quint64 generation)
+{
+    if (!saving_ || generation != generation_) return;
+    errorString_ = serializer_.errorString();
+    finish();
+}
+
+
+/// Stops and deletes the thread
+void TextDocumentSaver::stopThread()
+{
+    if (!thread_) return;
+    serializer_.requestStop();
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+}
+
+
+/// Closes the device and emits the finished signal
+void TextDocumentSaver::finish()
+{
+    stopThread();
+
+    if (closeDevice_) { ioDeviceRef_->close(); }
+    if (file_) {
+        if (errorString_.isEmpty()) {
+            if (!file_->commit()) { errorString_ = file_->errorString(); }
+        } else {
+            file_->cancelWriting();
+        }
+        delete file_;
+        file_ = nullptr;
+    }
+    ioDeviceRef_ = nullptr;
+    closeDevice_ = false;
+    snapshot_ = TextBufferSnapshot(TextRope(), snapshot_.version());  // release the text, keep the saved version
+    saving_ = false;
+
+    emit finished(errorString_.isEmpty());
+}
+
+
+} // edbee
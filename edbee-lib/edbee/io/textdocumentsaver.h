@@ -0,0 +1,88 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QObject>
+#include <QString>
+
+#include "edbee/io/textdocumentserializer.h"
+#include "edbee/models/textbuffersnapshot.h"
+
+class QSaveFile;
+class QIODevice;
+
+namespace edbee {
+
+class LineEnding;
+class TextCodec;
+class TextDocument;
+class TextDocumentSaverThread;
+
+
+/// Saves a textdocument asynchronously.
+///
+/// When saving is started, a snapshot of the buffer is taken. A background thread encodes and writes
+/// this snapshot, so the document can be changed (and the gui stays responsive) while a large file is saved.
+/// The encoding and line ending of the document at the start of the save are used.
+///
+/// The filter of the saver (when set) is called from the background thread.
+/// When saving to a file by name, the file is only replaced when the complete document is written.
+/// A canceled save to a device leaves a partially written device.
+class EDBEE_EXPORT TextDocumentSaver : public QObject
+{
+Q_OBJECT
+
+public:
+    TextDocumentSaver(TextDocument* textDocument, QObject* parent = nullptr);
+    virtual ~TextDocumentSaver();
+
+    bool save(QIODevice* ioDevice);
+    bool save(const QString& fileName);
+    void cancel();
+
+    bool isSaving() const { return saving_; }
+    void waitForFinished();
+
+    void setFilter(TextDocumentSerializerFilter* filter) { serializer_.setFilter(filter); }
+    TextDocumentSerializerFilter* filter() { return serializer_.filter(); }
+    /// The number of characters encoded at once, this may only be changed when not saving
+    void setSaveBlockSize(size_t size) { serializer_.setSaveBlockSize(size); }
+    size_t saveBlockSize() const { return serializer_.saveBlockSize(); }
+
+    /// Returns the version of the buffer that is saved (or being saved)
+    quint64 savedVersion() const { return snapshot_.version(); }
+
+    TextDocument* textDocument() const { return textDocumentRef_; }
+    QString errorString() const { return errorString_; }
+
+signals:
+    void finished(bool success);
+
+protected slots:
+    void threadFinished(quint64 generation);
+
+private:
+    void stopThread();
+    void finish();
+
+    friend class TextDocumentSaverThread;
+
+    TextDocument* textDocumentRef_;          ///< The document that's saved
+    QIODevice* ioDeviceRef_;                 ///< The device that's written
+    QSaveFile* file_;                        ///< The file, when saving a file by name
+    bool closeDevice_;                       ///< Should the device be closed after saving?
+    bool saving_;                            ///< Is the saver saving?
+    quint64 generation_;                     ///< The number of the current save (a finished thread of an earlier save is ignored)
+    QString errorString_;                    ///< The last error
+
+    TextDocumentSerializer serializer_;      ///< The serializer that writes the snapshot (used by the thread)
+    TextBufferSnapshot snapshot_;            ///< The text that's saved
+    TextCodec* codecRef_;                    ///< The encoding of the file
+    const LineEnding* lineEndingRef_;        ///< The line ending of the file
+    TextDocumentSaverThread* thread_;        ///< The background writer
+};
+
+} // edbee
@@ -0,0 +1,384 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentscopesserializer.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include "edbee/edbee.h"
+#include "edbee/models/textdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/util/hash64.h"
+#include "edbee/util/regexp.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+// The scopes are stored as unsigned varints and UTF-8 strings (a varint length followed by the bytes):
+//   grammar count, for every grammar: name  rule count  fingerprint
+//   scope name count, for every scope: name
+//   multi-line range count, for every range: anchor  caret  scope  grammar  rule index + 1  has end regexp  (end regexp)
+//   line count, for every line: range count + 1 (0 for a line without scopes)  independent
+//       for every range: multi-line range reference  anchor  caret  scope
+//   last scoped offset
+// The first grammar is the grammar of the document. A line range references a multi-line range with
+// 0 (none), 1 (the default range) or the index of the multi-line range + 2.
+
+
+/// Appends an unsigned integer in 7-bit groups (the high bit marks a next group)
+static void appendVarint(QByteArray& target, quint64 value)
+{
+    while (value >= 0x80) {
+        target.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    target.append(static_cast<char>(value));
+}
+
+
+/// Appends the length and the UTF-8 bytes of the given string
+static void appendString(QByteArray& target, const QString& str)
+{
+    QByteArray bytes = str.toUtf8();
+    appendVarint(target, static_cast<quint64>(bytes.size()));
+    target.append(bytes);
+}
+
+
+/// Reads the values written by appendVarint and appendString.
+/// Reading beyond the end of the data invalidates the reader (and returns zeros)
+class ScopesReader {
+public:
+    ScopesReader(const uchar* data, const uchar* end) : pos_(data), end_(end), valid_(true) {}
+
+    quint64 readVarint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; pos_ < end_ && shift < 64; shift += 7) {
+            uchar byte = *pos_++;
+            value |= static_cast<quint64>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) { return value; }
+        }
+        valid_ = false;
+        return 0;
+    }
+
+    QString readString()
+    {
+        quint64 length = readVarint();
+        if (length > static_cast<quint64>(end_ - pos_)) {
+            valid_ = false;
+            return QString();
+        }
+        QString result = QString::fromUtf8(reinterpret_cast<const char*>(pos_), static_cast<qsizetype>(length));
+        pos_ += length;
+        return result;
+    }
+
+    bool isValid() const { return valid_; }
+
+private:
+    const uchar* pos_;          ///< The current read position
+    const uchar* end_;          ///< The end of the data
+    bool valid_;                ///< Is all data read succesfully?
+};
+
+
+/// The rules of a grammar, in a fixed order. This order is used to store references to grammar rules
+struct GrammarRuleIndex {
+    TextGrammar* grammar;
+    QVector<TextGrammarRule*> rules;
+    QHash<TextGrammarRule*, quint64> indices;
+    quint64 fingerprint;        ///< The hash of the rule definitions, to detect a changed grammar
+};
+
+
+/// Adds the rule and all its child rules (depth first)
+static void collectRules(TextGrammarRule* rule, GrammarRuleIndex& result)
+{
+    if (!rule || result.indices.contains(rule)) { return; }
+    result.indices.insert(rule, static_cast<quint64>(result.rules.size()));
+    result.rules.append(rule);
+    for (qsizetype i = 0, cnt = rule->ruleCount(); i < cnt; ++i) {
+        collectRules(rule->rule(i), result);
+    }
+}
+
+
+/// Collects the rules of the grammar: the tree of the main rule, followed by the repository rules (sorted by name)
+static void indexGrammarRules(TextGrammar* grammar, GrammarRuleIndex& result)
+{
+    result.grammar = grammar;
+    collectRules(grammar->mainRule(), result);
+    for (TextGrammarRule* rule : grammar->reposRules()) {
+        collectRules(rule, result);
+    }
+
+    Hash64 hash;
+    for (TextGrammarRule* rule : result.rules) {
+        QString definition = QString::number(static_cast<int>(rule->instruction())) + QLatin1Char('|') + rule->scopeName() + QLatin1Char('|') + rule->contentScopeName() + QLatin1Char('|')
+            + (rule->matchRegExp() ? rule->matchRegExp()->pattern() : QString()) + QLatin1Char('|') + rule->endRegExpString() + QLatin1Char('|');
+        hash.add(definition.constData(), static_cast<size_t>(definition.size()));
+    }
+    result.fingerprint = hash.result();
+}
+
+
+/// Constructs the serializer for the scopes of the given document
+/// @param textDocument the document with the scopes to save or restore
+TextDocumentScopesSerializer::TextDocumentScopesSerializer(TextDocument* textDocument)
+    : textDocumentRef_(textDocument)
+    , grammarChangeAllowed_(true)
+{
+}
+
+
+/// Returns the scopes of the document in binary form.
+/// @return the scopes or an empty bytearray when the document has no grammar
+QByteArray TextDocumentScopesSerializer::save()
+{
+    QByteArray target;
+    TextDocument* doc = textDocumentRef_;
+    TextDocumentScopes* scopes = doc->scopes();
+    TextGrammar* docGrammar = doc->languageGrammar();
+    if (!scopes || !docGrammar) { return target; }
+
+    QVector<GrammarRuleIndex> grammars;
+    QHash<TextGrammar*, quint64> grammarIndices;
+    QStringList scopeNames;
+    QHash<TextScope*, quint64> scopeIndices;
+
+    auto grammarIndex = [&](TextGrammar* grammar) -> quint64 {
+        if (grammarIndices.contains(grammar)) { return grammarIndices.value(grammar); }
+        grammars.append(GrammarRuleIndex());
+        indexGrammarRules(grammar, grammars.last());
+        grammarIndices.insert(grammar, static_cast<quint64>(grammars.size() - 1));
+        return static_cast<quint64>(grammars.size() - 1);
+    };
+    auto scopeIndex = [&](TextScope* scope) -> quint64 {
+        if (scopeIndices.contains(scope)) { return scopeIndices.value(scope); }
+        scopeNames.append(scope->name());
+        scopeIndices.insert(scope, static_cast<quint64>(scopeNames.size() - 1));
+        return static_cast<quint64>(scopeNames.size() - 1);
+    };
+    grammarIndex(docGrammar);
+
+    // the multi-line ranges
+    QByteArray ranges;
+    MultiLineScopedTextRangeSet* rangeSet = scopes->multiLineScopedRangeSet();
+    QHash<MultiLineScopedTextRange*, quint64> rangeIndices;
+    appendVarint(ranges, rangeSet->rangeCount());
+    for (size_t i = 0, cnt = rangeSet->rangeCount(); i < cnt; ++i) {
+        MultiLineScopedTextRange& range = rangeSet->scopedRange(i);
+        rangeIndices.insert(&range, i);
+        appendVarint(ranges, range.anchor());
+        appendVarint(ranges, range.caret());
+        appendVarint(ranges, scopeIndex(range.scope()));
+
+        TextGrammarRule* rule = range.grammarRule();
+        quint64 grammar = rule && rule->grammar() ? grammarIndex(rule->grammar()) : 0;
+        appendVarint(ranges, grammar);
+        appendVarint(ranges, rule && rule->grammar() ? grammars.at(static_cast<qsizetype>(grammar)).indices.value(rule) + 1 : 0);
+
+        RegExp* endRegExp = range.endRegExp();
+        appendVarint(ranges, endRegExp ? 1 : 0);
+        if (endRegExp) { appendString(ranges, endRegExp->pattern()); }
+    }
+
+    // the line scopes
+    // the stale lines after a change aren't written, these lines reference ranges that aren't in the range set
+    MultiLineScopedTextRange* defaultRange = &scopes->defaultScopedRange();
+    size_t scopedLineCount = scopes->scopedLineCount();
+    if (scopes->hasStaleScopes()) {
+        scopedLineCount = qMin(scopedLineCount, scopes->textDocument()->lineFromOffset(scopes->lastScopedOffset()));
+    }
+    appendVarint(ranges, scopedLineCount);
+    for (size_t line = 0; line < scopedLineCount; ++line) {
+        ScopedTextRangeList* list = scopes->scopedRangesAtLine(line);
+        if (!list) {
+            appendVarint(ranges, 0);
+            continue;
+        }
+        appendVarint(ranges, list->size() + 1);
+        appendVarint(ranges, list->isIndependent() ? 1 : 0);
+        for (size_t i = 0, cnt = list->size(); i < cnt; ++i) {
+            ScopedTextRange* range = list->at(i);
+            MultiLineScopedTextRange* multiRange = range->multiLineScopedTextRange();
+            quint64 reference = 0;
+            if (multiRange == defaultRange) {
+                reference = 1;
+            } else if (multiRange && rangeIndices.contains(multiRange)) {
+                reference = rangeIndices.value(multiRange) + 2;
+            }
+            appendVarint(ranges, reference);
+            appendVarint(ranges, range->anchor());
+            appendVarint(ranges, range->caret());
+            appendVarint(ranges, scopeIndex(range->scope()));
+        }
+    }
+    appendVarint(ranges, scopes->lastScopedOffset());
+
+    // the tables, followed by the ranges
+    appendVarint(target, static_cast<quint64>(grammars.size()));
+    for (const GrammarRuleIndex& grammar : grammars) {
+        appendString(target, grammar.grammar->name());
+        appendVarint(target, static_cast<quint64>(grammar.rules.size()));
+        appendVarint(target, grammar.fingerprint);
+    }
+    appendVarint(target, static_cast<quint64>(scopeNames.size()));
+    for (const QString& name : scopeNames) {
+        appendString(target, name);
+    }
+    target.append(ranges);
+    return target;
+}
+
+
+/// Restores the scopes of the document. The scopes aren't changed when the data is invalid, or when
+/// a grammar isn't available or has been changed.
+///
+/// With an offset limit only the scopes before this offset are restored, for a document of which only
+/// the text before the limit is the same as the text of the saved scopes. The lexer continues from the limit.
+///
+/// @param data the saved scopes
+/// @param size the number of bytes of data
+/// @param offsetLimit the start of the first line that may have been changed (npos to restore all scopes)
+/// @return true if the scopes are restored
+bool TextDocumentScopesSerializer::restore(const uchar* data, qint64 size, size_t offsetLimit)
+{
+    TextDocument* doc = textDocumentRef_;
+    TextDocumentScopes* scopes = doc->scopes();
+    if (!scopes) { return false; }
+    size_t length = doc->length();
+    bool limited = offsetLimit < length;
+    size_t lineLimit = limited ? doc->lineFromOffset(offsetLimit) : doc->lineCount();
+    ScopesReader reader(data, data + size);
+
+    // the grammars, the first one is the grammar of the document
+    QVector<GrammarRuleIndex> grammars(static_cast<qsizetype>(qMin<quint64>(reader.readVarint(), static_cast<quint64>(size))));
+    for (GrammarRuleIndex& grammarRules : grammars) {
+        QString name = reader.readString();
+        quint64 ruleCount = reader.readVarint();
+        quint64 fingerprint = reader.readVarint();
+        TextGrammar* grammar = doc->languageGrammar();
+        if (!grammar || grammar->name() != name) {
+            grammar = Edbee::instance()->grammarManager()->get(name);
+        }
+        if (!reader.isValid() || !grammar) { return false; }
+        indexGrammarRules(grammar, grammarRules);
+        if (static_cast<quint64>(grammarRules.rules.size()) != ruleCount || grammarRules.fingerprint != fingerprint) { return false; }
+    }
+    if (grammars.isEmpty()) { return false; }
+    if (!grammarChangeAllowed_ && doc->languageGrammar() != grammars.first().grammar) { return false; }
+
+    QVector<TextScope*> scopeRefs(static_cast<qsizetype>(qMin<quint64>(reader.readVarint(), static_cast<quint64>(size))));
+    for (TextScope*& scope : scopeRefs) {
+        scope = Edbee::instance()->scopeManager()->refTextScope(reader.readString());
+    }
+    if (!reader.isValid()) { return false; }
+
+    // read all ranges, before changing the document scopes
+    auto readScope = [&]() -> TextScope* {
+        quint64 idx = reader.readVarint();
+        return idx < static_cast<quint64>(scopeRefs.size()) ? scopeRefs.at(static_cast<qsizetype>(idx)) : nullptr;
+    };
+
+    // ranges starting after the limit are skipped (a null entry), ranges crossing the limit get an open end
+    QVector<MultiLineScopedTextRange*> multiRanges;
+    QVector<ScopedTextRangeList*> lineRanges;
+    bool valid = true;
+    quint64 rangeCount = reader.readVarint();
+    for (quint64 i = 0; valid && i < rangeCount && reader.isValid(); ++i) {
+        size_t anchor = reader.readVarint();
+        size_t caret = reader.readVarint();
+        TextScope* scope = readScope();
+        quint64 grammar = reader.readVarint();
+        quint64 rule = reader.readVarint();
+        bool skipped = limited && qMin(anchor, caret) >= offsetLimit;
+        if (limited && !skipped) {
+            if (anchor > offsetLimit) { anchor = length; }
+            if (caret > offsetLimit) { caret = length; }
+        }
+        valid = scope && (skipped || (anchor <= length && caret <= length)) && grammar < static_cast<quint64>(grammars.size())
+            && rule <= static_cast<quint64>(grammars.at(static_cast<qsizetype>(grammar)).rules.size());
+        if (!valid) { break; }
+
+        bool hasEndRegExp = reader.readVarint() != 0;
+        QString endRegExp = hasEndRegExp ? reader.readString() : QString();
+        if (skipped) {
+            multiRanges.append(nullptr);
+            continue;
+        }
+        MultiLineScopedTextRange* range = new MultiLineScopedTextRange(anchor, caret, scope);
+        if (rule > 0) { range->setGrammarRule(grammars.at(static_cast<qsizetype>(grammar)).rules.at(static_cast<qsizetype>(rule - 1))); }
+        if (hasEndRegExp) { range->giveEndRegExp(new RegExp(endRegExp)); }
+        multiRanges.append(range);
+    }
+
+    MultiLineScopedTextRange* defaultRange = &scopes->defaultScopedRange();
+    quint64 lineCount = valid ? reader.readVarint() : 0;
+    valid = valid && (limited || lineCount <= doc->lineCount());
+    for (quint64 line = 0; valid && line < lineCount && reader.isValid(); ++line) {
+        quint64 count = reader.readVarint();
+        bool kept = line < lineLimit;
+        if (count == 0) {
+            if (kept) { lineRanges.append(nullptr); }
+            continue;
+        }
+        ScopedTextRangeList* list = kept ? new ScopedTextRangeList() : nullptr;
+        if (list) { lineRanges.append(list); }
+        bool independent = reader.readVarint() != 0;
+        if (list) { list->setIndependent(independent); }
+        for (quint64 i = 1; valid && i < count && reader.isValid(); ++i) {
+            quint64 reference = reader.readVarint();
+            size_t anchor = reader.readVarint();
+            size_t caret = reader.readVarint();
+            TextScope* scope = readScope();
+            valid = scope && reference < static_cast<quint64>(multiRanges.size()) + 2;
+            if (!valid || !list) { continue; }
+
+            ScopedTextRange* range = nullptr;
+            if (reference == 0) {
+                range = new ScopedTextRange(anchor, caret, scope);
+            } else {
+                MultiLineScopedTextRange* multiRange = reference == 1 ? defaultRange : multiRanges.at(static_cast<qsizetype>(reference - 2));
+                valid = multiRange != nullptr;
+                if (!valid) { break; }
+                range = new MultiLineScopedTextRangeReference(*multiRange);
+                range->set(anchor, caret);
+                range->setScope(scope);
+            }
+            list->giveRange(range);
+        }
+    }
+    size_t lastScopedOffset = reader.readVarint();
+    if (limited) { lastScopedOffset = qMin(lastScopedOffset, offsetLimit); }
+
+    if (!valid || !reader.isValid() || lastScopedOffset > length) {
+        qDeleteAll(lineRanges);
+        qDeleteAll(multiRanges);
+        return false;
+    }
+
+    // the document grammar resets the scopes
+    if (doc->languageGrammar() != grammars.first().grammar) {
+        doc->setLanguageGrammar(grammars.first().grammar);
+    }
+    scopes->removeScopesAfterOffset(0);
+    for (MultiLineScopedTextRange* range : multiRanges) {
+        if (range) { scopes->giveMultiLineScopedTextRange(range); }
+    }
+    for (qsizetype line = 0; line < lineRanges.size(); ++line) {
+        scopes->giveLineScopedRangeList(static_cast<size_t>(line), lineRanges.at(line));
+    }
+    scopes->setLastScopedOffset(lastScopedOffset);
+    if (limited) { scopes->removeScopesAfterOffset(lastScopedOffset); }
+    return true;
+}
+
+
+} // edbee
@@ -0,0 +1,46 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <string>
+
+#include <QByteArray>
+#include <QtGlobal>
+
+namespace edbee {
+
+class TextDocument;
+
+
+/// Converts the scopes of a textdocument (the result of the lexer) to a compact binary form and back.
+///
+/// The binary form contains the grammars (name, rule count and a fingerprint of the rule definitions), the scope
+/// names, the multi-line ranges with their grammar rules and end regexps, the scopes of every line and the last
+/// scoped offset. Everything the lexer needs to continue lexing after the last scoped offset.
+///
+/// The scopes can only be restored when the grammars are available and their rules didn't change.
+/// This is used by the session snapshots and the lexer cache.
+class EDBEE_EXPORT TextDocumentScopesSerializer {
+public:
+    TextDocumentScopesSerializer(TextDocument* textDocument);
+
+    QByteArray save();
+    bool restore(const uchar* data, qint64 size, size_t offsetLimit = std::string::npos);
+
+    /// May restore() change the grammar of the document to the grammar of the stored scopes? (default true)
+    /// When disabled restoring fails when the grammar of the document is another grammar
+    bool grammarChangeAllowed() const { return grammarChangeAllowed_; }
+    void setGrammarChangeAllowed(bool enabled) { grammarChangeAllowed_ = enabled; }
+
+    TextDocument* textDocument() const { return textDocumentRef_; }
+
+private:
+    TextDocument* textDocumentRef_;     ///< The document with the scopes
+    bool grammarChangeAllowed_;         ///< May restore change the grammar of the document?
+};
+
+
+} // edbee
@@ -5,10 +5,19 @@
 
 #include <QBuffer>
 #include <QIODevice>
+#include <QQueue>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QTextCodec>
+#include <QThreadPool>
 
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textbuffersnapshot.h"
 #include "edbee/models/textdocument.h"
 #include "edbee/util/lineending.h"
+#include "edbee/util/linediff.h"
+#include "edbee/util/newlinescanner.h"
 #include "edbee/util/textcodecdetector.h"
 #include "edbee/util/textcodec.h"
 
@@ -16,20 +25,184 @@
 
 namespace edbee {
 
+static const size_t DefaultSaveBlockSize = 256 * 1024;    ///< The default number of characters encoded at once when saving (and the write size in bytes)
+
+
+/// The MIB enum values of the codecs supported by the threaded loader
+enum ThreadedLoadCodecMib {
+    MibLatin1 = 4,
+    MibUtf8 = 106,
+    MibUtf16BE = 1013,
+    MibUtf16LE = 1014,
+    MibUtf32BE = 1018,
+    MibUtf32LE = 1019
+};
+
+
+/// Returns the end of a chunk, which can be decoded independently of the next chunk.
+/// A chunk never ends in the middle of a character or with a '\r' (which could be part of "\r\n").
+/// The bytes after the returned end are prepended to the next chunk
+/// @param data the data of the chunk
+/// @param size the number of bytes
+/// @param mib the MIB enum of the codec
+static int findChunkEnd(const uchar* data, int size, int mib)
+{
+    int end = size;
+    switch (mib) {
+        case MibUtf8: {
+            // find the start of the last sequence (continuation bytes have the form 10xxxxxx)
+            int start = end - 1;
+            while (start > 0 && start > end - 4 && (data[start] & 0xC0) == 0x80) { --start; }
+            if (start >= 0) {
+                uchar lead = data[start];
+                int length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 1;
+                if (start + length > end) { end = start; }
+            }
+            if (end > 0 && data[end - 1] == '\r') { --end; }
+            break;
+        }
+        case MibUtf16LE:
+        case MibUtf16BE: {
+            end &= ~1;
+            if (end >= 2) {
+                ushort unit = mib == MibUtf16LE ? (data[end - 1] << 8 | data[end - 2]) : (data[end - 2] << 8 | data[end - 1]);
+                if (unit >= 0xD800 && unit < 0xDC00) { end -= 2; }     // a high surrogate
+                else if (unit == '\r') { end -= 2; }
+            }
+            break;
+        }
+        case MibUtf32LE:
+        case MibUtf32BE: {
+            end &= ~3;
+            if (end >= 4) {
+                bool cr = mib == MibUtf32LE ? (data[end - 4] == '\r' && !data[end - 3] && !data[end - 2] && !data[end - 1])
+                                            : (!data[end - 4] && !data[end - 3] && !data[end - 2] && data[end - 1] == '\r');
+                if (cr) { end -= 4; }
+            }
+            break;
+        }
+        default:
+            if (end > 0 && data[end - 1] == '\r') { --end; }
+    }
+    return end;
+}
+
+
+//=====================================================
+
+
+/// A single chunk of the threaded loader. The chunk decodes the bytes and translates the
+/// windows line endings ("\r\n" to "\n") on a worker thread of the global thread pool
+class TextDocumentLoadChunk : public QRunnable
+{
+public:
+    TextDocumentLoadChunk(const QByteArray& bytes, TextCodec* codec, bool first)
+        : bytes_(bytes)
+        , codecRef_(codec)
+        , first_(first)
+        , lineEndingRef_(nullptr)
+    {
+        setAutoDelete(false);
+    }
+
+    /// Waits until the chunk has been processed
+    void waitForDone() { done_.acquire(); }
+
+    /// Returns the decoded and line-ending translated text
+    const QString& text() const { return text_; }
+
+    /// Returns the line ending detected in this chunk (or nullptr if it doesn't contain a line ending)
+    const LineEnding* lineEnding() const { return lineEndingRef_; }
+
+protected:
+    virtual void run();
+
+private:
+    QByteArray bytes_;                  ///< The bytes of the chunk
+    TextCodec* codecRef_;               ///< The codec used for decoding
+    bool first_;                        ///< Is this the first chunk of the file? (Only this chunk can contain a BOM)
+    QString text_;                      ///< The result
+    const LineEnding* lineEndingRef_;   ///< The detected line ending
+    QSemaphore done_;                   ///< Released when the chunk is processed
+};
+
+
+/// Processes the chunk
+void TextDocumentLoadChunk::run()
+{
+    // only the first chunk can start with a BOM, the other chunks are decoded without header handling
+    TextDecoder* decoder = codecRef_->makeTextDecoder(first_ ? QTextCodec::DefaultConversion : QTextCodec::IgnoreHeader);
+    decoder->toUnicode(bytes_.constData(), static_cast<int>(bytes_.size()), text_);
+    delete decoder;
+    bytes_.clear();
+
+    lineEndingRef_ = LineEnding::detect(text_);
+
+    // translate "\r\n" to "\n" in place
+    QChar* data = text_.data();
+    qsizetype length = text_.length();
+    qsizetype target = 0;
+    for (qsizetype pos = 0; pos < length; ++pos) {
+        if (data[pos] == QLatin1Char('\r') && pos + 1 < length && data[pos + 1] == QLatin1Char('\n')) { continue; }
+        data[target++] = data[pos];
+    }
+    text_.truncate(target);
+
+    done_.release();
+}
+
+
+//=====================================================
+
+
 TextDocumentSerializer::TextDocumentSerializer(TextDocument* textDocument)
     : textDocumentRef_(textDocument)
     , blockSize_(8192)
     , filterRef_(nullptr)
+    , threadedLoadChunkSize_(1024 * 1024)
+    , saveBlockSize_(DefaultSaveBlockSize)
+    , stopRequested_(false)
+{
+}
+
+
+/// Returns true if the given codec can be loaded by the threaded loader.
+/// The threaded loader decodes chunks independently, this requires a codec for which character boundaries can be found.
+/// (UTF-8, UTF-16LE/BE, UTF-32LE/BE and latin1)
+bool TextDocumentSerializer::isThreadedLoadSupported(TextCodec* codec)
 {
+    if (!codec) { return false; }
+    switch (codec->codec()->mibEnum()) {
+        case MibLatin1:
+        case MibUtf8:
+        case MibUtf16BE:
+        case MibUtf16LE:
+        case MibUtf32BE:
+        case MibUtf32LE:
+            return true;
+        default:
+            return false;
+    }
 }
 
 
 /// loads the file data for the given (opened) ioDevice
+/// Large files with a supported encoding are loaded with the threaded loader (see loadThreaded)
 /// @return true on success,
 bool TextDocumentSerializer::loadWithoutOpening(QIODevice* ioDevice)
 {
     errorString_.clear();
 
+    // detect the codec of larger files, to decide if the threaded loader can be used
+    if (threadedLoadChunkSize_ > 0 && !ioDevice->isSequential() && ioDevice->size() > 2 * static_cast<qint64>(threadedLoadChunkSize_)) {
+        QByteArray head = ioDevice->peek(blockSize_ - 1);
+        TextCodecDetector codecDetector(head.constData(), static_cast<size_t>(head.size()));
+        TextCodec* codec = codecDetector.detectCodec();
+        if (isThreadedLoadSupported(codec)) {
+            return loadThreaded(ioDevice, codec);
+        }
+    }
+
     // start raw appending
     textDocumentRef_->rawAppendBegin();
 
@@ -37,7 +210,7 @@ bool TextDocumentSerializer::loadWithoutOpening(QIODevice* ioDevice)
     TextCodec* detectedCodec = nullptr;
     const LineEnding* detectedLineEnding = nullptr;
 
-    QTextDecoder* textDecoder = nullptr;
+    TextDecoder* textDecoder = nullptr;
 
     // read the buffer
     QByteArray bytes(blockSize_ + 1, 0);
@@ -60,7 +233,7 @@ bool TextDocumentSerializer::loadWithoutOpening(QIODevice* ioDevice)
                 TextCodecDetector codecDetector(bytes.constData(), static_cast<size_t>(bytesRead));
                 detectedCodec = codecDetector.detectCodec();
                 Q_ASSERT(detectedCodec);
-                textDecoder = detectedCodec->makeDecoder();
+                textDecoder = detectedCodec->makeTextDecoder();
             }
 
             // convert the bytes to a string
@@ -107,6 +280,72 @@ bool TextDocumentSerializer::loadWithoutOpening(QIODevice* ioDevice)
 
 
 
+/// Loads the file with a pipeline of chunks.
+/// The calling thread reads the chunks and appends the decoded chunks to the document in order,
+/// while the next chunks are decoded and line-ending translated by the global thread pool.
+/// @param ioDevice the (opened) device to read
+/// @param codec the codec of the file
+/// @return true on success
+bool TextDocumentSerializer::loadThreaded(QIODevice* ioDevice, TextCodec* codec)
+{
+    int mib = codec->codec()->mibEnum();
+    QThreadPool* pool = QThreadPool::globalInstance();
+    int maxChunkCount = qMax(2, pool->maxThreadCount() * 2);
+
+    const LineEnding* detectedLineEnding = nullptr;
+    QQueue<TextDocumentLoadChunk*> chunks;
+    QByteArray remainingBytes;
+    bool first = true;
+    bool atEnd = false;
+
+    textDocumentRef_->rawAppendBegin();
+    while (!atEnd || !chunks.isEmpty()) {
+
+        // keep the pipeline filled
+        while (!atEnd && chunks.size() < maxChunkCount) {
+            // read the next chunk after the remaining bytes of the previous chunk
+            QByteArray bytes = remainingBytes;
+            int remainingSize = static_cast<int>(remainingBytes.size());
+            bytes.resize(remainingSize + threadedLoadChunkSize_);
+            qint64 bytesRead = ioDevice->read(bytes.data() + remainingSize, threadedLoadChunkSize_);
+            if (bytesRead < 0) { errorString_ = ioDevice->errorString(); }
+
+            if (bytesRead <= 0) {
+                atEnd = true;
+                bytes.resize(remainingSize);    // the last bytes, possibly an incomplete character
+                remainingBytes.clear();
+            } else {
+                int size = remainingSize + static_cast<int>(bytesRead);
+                int end = findChunkEnd(reinterpret_cast<const uchar*>(bytes.constData()), size, mib);
+                remainingBytes = bytes.mid(end, size - end);
+                bytes.resize(end);
+            }
+            if (bytes.isEmpty()) { continue; }
+
+            TextDocumentLoadChunk* chunk = new TextDocumentLoadChunk(bytes, codec, first);
+            first = false;
+            chunks.enqueue(chunk);
+            pool->start(chunk);
+        }
+
+        // append the oldest chunk
+        if (!chunks.isEmpty()) {
+            TextDocumentLoadChunk* chunk = chunks.dequeue();
+            chunk->waitForDone();
+            if (!detectedLineEnding) { detectedLineEnding = chunk->lineEnding(); }
+            textDocumentRef_->rawAppend(chunk->text().constData(), static_cast<size_t>(chunk->text().length()));
+            delete chunk;
+        }
+    }
+
+    if (!detectedLineEnding) { detectedLineEnding = LineEnding::get(LineEnding::UnixType); }
+    textDocumentRef_->setEncoding(codec);
+    textDocumentRef_->setLineEnding(detectedLineEnding);
+    textDocumentRef_->rawAppendEnd();
+    return errorString_.isEmpty();
+}
+
+
 /// executes the file loading for the given (unopened) ioDevice
 /// @return true on success,
 bool TextDocumentSerializer::load( QIODevice* ioDevice)
@@ -126,7 +365,80 @@ bool TextDocumentSerializer::load( QIODevice* ioDevice)
 }
 
 
-/// loads the file data for the given (opened) ioDevice
+/// Reloads the document from the given (opened) ioDevice, for example after the file has been changed on disk.
+/// The new content is loaded in a temporary document and compared with the current text line by line (see LineDiff).
+/// Only the changed lines are replaced, with ordinary (undoable) changes in a single undo group. The undo history,
+/// the scopes and the layouts of the unchanged parts of the document are kept.
+/// @return true on success
+bool TextDocumentSerializer::reloadWithoutOpening(QIODevice* ioDevice)
+{
+    errorString_.clear();
+
+    CharTextDocument newDocument;
+    TextDocumentSerializer serializer(&newDocument);
+    serializer.setThreadedLoadChunkSize(threadedLoadChunkSize_);
+    if (!serializer.loadWithoutOpening(ioDevice)) {
+        errorString_ = serializer.errorString();
+        return false;
+    }
+
+    TextBuffer* buffer = textDocumentRef_->buffer();
+    TextBuffer* newBuffer = newDocument.buffer();
+    QVector<LineDiff::Edit> edits = LineDiff::diff(buffer, newBuffer);
+
+    textDocumentRef_->beginUndoGroup();
+
+    // apply the edits from the last to the first, so the line numbers of the remaining edits don't change
+    for (qsizetype i = edits.size() - 1; i >= 0; --i) {
+        const LineDiff::Edit& edit = edits.at(i);
+        size_t offset = buffer->offsetFromLine(edit.oldLine);
+        size_t endLine = edit.oldLine + edit.oldLineCount;
+        size_t length = (endLine < buffer->lineCount() ? buffer->offsetFromLine(endLine) : buffer->length()) - offset;
+        size_t newOffset = newBuffer->offsetFromLine(edit.newLine);
+        size_t newEndLine = edit.newLine + edit.newLineCount;
+        size_t newLength = (newEndLine < newBuffer->lineCount() ? newBuffer->offsetFromLine(newEndLine) : newBuffer->length()) - newOffset;
+
+        // only the changed characters of the lines are replaced
+        QString text = buffer->textPart(offset, length);
+        QString newText = newBuffer->textPart(newOffset, newLength);
+        size_t maxLength = qMin(length, newLength);
+        size_t prefix = LineDiff::commonPrefixLength(text.constData(), newText.constData(), maxLength);
+        size_t suffix = LineDiff::commonSuffixLength(text.constData() + length - (maxLength - prefix), newText.constData() + newLength - (maxLength - prefix), maxLength - prefix);
+        textDocumentRef_->replace(offset + prefix, length - prefix - suffix, newText.mid(static_cast<qsizetype>(prefix), static_cast<qsizetype>(newLength - prefix - suffix)));
+    }
+
+    // the lines are compared by hash, a (very unlikely) collision is solved by replacing the remaining difference
+    size_t newLength = newBuffer->length();
+    size_t prefix = LineDiff::commonPrefixLength(buffer, newBuffer);
+    if (prefix != newLength || prefix != buffer->length()) {
+        size_t suffix = LineDiff::commonSuffixLength(buffer, newBuffer, qMin(buffer->length(), newLength) - prefix);
+        textDocumentRef_->replace(prefix, buffer->length() - prefix - suffix, newBuffer->textPart(prefix, newLength - prefix - suffix));
+    }
+
+    textDocumentRef_->endUndoGroup(0, true);
+    textDocumentRef_->setEncoding(newDocument.encoding());
+    textDocumentRef_->setLineEnding(newDocument.lineEnding());
+    return true;
+}
+
+
+/// Reloads the document from the given ioDevice, see reloadWithoutOpening
+/// @return true on success
+bool TextDocumentSerializer::reload(QIODevice* ioDevice)
+{
+    errorString_.clear();
+    if (!ioDevice->open(QIODevice::ReadOnly)) {
+        errorString_ = ioDevice->errorString();
+        return false;
+    }
+    bool result = reloadWithoutOpening(ioDevice);
+    ioDevice->close();
+    return result;
+}
+
+
+/// Saves the document to the given (opened) ioDevice.
+/// Without a filter the text is encoded directly from the spans of the buffer, in large blocks
 /// @return true on success
 bool TextDocumentSerializer::saveWithoutOpening(QIODevice *ioDevice)
 {
@@ -134,41 +446,27 @@ bool TextDocumentSerializer::saveWithoutOpening(QIODevice *ioDevice)
 
     // get the codec en encoder
     TextCodec* codec = textDocumentRef_->encoding();
-    QTextEncoder* encoder = codec->makeEncoder();
+    TextEncoder* encoder = codec->makeTextEncoder();
     QString lineEnding(textDocumentRef_->lineEnding()->chars());
 
     // work via a buffer
     QByteArray buffer;
-    for (size_t lineIdx = 0, cnt = textDocumentRef_->lineCount(); lineIdx < cnt; ++lineIdx) {
-        QString line = textDocumentRef_->lineWithoutNewline(lineIdx);
-        if (filter()) {
-            // if this line is not selected move to the next
-            if(!filter()->saveLineSelector( this, lineIdx, line) ) { continue; }
+    if (filter()) {
+        for (size_t lineIdx = 0, cnt = textDocumentRef_->lineCount(); lineIdx < cnt; ++lineIdx) {
+            QString line = textDocumentRef_->lineWithoutNewline(lineIdx);
+            if (!writeFilteredLine(ioDevice, encoder, lineIdx, line, lineIdx + 1 == cnt, lineEnding, buffer)) { break; }
         }
-        buffer.append(encoder->fromUnicode(line));
-
-        // no newline after the last line
-        if (lineIdx + 1 < cnt) {
-            buffer.append(encoder->fromUnicode(lineEnding));
-        }
-
-        // flush the bufer
-        if (buffer.size() >= blockSize_) {
-            if (ioDevice->write(buffer) < 0) {
-                errorString_ = ioDevice->errorString();
-                buffer.clear();
-                break;
-            }
-            buffer.clear();
+    } else {
+        TextBuffer* textBuffer = textDocumentRef_->buffer();
+        for (const TextBufferSpan& span : textBuffer->spans(0, textBuffer->length())) {
+            if (!writeText(ioDevice, encoder, span.data, span.length, lineEnding, buffer)) { break; }
         }
     }
 
-    // flush the last part of the buffer
-    if (buffer.size()) {
-        if (ioDevice->write(buffer) < 0) {
-            errorString_ = ioDevice->errorString();
-        }
-        buffer.clear();
+    // flush the encoder and the last part of the buffer
+    if (errorString_.isEmpty()) {
+        encoder->flush(buffer);
+        flushBuffer(ioDevice, buffer);
     }
     delete encoder;
     return errorString_.isEmpty();
@@ -194,6 +492,119 @@ bool TextDocumentSerializer::save(QIODevice* ioDevice)
 }
 
 
+/// Saves the given snapshot to the given (opened) ioDevice.
+/// This method only uses the snapshot (not the document), so it can be called from a background thread while the document is changed.
+/// The filter (when set) is called from the thread that calls this method.
+/// A save can be stopped with requestStop (the stop request isn't reset by this method)
+/// @param ioDevice the device to write to
+/// @param snapshot the text to save
+/// @param codec the encoding of the file
+/// @param lineEnding the line ending of the file
+/// @return true on success
+bool TextDocumentSerializer::saveSnapshotWithoutOpening(QIODevice* ioDevice, const TextBufferSnapshot& snapshot, TextCodec* codec, const LineEnding* lineEnding)
+{
+    errorString_.clear();
+
+    TextEncoder* encoder = codec->makeTextEncoder();
+    QString lineEndingChars(lineEnding->chars());
+
+    QByteArray buffer;
+    if (filter()) {
+        for (size_t lineIdx = 0, cnt = snapshot.lineCount(); lineIdx < cnt && !stopRequested_; ++lineIdx) {
+            QString line = snapshot.line(lineIdx);
+            if (line.endsWith('\n')) { line.chop(1); }
+            if (!writeFilteredLine(ioDevice, encoder, lineIdx, line, lineIdx + 1 == cnt, lineEndingChars, buffer)) { break; }
+        }
+    } else {
+        // copy the text of the rope in blocks
+        QString block(static_cast<qsizetype>(qMin(saveBlockSize_, snapshot.length())), Qt::Uninitialized);
+        for (size_t offset = 0, length = snapshot.length(); offset < length && !stopRequested_; offset += saveBlockSize_) {
+            size_t blockLength = qMin(saveBlockSize_, length - offset);
+            snapshot.copyRange(block.data(), offset, blockLength);
+            if (!writeText(ioDevice, encoder, block.constData(), blockLength, lineEndingChars, buffer)) { break; }
+        }
+    }
+
+    if (stopRequested_ && errorString_.isEmpty()) {
+        errorString_ = QStringLiteral("Saving canceled");
+    }
+    if (errorString_.isEmpty()) {
+        encoder->flush(buffer);
+        flushBuffer(ioDevice, buffer);
+    }
+    delete encoder;
+    return errorString_.isEmpty();
+}
+
+
+/// Encodes the given text to the buffer. Every '\n' is translated to the given line ending (when it differs from "\n").
+/// The buffer is written to the device when it's full.
+/// @return false when writing fails
+bool TextDocumentSerializer::writeText(QIODevice* ioDevice, TextEncoder* encoder, const QChar* data, size_t length, const QString& lineEnding, QByteArray& buffer)
+{
+    bool translate = lineEnding != QStringLiteral("\n");
+    while (length > 0) {
+        size_t blockLength = qMin(length, saveBlockSize_);
+        if (translate) {
+            size_t offset = 0;
+            while (offset < blockLength) {
+                size_t end = NewlineScanner::offsetAfterNewline(data + offset, blockLength - offset, 1);
+                if (end == std::string::npos) {
+                    encoder->fromUnicode(data + offset, static_cast<int>(blockLength - offset), buffer);
+                    break;
+                }
+                encoder->fromUnicode(data + offset, static_cast<int>(end - 1), buffer);
+                encoder->fromUnicode(lineEnding.constData(), static_cast<int>(lineEnding.size()), buffer);
+                offset += end;
+            }
+        } else {
+            encoder->fromUnicode(data, static_cast<int>(blockLength), buffer);
+        }
+        data += blockLength;
+        length -= blockLength;
+
+        if (static_cast<size_t>(buffer.size()) >= saveBlockSize_ && !flushBuffer(ioDevice, buffer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/// Encodes a single line (when the filter selects it) to the buffer. The line ending is added when this isn't the last line
+/// @return false when writing fails
+bool TextDocumentSerializer::writeFilteredLine(QIODevice* ioDevice, TextEncoder* encoder, size_t lineIdx, QString& line, bool lastLine, const QString& lineEnding, QByteArray& buffer)
+{
+    // if this line is not selected move to the next
+    if (!filter()->saveLineSelector(this, lineIdx, line)) { return true; }
+    encoder->fromUnicode(line.constData(), static_cast<int>(line.size()), buffer);
+
+    // no newline after the last line
+    if (!lastLine) {
+        encoder->fromUnicode(lineEnding.constData(), static_cast<int>(lineEnding.size()), buffer);
+    }
+
+    if (static_cast<size_t>(buffer.size()) >= saveBlockSize_) {
+        return flushBuffer(ioDevice, buffer);
+    }
+    return true;
+}
+
+
+/// Writes the buffer to the device and clears it
+/// @return false when writing fails (errorString_ contains the reason)
+bool TextDocumentSerializer::flushBuffer(QIODevice* ioDevice, QByteArray& buffer)
+{
+    bool result = true;
+    if (buffer.size() && ioDevice->write(buffer) < 0) {
+        errorString_ = ioDevice->errorString();
+        result = false;
+    }
+    buffer.clear();
+    return result;
+}
+
+
 /// This method appends the given lines to the document
 /// @param strIn the string to append
 /// @retirn the remaining last line
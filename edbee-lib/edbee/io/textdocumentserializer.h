@@ -5,14 +5,21 @@
 
 #include "edbee/exports.h"
 
+#include <atomic>
+
 #include <QString>
 
+class QByteArray;
 class QIODevice;
 
 namespace edbee {
 
+class LineEnding;
+class TextBufferSnapshot;
+class TextCodec;
 class TextDocument;
 class TextDocumentSerializer;
+class TextEncoder;
 
 class EDBEE_EXPORT TextDocumentSerializerFilter {
 public:
@@ -33,22 +40,48 @@ public:
     bool loadWithoutOpening(QIODevice* ioDevice);
     bool load( QIODevice* ioDevice );
 
+    bool reloadWithoutOpening(QIODevice* ioDevice);
+    bool reload(QIODevice* ioDevice);
+
     bool saveWithoutOpening(QIODevice* ioDevice);
     bool save(QIODevice* ioDevice);
+    bool saveSnapshotWithoutOpening(QIODevice* ioDevice, const TextBufferSnapshot& snapshot, TextCodec* codec, const LineEnding* lineEnding);
+
+    /// Requests a (running) saveSnapshotWithoutOpening call to stop. This method can be called from any thread.
+    /// The request stays active until resetStopRequest is called, so a stop requested before the save starts isn't lost
+    void requestStop() { stopRequested_ = true; }
+    void resetStopRequest() { stopRequested_ = false; }
 
 
     QString errorString() { return errorString_; }
     void setFilter(TextDocumentSerializerFilter* filter) { filterRef_ = filter; }
     TextDocumentSerializerFilter* filter() { return filterRef_; }
 
+    /// The size of the chunks that are decoded by the threaded loader. 0 disables the threaded loader
+    int threadedLoadChunkSize() const { return threadedLoadChunkSize_; }
+    void setThreadedLoadChunkSize(int size) { threadedLoadChunkSize_ = size; }
+
+    /// The number of characters encoded at once when saving. The buffer is written when it contains this number of bytes
+    size_t saveBlockSize() const { return saveBlockSize_; }
+    void setSaveBlockSize(size_t size) { Q_ASSERT(size > 0); saveBlockSize_ = size; }
+
+    static bool isThreadedLoadSupported(TextCodec* codec);
+
 private:
     QString appendBufferToDocument(const QString& strIn);
+    bool loadThreaded(QIODevice* ioDevice, TextCodec* codec);
+    bool writeText(QIODevice* ioDevice, TextEncoder* encoder, const QChar* data, size_t length, const QString& lineEnding, QByteArray& buffer);
+    bool writeFilteredLine(QIODevice* ioDevice, TextEncoder* encoder, size_t lineIdx, QString& line, bool lastLine, const QString& lineEnding, QByteArray& buffer);
+    bool flushBuffer(QIODevice* ioDevice, QByteArray& buffer);
 
 private:
     TextDocument* textDocumentRef_;             ///< The reference to the textdocument
-    int blockSize_;                             ///< The block-size to read/write. you must NOT makes this to small.. The first block is used to detected the encoding!!
+    int blockSize_;                             ///< The block-size to read. you must NOT makes this to small.. The first block is used to detected the encoding!!
     QString errorString_;                       ///< The last error (This is reset when calling load/save)
     TextDocumentSerializerFilter* filterRef_;   ///< The line filter
+    int threadedLoadChunkSize_;                 ///< The chunk size of the threaded loader
+    size_t saveBlockSize_;                      ///< The number of characters encoded at once when saving
+    std::atomic<bool> stopRequested_;           ///< Is a stop of the snapshot save requested?
 };
 
 } // edbee
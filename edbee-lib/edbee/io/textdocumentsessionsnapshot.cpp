@@ -0,0 +1,394 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentsessionsnapshot.h"
+
+#include <cstring>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+#include <QtEndian>
+
+#include "edbee/edbee.h"
+#include "edbee/io/textdocumentscopesserializer.h"
+#include "edbee/models/textbuffer.h"
+#include "edbee/models/textdocument.h"
+#include "edbee/util/hash64.h"
+#include "edbee/util/lineending.h"
+#include "edbee/util/textcodec.h"
+#include "edbee/util/unicodetranscoder.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+// The snapshot file starts with a header of fixed size:
+//   "EDBS"  version (uint16)  flags (uint16)
+//   source size (uint64)  source modification time (int64, msecs since epoch)  source hash (uint64)
+//   text length (uint64, characters)  line count (uint64)
+//   text offset (uint64)  line offsets offset (uint64)  scopes offset (uint64, 0 when absent)
+//   file size (uint64)  checksum (uint64, of all data after the header)
+// followed by:
+//   line ending type (uint8)  encoding name length (uint8)  encoding name
+//   the text (UTF-16), aligned at 8 bytes
+//   the start offsets of the lines 1..n (uint64), aligned at 8 bytes
+//   the scopes section (see TextDocumentScopesSerializer)
+// All integers are little endian. The file size is padded to a multiple of 8 bytes.
+
+static const char SnapshotMagic[] = "EDBS";
+static const quint16 SnapshotVersion = 1;
+static const qint64 HeaderSize = 88;
+static const quint16 FlagSource = 1;           ///< The snapshot is bound to a source file
+static const quint16 FlagSourceHash = 2;       ///< The source hash is stored
+static const quint16 FlagModified = 4;         ///< The document had unsaved changes
+static const quint16 FlagScopes = 8;           ///< The scopes section is stored
+static const size_t WriteBlockSize = 64 * 1024;
+
+
+/// Returns the value rounded up to a multiple of 8
+static qint64 align8(qint64 value)
+{
+    return (value + 7) & ~static_cast<qint64>(7);
+}
+
+
+/// Constructs the snapshot of the given document
+/// @param textDocument the document to save or restore
+TextDocumentSessionSnapshot::TextDocumentSessionSnapshot(TextDocument* textDocument)
+    : textDocumentRef_(textDocument)
+    , scopesIncluded_(true)
+    , sourceHashVerified_(true)
+    , scopesRestored_(false)
+{
+}
+
+
+/// Saves the snapshot of the document.
+/// The snapshot is written to a temporary file, which replaces the given file when it's complete
+/// @param fileName the name of the snapshot file
+/// @param sourceFileName the file the document was loaded from or saved to (empty for a new document)
+/// @return true on success
+bool TextDocumentSessionSnapshot::save(const QString& fileName, const QString& sourceFileName)
+{
+    errorString_.clear();
+    TextDocument* doc = textDocumentRef_;
+    TextBuffer* buffer = doc->buffer();
+
+    // the source file
+    quint16 flags = doc->isPersisted() ? 0 : FlagModified;
+    qint64 sourceSize = 0;
+    qint64 sourceModified = 0;
+    quint64 sourceHash = 0;
+    if (!sourceFileName.isEmpty()) {
+        if (!readSource(sourceFileName, sourceHashVerified_, sourceSize, sourceModified, sourceHash)) { return false; }
+        flags |= FlagSource | (sourceHashVerified_ ? FlagSourceHash : 0);
+    }
+
+    // the scopes
+    QByteArray scopes;
+    if (scopesIncluded_) {
+        scopes = TextDocumentScopesSerializer(doc).save();
+        if (!scopes.isEmpty()) { flags |= FlagScopes; }
+    }
+
+    // the layout of the file
+    QByteArray meta;
+    QByteArray encodingName = doc->encoding()->name().toLatin1().left(255);
+    meta.append(static_cast<char>(doc->lineEnding()->type()));
+    meta.append(static_cast<char>(encodingName.size()));
+    meta.append(encodingName);
+
+    size_t length = buffer->length();
+    size_t lineCount = buffer->lineCount();
+    qint64 textOffset = align8(HeaderSize + meta.size());
+    qint64 linesOffset = align8(textOffset + static_cast<qint64>(length) * 2);
+    qint64 scopesOffset = linesOffset + static_cast<qint64>(lineCount - 1) * 8;
+    qint64 fileSize = align8(scopesOffset + scopes.size());
+
+    QString tempFileName = fileName + QStringLiteral(".tmp");
+    QFile file(tempFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+
+    // writes the data after the header (and adds it to the checksum)
+    Hash64 checksum;
+    qint64 position = HeaderSize;
+    auto write = [&](const char* data, qint64 size) -> bool {
+        checksum.add(data, static_cast<size_t>(size));
+        position += size;
+        return file.write(data, size) == size;
+    };
+    auto pad = [&](qint64 offset) -> bool {
+        static const char zeros[8] = {};
+        return position >= offset || write(zeros, offset - position);
+    };
+
+    bool ok = file.write(QByteArray(static_cast<int>(HeaderSize), '\0')) == HeaderSize;
+    ok = ok && write(meta.constData(), meta.size()) && pad(textOffset);
+
+    // the text
+    QByteArray block;
+    for (const TextBufferSpan& span : buffer->spans(0, length)) {
+        for (size_t offset = 0; ok && offset < span.length; offset += WriteBlockSize) {
+            size_t count = qMin(WriteBlockSize, span.length - offset);
+            block.resize(static_cast<qsizetype>(count * 2));
+            UnicodeTranscoder::encodeUtf16LE(span.data + offset, count, block.data());
+            ok = write(block.constData(), block.size());
+        }
+    }
+    ok = ok && pad(linesOffset);
+
+    // the line offsets
+    for (size_t line = 1; ok && line < lineCount; line += WriteBlockSize / 8) {
+        size_t count = qMin(WriteBlockSize / 8, lineCount - line);
+        block.resize(static_cast<qsizetype>(count * 8));
+        for (size_t i = 0; i < count; ++i) {
+            qToLittleEndian<quint64>(buffer->offsetFromLine(line + i), block.data() + i * 8);
+        }
+        ok = write(block.constData(), block.size());
+    }
+
+    ok = ok && write(scopes.constData(), scopes.size()) && pad(fileSize);
+
+    // the header
+    if (ok) {
+        QByteArray header(static_cast<int>(HeaderSize), '\0');
+        char* data = header.data();
+        std::memcpy(data, SnapshotMagic, 4);
+        qToLittleEndian<quint16>(SnapshotVersion, data + 4);
+        qToLittleEndian<quint16>(flags, data + 6);
+        qToLittleEndian<quint64>(static_cast<quint64>(sourceSize), data + 8);
+        qToLittleEndian<qint64>(sourceModified, data + 16);
+        qToLittleEndian<quint64>(sourceHash, data + 24);
+        qToLittleEndian<quint64>(length, data + 32);
+        qToLittleEndian<quint64>(lineCount, data + 40);
+        qToLittleEndian<quint64>(static_cast<quint64>(textOffset), data + 48);
+        qToLittleEndian<quint64>(static_cast<quint64>(linesOffset), data + 56);
+        qToLittleEndian<quint64>(scopes.isEmpty() ? 0 : static_cast<quint64>(scopesOffset), data + 64);
+        qToLittleEndian<quint64>(static_cast<quint64>(fileSize), data + 72);
+        qToLittleEndian<quint64>(checksum.result(), data + 80);
+        ok = file.seek(0) && file.write(header) == HeaderSize;
+    }
+
+    if (!ok) {
+        errorString_ = file.errorString();
+        file.close();
+        QFile::remove(tempFileName);
+        return false;
+    }
+    file.close();
+
+    QFile::remove(fileName);
+    if (!QFile::rename(tempFileName, fileName)) {
+        errorString_ = QStringLiteral("Couldn't rename the snapshot file");
+        return false;
+    }
+    return true;
+}
+
+
+/// Restores the document from the snapshot. The document should be empty.
+/// Restoring fails when the snapshot doesn't match the source file, then the document should be loaded from the source file.
+/// The scopes are only restored when the grammar of the snapshot is available and didn't change (see scopesRestored)
+/// @param fileName the name of the snapshot file
+/// @param sourceFileName the source file of the document (empty for a new document)
+/// @return true on success
+bool TextDocumentSessionSnapshot::restore(const QString& fileName, const QString& sourceFileName)
+{
+    errorString_.clear();
+    scopesRestored_ = false;
+    TextDocument* doc = textDocumentRef_;
+    if (doc->length() > 0) {
+        errorString_ = QStringLiteral("The document isn't empty");
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar* data = size >= HeaderSize ? file.map(0, size) : nullptr;
+    if (!data) {
+        errorString_ = QStringLiteral("Invalid snapshot file");
+        return false;
+    }
+    if (!validate(data, size, sourceFileName)) {
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+
+    quint16 flags = qFromLittleEndian<quint16>(data + 6);
+    size_t length = qFromLittleEndian<quint64>(data + 32);
+    size_t lineCount = qFromLittleEndian<quint64>(data + 40);
+    qint64 textOffset = static_cast<qint64>(qFromLittleEndian<quint64>(data + 48));
+    qint64 linesOffset = static_cast<qint64>(qFromLittleEndian<quint64>(data + 56));
+    qint64 scopesOffset = static_cast<qint64>(qFromLittleEndian<quint64>(data + 64));
+
+    QString encodingName = QString::fromLatin1(reinterpret_cast<const char*>(data + HeaderSize + 2), data[HeaderSize + 1]);
+    TextCodec* codec = Edbee::instance()->codecManager()->codecForName(encodingName);
+    const LineEnding* lineEnding = data[HeaderSize] < LineEnding::typeCount() ? LineEnding::get(data[HeaderSize]) : nullptr;
+    if (!codec || !lineEnding) {
+        errorString_ = QStringLiteral("Unknown encoding or line ending in snapshot");
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+
+    // the line offsets, these are validated before changing the document
+    QVector<size_t> newLineOffsets(static_cast<qsizetype>(lineCount - 1));
+    size_t previousOffset = 0;
+    for (size_t i = 0; i + 1 < lineCount; ++i) {
+        size_t offset = qFromLittleEndian<quint64>(data + linesOffset + static_cast<qint64>(i) * 8);
+        if (offset <= previousOffset || offset > length) {
+            errorString_ = QStringLiteral("Invalid line offsets in snapshot");
+            file.unmap(const_cast<uchar*>(data));
+            return false;
+        }
+        newLineOffsets[static_cast<qsizetype>(i)] = offset;
+        previousOffset = offset;
+    }
+
+    // append the text, without decoding (on little endian systems) or scanning for newlines
+    doc->rawAppendBegin();
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    doc->rawAppend(reinterpret_cast<const QChar*>(data + textOffset), length);
+#else
+    QVector<QChar> block(static_cast<qsizetype>(qMin(WriteBlockSize, length)));
+    for (size_t offset = 0; offset < length; offset += WriteBlockSize) {
+        size_t count = qMin(WriteBlockSize, length - offset);
+        UnicodeTranscoder::decodeUtf16LE(reinterpret_cast<const char*>(data + textOffset) + offset * 2, count, block.data());
+        doc->rawAppend(block.constData(), count);
+    }
+#endif
+    doc->setEncoding(codec);
+    doc->setLineEnding(lineEnding);
+    doc->rawAppendEndWithLineOffsets(newLineOffsets);
+
+    if (scopesIncluded_ && (flags & FlagScopes) && scopesOffset > 0) {
+        scopesRestored_ = TextDocumentScopesSerializer(doc).restore(data + scopesOffset, size - scopesOffset);
+    }
+    doc->setPersisted(!(flags & FlagModified));
+
+    file.unmap(const_cast<uchar*>(data));
+    return true;
+}
+
+
+/// Checks if the snapshot file is valid and matches the source file, without restoring it
+/// @param fileName the name of the snapshot file
+/// @param sourceFileName the source file of the document (empty for a new document)
+/// @return true if the snapshot can be restored
+bool TextDocumentSessionSnapshot::isUpToDate(const QString& fileName, const QString& sourceFileName)
+{
+    errorString_.clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar* data = size >= HeaderSize ? file.map(0, size) : nullptr;
+    if (!data) {
+        errorString_ = QStringLiteral("Invalid snapshot file");
+        return false;
+    }
+    bool result = validate(data, size, sourceFileName);
+    file.unmap(const_cast<uchar*>(data));
+    return result;
+}
+
+
+/// Reads the size, modification time and (optionally) hash of the source file
+/// @return false if the source file can't be read
+bool TextDocumentSessionSnapshot::readSource(const QString& sourceFileName, bool hashRequired, qint64& size, qint64& modified, quint64& hash)
+{
+    QFileInfo info(sourceFileName);
+    if (!info.exists()) {
+        errorString_ = QStringLiteral("The source file doesn't exist");
+        return false;
+    }
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch();
+    hash = 0;
+    if (!hashRequired) { return true; }
+
+    QFile file(sourceFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    Hash64 checksum;
+    if (size > 0) {
+        const uchar* data = file.map(0, size);
+        if (!data) {
+            errorString_ = file.errorString();
+            return false;
+        }
+        checksum.add(reinterpret_cast<const char*>(data), static_cast<size_t>(size));
+        file.unmap(const_cast<uchar*>(data));
+    }
+    hash = checksum.result();
+    return true;
+}
+
+
+/// Validates the header and the checksum of the mapped snapshot, and compares it with the source file
+/// @param data the snapshot data
+/// @param size the size of the snapshot data (at least HeaderSize)
+bool TextDocumentSessionSnapshot::validate(const uchar* data, qint64 size, const QString& sourceFileName)
+{
+    quint16 flags = qFromLittleEndian<quint16>(data + 6);
+    quint64 length = qFromLittleEndian<quint64>(data + 32);
+    quint64 lineCount = qFromLittleEndian<quint64>(data + 40);
+    quint64 textOffset = qFromLittleEndian<quint64>(data + 48);
+    quint64 linesOffset = qFromLittleEndian<quint64>(data + 56);
+    quint64 scopesOffset = qFromLittleEndian<quint64>(data + 64);
+    quint64 fileSize = qFromLittleEndian<quint64>(data + 72);
+    quint64 dataSize = static_cast<quint64>(size);
+
+    // the layout
+    // (the size of the encoding name is checked first, a truncated file has no encoding name)
+    bool valid = dataSize >= static_cast<quint64>(HeaderSize) + 2 && std::memcmp(data, SnapshotMagic, 4) == 0 && qFromLittleEndian<quint16>(data + 4) == SnapshotVersion
+        && fileSize == dataSize && length <= dataSize / 2 && lineCount >= 1 && lineCount <= dataSize / 8 + 1
+        && textOffset >= static_cast<quint64>(HeaderSize) + 2 + data[HeaderSize + 1] && textOffset % 8 == 0
+        && linesOffset % 8 == 0 && textOffset + length * 2 <= linesOffset
+        && linesOffset + (lineCount - 1) * 8 <= (scopesOffset ? scopesOffset : fileSize) && scopesOffset <= fileSize;
+    if (!valid) {
+        errorString_ = QStringLiteral("Invalid snapshot file");
+        return false;
+    }
+
+    Hash64 checksum;
+    checksum.add(reinterpret_cast<const char*>(data + HeaderSize), static_cast<size_t>(size - HeaderSize));
+    if (checksum.result() != qFromLittleEndian<quint64>(data + 80)) {
+        errorString_ = QStringLiteral("The snapshot file is corrupt");
+        return false;
+    }
+
+    // the source file
+    if (sourceFileName.isEmpty() != !(flags & FlagSource)) {
+        errorString_ = QStringLiteral("The snapshot doesn't belong to the source file");
+        return false;
+    }
+    if (flags & FlagSource) {
+        bool hashRequired = sourceHashVerified_ && (flags & FlagSourceHash);
+        qint64 sourceSize = 0;
+        qint64 sourceModified = 0;
+        quint64 sourceHash = 0;
+        if (!readSource(sourceFileName, hashRequired, sourceSize, sourceModified, sourceHash)) { return false; }
+        if (static_cast<quint64>(sourceSize) != qFromLittleEndian<quint64>(data + 8) || sourceModified != qFromLittleEndian<qint64>(data + 16)
+                || (hashRequired && sourceHash != qFromLittleEndian<quint64>(data + 24))) {
+            errorString_ = QStringLiteral("The source file has been changed");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+} // edbee
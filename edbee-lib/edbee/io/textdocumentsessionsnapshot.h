@@ -0,0 +1,70 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QString>
+
+namespace edbee {
+
+class TextDocument;
+
+
+/// A binary snapshot of a textdocument, to reopen the documents of a session instantly.
+///
+/// The snapshot contains the text (UTF-16), the line offsets, the encoding and the line ending of the
+/// document, and optionally the scopes found by the lexer. The text and line offsets are stored aligned,
+/// so restoring the document is a memory mapped copy: the text isn't decoded, it isn't scanned for
+/// newlines and the grammar doesn't run.
+///
+/// The snapshot is bound to the source file of the document: restore() fails when the size, modification
+/// time or (optionally) the hash of the source file doesn't match. The caller should load the source file
+/// the normal way in that case.
+///
+/// The undo history isn't part of the snapshot. The changes on the undo stack refer to the controllers and
+/// the line data of the running editor, a restored document starts with an empty undo stack.
+///
+/// ~~~~
+/// TextDocumentSessionSnapshot snapshot(document);
+/// snapshot.save(snapshotFileName, fileName);                 // when closing the session
+/// ...
+/// if (!snapshot.restore(snapshotFileName, fileName)) {       // when reopening the session
+///     // load the document from fileName
+/// }
+/// ~~~~
+class EDBEE_EXPORT TextDocumentSessionSnapshot {
+public:
+    TextDocumentSessionSnapshot(TextDocument* textDocument);
+
+    bool save(const QString& fileName, const QString& sourceFileName = QString());
+    bool restore(const QString& fileName, const QString& sourceFileName = QString());
+    bool isUpToDate(const QString& fileName, const QString& sourceFileName = QString());
+
+    /// Should the scopes of the document be saved and restored? (default true)
+    bool scopesIncluded() const { return scopesIncluded_; }
+    void setScopesIncluded(bool enabled) { scopesIncluded_ = enabled; }
+
+    /// Should the hash of the source file be verified? When disabled only the size and modification time are compared (default true)
+    bool sourceHashVerified() const { return sourceHashVerified_; }
+    void setSourceHashVerified(bool enabled) { sourceHashVerified_ = enabled; }
+
+    /// Returns true if the last restore call restored the scopes (when false the document needs to be lexed)
+    bool scopesRestored() const { return scopesRestored_; }
+
+    TextDocument* textDocument() const { return textDocumentRef_; }
+    QString errorString() const { return errorString_; }
+
+private:
+    bool readSource(const QString& sourceFileName, bool hashRequired, qint64& size, qint64& modified, quint64& hash);
+    bool validate(const uchar* data, qint64 size, const QString& sourceFileName);
+
+    TextDocument* textDocumentRef_;     ///< The document to save or restore
+    bool scopesIncluded_;               ///< Are the scopes saved and restored?
+    bool sourceHashVerified_;           ///< Is the hash of the source file verified?
+    bool scopesRestored_;               ///< Did the last restore restore the scopes?
+    QString errorString_;               ///< The last error
+};
+
+} // edbee
@@ -0,0 +1,217 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textlexercache.h"
+
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include "edbee/io/textdocumentscopesserializer.h"
+#include "edbee/models/textdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/util/hash64.h"
+#include "edbee/util/linediff.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+// A cache file starts with a header of fixed size:
+//   "EDBL"  version (uint16)  reserved (uint16)
+//   content hash (uint64)  text length (uint64, characters)  line count (uint64)
+//   scopes size (uint64)  checksum (uint64, of all data after the header)
+// followed by the hashes of the lines (uint64) and the scopes (see TextDocumentScopesSerializer).
+// All integers are little endian.
+
+static const char CacheMagic[] = "EDBL";
+static const quint16 CacheVersion = 1;
+static const qint64 HeaderSize = 48;
+
+
+/// Returns the hash of the given line hashes and text length
+static quint64 contentHash(const QVector<quint64>& lineHashes, size_t length)
+{
+    Hash64 hash;
+    hash.add(reinterpret_cast<const char*>(lineHashes.constData()), static_cast<size_t>(lineHashes.size()) * sizeof(quint64));
+    hash.add(static_cast<quint64>(length));
+    return hash.result();
+}
+
+
+/// Constructs the cache
+/// @param path the directory with the cache files (it's created when an entry is saved)
+TextLexerCache::TextLexerCache(const QString& path)
+    : path_(path)
+    , restoredOffset_(0)
+{
+}
+
+
+/// Saves the scopes of the document.
+/// Only the lexed part of the document is saved, the lexer isn't invoked to lex the rest of the document.
+/// @param textDocument the document with a grammar
+/// @param key the key of the entry (usually the file name of the document)
+/// @return true on success
+bool TextLexerCache::save(TextDocument* textDocument, const QString& key)
+{
+    errorString_.clear();
+    QByteArray scopes = TextDocumentScopesSerializer(textDocument).save();
+    if (scopes.isEmpty()) {
+        errorString_ = QStringLiteral("The document has no grammar");
+        return false;
+    }
+    if (!QDir().mkpath(path_)) {
+        errorString_ = QStringLiteral("Couldn't create the cache directory");
+        return false;
+    }
+
+    QVector<quint64> hashes = lineHashes(textDocument);
+    size_t length = textDocument->length();
+    QByteArray data(static_cast<int>(HeaderSize + hashes.size() * 8), '\0');
+    char* lines = data.data() + HeaderSize;
+    for (qsizetype i = 0; i < hashes.size(); ++i) {
+        qToLittleEndian<quint64>(hashes.at(i), lines + i * 8);
+    }
+    data.append(scopes);
+
+    Hash64 checksum;
+    checksum.add(data.constData() + HeaderSize, static_cast<size_t>(data.size() - HeaderSize));
+    char* header = data.data();
+    std::memcpy(header, CacheMagic, 4);
+    qToLittleEndian<quint16>(CacheVersion, header + 4);
+    qToLittleEndian<quint64>(contentHash(hashes, length), header + 8);
+    qToLittleEndian<quint64>(length, header + 16);
+    qToLittleEndian<quint64>(static_cast<quint64>(hashes.size()), header + 24);
+    qToLittleEndian<quint64>(static_cast<quint64>(scopes.size()), header + 32);
+    qToLittleEndian<quint64>(checksum.result(), header + 40);
+
+    // write a temporary file, which replaces the entry when it's complete
+    QString entryFileName = fileName(textDocument, key);
+    QString tempFileName = entryFileName + QStringLiteral(".tmp");
+    QFile file(tempFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        errorString_ = file.errorString();
+        file.close();
+        QFile::remove(tempFileName);
+        return false;
+    }
+    file.close();
+
+    QFile::remove(entryFileName);
+    if (!QFile::rename(tempFileName, entryFileName)) {
+        errorString_ = QStringLiteral("Couldn't rename the cache file");
+        return false;
+    }
+    return true;
+}
+
+
+/// Restores the scopes of the document from the cache.
+/// The document should contain the text and the grammar. When the text has been changed, only the scopes before
+/// the first changed line are restored (see restoredOffset).
+/// @param textDocument the document to restore the scopes of
+/// @param key the key of the entry (usually the file name of the document)
+/// @return true if (a part of) the scopes are restored
+bool TextLexerCache::restore(TextDocument* textDocument, const QString& key)
+{
+    errorString_.clear();
+    restoredOffset_ = 0;
+    if (!textDocument->languageGrammar()) {
+        errorString_ = QStringLiteral("The document has no grammar");
+        return false;
+    }
+
+    QFile file(fileName(textDocument, key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar* data = size >= HeaderSize ? file.map(0, size) : nullptr;
+    if (!data) {
+        errorString_ = QStringLiteral("Invalid cache file");
+        return false;
+    }
+
+    quint64 lineCount = qFromLittleEndian<quint64>(data + 24);
+    quint64 scopesSize = qFromLittleEndian<quint64>(data + 32);
+    bool valid = std::memcmp(data, CacheMagic, 4) == 0 && qFromLittleEndian<quint16>(data + 4) == CacheVersion
+        && lineCount <= static_cast<quint64>(size) / 8 && scopesSize <= static_cast<quint64>(size) && static_cast<quint64>(HeaderSize) + lineCount * 8 + scopesSize == static_cast<quint64>(size);
+    if (valid) {
+        Hash64 checksum;
+        checksum.add(reinterpret_cast<const char*>(data + HeaderSize), static_cast<size_t>(size - HeaderSize));
+        valid = checksum.result() == qFromLittleEndian<quint64>(data + 40);
+    }
+    if (!valid) {
+        errorString_ = QStringLiteral("Invalid cache file");
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+
+    // find the first changed line, the scopes before this line can be restored
+    size_t length = textDocument->length();
+    size_t offsetLimit = std::string::npos;
+    QVector<quint64> hashes = lineHashes(textDocument);
+    if (qFromLittleEndian<quint64>(data + 8) != contentHash(hashes, length) || qFromLittleEndian<quint64>(data + 16) != length) {
+        const uchar* lines = data + HeaderSize;
+        size_t line = 0;
+        size_t lineEnd = qMin(static_cast<size_t>(lineCount), static_cast<size_t>(hashes.size()));
+        while (line < lineEnd && qFromLittleEndian<quint64>(lines + line * 8) == hashes.at(static_cast<qsizetype>(line))) {
+            ++line;
+        }
+        offsetLimit = line < static_cast<size_t>(hashes.size()) ? textDocument->offsetFromLine(line) : length;
+        if (offsetLimit == 0) {
+            errorString_ = QStringLiteral("The first line has been changed");
+            file.unmap(const_cast<uchar*>(data));
+            return false;
+        }
+    }
+
+    TextDocumentScopesSerializer serializer(textDocument);
+    serializer.setGrammarChangeAllowed(false);
+    bool result = serializer.restore(data + HeaderSize + lineCount * 8, static_cast<qint64>(scopesSize), offsetLimit);
+    file.unmap(const_cast<uchar*>(data));
+    if (!result) {
+        errorString_ = QStringLiteral("The grammar has been changed or the cache file is invalid");
+        return false;
+    }
+    restoredOffset_ = textDocument->scopes()->lastScopedOffset();
+    return true;
+}
+
+
+/// Removes the cache entry of the given document
+/// @return true if the entry has been removed
+bool TextLexerCache::remove(TextDocument* textDocument, const QString& key)
+{
+    return QFile::remove(fileName(textDocument, key));
+}
+
+
+/// Returns the name of the cache file with the entry of the given key and the grammar of the document
+QString TextLexerCache::fileName(TextDocument* textDocument, const QString& key) const
+{
+    TextGrammar* grammar = textDocument->languageGrammar();
+    QString name = key + QLatin1Char('\n') + (grammar ? grammar->name() : QString());
+    Hash64 hash;
+    hash.add(name.constData(), static_cast<size_t>(name.size()));
+    return path_ + QLatin1Char('/') + QString::number(hash.result(), 16).rightJustified(16, QLatin1Char('0')) + QStringLiteral(".lexcache");
+}
+
+
+/// Returns the hashes of all lines of the document (including the newline)
+QVector<quint64> TextLexerCache::lineHashes(TextDocument* textDocument)
+{
+    return LineDiff::lineHashes(textDocument->buffer(), 0, textDocument->lineCount());
+}
+
+
+} // edbee
@@ -0,0 +1,57 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QString>
+#include <QVector>
+
+namespace edbee {
+
+class TextDocument;
+
+
+/// A disk cache for the results of the lexer, so a reopened file doesn't need to be lexed again.
+///
+/// Every entry contains the scopes of a document (see TextDocumentScopesSerializer), which include the multi-line
+/// ranges that are open at the end of every line: the state the lexer continues from. The entry is found with a key
+/// (usually the file name) and the name of the grammar, and is only used when the grammar rules didn't change.
+///
+/// The entry also contains a hash of every line. When the file is unchanged all scopes are restored. When it has been
+/// changed the scopes before the first changed line are restored, and the lexer continues from that line.
+///
+/// ~~~~
+/// TextLexerCache cache(cachePath);
+/// cache.restore(document, fileName);        // after loading the document
+/// ...
+/// cache.save(document, fileName);           // when closing the document
+/// ~~~~
+class EDBEE_EXPORT TextLexerCache {
+public:
+    TextLexerCache(const QString& path);
+
+    bool save(TextDocument* textDocument, const QString& key);
+    bool restore(TextDocument* textDocument, const QString& key);
+    bool remove(TextDocument* textDocument, const QString& key);
+    QString fileName(TextDocument* textDocument, const QString& key) const;
+
+    /// The directory with the cache files
+    QString path() const { return path_; }
+
+    /// Returns the offset up to which the last restore call restored the scopes, the lexer continues from this offset
+    size_t restoredOffset() const { return restoredOffset_; }
+
+    QString errorString() const { return errorString_; }
+
+    static QVector<quint64> lineHashes(TextDocument* textDocument);
+
+private:
+    QString path_;                      ///< The directory with the cache files
+    size_t restoredOffset_;             ///< The offset up to which the scopes were restored
+    QString errorString_;               ///< The last error
+};
+
+
+} // edbee
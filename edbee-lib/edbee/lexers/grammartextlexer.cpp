@@ -4,7 +4,6 @@
 #include "grammartextlexer.h"
 
 #include <limits>
-#include <QStack>
 #include <QThread>
 
 #include "edbee/models/textgrammar.h"
@@ -65,74 +64,102 @@ RegExp* GrammarTextLexer::createEndRegExp(RegExp* startRegExp, const QString& en
 }
 
 
-/// Search the next grammar rule
+/// Returns true if this search result is also the result of a search from the given offset.
+/// A search from an offset finds the first match after that offset, so the result is valid for every offset between
+/// the search offset and the found position
+bool GrammarTextLexer::MatchPosition::isValidFor(size_t offset) const
+{
+    return cacheable && searchOffset <= offset && (position == std::string::npos || offset <= position);
+}
+
+
+/// Searches the given regular expression in the current line, the result of the previous search is reused when possible.
+/// The regular expression still contains the reused match, because the result of every search is remembered.
+/// @param regExp the regular expression to search
+/// @param line the line that's being lexed
+/// @param offsetInLine the offset to search from
+/// @return the found position or std::string::npos
+size_t GrammarTextLexer::indexInLine(RegExp* regExp, QStringView line, size_t offsetInLine)
+{
+    QHash<RegExp*, MatchPosition>::iterator itr = matchPositionCache_.find(regExp);
+    if (itr == matchPositionCache_.end()) {
+        MatchPosition match;
+        match.cacheable = !regExp->pattern().contains(QStringLiteral("\\G"));
+        itr = matchPositionCache_.insert(regExp, match);
+    } else if (itr.value().isValidFor(offsetInLine)) {
+        return itr.value().position;
+    }
+
+    MatchPosition& match = itr.value();
+    match.searchOffset = offsetInLine;
+    match.position = regExp->indexIn(line.constData(), offsetInLine, static_cast<size_t>(line.size()));
+    return match.position;
+}
+
+
+/// Searches all expressions of the given scanner in the current line, the result of the previous scan is reused when possible.
+/// The scanner still contains the index of the matched expression of the reused result.
+/// @param scanner the scanner to search with
+/// @param line the line that's being lexed
+/// @param offsetInLine the offset to search from
+/// @return the found position or std::string::npos
+size_t GrammarTextLexer::indexInLine(RegExpScanner* scanner, QStringView line, size_t offsetInLine)
+{
+    QHash<RegExpScanner*, MatchPosition>::iterator itr = scanPositionCache_.find(scanner);
+    if (itr == scanPositionCache_.end()) {
+        MatchPosition match;
+        match.cacheable = !scanner->isOffsetDependent();
+        itr = scanPositionCache_.insert(scanner, match);
+    } else if (itr.value().isValidFor(offsetInLine)) {
+        return itr.value().position;
+    }
+
+    MatchPosition& match = itr.value();
+    match.searchOffset = offsetInLine;
+    match.position = scanner->indexIn(line.constData(), offsetInLine, static_cast<size_t>(line.size()));
+    return match.position;
+}
+
+
+/// Search the next grammar rule. The rules are tried in the order of the compiled context of the active rule,
+/// the first rule with the lowest position wins
 /// @param (out) foundRegExp the found regexp
 /// @param (out) foundPosition the found position
 /// @return the grammarRule found
-void GrammarTextLexer::findNextGrammarRule(const QString& line, size_t offsetInLine, TextGrammarRule* activeRule, TextGrammarRule*& foundRule, RegExp*& foundRegExp, size_t& foundPosition)
+void GrammarTextLexer::findNextGrammarRule(QStringView line, size_t offsetInLine, TextGrammarRule* activeRule, TextGrammarRule*& foundRule, RegExp*& foundRegExp, size_t& foundPosition)
 {
-    // next iterate over all rules and find the rule with the lowest offset
-    QStack<TextGrammarRule::Iterator*> ruleIterators;
-    ruleIterators.push( activeRule->createIterator());
-    while (!ruleIterators.isEmpty()) {
-
-        while (ruleIterators.top()->hasNext()) {
-            TextGrammarRule* rule = ruleIterators.top()->next(); // activeRule->rule(i);
-
-            bool processNewRule = false;
-            do {
-                processNewRule = false;
-                switch (rule->instruction()) {
-                    case TextGrammarRule::SingleLineRegExp:
-                    case TextGrammarRule::MultiLineRegExp:
-                    {
-                        // only use this match if the offset < foundPosition
-                        size_t pos = rule->matchRegExp()->indexIn(line, offsetInLine);
-                        if (pos != std::string::npos) {
-                            if (pos < foundPosition) {
-                                foundRule     = rule;
-                                foundRegExp   = rule->matchRegExp();
-                                foundPosition = pos;
-                            }
-                        }
-                        break;
-                    }
-
-                    // and include rule
-                    case TextGrammarRule::IncludeCall:
-                    {
-                        TextGrammarRule* includedRule = findIncludeGrammarRule(rule);
-                        if (includedRule) {
-                            // a rule list, append the iterator
-                            if (includedRule->isRuleList() || includedRule->isMainRule()) {
-                                ruleIterators.push_back( includedRule->createIterator());
-
-                            // a normal rule? We need to process this one again
-                            } else {
-                                rule = includedRule;
-                                processNewRule = true;
-                            }
-                        } else {
-                            qlog_warn() << "ERROR, include rule" << rule->includeName() << "not found!" ;
-                        }
-                        break;
-                    }
-                    case TextGrammarRule::MainRule:
-                        Q_ASSERT(false && "a mainrule as child is not allowed!");
-                        break;
-                    case TextGrammarRule::RuleList:
-                        Q_ASSERT(false && "a rule list is not directly allowed!");
-                        break;
-                    default:
-                        Q_ASSERT(false && "unkown rule");
-                }
-            }
-            while (processNewRule);
-        } // while hasNext
-
-        delete ruleIterators.pop();
+    // a match at the offset can't be beaten
+    if (foundPosition == offsetInLine) { return; }
+    TextGrammarRuleContext* context = grammar()->ruleContext(activeRule);
+
+    // all expressions of the context are searched in a single scan
+    RegExpScanner* scanner = context->scanner();
+    if (scanner) {
+        size_t pos = indexInLine(scanner, line, offsetInLine);
+        if (pos != std::string::npos && pos < foundPosition) {
+            qsizetype idx = scanner->matchedIndex();
+            foundRule     = context->rule(idx);
+            foundRegExp   = context->regExp(idx);
+            foundPosition = pos;
+
+            // the expression itself is searched at the found position, for the length and the captures
+            size_t regExpPos = indexInLine(foundRegExp, line, pos);
+            Q_ASSERT(regExpPos == pos);
+            Q_UNUSED(regExpPos)
+        }
+        return;
+    }
 
-    } // while ruleIterators
+    for (qsizetype i = 0, cnt = context->ruleCount(); i < cnt; ++i) {
+        RegExp* regExp = context->regExp(i);
+        size_t pos = indexInLine(regExp, line, offsetInLine);
+        if (pos != std::string::npos && pos < foundPosition) {
+            foundRule     = context->rule(i);
+            foundRegExp   = regExp;
+            foundPosition = pos;
+            if (foundPosition == offsetInLine) { return; }
+        }
+    }
 }
 
 
@@ -166,7 +193,7 @@ void GrammarTextLexer::processCaptures(RegExp* foundRegExp, const QMap<size_t, Q
 /// @param currentDocOffset the current document offset
 /// @param line the line that's being matches
 /// @param offsetInLine (in/out) the current offset in the line
-TextGrammarRule* GrammarTextLexer::findAndApplyNextGrammarRule(size_t currentDocOffset, const QString& line, size_t& offsetInLine)
+TextGrammarRule* GrammarTextLexer::findAndApplyNextGrammarRule(size_t currentDocOffset, QStringView line, size_t& offsetInLine)
 {
     Q_ASSERT(lineRangeList_);
 
@@ -182,7 +209,7 @@ TextGrammarRule* GrammarTextLexer::findAndApplyNextGrammarRule(size_t currentDoc
 
     // first try to close the active rule
     if (activeMultiRange->endRegExp()) {
-        if (activeMultiRange->endRegExp()->indexIn(line, offsetInLine) != std::string::npos) {
+        if (activeMultiRange->endRegExp()->indexIn(line.constData(), offsetInLine, static_cast<size_t>(line.size())) != std::string::npos) {
             foundRule      = activeRule;
             foundRegExp    = activeMultiRange->endRegExp();
             foundPosition  = foundRegExp->pos();
@@ -219,7 +246,7 @@ TextGrammarRule* GrammarTextLexer::findAndApplyNextGrammarRule(size_t currentDoc
 
             // did we find a multiline regexp. add the start of this scope
             if( foundRule->isMultiLineRegExp() ) {
-                ScopedTextRange* range = new ScopedTextRange(startPos, static_cast<size_t>(line.length()), scopeRef);
+                ScopedTextRange* range = new ScopedTextRange(startPos, static_cast<size_t>(line.size()), scopeRef);
                 lineRangeList_->giveRange(range);
 
                 MultiLineScopedTextRange* multiRange = new MultiLineScopedTextRange(currentDocOffset+startPos, textScopes()->textDocument()->length(), scopeRef);
@@ -299,41 +326,12 @@ void GrammarTextLexer::pushActiveRange(ScopedTextRange* range, MultiLineScopedTe
 }
 
 
-/// T his method finds the 'included' grammar rule
-TextGrammarRule* GrammarTextLexer::findIncludeGrammarRule(TextGrammarRule* base)
-{
-    Q_ASSERT( base->isIncludeCall() );
-    QString name = base->includeName();
-
-    // repos call
-    if (name.startsWith("#")) {
-        return base->grammar()->findFromRepos(name.mid(1));
-
-    }
-    // another language call
-    // The difference between $base and $self is very subtle.. The exact difference is unkown to me..
-    if (name=="$base" || name == "$self") {
-        return grammar()->mainRule();
-    }
-
-    TextGrammar* grammar = Edbee::instance()->grammarManager()->get(name);
-    if (grammar) { return grammar->mainRule(); }
-    return nullptr;
-}
-
-
-
 /// This method is called to notify the lexer some data has been changed
 //void GrammarTextLexer::textReplaced( int offset, int length, int newLength )
 void GrammarTextLexer::textChanged(const TextBufferChange& change)
 {
-    TextDocument* doc = textDocument();
-    TextDocumentScopes* docScopes = textScopes();
-
-    size_t offsetStart = doc->offsetFromLine(change.line());
-    docScopes->removeScopesAfterOffset(offsetStart);
-
-    /// TODO: rebuild an optimized scope-rebuilding algorithm
+    // the scopes after the change are kept, lexing stops when a line ends with the same state as before the change
+    textScopes()->moveScopesAfterChange(change);
 }
 
 
@@ -345,19 +343,22 @@ bool GrammarTextLexer::lexLine(size_t lineIdx, size_t& currentDocOffset)
     TextDocument* doc = textDocument();
     TextDocumentScopes* docScopes = textScopes();
 
-    QString line        = doc->line(lineIdx);
+    // the view is valid during lexing of this line, the buffer isn't changed while lexing
+    QStringView line    = doc->lineView(lineIdx);
 
     Q_ASSERT(currentMultiLineRangeList_.isEmpty());
     Q_ASSERT(closedMultiRangesRangesRefList_.isEmpty());
     Q_ASSERT(activeScopedRangesRefList_.isEmpty());
 
     lineRangeList_ = new ScopedTextRangeList();
+    matchPositionCache_.clear();
+    scanPositionCache_.clear();
 
     // append the active ranges
     for (qsizetype i=0, cnt=activeMultiLineRangesRefList_.size(); i < cnt; ++i) {
         MultiLineScopedTextRangeReference* range = new MultiLineScopedTextRangeReference(*activeMultiLineRangesRefList_.at(i));
         range->setAnchor(0);
-        range->setCaret(static_cast<size_t>(line.length()));
+        range->setCaret(static_cast<size_t>(line.size()));
         lineRangeList_->giveRange(range);
         activeScopedRangesRefList_.append(range);
     }
@@ -370,7 +371,10 @@ bool GrammarTextLexer::lexLine(size_t lineIdx, size_t& currentDocOffset)
     size_t offsetInLine = 0;
     size_t lastOffsetInLine = 0;
     TextGrammarRule* lastFoundRule = nullptr;
-    while (true) {
+
+    // a very long line only gets the active multi-line ranges, matching the rules would block the lexer for seconds
+    bool tooLong = maxLineLength() && static_cast<size_t>(line.size()) > maxLineLength();
+    while (!tooLong) {
         //QString debug;
         //debug.append( QStringLiteral((" =[%1,%2,%3]= ").arg(lineIdx).arg(offsetInLine).arg(currentDocOffset) );
 
@@ -469,6 +473,17 @@ void GrammarTextLexer::lexLines(size_t lineStart, size_t lineCount)
     bool independent = true;
     for (size_t idx = 0; idx < lineCount; ++idx) {
         independent = lexLine(lineStart + idx, currentDocOffset) && independent;
+
+        // after a change the lines that are lexed again can end with the same state as before, the rest is still valid
+        if (docScopes->hasStaleScopes() && docScopes->reuseStaleScopes(lineStart + idx, currentDocOffset, activeMultiLineRangesRefList_)) {
+            return;
+        }
+    }
+
+    // the stale lines after this line are kept, until the state converges
+    if (docScopes->hasStaleScopes() && currentDocOffset < docScopes->staleEndOffset()) {
+        docScopes->setLastScopedOffset(currentDocOffset);
+        return;
     }
 
     // only set the scoped offset if less and not indepdent
@@ -496,6 +511,11 @@ void GrammarTextLexer::lexRange(size_t beginOffset, size_t endOffset)
 {
     Q_UNUSED(beginOffset);
 
+    // no lexing while the lexer is suspended
+    if (isSuspended()) {
+        return;
+    }
+
     // find the beginning of the given line
     TextDocument* doc = textDocument();
     TextDocumentScopes* docScopes = textScopes();
@@ -511,6 +531,11 @@ void GrammarTextLexer::lexRange(size_t beginOffset, size_t endOffset)
     size_t lineStart   = doc->lineFromOffset(offset);
     size_t lineEnd     = doc->lineFromOffset(endOffset) + 1;
 
+    // an empty last line starts at the end of the document, it's lexed with the line before it
+    if (lineEnd + 1 == doc->lineCount() && doc->offsetFromLine(lineEnd) == doc->length()) {
+        ++lineEnd;
+    }
+
     lexLines(lineStart, lineEnd - lineStart);
 }
 
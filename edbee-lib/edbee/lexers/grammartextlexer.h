@@ -5,7 +5,9 @@
 
 #include "edbee/exports.h"
 
+#include <QHash>
 #include <QMap>
+#include <QStringView>
 #include <QList>
 #include <QVector>
 
@@ -15,6 +17,7 @@ namespace edbee {
 
 class MultiLineScopedTextRange;
 class RegExp;
+class RegExpScanner;
 class ScopedTextRange;
 class ScopedTextRangeList;
 class TextDocumentScopes;
@@ -41,10 +44,12 @@ private:
 
     RegExp* createEndRegExp( RegExp* startRegExp, const QString &endRegExpStringIn);
 
-    void findNextGrammarRule(const QString &line, size_t offsetInLine, TextGrammarRule *activeRule, TextGrammarRule *&foundRule, RegExp*& foundRegExp, size_t& foundPosition);
+    size_t indexInLine(RegExp* regExp, QStringView line, size_t offsetInLine);
+    size_t indexInLine(RegExpScanner* scanner, QStringView line, size_t offsetInLine);
+    void findNextGrammarRule(QStringView line, size_t offsetInLine, TextGrammarRule *activeRule, TextGrammarRule *&foundRule, RegExp*& foundRegExp, size_t& foundPosition);
     void processCaptures(RegExp *foundRegExp, const QMap<size_t, QString>* foundCaptures);
 
-    TextGrammarRule* findAndApplyNextGrammarRule(size_t currentDocOffset, const QString& line, size_t& offsetInLine);
+    TextGrammarRule* findAndApplyNextGrammarRule(size_t currentDocOffset, QStringView line, size_t& offsetInLine);
 
     MultiLineScopedTextRange* activeMultiLineRange();
     ScopedTextRange* activeScopedTextRange();
@@ -52,10 +57,17 @@ private:
     void popActiveRange();
     void pushActiveRange( ScopedTextRange* range, MultiLineScopedTextRange* multiRange );
 
-    TextGrammarRule* findIncludeGrammarRule( TextGrammarRule* base );
-
 private:
 
+    /// The result of the last search of a regular expression in the current line
+    struct MatchPosition {
+        size_t searchOffset;    ///< The offset the search started at
+        size_t position;        ///< The found position (std::string::npos if there's no match after the search offset)
+        bool cacheable;         ///< Can the result be reused for another offset? (\G depends on the search offset)
+
+        bool isValidFor(size_t offset) const;
+    };
+
     QVector<MultiLineScopedTextRange*> activeMultiLineRangesRefList_;        ///< The current active scoped text ranges, DOC  (this is only valid during parsing)
     QVector<MultiLineScopedTextRange*> currentMultiLineRangeList_;           ///< The doc ranges currently created            (only valid during parsing
     QVector<MultiLineScopedTextRange*> closedMultiRangesRangesRefList_;      ///< A list of all ranges (from other lines) that have been closed. (only valid during parsing)
@@ -65,6 +77,8 @@ private:
 //    QVector<MultiLineScopedTextRange*> currentLineRangesList_;      ///< The current scope ranges (only valid during parsing)
 
     ScopedTextRangeList* lineRangeList_;                            ///< The scopes at current line (only valid during parsing)
+    QHash<RegExp*, MatchPosition> matchPositionCache_;              ///< The match positions of the rule expressions in the current line (only valid during parsing)
+    QHash<RegExpScanner*, MatchPosition> scanPositionCache_;        ///< The match positions of the context scanners in the current line (only valid during parsing)
 
 };
 
@@ -16,6 +16,9 @@ CharTextBuffer::CharTextBuffer(QObject *parent)
     : TextBuffer( parent )
     , rawAppendStart_(std::string::npos)
     , rawAppendLineStart_(std::string::npos)
+    , snapshotRopeActive_(false)
+    , snapshotRopeChangeLength_(0)
+    , snapshotUsage_(new TextBufferSnapshotUsage())
 {
 }
 
@@ -74,14 +77,19 @@ void CharTextBuffer::replaceText(size_t offset, size_t length, const QChar* buff
 
     emit textAboutToBeChanged(change);
 
-    // replace the text
-    QString oldText = buf_.mid(offset, length);
+    // replace the text (the old text is only copied when a listener requires it)
+    QString oldText = isOldTextRequired() ? buf_.mid(offset, length) : QString();
 
     buf_.replace(offset, length, buffer, bufferLength);
 
     // replace the line data and offsets
     lineOffsetList_.applyChange(change);
 
+    if (updateSnapshotRope(length + bufferLength)) {
+        snapshotRope_.replace(offset, length, buffer, bufferLength);
+    }
+    increaseVersion();
+
     emit textChanged(change, oldText);
 }
 
@@ -143,11 +151,31 @@ void CharTextBuffer::rawAppendEnd()
     Q_ASSERT(rawAppendStart_ != std::string::npos);
     Q_ASSERT(rawAppendLineStart_ != std::string::npos);
 
-    // emit the about signal
-    TextBufferChange change(this, rawAppendStart_, 0, buf_.data() + rawAppendStart_, buf_.length() - rawAppendStart_);
+    finishRawAppend(TextBufferChange(this, rawAppendStart_, 0, buf_.data() + rawAppendStart_, buf_.length() - rawAppendStart_));
+}
+
+
+/// Ends the 'raw' appending of data, without scanning the appended text for newlines
+/// @param newLineOffsets the start offsets of the new lines in the appended text (offsets within the document)
+void CharTextBuffer::rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets)
+{
+    Q_ASSERT(rawAppendStart_ != std::string::npos);
+    Q_ASSERT(rawAppendLineStart_ != std::string::npos);
+
+    finishRawAppend(TextBufferChange(this, rawAppendStart_, 0, buf_.data() + rawAppendStart_, buf_.length() - rawAppendStart_, newLineOffsets));
+}
+
 
+/// Applies the change of the appended text and emits the change signals
+void CharTextBuffer::finishRawAppend(const TextBufferChange& change)
+{
+    // emit the about signal
     emit textAboutToBeChanged( change );
     lineOffsetList_.applyChange( change );
+    if (updateSnapshotRope(change.newTextLength())) {
+        snapshotRope_.append(change.newText(), change.newTextLength());
+    }
+    increaseVersion();
     emit textChanged( change, QString() );
 
     rawAppendLineStart_ = std::string::npos;
@@ -162,4 +190,79 @@ QChar* CharTextBuffer::rawDataPointer()
     return buf_.data();
 }
 
+
+/// Returns the given range as a continuous block of characters.
+/// The gap is only moved when it's inside the given range, to the nearest side of the range
+/// @param offset the offset of the range
+/// @param length the length of the range
+const QChar* CharTextBuffer::rangeDataPointer(size_t offset, size_t length)
+{
+    return buf_.rangeData(offset, length);
+}
+
+
+/// Returns the given range as (at most) 2 blocks, the text before and after the gap.
+/// This method never moves the gap
+/// @param offset the offset of the range
+/// @param length the length of the range
+QVector<TextBufferSpan> CharTextBuffer::spans(size_t offset, size_t length)
+{
+    Q_ASSERT(offset + length <= buf_.length());
+    QVector<TextBufferSpan> result;
+    size_t end = offset + length;
+    size_t gapBegin = buf_.gapBegin();
+
+    if (offset < gapBegin && offset < end) {
+        TextBufferSpan span = { buf_.firstPartData() + offset, offset, qMin(end, gapBegin) - offset };
+        result.append(span);
+    }
+    if (gapBegin < end) {
+        size_t begin = qMax(offset, gapBegin);
+        TextBufferSpan span = { buf_.secondPartData() + (begin - gapBegin), begin, end - begin };
+        result.append(span);
+    }
+    return result;
+}
+
+
+/// Returns a snapshot of the text.
+/// The first call copies the text to the snapshot rope, after that the rope is kept up-to-date on every change
+/// (see updateSnapshotRope), so the following snapshots don't copy the text
+TextBufferSnapshot CharTextBuffer::snapshot()
+{
+    if (!snapshotRopeActive_) {
+        snapshotRope_.clear();
+        for (const TextBufferSpan& span : spans(0, buf_.length())) {
+            snapshotRope_.append(span.data, span.length);
+        }
+        snapshotRopeActive_ = true;
+    }
+    snapshotRopeChangeLength_ = 0;
+    return TextBufferSnapshot(snapshotRope_, version(), snapshotUsage_);
+}
+
+
+/// Returns true if a snapshot of this buffer is still in use
+bool CharTextBuffer::hasSnapshots() const
+{
+    return snapshotUsage_->ref.loadAcquire() > 1;
+}
+
+
+/// Checks if the snapshot rope should be updated for a change.
+/// The rope is kept up-to-date while snapshots are taken. When none of the snapshots is in use, and the changes
+/// since the last snapshot call are larger than the text, the rope is released and isn't updated anymore
+/// @param changeLength the number of removed and inserted characters of the change
+/// @return true if the snapshot rope should be updated
+bool CharTextBuffer::updateSnapshotRope(size_t changeLength)
+{
+    if (!snapshotRopeActive_) { return false; }
+    snapshotRopeChangeLength_ += changeLength;
+    if (snapshotRopeChangeLength_ > buf_.length() && !hasSnapshots()) {
+        snapshotRope_.clear();
+        snapshotRopeActive_ = false;
+    }
+    return snapshotRopeActive_;
+}
+
 } // edbee
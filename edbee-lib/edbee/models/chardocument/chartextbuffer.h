@@ -7,12 +7,20 @@
 
 #include "edbee/models/textbuffer.h"
 #include "edbee/util/gapvector.h"
-#include "edbee/util/lineoffsetvector.h"
+#include "edbee/util/lineoffsettree.h"
+#include "edbee/util/textrope.h"
 
 namespace edbee {
 
 
 /// This textbuffer implementation uses QChars for storing the data.
+///
+/// The gap vector can't be shared, so after the first snapshot call, the buffer keeps a rope with
+/// a copy of the text up-to-date. Creating the first snapshot is O(n), every following change
+/// updates the rope in O(log n) and all following snapshots are O(1).
+/// The rope is a second copy of the text. When no snapshot is in use, it's released as soon as the changes
+/// since the last snapshot call are larger than the text (keeping it up-to-date would cost more than a new copy).
+/// Use a RopeTextBuffer for large documents that are snapshotted often, it shares its rope with the snapshots.
 class EDBEE_EXPORT CharTextBuffer : public TextBuffer
 {
 public:
@@ -33,22 +41,38 @@ public:
     virtual void rawAppend(QChar c);
     virtual void rawAppend(const QChar* data, size_t dataLength);
     virtual void rawAppendEnd();
+    virtual void rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets);
 
     virtual QChar* rawDataPointer();
+    virtual const QChar* rangeDataPointer(size_t offset, size_t length);
+    virtual QVector<TextBufferSpan> spans(size_t offset, size_t length);
+
+    virtual TextBufferSnapshot snapshot();
+    bool hasSnapshots() const;
 
     /// TODO: Temporary debug method. REMOVE!!
-    LineOffsetVector& lineOffsetList() { return lineOffsetList_; }
+    LineOffsetTree& lineOffsetList() { return lineOffsetList_; }
 
 protected slots:
 
     void emitTextChanged( edbee::TextBufferChange* change, QString oldText = QString());
 
 private:
+    void finishRawAppend(const TextBufferChange& change);
+    bool updateSnapshotRope(size_t changeLength);
+
     QCharGapVector buf_;                     ///< The textbuffer
-    LineOffsetVector lineOffsetList_;        ///< The line offset vector
+    LineOffsetTree lineOffsetList_;          ///< The line offsets
 
     size_t rawAppendStart_;                     ///< The start offset of raw appending. std::string::npos means no appending is happening
     size_t rawAppendLineStart_;                 ///< The line start. std::string::npos no appending is happening
+
+    TextRope snapshotRope_;                     ///< A copy of the text used for snapshots
+    bool snapshotRopeActive_;                   ///< Is the snapshot rope kept up-to-date?
+    size_t snapshotRopeChangeLength_;           ///< The number of changed characters since the last snapshot call
+    TextBufferSnapshotUsageRef snapshotUsage_;  ///< The use count of the snapshots (held by every snapshot)
+
+friend class TextBufferSnapshotTest;
 };
 
 } // edbee
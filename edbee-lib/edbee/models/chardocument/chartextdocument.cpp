@@ -30,24 +30,36 @@ CharTextDocument::CharTextDocument(QObject* object)
 {
 }
 
+
+/// Constructs a document with the default (gapvector) textbuffer
 CharTextDocument::CharTextDocument(TextEditorConfig* config, QObject* object)
+    : edbee::CharTextDocument(new CharTextBuffer(), config, object)
+{
+}
+
+
+/// Constructs a document with the given textbuffer
+/// @param buffer the textbuffer to use. The ownership of this buffer is transfered to the document
+/// @param config the editor configuration
+/// @param object the parent object
+CharTextDocument::CharTextDocument(TextBuffer* buffer, TextEditorConfig* config, QObject* object)
     : TextDocument(object)
     , config_(config)
-    , textBuffer_(nullptr)
+    , textBuffer_(buffer)
     , textScopes_(nullptr)
     , textLexer_(nullptr)
+    , removingLeadingText_(false)
     , textCodecRef_(nullptr)
     , lineEndingRef_(nullptr)
     , textUndoStack_(nullptr)
     , autoCompleteProviderList_(nullptr)
 {
     Q_ASSERT_GUI_THREAD;
+    Q_ASSERT(textBuffer_);
 
     // auto initialize edbee if this hasn't been done already
     Edbee::instance()->autoInit();
 
-    textBuffer_ = new CharTextBuffer();
-
     textScopes_ = new TextDocumentScopes(this);
 
     textCodecRef_ = Edbee::instance()->codecManager()->codecForName("UTF-8");
@@ -148,10 +160,25 @@ Change* CharTextDocument::giveChangeWithoutFilter(Change *change, int coalesceId
 //}
 
 
+/// Removes the text at the start of the document, without undo records.
+/// The scopes of the remaining lines are moved before the text is removed (see TextDocumentScopes::removeScopesBeforeOffset),
+/// so these lines don't need to be lexed again. The lexer doesn't handle the change itself
+/// @param length the length of the removed text, this should be the start of a line
+void CharTextDocument::removeLeadingText(size_t length)
+{
+    Q_ASSERT(length == offsetFromLine(lineFromOffset(length)));
+    if (length == 0) { return; }
+    textScopes_->removeScopesBeforeOffset(length, lineFromOffset(length));
+    removingLeadingText_ = true;
+    textBuffer_->replaceText(0, length, QString());
+    removingLeadingText_ = false;
+}
+
+
 // the text is changed
 void CharTextDocument::textBufferChanged(const TextBufferChange& change, QString oldText)
 {
-    if (textLexer_) {
+    if (textLexer_ && !removingLeadingText_) {
         textLexer_->textChanged(change);
     }
 
@@ -28,6 +28,7 @@ Q_OBJECT
 public:
     CharTextDocument(QObject* object);
     CharTextDocument(TextEditorConfig *config = new TextEditorConfig(), QObject* object = nullptr);
+    CharTextDocument(TextBuffer* buffer, TextEditorConfig *config = new TextEditorConfig(), QObject* object = nullptr);
     virtual ~CharTextDocument();
 
 
@@ -74,6 +75,8 @@ public:
 
     virtual Change* giveChangeWithoutFilter(Change* change, int coalesceId );
 
+    virtual void removeLeadingText(size_t length);
+
 
 protected slots:
     //    virtual void textReplaced( int offset, int length, const QChar* data, int dataLength );
@@ -86,6 +89,7 @@ private:
 
     TextDocumentScopes* textScopes_;                         ///< The text document scopes
     TextLexer* textLexer_;                                   ///< The lexer used for finding the scopes
+    bool removingLeadingText_;                               ///< Is removeLeadingText running? (it moves the scopes itself)
 
     TextCodec* textCodecRef_;                                ///< The used encoding
     const edbee::LineEnding* lineEndingRef_;                 ///< The used line-ending
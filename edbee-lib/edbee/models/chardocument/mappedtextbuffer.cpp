@@ -0,0 +1,509 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "mappedtextbuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include "edbee/util/lineending.h"
+#include "edbee/util/newlinescanner.h"
+#include "edbee/util/textcodec.h"
+#include "edbee/util/textcodecdetector.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const size_t DefaultPageSize = 64 * 1024;              ///< The default number of bytes of a page
+static const size_t MinimumPageSize = 16;                     ///< A page should contain at least a complete character
+static const size_t DefaultPageCacheSize = 32 * 1024 * 1024;  ///< The default size of the page cache in bytes
+static const qint64 BatchSize = 4 * 1024 * 1024;             ///< The number of bytes that are published at once
+static const size_t DetectSize = 8192;                        ///< The number of bytes used for detecting the encoding
+
+
+/// Decodes the bytes of a page. Windows line endings are converted to '\n'
+static QString decodePage(const uchar* data, size_t length, bool utf8)
+{
+    const char* chars = reinterpret_cast<const char*>(data);
+    QString text = utf8 ? QString::fromUtf8(chars, static_cast<int>(length)) : QString::fromLatin1(chars, static_cast<int>(length));
+    if (text.contains('\r')) {
+        text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+    return text;
+}
+
+
+/// Returns the end of the page that starts at the given position.
+/// A page never ends in the middle of a UTF-8 sequence or a windows line ending
+static qint64 findPageEnd(const uchar* data, qint64 pos, qint64 size, size_t pageSize, bool utf8)
+{
+    qint64 end = pos + static_cast<qint64>(pageSize);
+    if (end >= size) return size;
+
+    // don't split an UTF-8 sequence (continuation bytes have the form 10xxxxxx)
+    if (utf8) {
+        while (end > pos + 1 && (data[end] & 0xC0) == 0x80) { --end; }
+    }
+
+    // don't split "\r\n"
+    if (end > pos + 1 && data[end - 1] == '\r') { --end; }
+    return end;
+}
+
+
+//=====================================================
+
+
+/// The background thread that scans the pages of a mapped file
+/// The results are added to the pending lists of the buffer, which are published in the gui thread
+class MappedTextBufferScanner : public QThread
+{
+public:
+    MappedTextBufferScanner(MappedTextBuffer* buffer, qint64 startOffset)
+        : bufferRef_(buffer)
+        , startOffset_(startOffset)
+        , stopRequested_(false)
+    {
+    }
+
+    /// Requests the scanner to stop. (Use wait to wait for it)
+    void requestStop() { stopRequested_ = true; }
+
+protected:
+    virtual void run();
+    void addScannedPages(QVector<MappedTextPage>& pages, QVector<size_t>& lineOffsets, qint64 scannedBytes, bool finished);
+
+private:
+    MappedTextBuffer* bufferRef_;            ///< The buffer that's scanned
+    qint64 startOffset_;                     ///< The byte offset to start scanning
+    std::atomic<bool> stopRequested_;        ///< Is a stop requested
+};
+
+
+/// Scans all pages of the file
+void MappedTextBufferScanner::run()
+{
+    const uchar* data = bufferRef_->data_;
+    qint64 size = bufferRef_->fileSize_;
+    size_t pageSize = bufferRef_->pageSize_;
+    bool utf8 = bufferRef_->utf8_;
+
+    QVector<MappedTextPage> pages;
+    QVector<size_t> lineOffsets;
+    qint64 pos = startOffset_;
+    qint64 batchStart = pos;
+    size_t charOffset = 0;
+    bool firstBatch = true;
+
+    while (pos < size && !stopRequested_) {
+        qint64 end = findPageEnd(data, pos, size, pageSize, utf8);
+        QString text = decodePage(data + pos, static_cast<size_t>(end - pos), utf8);
+
+        NewlineScanner::appendNewlineOffsets(text.constData(), static_cast<size_t>(text.length()), charOffset, lineOffsets);
+
+        MappedTextPage page = { pos, static_cast<size_t>(end - pos), charOffset, static_cast<size_t>(text.length()) };
+        pages.append(page);
+        charOffset += page.charLength;
+        pos = end;
+
+        // the first page is published directly, so something can be shown as soon as possible
+        if (firstBatch || pos - batchStart >= BatchSize) {
+            addScannedPages(pages, lineOffsets, pos, false);
+            batchStart = pos;
+            firstBatch = false;
+        }
+    }
+    addScannedPages(pages, lineOffsets, pos, true);
+}
+
+
+/// Adds the scanned pages to the pending lists and requests the buffer to publish them
+void MappedTextBufferScanner::addScannedPages(QVector<MappedTextPage>& pages, QVector<size_t>& lineOffsets, qint64 scannedBytes, bool finished)
+{
+    if (stopRequested_) return;
+
+    bool requestPublish = false;
+    {
+        QMutexLocker locker(&bufferRef_->mutex_);
+        bufferRef_->pendingPages_ += pages;
+        bufferRef_->pendingLineOffsets_ += lineOffsets;
+        bufferRef_->pendingBytes_ = scannedBytes;
+        bufferRef_->scanFinished_ = finished;
+        requestPublish = !bufferRef_->publishRequested_;
+        bufferRef_->publishRequested_ = true;
+    }
+    pages.clear();
+    lineOffsets.clear();
+
+    if (requestPublish) {
+        QMetaObject::invokeMethod(bufferRef_, "publishScannedPages", Qt::QueuedConnection);
+    }
+}
+
+
+//=====================================================
+
+
+/// The constructor of the mapped textbuffer
+/// @param parent a reference to the parent
+MappedTextBuffer::MappedTextBuffer(QObject* parent)
+    : TextBuffer(parent)
+    , data_(nullptr)
+    , fileSize_(0)
+    , pageSize_(DefaultPageSize)
+    , utf8_(true)
+    , codecRef_(nullptr)
+    , lineEndingRef_(nullptr)
+    , scanner_(nullptr)
+    , pendingBytes_(0)
+    , scanFinished_(false)
+    , publishRequested_(false)
+    , length_(0)
+    , publishedBytes_(0)
+    , finishedEmitted_(false)
+    , pageCache_(static_cast<int>(DefaultPageCacheSize))
+    , currentPageIndex_(std::string::npos)
+{
+}
+
+
+/// Stops the scanner and unmaps the file
+MappedTextBuffer::~MappedTextBuffer()
+{
+    if (scanner_) {
+        scanner_->requestStop();
+        scanner_->wait();
+        delete scanner_;
+    }
+    if (data_) {
+        file_.unmap(const_cast<uchar*>(data_));
+    }
+    file_.close();
+}
+
+
+/// Opens and maps the given file and starts the background scanner.
+/// This method returns directly, the content of the file is appended while it's scanned.
+/// A buffer can only open a single file.
+/// @param fileName the file to open
+/// @param codec the encoding of the file, when nullptr the encoding is detected
+/// @return true on success. On failure errorString() contains the reason
+bool MappedTextBuffer::open(const QString& fileName, TextCodec* codec)
+{
+    errorString_.clear();
+    if (file_.isOpen()) {
+        errorString_ = QStringLiteral("A file is already opened");
+        return false;
+    }
+
+    file_.setFileName(fileName);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        errorString_ = file_.errorString();
+        return false;
+    }
+
+    fileSize_ = file_.size();
+    if (fileSize_ > 0) {
+        data_ = file_.map(0, fileSize_);
+        if (!data_) {
+            errorString_ = file_.errorString();
+            file_.close();
+            return false;
+        }
+    }
+
+    // detect the encoding
+    const char* chars = reinterpret_cast<const char*>(data_);
+    size_t detectLength = static_cast<size_t>(qMin(fileSize_, static_cast<qint64>(DetectSize)));
+    if (!codec) {
+        if (detectLength > 8) {
+            TextCodecDetector detector(chars, detectLength);
+            codec = detector.detectCodec();
+        } else {
+            codec = TextCodecDetector::globalPreferedCodec();
+        }
+    }
+    Q_ASSERT(codec);
+
+    qint64 startOffset = 0;
+    QString codecName = codec->name();
+    if (codecName == "UTF-8" || codecName == "UTF-8 with BOM") {
+        utf8_ = true;
+        if (TextCodecDetector::hasUTF8Bom(chars, detectLength)) { startOffset = 3; }
+    } else if (codecName == "ISO-8859-1") {
+        utf8_ = false;
+    } else {
+        errorString_ = QStringLiteral("Encoding %1 isn't supported for mapped files").arg(codecName);
+        if (data_) { file_.unmap(const_cast<uchar*>(data_)); }
+        data_ = nullptr;
+        file_.close();
+        return false;
+    }
+    codecRef_ = codec;
+
+    // detect the line ending in the first block (without conversion)
+    qint64 detectEnd = qMin(fileSize_, startOffset + static_cast<qint64>(DetectSize));
+    QString firstBlock = utf8_
+        ? QString::fromUtf8(chars + startOffset, static_cast<int>(detectEnd - startOffset))
+        : QString::fromLatin1(chars + startOffset, static_cast<int>(detectEnd - startOffset));
+    lineEndingRef_ = LineEnding::detect(firstBlock, LineEnding::unixType());
+
+    // start scanning
+    scanner_ = new MappedTextBufferScanner(this, startOffset);
+    scanner_->start(QThread::LowPriority);
+    return true;
+}
+
+
+/// Returns true if the file is still being scanned (or the results aren't published yet)
+bool MappedTextBuffer::isScanning() const
+{
+    return scanner_ && !finishedEmitted_;
+}
+
+
+/// Blocks until the complete file is scanned and publishes all pages
+void MappedTextBuffer::waitForScan()
+{
+    if (!scanner_) return;
+    scanner_->wait();
+    publishScannedPages();
+}
+
+
+/// Sets the maximum number of bytes of a page. This is only possible before opening a file
+void MappedTextBuffer::setPageSize(size_t size)
+{
+    Q_ASSERT(!file_.isOpen());
+    pageSize_ = qMax(size, MinimumPageSize);
+}
+
+
+/// Returns the maximum number of bytes used by the decoded pages
+size_t MappedTextBuffer::pageCacheSize() const
+{
+    return static_cast<size_t>(pageCache_.maxCost());
+}
+
+
+/// Sets the maximum number of bytes used by the decoded pages (the cost of the cache is limited to INT_MAX bytes)
+void MappedTextBuffer::setPageCacheSize(size_t bytes)
+{
+    size_t maxCost = static_cast<size_t>(std::numeric_limits<int>::max());
+    pageCache_.setMaxCost(static_cast<int>(qMin(bytes, maxCost)));
+}
+
+
+/// Returns the number of pages in the page cache
+size_t MappedTextBuffer::cachedPageCount() const
+{
+    return static_cast<size_t>(pageCache_.count());
+}
+
+
+/// Returns the number of (published) characters
+size_t MappedTextBuffer::length() const
+{
+    return length_;
+}
+
+
+/// Returns the character at the given offset
+QChar MappedTextBuffer::charAt(size_t offset) const
+{
+    Q_ASSERT(offset < length_);
+
+    // fast path: the character is in the last used page
+    if (currentPageIndex_ != std::string::npos) {
+        const MappedTextPage& page = pages_.at(static_cast<qsizetype>(currentPageIndex_));
+        if (page.charOffset <= offset && offset < page.charOffset + page.charLength) {
+            return currentPage_.at(static_cast<qsizetype>(offset - page.charOffset));
+        }
+    }
+
+    size_t pageIndex = findPageIndex(offset);
+    QString text = pageText(pageIndex);
+    return text.at(static_cast<qsizetype>(offset - pages_.at(static_cast<qsizetype>(pageIndex)).charOffset));
+}
+
+
+/// Returns the text part
+/// @param offset the offset of the text
+/// @param length the length of the text to get
+QString MappedTextBuffer::textPart(size_t offset, size_t length) const
+{
+    Q_ASSERT(offset + length <= length_);
+
+    QString result;
+    result.reserve(static_cast<qsizetype>(length));
+    size_t pageIndex = findPageIndex(offset);
+    while (length > 0) {
+        const MappedTextPage& page = pages_.at(static_cast<qsizetype>(pageIndex));
+        QString text = pageText(pageIndex);
+        size_t pageOffset = offset - page.charOffset;
+        size_t len = qMin(page.charLength - pageOffset, length);
+        result.append(text.constData() + pageOffset, static_cast<qsizetype>(len));
+        offset += len;
+        length -= len;
+        ++pageIndex;
+    }
+    return result;
+}
+
+
+/// The mapped textbuffer is read-only. Changes are ignored
+void MappedTextBuffer::replaceText(size_t offset, size_t length, const QChar* buffer, size_t bufferLength)
+{
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    Q_UNUSED(buffer);
+    Q_UNUSED(bufferLength);
+    qlog_warn() << "MappedTextBuffer::replaceText ignored, the buffer is read-only";
+}
+
+
+/// Returns the line at the given offset
+size_t MappedTextBuffer::lineFromOffset(size_t offset)
+{
+    return lineOffsetList_.findLineFromOffset(offset);
+}
+
+
+/// Returns the offset of the given line
+size_t MappedTextBuffer::offsetFromLine(size_t line)
+{
+    if (line >= lineOffsetList_.length()) {
+        return length();
+    }
+    return lineOffsetList_.at(line);
+}
+
+
+/// The mapped textbuffer is read-only. Raw appending isn't supported
+void MappedTextBuffer::rawAppendBegin()
+{
+    qlog_warn() << "MappedTextBuffer::rawAppendBegin ignored, the buffer is read-only";
+}
+
+
+/// The mapped textbuffer is read-only. Raw appending isn't supported
+void MappedTextBuffer::rawAppend(QChar c)
+{
+    Q_UNUSED(c);
+}
+
+
+/// The mapped textbuffer is read-only. Raw appending isn't supported
+void MappedTextBuffer::rawAppend(const QChar* data, size_t dataLength)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(dataLength);
+}
+
+
+/// The mapped textbuffer is read-only. Raw appending isn't supported
+void MappedTextBuffer::rawAppendEnd()
+{
+}
+
+
+/// This method returns the raw data pointer
+/// WARNING this decodes the complete (published) file in a single buffer, which defeats the page cache!
+QChar* MappedTextBuffer::rawDataPointer()
+{
+    rawData_ = textPart(0, length_);
+    return rawData_.data();
+}
+
+
+/// Returns the given range as a continuous block of characters.
+/// Only the pages of the given range are decoded
+/// @param offset the offset of the range
+/// @param length the length of the range
+const QChar* MappedTextBuffer::rangeDataPointer(size_t offset, size_t length)
+{
+    rangeData_ = textPart(offset, length);
+    return rangeData_.constData();
+}
+
+
+/// Publishes the pages found by the scanner. The new text is emitted as an append change
+void MappedTextBuffer::publishScannedPages()
+{
+    QVector<MappedTextPage> pages;
+    QVector<size_t> lineOffsets;
+    qint64 scannedBytes = 0;
+    bool finished = false;
+    {
+        QMutexLocker locker(&mutex_);
+        pages.swap(pendingPages_);
+        lineOffsets.swap(pendingLineOffsets_);
+        scannedBytes = pendingBytes_;
+        finished = scanFinished_;
+        publishRequested_ = false;
+    }
+    if (finishedEmitted_) return;
+
+    if (!pages.isEmpty()) {
+        const MappedTextPage& lastPage = pages.last();
+        size_t textLength = lastPage.charOffset + lastPage.charLength - length_;
+
+        // the new text isn't decoded, the change only contains the length and line offsets
+        TextBufferChange change(this, length_, 0, nullptr, textLength, lineOffsets);
+        emit textAboutToBeChanged(change);
+
+        pages_ += pages;
+        length_ += textLength;
+        lineOffsetList_.applyChange(change);
+        increaseVersion();
+
+        emit textChanged(change, QString());
+    }
+
+    publishedBytes_ = scannedBytes;
+    emit scanProgress(publishedBytes_, fileSize_);
+
+    if (finished) {
+        finishedEmitted_ = true;
+        emit scanFinished();
+    }
+}
+
+
+/// Returns the index of the page that contains the given offset
+size_t MappedTextBuffer::findPageIndex(size_t offset) const
+{
+    Q_ASSERT(!pages_.isEmpty());
+    QVector<MappedTextPage>::const_iterator it = std::upper_bound(pages_.constBegin(), pages_.constEnd(), offset,
+        [](size_t value, const MappedTextPage& page) { return value < page.charOffset; });
+    return static_cast<size_t>(it - pages_.constBegin()) - 1;
+}
+
+
+/// Returns the decoded text of the given page. The page is decoded when it isn't in the page cache
+QString MappedTextBuffer::pageText(size_t pageIndex) const
+{
+    if (pageIndex == currentPageIndex_) return currentPage_;
+
+    QString text;
+    QString* cachedText = pageCache_.object(pageIndex);
+    if (cachedText) {
+        text = *cachedText;
+    } else {
+        const MappedTextPage& page = pages_.at(static_cast<qsizetype>(pageIndex));
+        text = decodePage(data_ + page.byteOffset, page.byteLength, utf8_);
+        Q_ASSERT(static_cast<size_t>(text.length()) == page.charLength);
+        pageCache_.insert(pageIndex, new QString(text), static_cast<int>(page.charLength * sizeof(QChar)));
+    }
+    currentPageIndex_ = pageIndex;
+    currentPage_ = text;
+    return text;
+}
+
+
+} // edbee
@@ -0,0 +1,138 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/util/lineoffsettree.h"
+
+namespace edbee {
+
+class LineEnding;
+class MappedTextBufferScanner;
+class TextCodec;
+
+
+/// A single page of a mapped file
+struct MappedTextPage {
+    qint64 byteOffset;      ///< The offset of the page in the file
+    size_t byteLength;      ///< The number of bytes of the page
+    size_t charOffset;      ///< The offset of the first character of this page in the buffer
+    size_t charLength;      ///< The number of characters of this page
+};
+
+
+/// A read-only textbuffer for (very) large files.
+///
+/// The file is memory mapped and divided in pages. A background thread scans all pages, to find
+/// the character length of every page and the line offsets. The scanned pages are published in
+/// batches to the buffer, every batch is emitted as an append change. So the first part of the
+/// file is available almost immediately, regardless of the file size.
+///
+/// The text of a page is decoded when it's requested and stored in a LRU page cache with a
+/// configurable size. Only UTF-8 and latin1 (ISO-8859-1) files are supported.
+/// Windows line endings are converted to '\n', like the TextDocumentSerializer does.
+///
+/// All modifying methods are ignored (with a warning), use a readonly editor for this buffer.
+class EDBEE_EXPORT MappedTextBuffer : public TextBuffer
+{
+Q_OBJECT
+
+public:
+    MappedTextBuffer(QObject* parent=nullptr);
+    virtual ~MappedTextBuffer();
+
+    bool open(const QString& fileName, TextCodec* codec = nullptr);
+    QString errorString() const { return errorString_; }
+
+    TextCodec* encoding() const { return codecRef_; }
+    const LineEnding* lineEnding() const { return lineEndingRef_; }
+
+    bool isScanning() const;
+    void waitForScan();
+    qint64 fileSize() const { return fileSize_; }
+    qint64 scannedBytes() const { return publishedBytes_; }
+
+    size_t pageSize() const { return pageSize_; }
+    void setPageSize(size_t size);
+    size_t pageCount() const { return static_cast<size_t>(pages_.size()); }
+
+    size_t pageCacheSize() const;
+    void setPageCacheSize(size_t bytes);
+    size_t cachedPageCount() const;
+
+    virtual size_t length() const;
+    virtual QChar charAt(size_t offset) const;
+    virtual QString textPart(size_t offset, size_t length) const;
+
+    virtual void replaceText(size_t offset, size_t length, const QChar* buffer, size_t bufferLength);
+
+    virtual size_t lineCount() { return lineOffsetList_.length(); }
+
+    virtual size_t lineFromOffset(size_t offset);
+    virtual size_t offsetFromLine(size_t line);
+
+    virtual void rawAppendBegin();
+    virtual void rawAppend(QChar c);
+    virtual void rawAppend(const QChar* data, size_t dataLength);
+    virtual void rawAppendEnd();
+
+    virtual QChar* rawDataPointer();
+    virtual const QChar* rangeDataPointer(size_t offset, size_t length);
+
+signals:
+    void scanProgress(qint64 scannedBytes, qint64 totalBytes);
+    void scanFinished();
+
+protected slots:
+    void publishScannedPages();
+
+protected:
+    size_t findPageIndex(size_t offset) const;
+    QString pageText(size_t pageIndex) const;
+
+private:
+    friend class MappedTextBufferScanner;
+
+    QFile file_;                             ///< The mapped file
+    const uchar* data_;                      ///< The mapped data
+    qint64 fileSize_;                        ///< The size of the file
+    size_t pageSize_;                        ///< The (maximum) number of bytes of a page
+    bool utf8_;                              ///< Is the file UTF-8? (else it's latin1)
+    TextCodec* codecRef_;                    ///< The encoding of the file
+    const LineEnding* lineEndingRef_;        ///< The detected line ending
+    QString errorString_;                    ///< The last error
+
+    MappedTextBufferScanner* scanner_;       ///< The background scanner
+
+    // The scanned pages, that aren't published yet (protected by the mutex)
+    QMutex mutex_;                           ///< The mutex for the scan results
+    QVector<MappedTextPage> pendingPages_;   ///< The scanned pages
+    QVector<size_t> pendingLineOffsets_;     ///< The line offsets of the scanned pages
+    qint64 pendingBytes_;                    ///< The number of bytes scanned
+    bool scanFinished_;                      ///< Is the scanner finished?
+    bool publishRequested_;                  ///< Is a publish call already pending?
+
+    // The published pages
+    QVector<MappedTextPage> pages_;          ///< All published pages
+    LineOffsetTree lineOffsetList_;          ///< The line offsets of the published pages
+    size_t length_;                          ///< The number of published characters
+    qint64 publishedBytes_;                  ///< The number of published bytes
+    bool finishedEmitted_;                   ///< Is the scanFinished signal emitted?
+
+    mutable QCache<size_t, QString> pageCache_;  ///< The cache with decoded pages
+    mutable size_t currentPageIndex_;        ///< The index of the last used page
+    mutable QString currentPage_;            ///< The text of the last used page
+
+    QString rawData_;                        ///< The flattened text returned by rawDataPointer
+    QString rangeData_;                      ///< The text returned by rangeDataPointer
+};
+
+} // edbee
@@ -0,0 +1,193 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "ropetextbuffer.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// The constructor of the rope textbuffer
+/// @param parent a reference to the parent
+RopeTextBuffer::RopeTextBuffer(QObject* parent)
+    : TextBuffer(parent)
+    , rawAppending_(false)
+    , rawDataValid_(false)
+{
+}
+
+
+/// Returns the length of the buffer
+size_t RopeTextBuffer::length() const
+{
+    return rope_.length();
+}
+
+
+/// Returns the character at the given offset
+/// @param offset the offset of the given character
+QChar RopeTextBuffer::charAt(size_t offset) const
+{
+    Q_ASSERT(offset < rope_.length());
+    return rope_.at(offset);
+}
+
+
+/// Returns the text part
+/// @param offset the offset of the text
+/// @param length the length of the text to get
+QString RopeTextBuffer::textPart(size_t offset, size_t length) const
+{
+    Q_ASSERT(offset + length <= rope_.length());
+    return rope_.mid(offset, length);
+}
+
+
+/// replaces the given text
+/// @param offset the offset of the text to replace
+/// @param length the length of the text to replace
+/// @param buffer a pointer to a buffer with data
+/// @param bufferLength the length of the buffer
+void RopeTextBuffer::replaceText(size_t offset, size_t length, const QChar* buffer, size_t bufferLength)
+{
+    // make sure the position is correct
+    if (offset > rope_.length()) {
+        offset = rope_.length();
+        length = 0;
+    }
+
+    // make sure the length matches
+    length = qMin(rope_.length() - offset, length);
+
+    TextBufferChange change(this, offset, length, buffer, bufferLength);
+
+    emit textAboutToBeChanged(change);
+
+    QString oldText = isOldTextRequired() ? rope_.mid(offset, length) : QString();
+    rope_.replace(offset, length, buffer, bufferLength);
+    releaseRawData();
+    increaseVersion();
+
+    emit textChanged(change, oldText);
+}
+
+
+/// Returns the line at the given offset
+/// @param offset the offset to retrieve the line from
+size_t RopeTextBuffer::lineFromOffset(size_t offset)
+{
+    return rope_.lineFromOffset(qMin(offset, rope_.length()));
+}
+
+
+/// Returns the offset of the given line
+/// @param line the line to retrieve the offset from
+size_t RopeTextBuffer::offsetFromLine(size_t line)
+{
+    return rope_.offsetFromLine(line);
+}
+
+
+/// Changes the storage mode of the text. The existing text is converted.
+/// This doesn't change the content, so no change signals are emitted
+void RopeTextBuffer::setStorageMode(TextRope::StorageMode mode)
+{
+    rope_.setStorageMode(mode);
+}
+
+
+/// Starts raw data appending to the buffer
+void RopeTextBuffer::rawAppendBegin()
+{
+    Q_ASSERT(!rawAppending_);
+    rawAppending_ = true;
+    rawAppendBuffer_.clear();
+}
+
+
+/// Appends a single character in raw mode
+/// @param c the character to append
+void RopeTextBuffer::rawAppend(QChar c)
+{
+    Q_ASSERT(rawAppending_);
+    rawAppendBuffer_.append(c);
+}
+
+
+/// Appends a buffer of text in raw mode
+/// @param data the data to append
+/// @param dataLength the number of characters available in data
+void RopeTextBuffer::rawAppend(const QChar* data, size_t dataLength)
+{
+    Q_ASSERT(rawAppending_);
+    rawAppendBuffer_.append(data, static_cast<qsizetype>(dataLength));
+}
+
+
+/// Ends the 'raw' appending of data. The appended data is added to the rope in a single change
+void RopeTextBuffer::rawAppendEnd()
+{
+    Q_ASSERT(rawAppending_);
+
+    size_t offset = rope_.length();
+    size_t dataLength = static_cast<size_t>(rawAppendBuffer_.length());
+    TextBufferChange change(this, offset, 0, rawAppendBuffer_.constData(), dataLength);
+
+    emit textAboutToBeChanged(change);
+    rope_.append(rawAppendBuffer_.constData(), dataLength);
+    releaseRawData();
+    increaseVersion();
+    emit textChanged(change, QString());
+
+    rawAppendBuffer_.clear();
+    rawAppending_ = false;
+}
+
+
+/// This method returns the raw data pointer
+/// WARNING the rope doesn't store the text in a continuous buffer, so this call flattens the complete rope.
+/// The flattened copy is freed at the next change, use rangeDataPointer or spans to read a part of the text
+QChar* RopeTextBuffer::rawDataPointer()
+{
+    if (!rawDataValid_) {
+        rawData_.resize(static_cast<qsizetype>(rope_.length()));
+        rope_.copyRange(rawData_.data(), 0, rope_.length());
+        rawDataValid_ = true;
+    }
+    return rawData_.data();
+}
+
+
+/// Returns the given range as a continuous block of characters.
+/// The range is copied to a buffer that's reused by the next call, the complete rope is only flattened when it's already flattened
+/// @param offset the offset of the range
+/// @param length the length of the range
+const QChar* RopeTextBuffer::rangeDataPointer(size_t offset, size_t length)
+{
+    Q_ASSERT(offset + length <= rope_.length());
+    if (rawDataValid_) {
+        return rawData_.constData() + offset;
+    }
+    rangeData_.resize(static_cast<qsizetype>(length));
+    rope_.copyRange(rangeData_.data(), offset, length);
+    return rangeData_.constData();
+}
+
+
+/// Frees the copied text of rawDataPointer and rangeDataPointer, it's outdated after a change
+void RopeTextBuffer::releaseRawData()
+{
+    rawData_ = QString();
+    rawDataValid_ = false;
+    rangeData_ = QString();
+}
+
+
+/// Returns a snapshot of the text. The snapshot shares the rope, so this is O(1)
+TextBufferSnapshot RopeTextBuffer::snapshot()
+{
+    return TextBufferSnapshot(rope_, version());
+}
+
+
+} // edbee
@@ -0,0 +1,68 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/util/textrope.h"
+
+namespace edbee {
+
+
+/// This textbuffer implementation stores the text in a rope (a balanced tree of text chunks)
+///
+/// Compared to the CharTextBuffer, an edit doesn't move a gap through the buffer and the line
+/// offsets are stored in the tree. This keeps the cost of edits at random offsets in very large
+/// documents O(log n). Reading a single character is a bit slower, because it requires a tree walk.
+///
+/// With the TextRope::Latin1Storage mode, mostly-ASCII documents use about half the memory.
+class EDBEE_EXPORT RopeTextBuffer : public TextBuffer
+{
+public:
+    RopeTextBuffer(QObject* parent=nullptr);
+
+    virtual size_t length() const;
+    virtual QChar charAt(size_t offset) const;
+    virtual QString textPart(size_t offset, size_t length) const;
+
+    virtual void replaceText(size_t offset, size_t length, const QChar* buffer, size_t bufferLength);
+
+    virtual size_t lineCount() { return rope_.newlineCount() + 1; }
+
+    virtual size_t lineFromOffset(size_t offset);
+    virtual size_t offsetFromLine(size_t line);
+
+    virtual void rawAppendBegin();
+    virtual void rawAppend(QChar c);
+    virtual void rawAppend(const QChar* data, size_t dataLength);
+    virtual void rawAppendEnd();
+
+    virtual QChar* rawDataPointer();
+    virtual const QChar* rangeDataPointer(size_t offset, size_t length);
+
+    virtual TextBufferSnapshot snapshot();
+
+    /// Returns the rope with the text of this buffer
+    const TextRope& rope() const { return rope_; }
+
+    /// Returns the storage mode of the text
+    TextRope::StorageMode storageMode() const { return rope_.storageMode(); }
+    void setStorageMode(TextRope::StorageMode mode);
+
+private:
+    void releaseRawData();
+
+    TextRope rope_;                  ///< The rope with the text
+    QString rawAppendBuffer_;        ///< The data that's appended in raw mode
+    bool rawAppending_;              ///< Is raw appending active?
+
+    QString rawData_;                ///< The flattened text returned by rawDataPointer (freed at the next change)
+    bool rawDataValid_;              ///< Is the rawData_ buffer up-to-date?
+    QString rangeData_;              ///< The buffer for the rangeDataPointer result (freed at the next change)
+
+friend class RopeTextBufferTest;
+};
+
+} // edbee
@@ -5,6 +5,7 @@
 
 #include "edbee/models/textrange.h"
 #include "edbee/util/lineoffsetvector.h"
+#include "edbee/util/newlinescanner.h"
 
 #include "edbee/debug.h"
 
@@ -30,11 +31,7 @@ TextBufferChangeData::TextBufferChangeData(TextBuffer* buffer, size_t off, size_
     lineCount_    = endLine - line_;
 
     // find the newlines in the text
-    for (size_t i = 0; i < newTextLength_; ++i) {
-        if (newText_[i] == '\n') {
-            newLineOffsets_.append(offset_ + i + 1);    // +1 because it points to the start of the next line
-        }
-    }
+    NewlineScanner::appendNewlineOffsets(newText_, newTextLength_, offset_, newLineOffsets_);
 }
 
 
@@ -57,11 +54,29 @@ TextBufferChangeData::TextBufferChangeData(LineOffsetVector* lineOffsets, size_t
     lineCount_     = endLine - line_;
 
     // find the newlines in the text
-    for (size_t i = 0; i < newTextLength_; ++i) {
-        if( newText_[i] == '\n' ) {
-            newLineOffsets_.append(offset_ + i + 1);    // +1 because it points to the start of the next line
-        }
-    }
+    NewlineScanner::appendNewlineOffsets(newText_, newTextLength_, offset_, newLineOffsets_);
+}
+
+
+/// Initializes the textbuffer change with the already known newline offsets
+/// This prevents scanning the text for newlines again, when the caller already found them
+/// @param buffer the buffer used for the line calculations
+/// @param newLineOffsets the start offsets of the new lines in the text (offsets within the document)
+TextBufferChangeData::TextBufferChangeData(TextBuffer* buffer, size_t off, size_t len, const QChar *text, size_t textlen, const QVector<size_t>& newLineOffsets)
+    : offset_(off)
+    , length_(len)
+    , newText_(text)
+    , newTextLength_(textlen)
+    , newLineOffsets_(newLineOffsets)
+{
+    Q_ASSERT(buffer);
+
+    // decide which lines
+    line_          = buffer->lineFromOffset(offset_);
+    size_t endLine = buffer->lineFromOffset(offset_ + length_);
+    Q_ASSERT(endLine >= line_);
+
+    lineCount_     = endLine - line_;
 }
 
 
@@ -82,6 +97,12 @@ TextBufferChange::TextBufferChange(LineOffsetVector* lineOffsets, size_t off, si
 }
 
 
+TextBufferChange::TextBufferChange(TextBuffer* buffer, size_t off, size_t len, const QChar* text, size_t textlen, const QVector<size_t>& newLineOffsets)
+{
+    d_ = new TextBufferChangeData(buffer, off, len, text, textlen, newLineOffsets);
+}
+
+
 TextBufferChange::TextBufferChange(const TextBufferChange& other) : d_(other.d_)
 {
 }
@@ -110,6 +131,8 @@ const QString TextBufferChange::toDebugString() const
 /// The textbuffer constructor
 TextBuffer::TextBuffer(QObject *parent)
     : QObject(parent)
+    , version_(0)
+    , oldTextRequiredCount_(0)
 {
 }
 
@@ -124,6 +147,105 @@ void TextBuffer::replaceText(size_t offset, size_t length, const QString& text)
 }
 
 
+/// Replaces multiple ranges with a single change.
+/// All edits are combined to one replacement of the range from the first edit to the end of the last edit (see replacedText).
+/// This way the data is moved once, the line offsets are updated once and a single change is emitted.
+/// Listeners only see the combined change: line data and ranges between the edits are treated as replaced.
+/// That's why TextDocument::replaceRangeSet gives a change per range.
+/// @param edits the edits sorted by offset. The edits may not overlap
+void TextBuffer::replaceTexts(const QVector<TextBufferEdit>& edits)
+{
+    if (edits.isEmpty()) { return; }
+    size_t begin = edits.first().offset;
+    size_t end = edits.last().offset + edits.last().length;
+    if (edits.size() == 1) {
+        replaceText(begin, end - begin, edits.first().text);
+    } else {
+        replaceText(begin, end - begin, replacedText(edits));
+    }
+}
+
+
+/// Returns the new text of the range affected by the given edits, from the first offset to the end of the last edit
+/// The unchanged text between the edits is copied from the spans of the buffer in a single pass
+/// @param edits the edits sorted by offset. The edits may not overlap
+QString TextBuffer::replacedText(const QVector<TextBufferEdit>& edits)
+{
+    if (edits.isEmpty()) { return QString(); }
+    size_t begin = edits.first().offset;
+    size_t end = edits.last().offset + edits.last().length;
+    Q_ASSERT(end <= length());
+
+    // calculate the resulting length
+    size_t newLength = end - begin;
+    for (const TextBufferEdit& edit : edits) {
+        newLength = newLength - edit.length + static_cast<size_t>(edit.text.length());
+    }
+
+    QVector<TextBufferSpan> spanList = spans(begin, end - begin);
+    qsizetype spanIndex = 0;
+
+    QString result;
+    result.reserve(static_cast<qsizetype>(newLength));
+    size_t offset = begin;
+    for (const TextBufferEdit& edit : edits) {
+        Q_ASSERT(offset <= edit.offset);
+
+        // copy the unchanged text before this edit
+        while (offset < edit.offset) {
+            const TextBufferSpan& span = spanList.at(spanIndex);
+            size_t spanEnd = span.offset + span.length;
+            if (offset >= spanEnd) {
+                ++spanIndex;
+                continue;
+            }
+            size_t count = qMin(spanEnd, edit.offset) - offset;
+            result.append(span.data + (offset - span.offset), static_cast<qsizetype>(count));
+            offset += count;
+        }
+        result.append(edit.text);
+        offset = edit.offset + edit.length;
+    }
+    return result;
+}
+
+
+/// Ends the 'raw' appending of data, with the already known line offsets of the appended text.
+/// This prevents scanning the text for newlines again, for example when restoring a session snapshot.
+/// The default implementation ignores the offsets and calls rawAppendEnd
+/// @param newLineOffsets the start offsets of the new lines in the appended text (offsets within the document)
+void TextBuffer::rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets)
+{
+    Q_UNUSED(newLineOffsets);
+    rawAppendEnd();
+}
+
+
+/// Returns the given range as a continuous block of characters
+/// @param offset the offset of the range
+/// @param length the length of the range
+const QChar* TextBuffer::rangeDataPointer(size_t offset, size_t length)
+{
+    Q_ASSERT(offset + length <= this->length());
+    Q_UNUSED(length);
+    return rawDataPointer() + offset;
+}
+
+
+/// Returns the given range as one or more continuous blocks
+/// @param offset the offset of the range
+/// @param length the length of the range
+QVector<TextBufferSpan> TextBuffer::spans(size_t offset, size_t length)
+{
+    QVector<TextBufferSpan> result;
+    if (length > 0) {
+        TextBufferSpan span = { rangeDataPointer(offset, length), offset, length };
+        result.append(span);
+    }
+    return result;
+}
+
+
 /// Returns the full text as a QString
 QString TextBuffer::text()
 {
@@ -201,6 +323,35 @@ QString TextBuffer::lineWithoutNewline(size_t line)
 }
 
 
+/// Returns a view of the given text, without copying the text (see rangeDataPointer for the lifetime)
+/// @param offset the offset of the text
+/// @param length the number of characters
+QStringView TextBuffer::textPartView(size_t offset, size_t length)
+{
+    return QStringView(rangeDataPointer(offset, length), static_cast<qsizetype>(length));
+}
+
+
+/// Returns a view of the given line. This line INCLUDES the newline character (if it's there)
+/// @param line the line to return
+QStringView TextBuffer::lineView(size_t line)
+{
+    size_t off = offsetFromLine(line);
+    return textPartView(off, offsetFromLine(line + 1) - off);
+}
+
+
+/// Returns a view of the given line without the newline character
+/// @param line the line to return
+QStringView TextBuffer::lineWithoutNewlineView(size_t line)
+{
+    size_t off = offsetFromLine(line);
+    size_t removeNewlineCount = 1;
+    if (line == lineCount() - 1) { removeNewlineCount = 0; }
+    return textPartView(off, offsetFromLine(line + 1) - off - removeNewlineCount);
+}
+
+
 /// Returns the length of the given line. Also counting the trailing newline character if present
 /// @param line the line to retrieve the length for
 /// @return the length of the given line
@@ -296,6 +447,47 @@ size_t TextBuffer::findCharPosWithinRangeOrClamp(size_t offset, int direction, c
 
 
 
+/// Returns an immutable copy of the current content (see TextBufferSnapshot)
+/// The default implementation copies the text in chunks to a new rope, which is O(n).
+/// Implementations should override this method when they can share their data.
+TextBufferSnapshot TextBuffer::snapshot()
+{
+    const size_t chunkSize = 65536;
+    TextRope rope;
+    QString chunk;
+    for (size_t offset = 0, len = length(); offset < len; offset += chunkSize) {
+        chunk = textPart(offset, qMin(chunkSize, len - offset));
+        rope.append(chunk.constData(), static_cast<size_t>(chunk.length()));
+    }
+    return TextBufferSnapshot(rope, version_);
+}
+
+
+/// Registers a listener that requires the oldText argument of the textChanged signal.
+/// Copying the old text is expensive for large changes, so it's only done when at least one listener requires it.
+/// The requirement is reference counted: every call should be balanced with a call to releaseOldText
+void TextBuffer::acquireOldText()
+{
+    ++oldTextRequiredCount_;
+}
+
+
+/// Unregisters a listener that required the old text (see acquireOldText)
+void TextBuffer::releaseOldText()
+{
+    Q_ASSERT(oldTextRequiredCount_ > 0);
+    --oldTextRequiredCount_;
+}
+
+
+/// Increases the version of the content. Implementations should call this method on every change,
+/// before emitting the textChanged signal
+void TextBuffer::increaseVersion()
+{
+    ++version_;
+}
+
+
 // This method converts the line offsets as a comma-seperated string (easy for debugging)
 QString TextBuffer::lineOffsetsAsString()
 {
@@ -6,10 +6,13 @@
 #include "edbee/exports.h"
 
 #include <QObject>
+#include <QStringView>
 #include <QVector>
 #include <QSharedData>
 #include <QExplicitlySharedDataPointer>
 
+#include "edbee/models/textbuffersnapshot.h"
+
 namespace edbee {
 
 class TextBuffer;
@@ -24,6 +27,7 @@ class EDBEE_EXPORT TextBufferChangeData : public QSharedData
 public:
     TextBufferChangeData(TextBuffer* buffer, size_t off, size_t len, const QChar* text, size_t textlen);
     TextBufferChangeData(LineOffsetVector* lineOffsets, size_t off, size_t len, const QChar* text, size_t textlen);
+    TextBufferChangeData(TextBuffer* buffer, size_t off, size_t len, const QChar* text, size_t textlen, const QVector<size_t>& newLineOffsets);
 
     // text information
     size_t offset_;             ///< The offset in the buffer
@@ -46,6 +50,7 @@ public:
     TextBufferChange();
     TextBufferChange(TextBuffer* buffer, size_t off, size_t len, const QChar* text, size_t textlen);
     TextBufferChange(LineOffsetVector* lineOffsets, size_t off, size_t len, const QChar* text, size_t textlen);
+    TextBufferChange(TextBuffer* buffer, size_t off, size_t len, const QChar* text, size_t textlen, const QVector<size_t>& newLineOffsets);
     TextBufferChange(const TextBufferChange& other);
 
     size_t offset() const { return d_->offset_; }
@@ -64,6 +69,22 @@ private:
     QExplicitlySharedDataPointer<TextBufferChangeData> d_;
 };
 
+/// A continuous block of characters of a textbuffer
+struct TextBufferSpan {
+    const QChar* data;      ///< A pointer to the characters
+    size_t offset;          ///< The offset of the first character in the buffer
+    size_t length;          ///< The number of characters
+};
+
+
+/// A single replacement of a batched edit (see TextBuffer::replaceTexts)
+struct TextBufferEdit {
+    size_t offset;          ///< The offset of the text to replace
+    size_t length;          ///< The number of characters to replace
+    QString text;           ///< The new text
+};
+
+
 /// This class represents the textbuffer of the editor
 class EDBEE_EXPORT TextBuffer : public QObject
 {
@@ -109,18 +130,32 @@ public:
     /// WARNING the textAboutToBeReplaced signals are given but at that moment the text is already replaced
     /// And the newlines are already added to the newline list!
     virtual void rawAppendEnd() = 0;
+    virtual void rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets);
 
     /// returns the raw data buffer.
     /// WARNING this method CAN be slow because when using a gapvector the gap is moved to the end to make a full buffer
     /// Modifying the content of the data will mess up the line-offset-vector and other dependent classes. For reading it's ok :-)
     virtual QChar* rawDataPointer() = 0;
 
+    /// returns the given range as a continuous block of characters.
+    /// The default implementation uses rawDataPointer. Implementations should override this
+    /// method when they can provide the range without making the complete buffer continuous.
+    /// The pointer is only valid until the buffer is changed or until the next call to rangeDataPointer
+    virtual const QChar* rangeDataPointer(size_t offset, size_t length);
+
+    /// returns the given range as one or more continuous blocks, without moving any data.
+    /// The default implementation returns a single block from rangeDataPointer
+    virtual QVector<TextBufferSpan> spans(size_t offset, size_t length);
+
 
 // easy functions
 
     /// Replace the given text.
     virtual void replaceText(size_t offset, size_t length, const QString& text);
 
+    virtual void replaceTexts(const QVector<TextBufferEdit>& edits);
+    QString replacedText(const QVector<TextBufferEdit>& edits);
+
     QString text();
     void setText(const QString& text);
     virtual size_t columnFromOffsetAndLine(size_t offset, size_t line = std::string::npos);
@@ -128,6 +163,12 @@ public:
     virtual size_t offsetFromLineAndColumn(size_t line, size_t col);
     virtual QString line(size_t line);
     virtual QString lineWithoutNewline(size_t line);
+
+    /// The views below don't copy the text. A view has the same lifetime as the rangeDataPointer result:
+    /// It's only valid until the buffer is changed or until the next view or rangeDataPointer call
+    QStringView textPartView(size_t offset, size_t length);
+    QStringView lineView(size_t line);
+    QStringView lineWithoutNewlineView(size_t line);
     
     virtual size_t lineLength(size_t line);
     virtual size_t lineLengthWithoutNewline(size_t line);
@@ -140,11 +181,28 @@ public:
 
     virtual QString lineOffsetsAsString();
 
+    /// Returns the version of the content. The version is increased on every change
+    quint64 version() const { return version_; }
+
+    /// Returns true if the old text should be passed to the textChanged signal
+    bool isOldTextRequired() const { return oldTextRequiredCount_ > 0; }
+    void acquireOldText();
+    void releaseOldText();
+    virtual TextBufferSnapshot snapshot();
+
+protected:
+    void increaseVersion();
+
  signals:
 
     void textAboutToBeChanged(edbee::TextBufferChange change);
+    /// Emitted after the text has been changed.
+    /// The oldText is only filled when a listener requires it (see acquireOldText), else it's empty
     void textChanged(edbee::TextBufferChange change, QString oldText = QString());
 
+private:
+    quint64 version_;                ///< The version of the content
+    int oldTextRequiredCount_;       ///< The number of listeners that require the old text
 };
 
 } // edbee
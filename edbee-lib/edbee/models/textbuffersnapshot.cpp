@@ -0,0 +1,105 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textbuffersnapshot.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Constructs an empty snapshot
+TextBufferSnapshot::TextBufferSnapshot()
+    : version_(0)
+{
+}
+
+
+/// Constructs a snapshot with the given text
+/// @param rope the text of the snapshot. The rope is shared, this is O(1)
+/// @param version the version of the textbuffer
+/// @param usage the use count of the snapshots of the buffer, which is held by this snapshot
+TextBufferSnapshot::TextBufferSnapshot(const TextRope& rope, quint64 version, const TextBufferSnapshotUsageRef& usage)
+    : rope_(rope)
+    , version_(version)
+    , usage_(usage)
+{
+}
+
+
+/// Returns the number of characters
+size_t TextBufferSnapshot::length() const
+{
+    return rope_.length();
+}
+
+
+/// Returns the character at the given offset
+/// @param offset the offset of the character
+QChar TextBufferSnapshot::charAt(size_t offset) const
+{
+    Q_ASSERT(offset < rope_.length());
+    return rope_.at(offset);
+}
+
+
+/// Returns the given part of the text
+/// @param offset the offset of the text
+/// @param length the number of characters
+QString TextBufferSnapshot::textPart(size_t offset, size_t length) const
+{
+    Q_ASSERT(offset + length <= rope_.length());
+    return rope_.mid(offset, length);
+}
+
+
+/// Returns the complete text
+QString TextBufferSnapshot::text() const
+{
+    return rope_.mid(0, rope_.length());
+}
+
+
+/// Copies the given range to the target
+/// @param target the target buffer, which should be large enough for length characters
+/// @param offset the offset of the range
+/// @param length the number of characters to copy
+void TextBufferSnapshot::copyRange(QChar* target, size_t offset, size_t length) const
+{
+    rope_.copyRange(target, offset, length);
+}
+
+
+/// Returns the number of lines
+size_t TextBufferSnapshot::lineCount() const
+{
+    return rope_.newlineCount() + 1;
+}
+
+
+/// Returns the line at the given offset
+/// @param offset the offset to retrieve the line from
+size_t TextBufferSnapshot::lineFromOffset(size_t offset) const
+{
+    return rope_.lineFromOffset(qMin(offset, rope_.length()));
+}
+
+
+/// Returns the offset of the given line
+/// @param line the line to retrieve the offset for
+size_t TextBufferSnapshot::offsetFromLine(size_t line) const
+{
+    return rope_.offsetFromLine(line);
+}
+
+
+/// Returns the given line, including the newline character (if it's there)
+/// @param line the line to return
+QString TextBufferSnapshot::line(size_t line) const
+{
+    size_t offset = offsetFromLine(line);
+    return rope_.mid(offset, offsetFromLine(line + 1) - offset);
+}
+
+
+} // edbee
@@ -0,0 +1,58 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QExplicitlySharedDataPointer>
+#include <QSharedData>
+#include <QString>
+
+#include "edbee/util/textrope.h"
+
+namespace edbee {
+
+
+/// The shared use count of the snapshots of a textbuffer.
+/// Every snapshot holds a reference, so the buffer can see if its snapshots are still in use
+class EDBEE_EXPORT TextBufferSnapshotUsage : public QSharedData {};
+typedef QExplicitlySharedDataPointer<TextBufferSnapshotUsage> TextBufferSnapshotUsageRef;
+
+
+
+/// An immutable copy of the content of a textbuffer at a given version.
+///
+/// The text is stored in a persistent rope, so copying a snapshot is O(1) and a snapshot shares
+/// its structure with the buffer and other snapshots. A snapshot never changes after construction,
+/// which makes it safe to read it from a background thread while the buffer keeps changing.
+/// (Create the snapshot in the thread that owns the buffer, and pass a copy to the worker)
+class EDBEE_EXPORT TextBufferSnapshot {
+public:
+    TextBufferSnapshot();
+    TextBufferSnapshot(const TextRope& rope, quint64 version, const TextBufferSnapshotUsageRef& usage = TextBufferSnapshotUsageRef());
+
+    /// Returns the version of the textbuffer when this snapshot was taken
+    quint64 version() const { return version_; }
+
+    size_t length() const;
+    QChar charAt(size_t offset) const;
+    QString textPart(size_t offset, size_t length) const;
+    QString text() const;
+    void copyRange(QChar* target, size_t offset, size_t length) const;
+
+    size_t lineCount() const;
+    size_t lineFromOffset(size_t offset) const;
+    size_t offsetFromLine(size_t line) const;
+    QString line(size_t line) const;
+
+    /// Returns the rope with the text of this snapshot
+    const TextRope& rope() const { return rope_; }
+
+private:
+    TextRope rope_;         ///< The text
+    quint64 version_;       ///< The version of the buffer
+    TextBufferSnapshotUsageRef usage_;    ///< The use count of the snapshots of the buffer (optional)
+};
+
+} // edbee
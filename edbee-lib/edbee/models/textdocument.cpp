@@ -337,6 +337,15 @@ void TextDocument::setText(const QString& text)
 }
 
 
+/// Removes the text at the start of the document, without undo records (used for a rolling window, see TextDocumentFollower).
+/// The remaining text is lexed again, CharTextDocument keeps the scopes of the remaining lines
+/// @param length the length of the removed text, this should be the start of a line
+void TextDocument::removeLeadingText(size_t length)
+{
+    buffer()->replaceText(0, length, QString());
+}
+
+
 /// begins the raw append modes. In raw append mode data is directly streamed
 /// to the textdocument-buffer. No undo-data is collected and no events are fired
 void TextDocument::rawAppendBegin()
@@ -355,6 +364,15 @@ void TextDocument::rawAppendEnd()
 }
 
 
+/// Ends the raw append mode with the already known line offsets of the appended text
+/// @param newLineOffsets the start offsets of the new lines in the appended text (see TextBuffer::rawAppendEndWithLineOffsets)
+void TextDocument::rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets)
+{
+    buffer()->rawAppendEndWithLineOffsets(newLineOffsets);
+    setUndoCollectionEnabled(true);
+}
+
+
 /// Appends a single char in raw append mode
 void TextDocument::rawAppend(QChar c)
 {
@@ -500,4 +518,30 @@ QString TextDocument::line(size_t line)
 }
 
 
+/// Returns a view of the given part of the text, without copying the text.
+/// The view is only valid until the document is changed or until another view is requested
+/// @param offset the character offset in the document
+/// @param length the length of the part in characters
+QStringView TextDocument::textPartView(size_t offset, size_t length)
+{
+    return buffer()->textPartView(offset, length);
+}
+
+
+/// Returns a view of the given line without the trailing \n character (see textPartView for the lifetime)
+/// @param line the line number to retrieve the data for
+QStringView TextDocument::lineWithoutNewlineView(size_t line)
+{
+    return buffer()->lineWithoutNewlineView(line);
+}
+
+
+/// Returns a view of the given line inclusive the trailing \n character (see textPartView for the lifetime)
+/// @param line the line number to retrieve
+QStringView TextDocument::lineView(size_t line)
+{
+    return buffer()->lineView(line);
+}
+
+
 } // edbee
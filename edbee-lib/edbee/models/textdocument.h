@@ -119,10 +119,12 @@ public:
     void append(const QString& text, int coalesceId=0);
     void replace(size_t offset, size_t length, const QString& text, int coalesceId = 0);
     void setText(const QString& text);
+    virtual void removeLeadingText(size_t length);
 
     // raw access for filling the document
     void rawAppendBegin();
     void rawAppendEnd();
+    void rawAppendEndWithLineOffsets(const QVector<size_t>& newLineOffsets);
     void rawAppend(QChar c);
     void rawAppend(const QChar *chars, size_t length);
 
@@ -143,6 +145,9 @@ public:
     QString textPart(size_t offset, size_t length);
     QString lineWithoutNewline(size_t line);
     QString line(size_t line);
+    QStringView textPartView(size_t offset, size_t length);
+    QStringView lineWithoutNewlineView(size_t line);
+    QStringView lineView(size_t line);
 
 signals:
 
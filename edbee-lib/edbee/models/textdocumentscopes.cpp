@@ -136,6 +136,19 @@ void ScopedTextRangeList::squeeze()
 }
 
 
+/// Changes the references to the given multi-line range into references to the new range
+/// @param range the referenced range
+/// @param newRange the range that replaces this range
+void ScopedTextRangeList::replaceMultiLineScopedTextRange(MultiLineScopedTextRange* range, MultiLineScopedTextRange* newRange)
+{
+    for (ScopedTextRange* scopedRange : ranges_) {
+        if (scopedRange->multiLineScopedTextRange() == range) {
+            static_cast<MultiLineScopedTextRangeReference*>(scopedRange)->setMultiLineScopedTextRange(newRange);
+        }
+    }
+}
+
+
 /// set the independent flag. The independent flag means it's not dependent on other lines
 void ScopedTextRangeList::setIndependent(bool enable)
 {
@@ -723,6 +736,51 @@ void MultiLineScopedTextRangeSet::removeAndInvalidateRangesAfterOffset(size_t of
 }
 
 
+/// Removes the ranges before the given offset, when the text before this offset is removed from the document.
+/// The other ranges are moved to the start, a range that started in the removed text starts at offset 0
+/// @param offset the length of the removed text
+void MultiLineScopedTextRangeSet::removeRangesBeforeOffset(size_t offset)
+{
+    QList<MultiLineScopedTextRange*> ranges;
+    ranges.reserve(scopedRangeList_.size());
+    for (MultiLineScopedTextRange* range : scopedRangeList_) {
+        if (range->max() < offset) {
+            delete range;
+        } else {
+            range->set(range->anchor() > offset ? range->anchor() - offset : 0, range->caret() > offset ? range->caret() - offset : 0);
+            ranges.append(range);
+        }
+    }
+    scopedRangeList_ = ranges;  // the order by start offset isn't changed
+}
+
+
+/// Removes the ranges that start at or after the given offset, without deleting them
+/// @param offset the offset from which the ranges are removed
+/// @return the removed ranges, the caller is the owner of these ranges
+QList<MultiLineScopedTextRange*> MultiLineScopedTextRangeSet::takeRangesFromOffset(size_t offset)
+{
+    qsizetype idx = scopedRangeList_.size();
+    while (idx > 0 && scopedRangeList_.at(idx - 1)->min() >= offset) { --idx; }
+    QList<MultiLineScopedTextRange*> result = scopedRangeList_.mid(idx);
+    scopedRangeList_.erase(scopedRangeList_.begin() + idx, scopedRangeList_.end());
+    return result;
+}
+
+
+/// Replaces the given range with another range that starts at the same offset. The replaced range isn't deleted
+/// @param range the range to replace
+/// @param newRange the new range
+/// @return false if the range isn't found
+bool MultiLineScopedTextRangeSet::replaceScopedTextRange(MultiLineScopedTextRange* range, MultiLineScopedTextRange* newRange)
+{
+    qsizetype idx = scopedRangeList_.lastIndexOf(range);
+    if (idx < 0) { return false; }
+    scopedRangeList_[idx] = newRange;
+    return true;
+}
+
+
 /// Gives the scoped text range to this object
 void MultiLineScopedTextRangeSet::giveScopedTextRange(MultiLineScopedTextRange* textScope)
 {
@@ -766,6 +824,10 @@ TextDocumentScopes::TextDocumentScopes(TextDocument* textDocument)
     , defaultScopedRange_(0, 0, Edbee::instance()->scopeManager()->refTextScope("text.plain"))
     , scopedRanges_(textDocument, this)
     , lastScopedOffset_(0)
+    , hasStaleScopes_(false)
+    , staleBeginOffset_(0)
+    , staleEndOffset_(0)
+    , staleLine_(0)
 {
     connect(textDocument, SIGNAL(languageGrammarChanged()), this, SLOT(grammarChanged()));
 }
@@ -774,6 +836,7 @@ TextDocumentScopes::TextDocumentScopes(TextDocument* textDocument)
 /// The destructor
 TextDocumentScopes::~TextDocumentScopes()
 {
+    qDeleteAll(staleRanges_);
     for (size_t i = 0, cnt = lineRangeList_.length(); i < cnt; ++i) {
         delete lineRangeList_.at(i);
     }
@@ -853,6 +916,10 @@ void TextDocumentScopes::giveMultiLineScopedTextRange(MultiLineScopedTextRange *
 /// @param offset the offset from which to remove the offset
 void TextDocumentScopes::removeScopesAfterOffset(size_t offset)
 {
+    if (hasStaleScopes_) {
+        discardStaleScopes();
+        offset = qMin(offset, lastScopedOffset_);
+    }
     if (offset == 0) {
         scopedRanges_.clear();
     } else {
@@ -873,6 +940,228 @@ void TextDocumentScopes::removeScopesAfterOffset(size_t offset)
 }
 
 
+/// Removes the scopes of the given lines at the start of the document. Call this method before these lines are removed.
+/// The scopes of the remaining lines are moved, so these lines don't need to be lexed again.
+/// The change that removes the lines shouldn't be passed to the lexer (see CharTextDocument::removeLeadingText)
+/// @param offset the length of the removed text
+/// @param lineCount the number of removed lines
+void TextDocumentScopes::removeScopesBeforeOffset(size_t offset, size_t lineCount)
+{
+    if (hasStaleScopes_) {
+        removeScopesAfterOffset(lastScopedOffset_);
+    }
+
+    // none of the remaining text has been scoped
+    if (lastScopedOffset_ <= offset) {
+        scopedRanges_.clear();
+        for (size_t i = 0, cnt = lineRangeList_.length(); i < cnt; ++i) {
+            delete lineRangeList_.at(i);
+        }
+        lineRangeList_.clear();
+        setLastScopedOffset(0);
+        return;
+    }
+
+    scopedRanges_.removeRangesBeforeOffset(offset);
+    size_t count = qMin(lineCount, lineRangeList_.length());
+    for (size_t i = 0; i < count; ++i) {
+        delete lineRangeList_.at(i);
+    }
+    lineRangeList_.replace(0, count, 0, 0);
+    setLastScopedOffset(lastScopedOffset_ - offset);
+}
+
+
+/// Moves the scopes after a change of the text, so the lines after the change don't need to be lexed again.
+///
+/// The scopes of the lines from the changed line become stale: the line lists are moved with the text, and the
+/// multi-line ranges that start in these lines are moved to a separate set. The multi-line ranges that are open
+/// at the changed line are reopened, like removeScopesAfterOffset does. The lexer restarts at the changed line,
+/// and calls reuseStaleScopes after every line. When the lexer state at the end of a line is the same as the
+/// state at the start of the stale next line, the remaining stale scopes are valid again.
+///
+/// @param change the change of the text (the document already contains the new text)
+void TextDocumentScopes::moveScopesAfterChange(const TextBufferChange& change)
+{
+    TextDocument* doc = textDocument();
+    size_t line = change.line();
+    size_t lineStart = doc->offsetFromLine(line);
+
+    // nothing that has been lexed is changed
+    if (!hasStaleScopes_ && lastScopedOffset_ <= lineStart) {
+        removeScopesAfterOffset(lineStart);
+        return;
+    }
+
+    // moves an offset of the old text to the new text, an offset in the replaced text is moved to the start of the change
+    size_t changeOffset = change.offset();
+    size_t changeEnd = change.offset() + change.length();
+    size_t newChangeEnd = change.offset() + change.newTextLength();
+    auto moveOffset = [=](size_t offset) -> size_t {
+        return offset >= changeEnd ? offset - changeEnd + newChangeEnd : qMin(offset, changeOffset);
+    };
+
+    // the stale lines can only be reused after the changed lines, and after the lines that were lexed after the previous change
+    size_t restartOffset = qMin(moveOffset(lastScopedOffset_), lineStart);
+    size_t lastChangedLine = line + change.newLineCount();
+    if (hasStaleScopes_) {
+        size_t staleLine = staleLine_;
+        if (staleLine >= line + change.lineCount()) {
+            staleLine = staleLine - change.lineCount() + change.newLineCount();
+        } else if (staleLine > line) {
+            staleLine = lastChangedLine;
+        }
+        staleLine_ = qMax(qMax(staleLine, lastChangedLine), doc->lineFromOffset(moveOffset(lastScopedOffset_)));
+        staleBeginOffset_ = qMin(moveOffset(staleBeginOffset_), lineStart);
+        staleEndOffset_ = moveOffset(staleEndOffset_);
+    } else {
+        hasStaleScopes_ = true;
+        staleLine_ = lastChangedLine;
+        staleBeginOffset_ = lineStart;
+        staleEndOffset_ = moveOffset(lastScopedOffset_);
+    }
+
+    // move the multi-line ranges
+    for (MultiLineScopedTextRange* range : staleRanges_) {
+        range->set(moveOffset(range->anchor()), moveOffset(range->caret()));
+    }
+    for (QHash<MultiLineScopedTextRange*, size_t>::iterator itr = staleRangeEnds_.begin(); itr != staleRangeEnds_.end(); ++itr) {
+        itr.value() = moveOffset(itr.value());
+    }
+    for (size_t i = 0, cnt = scopedRanges_.rangeCount(); i < cnt; ++i) {
+        MultiLineScopedTextRange& range = scopedRanges_.scopedRange(i);
+        range.set(moveOffset(range.anchor()), moveOffset(range.caret()));
+    }
+
+    // the ranges that start after the restart offset become stale, the ranges that are open are reopened
+    for (MultiLineScopedTextRange* range : scopedRanges_.takeRangesFromOffset(restartOffset)) {
+        if (staleRangeEnds_.contains(range)) {
+            range->maxVar() = staleRangeEnds_.take(range);
+        }
+        staleRanges_.insert(range);
+    }
+    size_t length = doc->length();
+    for (size_t i = 0, cnt = scopedRanges_.rangeCount(); i < cnt; ++i) {
+        MultiLineScopedTextRange& range = scopedRanges_.scopedRange(i);
+        if (range.max() >= restartOffset) {
+            if (!staleRangeEnds_.contains(&range)) {
+                staleRangeEnds_.insert(&range, range.max());
+            }
+            range.maxVar() = length;
+        }
+    }
+
+    // move the line lists, the list of the last changed line is kept (the end of this line isn't changed)
+    size_t lineRangeCount = lineRangeList_.length();
+    if (line < lineRangeCount) {
+        size_t removedLineCount = qMin(change.lineCount(), lineRangeCount - line);
+        for (size_t i = line; i < line + removedLineCount; ++i) {
+            delete lineRangeList_.at(i);
+        }
+        lineRangeList_.fill(line, removedLineCount, 0, change.newLineCount());
+    }
+
+    setLastScopedOffset(restartOffset);
+}
+
+
+/// Called by the lexer after lexing a line while there are stale scopes. When the multi-line ranges that are
+/// open at the end of the line are the same as the ranges at the start of the next (stale) line, the stale scopes
+/// are valid: the new ranges are replaced by the stale ranges and the last scoped offset is moved to the end
+/// of the stale lines.
+///
+/// @param line the line that has been lexed
+/// @param nextLineOffset the offset of the next line
+/// @param activeRanges the multi-line ranges that are open at the end of the line (starting with the default range)
+/// @return true if the stale scopes are reused, the lexer can stop
+bool TextDocumentScopes::reuseStaleScopes(size_t line, size_t nextLineOffset, const QVector<MultiLineScopedTextRange*>& activeRanges)
+{
+    if (!hasStaleScopes_ || line < staleLine_ || nextLineOffset >= staleEndOffset_) { return false; }
+    ScopedTextRangeList* list = scopedRangesAtLine(line + 1);
+    if (!list) { return false; }
+
+    // the multi-line ranges that were open at the start of the next line are referenced at the start of the list
+    QVector<MultiLineScopedTextRange*> staleActiveRanges;
+    for (size_t i = 0, cnt = list->size(); i < cnt; ++i) {
+        MultiLineScopedTextRange* range = list->at(i)->multiLineScopedTextRange();
+        if (!range) { break; }
+        staleActiveRanges.append(range);
+    }
+    if (staleActiveRanges.size() != activeRanges.size()) { return false; }
+
+    // the same rules and end expressions (which contain the captures of the start) mean the lexer state is the same.
+    // A stale range can only replace a range that has been created after the change
+    for (qsizetype i = 0; i < activeRanges.size(); ++i) {
+        MultiLineScopedTextRange* range = activeRanges.at(i);
+        MultiLineScopedTextRange* staleRange = staleActiveRanges.at(i);
+        if (range == staleRange) { continue; }
+        if (range->grammarRule() != staleRange->grammarRule()) { return false; }
+        RegExp* endRegExp = range->endRegExp();
+        RegExp* staleEndRegExp = staleRange->endRegExp();
+        if ((endRegExp == nullptr) != (staleEndRegExp == nullptr)) { return false; }
+        if (endRegExp && endRegExp->pattern() != staleEndRegExp->pattern()) { return false; }
+        if (range->min() < staleBeginOffset_ || !staleRanges_.contains(staleRange)) { return false; }
+    }
+
+    // the stale ranges replace the new ranges, which are referenced by the lines lexed after the change
+    for (qsizetype i = 0; i < activeRanges.size(); ++i) {
+        MultiLineScopedTextRange* range = activeRanges.at(i);
+        MultiLineScopedTextRange* staleRange = staleActiveRanges.at(i);
+        if (range == staleRange) {
+            if (staleRangeEnds_.contains(range)) { range->maxVar() = staleRangeEnds_.value(range); }
+            continue;
+        }
+        staleRange->setAnchor(range->min());
+        for (size_t rangeLine = textDocument()->lineFromOffset(range->min()); rangeLine <= line; ++rangeLine) {
+            ScopedTextRangeList* rangeList = scopedRangesAtLine(rangeLine);
+            if (rangeList) { rangeList->replaceMultiLineScopedTextRange(range, staleRange); }
+        }
+        scopedRanges_.replaceScopedTextRange(range, staleRange);
+        staleRanges_.remove(staleRange);
+        delete range;
+    }
+
+    // the stale ranges after the line are valid, the others have been lexed again
+    QList<MultiLineScopedTextRange*> validRanges;
+    for (MultiLineScopedTextRange* range : staleRanges_) {
+        if (range->min() >= nextLineOffset) {
+            validRanges.append(range);
+        } else {
+            delete range;
+        }
+    }
+    std::sort(validRanges.begin(), validRanges.end(), MultiLineScopedTextRange::lessThan);
+    for (MultiLineScopedTextRange* range : validRanges) {
+        scopedRanges_.giveScopedTextRange(range);
+    }
+    staleRanges_.clear();
+    staleRangeEnds_.clear();
+    hasStaleScopes_ = false;
+
+    setLastScopedOffset(staleEndOffset_);
+    return true;
+}
+
+
+/// Deletes the stale multi-line ranges. The line lists after the last scoped offset should be removed
+void TextDocumentScopes::discardStaleScopes()
+{
+    qDeleteAll(staleRanges_);
+    staleRanges_.clear();
+    staleRangeEnds_.clear();
+    hasStaleScopes_ = false;
+
+    // the line at the last scoped offset hasn't been lexed, the list can reference the deleted ranges
+    if (lastScopedOffset_ < textDocument()->length()) {
+        size_t line = textDocument()->lineFromOffset(lastScopedOffset_);
+        if (line < lineRangeList_.length()) {
+            delete lineRangeList_.at(line);
+            lineRangeList_.set(line, 0);
+        }
+    }
+}
+
+
 /// Retursn the default scoped textrange
 /// Currently this is done very dirty, by retrieving the defaultscoped range the begin and end is set tot he complete document
 /// a better solution would be a subclass that always returns 0 for an anchor and the documentlength for the caret
@@ -7,6 +7,7 @@
 
 #include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 #include <QVector>
 
@@ -18,6 +19,7 @@ namespace edbee {
 class MultiLineScopedTextRange;
 class RegExp;
 class ScopedTextRange;
+class TextBufferChange;
 class TextDocumentScopes;
 class TextGrammarRule;
 class TextScope;
@@ -205,6 +207,7 @@ public:
 
     /// returns the multi-line scoped text range
     virtual MultiLineScopedTextRange* multiLineScopedTextRange();
+    void setMultiLineScopedTextRange(MultiLineScopedTextRange* range) { multiScopeRef_ = range; }
 
 private:
     MultiLineScopedTextRange* multiScopeRef_;       ///< the reference to the multi-scoped textrange that defined this scope
@@ -230,6 +233,7 @@ public:
     void giveAndPrependRange(ScopedTextRange* range);
 
     void squeeze();
+    void replaceMultiLineScopedTextRange(MultiLineScopedTextRange* range, MultiLineScopedTextRange* newRange);
     void setIndependent(bool enable = true);
     bool isIndependent() const;
 
@@ -293,6 +297,9 @@ public:
     virtual MultiLineScopedTextRange& addRange(size_t anchor, size_t caret, const QString& name , TextGrammarRule *rule);
 
     void removeAndInvalidateRangesAfterOffset(size_t offset);
+    void removeRangesBeforeOffset(size_t offset);
+    QList<MultiLineScopedTextRange*> takeRangesFromOffset(size_t offset);
+    bool replaceScopedTextRange(MultiLineScopedTextRange* range, MultiLineScopedTextRange* newRange);
 
     // adds a text scope
     void giveScopedTextRange(MultiLineScopedTextRange* textScope);
@@ -333,7 +340,16 @@ public:
 
     void giveMultiLineScopedTextRange(MultiLineScopedTextRange* range);
     void removeScopesAfterOffset(size_t offset);
+    void removeScopesBeforeOffset(size_t offset, size_t lineCount);
+
+    // convergent re-lexing after a change
+    void moveScopesAfterChange(const TextBufferChange& change);
+    bool reuseStaleScopes(size_t line, size_t nextLineOffset, const QVector<MultiLineScopedTextRange*>& activeRanges);
+    bool hasStaleScopes() const { return hasStaleScopes_; }
+    size_t staleEndOffset() const { return staleEndOffset_; }
+
     MultiLineScopedTextRange& defaultScopedRange();
+    MultiLineScopedTextRangeSet* multiLineScopedRangeSet() { return &scopedRanges_; }
 
     QVector<MultiLineScopedTextRange*> multiLineScopedRangesBetweenOffsets(size_t offsetBegin, size_t offsetEnd);
     TextScopeList scopesAtOffset(size_t offset, bool includeEnd = false);
@@ -355,6 +371,8 @@ signals:
     void lastScopedOffsetChanged(size_t previousOffset, size_t lastScopedOffset);
 
 private:
+    void discardStaleScopes();
+
     TextDocument* textDocumentRef_;             ///< The default document reference
 
     MultiLineScopedTextRange defaultScopedRange_;     ///< The default scoped text range
@@ -370,6 +388,14 @@ private:
     ///
     /// The scopedToOffset_ should only mark the multi-line scopes. Single lines scopes do NOT affect other regions of the document
     size_t lastScopedOffset_;            ///< How far has the text been fully scoped?
+
+    // The scopes after the last scoped offset that have been lexed before a change (see moveScopesAfterChange)
+    bool hasStaleScopes_;                                       ///< Are there stale scopes after the last scoped offset?
+    size_t staleBeginOffset_;                                   ///< The start of the first changed line
+    size_t staleEndOffset_;                                     ///< The offset up to which the stale lines have been lexed
+    size_t staleLine_;                                          ///< The first line after which the stale lines can be reused
+    QSet<MultiLineScopedTextRange*> staleRanges_;               ///< The multi-line ranges that start in the stale lines
+    QHash<MultiLineScopedTextRange*, size_t> staleRangeEnds_;   ///< The previous end offsets of the ranges that were reopened
 };
 
 
@@ -7,11 +7,15 @@
 
 #include "edbee/io/tmlanguageparser.h"
 #include "edbee/util/regexp.h"
+#include "edbee/edbee.h"
 
 #include "edbee/debug.h"
 
 namespace edbee {
 
+static const int MaxIncludeDepth = 32;  ///< The maximum number of includes that include another include
+
+
 
 /// The text grammar rule constructor
 /// @param grammar the grammar this rule belongs to
@@ -177,6 +181,48 @@ RegExp* TextGrammarRule::createRegExp(const QString& regexp)
 //==========================
 
 
+/// Constructs an empty context
+TextGrammarRuleContext::TextGrammarRuleContext()
+    : scanner_(nullptr)
+{
+}
+
+
+/// Destructs the context and the scanner
+TextGrammarRuleContext::~TextGrammarRuleContext()
+{
+    delete scanner_;
+}
+
+
+/// Appends the given rule to the context
+/// @param rule a single-line or multi-line regexp rule
+void TextGrammarRuleContext::appendRule(TextGrammarRule* rule)
+{
+    rules_.append(rule);
+    regExps_.append(rule->matchRegExp());
+}
+
+
+/// Creates the scanner for the match expressions, after all rules have been appended.
+/// A single expression doesn't need a scanner, and expressions that don't support scanning are searched one by one
+void TextGrammarRuleContext::createScanner()
+{
+    delete scanner_;
+    scanner_ = nullptr;
+    if (regExps_.size() < 2) { return; }
+
+    scanner_ = new RegExpScanner(regExps_);
+    if (!scanner_->isValid()) {
+        delete scanner_;
+        scanner_ = nullptr;
+    }
+}
+
+
+//==========================
+
+
 /// The default texgrammar constructor
 /// @param name the name of the textgrammar
 /// @param displayName th name to display
@@ -184,6 +230,7 @@ TextGrammar::TextGrammar(const QString& name, const QString& displayName)
     : name_(name)
     , displayName_(displayName)
     , mainRule_(nullptr)
+    , ruleContextsGeneration_(0)
 {
 
 }
@@ -192,6 +239,7 @@ TextGrammar::TextGrammar(const QString& name, const QString& displayName)
 /// The textgrammar destructor
 TextGrammar::~TextGrammar()
 {
+    clearRuleContexts();
     qDeleteAll(repository_);
     repository_.clear();
     delete mainRule_;
@@ -203,6 +251,7 @@ void TextGrammar::giveMainRule(TextGrammarRule* mainRule)
 {
     Q_ASSERT(!mainRule_);
     mainRule_ = mainRule;
+    clearRuleContexts();
 }
 
 
@@ -239,6 +288,7 @@ QStringList TextGrammar::fileExtensions() const
 void TextGrammar::giveToRepos(const QString& name, TextGrammarRule* rule)
 {
     repository_.insert(name, rule);
+    clearRuleContexts();
 }
 
 
@@ -260,12 +310,114 @@ void TextGrammar::addFileExtension(const QString& ext)
 }
 
 
+/// Finds the rule that's included by the given include rule.
+/// A repository include ("#name") is searched in the grammar of the include rule, "$self" and "$base" refer to the main
+/// rule of this grammar, other names are the names of other grammars
+/// @param includeRule the include rule
+/// @return the included rule or nullptr if it isn't found
+TextGrammarRule* TextGrammar::findIncludedRule(TextGrammarRule* includeRule)
+{
+    Q_ASSERT(includeRule->isIncludeCall());
+    QString name = includeRule->includeName();
+
+    // repos call
+    if (name.startsWith("#")) {
+        return includeRule->grammar()->findFromRepos(name.mid(1));
+    }
+
+    // another language call
+    // The difference between $base and $self is very subtle.. The exact difference is unkown to me..
+    if (name == "$base" || name == "$self") {
+        return mainRule();
+    }
+
+    TextGrammar* grammar = Edbee::instance()->grammarManager()->get(name);
+    if (grammar) { return grammar->mainRule(); }
+    return nullptr;
+}
+
+
+/// Returns the compiled context of the given rule, the context is compiled on first use.
+/// The contexts are compiled again after a grammar has been added to the grammar manager, because an include can
+/// refer to another grammar. The rules shouldn't be changed after a grammar has been used by a lexer.
+/// @param rule the active rule (the main rule, or a multi-line rule of this grammar or an included grammar)
+/// @return the context with all rules that can match while the given rule is active
+TextGrammarRuleContext* TextGrammar::ruleContext(TextGrammarRule* rule)
+{
+    int generation = Edbee::instance()->grammarManager()->generation();
+    if (ruleContextsGeneration_ != generation) {
+        clearRuleContexts();
+        ruleContextsGeneration_ = generation;
+    }
+
+    TextGrammarRuleContext* context = ruleContexts_.value(rule);
+    if (!context) {
+        context = new TextGrammarRuleContext();
+        // a main rule that includes itself ($self) isn't expanded again, a multi-line rule can contain itself
+        QSet<TextGrammarRule*> addedRules;
+        if (!rule->isMultiLineRegExp()) { addedRules.insert(rule); }
+        compileRuleContext(context, rule, addedRules);
+        context->createScanner();
+        ruleContexts_.insert(rule, context);
+    }
+    return context;
+}
+
+
+/// Appends the rules that can match in the child rules of the given rule to the context (depth first)
+/// @param context the context to append the rules to
+/// @param rule the rule with the child rules
+/// @param addedRules the rules that already have been added
+void TextGrammar::compileRuleContext(TextGrammarRuleContext* context, TextGrammarRule* rule, QSet<TextGrammarRule*>& addedRules)
+{
+    for (qsizetype i = 0, cnt = rule->ruleCount(); i < cnt; ++i) {
+        TextGrammarRule* childRule = rule->rule(i);
+
+        // an include can refer to another include
+        for (int depth = 0; childRule && childRule->isIncludeCall() && depth < MaxIncludeDepth; ++depth) {
+            TextGrammarRule* includedRule = findIncludedRule(childRule);
+            if (!includedRule) {
+                qlog_warn() << "ERROR, include rule" << childRule->includeName() << "not found!";
+            }
+            childRule = includedRule;
+        }
+        if (!childRule || addedRules.contains(childRule)) { continue; }
+        addedRules.insert(childRule);
+
+        switch (childRule->instruction()) {
+            case TextGrammarRule::SingleLineRegExp:
+            case TextGrammarRule::MultiLineRegExp:
+                if (childRule->matchRegExp()) { context->appendRule(childRule); }
+                break;
+            case TextGrammarRule::MainRule:
+            case TextGrammarRule::RuleList:
+                compileRuleContext(context, childRule, addedRules);
+                break;
+            case TextGrammarRule::IncludeCall:
+                qlog_warn() << "ERROR, include rule" << childRule->includeName() << "includes itself!";
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+/// Deletes the compiled rule contexts
+void TextGrammar::clearRuleContexts()
+{
+    qDeleteAll(ruleContexts_);
+    ruleContexts_.clear();
+}
+
+
 //==========================
 
 
 /// The text grammar manager constructor
 TextGrammarManager::TextGrammarManager()
     : defaultGrammarRef_(nullptr)
+    , generation_(0)
 {
 
     // always make sure there's a default grammar
@@ -345,6 +497,7 @@ void TextGrammarManager::giveGrammar(TextGrammar* grammar)
         delete oldGrammar;
     }
     grammarMap_.insert(name, grammar);
+    ++generation_;
 }
 
 
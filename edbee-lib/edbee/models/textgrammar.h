@@ -8,15 +8,19 @@
 #include <QHash>
 #include <QList>
 #include <QMap>
+#include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
 class QFile;
 
 namespace edbee {
 
 class RegExp;
+class RegExpScanner;
 class TextGrammar;
+class TextGrammarRuleContext;
 class Edbee;
 
 
@@ -118,6 +122,35 @@ private:
 //================================
 
 
+/// The compiled patterns of a grammar rule: all rules that can match while this rule is active.
+/// The child rules are flattened in the order in which the lexer tries them, with the includes resolved.
+/// A rule that's reachable more than once is only added the first time (the first rule wins on the same position).
+/// A context with multiple rules has a scanner, which searches all match expressions in a single scan.
+class EDBEE_EXPORT TextGrammarRuleContext {
+public:
+    TextGrammarRuleContext();
+    virtual ~TextGrammarRuleContext();
+
+    void appendRule(TextGrammarRule* rule);
+    void createScanner();
+
+    qsizetype ruleCount() const { return rules_.size(); }
+    TextGrammarRule* rule(qsizetype idx) const { return rules_.at(idx); }
+    RegExp* regExp(qsizetype idx) const { return regExps_.at(idx); }
+
+    /// The scanner of all match expressions (nullptr if the expressions are searched one by one)
+    RegExpScanner* scanner() const { return scanner_; }
+
+private:
+    QVector<TextGrammarRule*> rules_;     ///< The single-line and multi-line regexp rules
+    QVector<RegExp*> regExps_;            ///< The match expressions of the rules
+    RegExpScanner* scanner_;              ///< The scanner of the match expressions
+};
+
+
+//================================
+
+
 /// This class defines a single language grammar
 class EDBEE_EXPORT TextGrammar {
 public:
@@ -134,14 +167,24 @@ public:
 
     void giveToRepos(const QString& name, TextGrammarRule* rule);
     TextGrammarRule* findFromRepos( const QString& name, TextGrammarRule* defValue = nullptr);
+    QList<TextGrammarRule*> reposRules() const { return repository_.values(); }
     void addFileExtension(const QString& ext);
 
+    TextGrammarRule* findIncludedRule(TextGrammarRule* includeRule);
+    TextGrammarRuleContext* ruleContext(TextGrammarRule* rule);
+
 private:
+    void compileRuleContext(TextGrammarRuleContext* context, TextGrammarRule* rule, QSet<TextGrammarRule*>& addedRules);
+    void clearRuleContexts();
+
     QString name_;                               ///< the display name of this
     QString displayName_;                        ///< the name to display
     TextGrammarRule *mainRule_;                  ///< the 'main' rule of this grammar
     QMap<QString, TextGrammarRule*> repository_; ///< A map with all named grammar rules
     QStringList fileExtensions_;                 ///< A list with all file-extensions
+
+    QHash<TextGrammarRule*, TextGrammarRuleContext*> ruleContexts_;  ///< The compiled rule contexts (with this grammar as $self)
+    int ruleContextsGeneration_;                 ///< The grammar manager generation the rule contexts are compiled for
 };
 
 
@@ -171,11 +214,15 @@ public:
 
     QString lastErrorMessage() const;
 
+    /// The generation is increased when a grammar is added or replaced (the compiled includes are invalid then)
+    int generation() const { return generation_; }
+
 private:
 
     TextGrammar* defaultGrammarRef_;                   ///< A reference to the default grammar
     QMap<QString,TextGrammar*> grammarMap_;            ///< A map with all grammar definitions
     QString lastErrorMessage_;                             ///< Returns the error message
+    int generation_;                                   ///< The number of times a grammar has been added
 
     friend class Edbee;
 };
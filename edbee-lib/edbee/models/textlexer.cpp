@@ -10,9 +10,13 @@
 
 namespace edbee {
 
+static const size_t DefaultMaxLineLength = 20000;   ///< Longer lines (minified files, data dumps) would block the lexer
+
 TextLexer::TextLexer( TextDocumentScopes* scopes)
     : textDocumentScopesRef_(scopes)
     , grammarRef_(nullptr)
+    , suspended_(false)
+    , maxLineLength_(DefaultMaxLineLength)
 {
 }
 
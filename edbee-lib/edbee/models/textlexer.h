@@ -38,9 +38,19 @@ public:
     TextDocumentScopes* textScopes() { return textDocumentScopesRef_; }
     TextDocument* textDocument();
 
+    /// A suspended lexer ignores lexRange calls (used while a document is loading)
+    void setSuspended(bool suspended) { suspended_ = suspended; }
+    bool isSuspended() const { return suspended_; }
+
+    /// Lines longer than this length aren't matched with the grammar, they're rendered without styling (0 lexes every line)
+    void setMaxLineLength(size_t length) { maxLineLength_ = length; }
+    size_t maxLineLength() const { return maxLineLength_; }
+
 private:
     TextDocumentScopes* textDocumentScopesRef_; ///< A Text document refs
     TextGrammar* grammarRef_;                   ///< The reference to the active grammar
+    bool suspended_;                            ///< Is lexing suspended?
+    size_t maxLineLength_;                      ///< The length of the longest line that's matched with the grammar
 };
 
 } // edbee
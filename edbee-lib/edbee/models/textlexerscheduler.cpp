@@ -0,0 +1,145 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textlexerscheduler.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "edbee/models/textdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textlexer.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const int DefaultForegroundDuration = 20;    ///< The default time a requestRange call may lex (ms)
+static const int DefaultSliceDuration = 10;         ///< The default duration of a background slice (ms)
+static const size_t BlockLineCount = 64;            ///< The maximum number of lines that are lexed between two time checks
+static const size_t BlockCharCount = 16384;         ///< The maximum number of characters that are lexed between two time checks
+
+
+/// Constructs the lexer scheduler
+/// @param parent the parent of this object
+TextLexerScheduler::TextLexerScheduler(QObject* parent)
+    : QObject(parent)
+    , timer_(new QTimer(this))
+    , targetOffset_(0)
+    , foregroundDuration_(DefaultForegroundDuration)
+    , sliceDuration_(DefaultSliceDuration)
+{
+    timer_->setSingleShot(true);
+    connect(timer_, SIGNAL(timeout()), this, SLOT(lexSlice()));
+}
+
+
+TextLexerScheduler::~TextLexerScheduler()
+{
+}
+
+
+/// Requests the lexing of the given range. (Called by the renderer before painting the given range)
+/// The document is lexed up to the end of the range for at most the foreground duration,
+/// the remaining lines are lexed in the background.
+/// A request of the range that's already being lexed in the background doesn't lex in the foreground again,
+/// the repaint after a background slice would else block the user interface for the foreground duration.
+/// @param textDocument the document to lex
+/// @param beginOffset the first offset of the range
+/// @param endOffset the end offset of the range
+void TextLexerScheduler::requestRange(TextDocument* textDocument, size_t beginOffset, size_t endOffset)
+{
+    Q_UNUSED(beginOffset)
+    if (timer_->isActive() && textDocumentRef_ == textDocument && targetOffset_ == endOffset) { return; }
+    textDocumentRef_ = textDocument;
+    targetOffset_ = endOffset;
+
+    if (lex(foregroundDuration_, false)) {
+        if (!timer_->isActive()) { timer_->start(0); }
+    } else {
+        timer_->stop();
+    }
+}
+
+
+/// Stops the background lexing
+void TextLexerScheduler::cancel()
+{
+    timer_->stop();
+    textDocumentRef_ = nullptr;
+    targetOffset_ = 0;
+}
+
+
+/// Returns true if the requested range hasn't been lexed completely
+bool TextLexerScheduler::isPending() const
+{
+    if (!textDocumentRef_ || !textDocumentRef_->textLexer()) { return false; }
+    return textDocumentRef_->scopes()->lastScopedOffset() < qMin(targetOffset_, textDocumentRef_->length());
+}
+
+
+/// Lexes the next slice of the requested range, and schedules the next slice when the range isn't complete.
+/// This is called by the timer, but can also be called directly
+/// @return true if there's more to lex
+bool TextLexerScheduler::lexSlice()
+{
+    if (!textDocumentRef_) { return false; }
+
+    TextDocumentScopes* scopes = textDocumentRef_->scopes();
+    size_t previousOffset = scopes->lastScopedOffset();
+    bool more = lex(sliceDuration_, true);
+    if (scopes->lastScopedOffset() != previousOffset) {
+        emit lexed(previousOffset, scopes->lastScopedOffset());
+    }
+    if (more) { timer_->start(0); }
+    return more;
+}
+
+
+/// Lexes blocks of lines from the last scoped offset to the target offset, until the given duration has passed
+/// @param duration the maximum duration in milliseconds
+/// @param lexAtLeastOneBlock always lex a block, even if the duration is 0
+/// @return true if the target offset hasn't been reached
+bool TextLexerScheduler::lex(int duration, bool lexAtLeastOneBlock)
+{
+    if (!textDocumentRef_) { return false; }
+    TextDocument* doc = textDocumentRef_;
+    TextLexer* lexer = doc->textLexer();
+
+    // a suspended lexer is resumed with a repaint, which requests the range again
+    if (!lexer || lexer->isSuspended()) { return false; }
+
+    TextDocumentScopes* scopes = doc->scopes();
+    size_t endOffset = qMin(targetOffset_, doc->length());
+
+    QElapsedTimer timer;
+    timer.start();
+    while (scopes->lastScopedOffset() < endOffset) {
+        if (!lexAtLeastOneBlock && timer.elapsed() >= duration) { return true; }
+        lexAtLeastOneBlock = false;
+
+        // a block ends after a number of lines or characters, so long lines don't exceed the duration much
+        size_t offset = scopes->lastScopedOffset();
+        size_t line = doc->lineFromOffset(offset);
+        size_t blockEndLine = line + 1;
+        size_t blockCharCount = doc->lineLength(line);
+        size_t lineCount = doc->lineCount();
+        while (blockEndLine < lineCount && blockEndLine - line < BlockLineCount && blockCharCount < BlockCharCount) {
+            blockCharCount += doc->lineLength(blockEndLine);
+            ++blockEndLine;
+        }
+        size_t blockEndOffset = endOffset;
+        if (blockEndLine < lineCount) {
+            blockEndOffset = qMin(endOffset, doc->offsetFromLine(blockEndLine));
+        }
+        lexer->lexRange(offset, blockEndOffset);
+
+        // never keep on lexing when the lexer doesn't get any further
+        if (scopes->lastScopedOffset() <= offset) { return false; }
+    }
+    return false;
+}
+
+
+} // edbee
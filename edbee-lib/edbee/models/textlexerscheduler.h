@@ -0,0 +1,75 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QObject>
+#include <QPointer>
+
+class QTimer;
+
+namespace edbee {
+
+class TextDocument;
+
+
+/// Lexes the scopes of a document in small time slices, so lexing a large document doesn't block the user interface.
+///
+/// The renderer requests the lexing of the visible range with requestRange. The lines up to this range are lexed
+/// for a short time, the remaining lines are lexed in the next event loop iterations. Every slice lexes for a few
+/// milliseconds and publishes the lexed lines to the document scopes, lines that aren't lexed yet are rendered
+/// without styling.
+///
+/// Only the last requested range is lexed: when the view is scrolled, lexing continues to the new visible range.
+/// A change of the text moves the last scoped offset back, the next slice simply continues from there.
+///
+/// A slice is lexed in blocks of a limited number of lines and characters, and lines that are longer than the
+/// maximum line length of the lexer aren't matched at all. So a slice never blocks much longer than its duration,
+/// not even for a file with a single long line.
+///
+/// The grammar rules (and their regular expressions) are shared by all documents, and the scopes are read
+/// while painting. That's why the lexing is done in the GUI thread, and not in a worker thread.
+class EDBEE_EXPORT TextLexerScheduler : public QObject
+{
+Q_OBJECT
+
+public:
+    TextLexerScheduler(QObject* parent = nullptr);
+    virtual ~TextLexerScheduler();
+
+    void requestRange(TextDocument* textDocument, size_t beginOffset, size_t endOffset);
+    void cancel();
+    bool isPending() const;
+
+    /// The end offset of the last requested range
+    size_t targetOffset() const { return targetOffset_; }
+
+    /// The time the lexer may block a requestRange call, in milliseconds
+    int foregroundDuration() const { return foregroundDuration_; }
+    void setForegroundDuration(int duration) { foregroundDuration_ = duration; }
+
+    /// The duration of a single background slice, in milliseconds
+    int sliceDuration() const { return sliceDuration_; }
+    void setSliceDuration(int duration) { sliceDuration_ = duration; }
+
+public slots:
+    bool lexSlice();
+
+signals:
+    /// Emitted after a background slice has lexed the range between the given offsets
+    void lexed(size_t previousOffset, size_t lastScopedOffset);
+
+private:
+    bool lex(int duration, bool lexAtLeastOneBlock);
+
+    QPointer<TextDocument> textDocumentRef_;    ///< The document that's being lexed
+    QTimer* timer_;                             ///< The single shot timer that starts the next slice
+    size_t targetOffset_;                       ///< The offset up to which the document needs to be lexed
+    int foregroundDuration_;                    ///< The maximum duration of the lexing in requestRange (ms)
+    int sliceDuration_;                         ///< The duration of a background slice (ms)
+};
+
+
+} // edbee
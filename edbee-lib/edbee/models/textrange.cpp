@@ -655,7 +655,8 @@ QString TextRangeSetBase::getSelectedTextExpandedToFullLines()
         // skip the current line if it's the same as last one
         if (line == lastLine) { ++line; }
         while (line <= maxLine) {
-            buffer.append(doc->lineWithoutNewline(line));
+            QStringView lineText = doc->lineWithoutNewlineView(line);
+            buffer.append(lineText.constData(), lineText.size());
             buffer.append("\n");
             ++line;
         }
@@ -16,6 +16,10 @@
 
 namespace edbee {
 
+static const size_t SearchContextLength = 1024;     ///< The number of characters before the search start, that are available to the regexp
+static const size_t SearchWindowLength = 65536;     ///< The initial number of searched characters, the window is doubled until a match is found
+
+
 TextSearcher::TextSearcher( QObject* parent )
     : QObject(parent)
     , searchTerm_()
@@ -109,12 +113,14 @@ void TextSearcher::setReverse(bool on)
 
 /// Finds the next matching textrange
 /// This method does not alter the textrange selection. It only returns the range of the next match
+/// The buffer is searched in growing windows (see findForward and findBackward), so only the text up to the match is copied
 /// @param selection the text-selection to use
 /// @return the textRange with the found text.  TextRange::isEmpty() can be called to check if nothing has been found
 TextRange TextSearcher::findNextRange(TextRangeSet* selection)
 {
     TextDocument* document = selection->textDocument();
-    QChar* buffer = document->buffer()->rawDataPointer();
+    TextBuffer* buffer = document->buffer();
+    size_t length = document->length();
 
     if (!regExp_) { regExp_ = createRegExp(); }
 
@@ -129,17 +135,17 @@ TextRange TextSearcher::findNextRange(TextRangeSet* selection)
 
     size_t idx = 0;
     if (isReverse()) {
-        idx = regExp_->lastIndexIn(buffer, 0, caretPos);
+        idx = findBackward(buffer, caretPos);
     } else {
-        idx = regExp_->indexIn(buffer,caretPos,document->length());
+        idx = findForward(buffer, caretPos, length);
     }
 
     // wrapped around? Let's try it from the beginning
     if (idx == std::string::npos && isWrapAroundEnabled()) {
         if (isReverse()) {
-            idx = regExp_->lastIndexIn(buffer, 0, document->length());
+            idx = findBackward(buffer, length);
         } else {
-            idx = regExp_->indexIn(buffer, 0, document->length());
+            idx = findForward(buffer, 0, length);
         }
     }
     if (idx != std::string::npos) {
@@ -374,4 +380,49 @@ RegExp* TextSearcher::createRegExp()
 }
 
 
+/// Searches the first match of the regexp after the given offset.
+/// The text is searched in a window that's doubled until a match is found, so a match near the offset only copies
+/// a small part of the buffer. A match that ends near the end of the window could continue after the window,
+/// it's only accepted when the window is the end of the range. A match longer than the window can be missed.
+/// @param buffer the buffer to search
+/// @param offset the offset to start searching
+/// @param end the end of the searched range
+/// @return the offset of the match (std::string::npos if not found)
+size_t TextSearcher::findForward(TextBuffer* buffer, size_t offset, size_t end)
+{
+    // include some text before the offset for look-behinds and word boundaries
+    size_t start = offset > SearchContextLength ? offset - SearchContextLength : 0;
+    size_t windowLength = SearchWindowLength;
+    for (;;) {
+        size_t windowEnd = end - offset > windowLength ? offset + windowLength : end;
+        size_t idx = regExp_->indexIn(buffer->rangeDataPointer(start, windowEnd - start), offset - start, windowEnd - start);
+        if (idx != std::string::npos) { idx += start; }
+        if (windowEnd == end || (idx != std::string::npos && idx + regExp_->len(0) + SearchContextLength <= windowEnd)) {
+            return idx;
+        }
+        windowLength *= 2;
+    }
+}
+
+
+/// Searches the last match of the regexp that ends before the given offset.
+/// The text is searched in a window that's doubled until a match is found (see findForward).
+/// A match close to the start of the window is only accepted when the window is the start of the buffer
+/// @param buffer the buffer to search
+/// @param end the offset to search before
+/// @return the offset of the match (std::string::npos if not found)
+size_t TextSearcher::findBackward(TextBuffer* buffer, size_t end)
+{
+    size_t windowLength = SearchWindowLength;
+    for (;;) {
+        size_t windowStart = end > windowLength ? end - windowLength : 0;
+        size_t idx = regExp_->lastIndexIn(buffer->rangeDataPointer(windowStart, end - windowStart), 0, end - windowStart);
+        if (windowStart == 0 || (idx != std::string::npos && idx >= SearchContextLength)) {
+            return idx == std::string::npos ? idx : idx + windowStart;
+        }
+        windowLength *= 2;
+    }
+}
+
+
 } // edbee
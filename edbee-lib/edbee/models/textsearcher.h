@@ -13,6 +13,7 @@ namespace edbee {
 
 
 class RegExp;
+class TextBuffer;
 class TextDocument;
 class TextEditorWidget;
 
@@ -74,6 +75,8 @@ protected:
 
     void setDirty();
     RegExp* createRegExp();
+    size_t findForward(TextBuffer* buffer, size_t offset, size_t end);
+    size_t findBackward(TextBuffer* buffer, size_t end);
 
 private:
 
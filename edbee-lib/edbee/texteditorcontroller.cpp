@@ -61,6 +61,8 @@ TextEditorController::TextEditorController(TextDocument *document, TextEditorWid
     , textCaretCache_(nullptr)
     , textSearcher_(nullptr)
     , autoScrollToCaret_(AutoScrollAlways)
+    , followEnd_(false)
+    , oldTextBufferRef_(nullptr)
     , borderedTextRanges_(nullptr)
 {
     // auto initialize edbee if this hasn't been done already
@@ -85,6 +87,10 @@ TextEditorController::TextEditorController(TextDocument *document, TextEditorWid
 /// Destroys the controller and associated objects
 TextEditorController::~TextEditorController()
 {
+    // the buffer is gone when the document isn't owned and already deleted
+    if (oldTextBufferRef_) {
+        oldTextBufferRef_->releaseOldText();
+    }
     delete borderedTextRanges_;
     delete textSearcher_;
     delete textRenderer_;
@@ -134,6 +140,11 @@ void TextEditorController::setTextDocument(TextDocument* doc)
         TextDocument* oldDocumentRef = textDocument();
         if (oldDocumentRef) {
             oldDocumentRef->textUndoStack()->unregisterController(this);
+            if (oldTextBufferRef_) {
+                oldTextBufferRef_->releaseOldText();
+                oldTextBufferRef_ = nullptr;
+            }
+            disconnect(oldDocumentRef, SIGNAL(textAboutToBeChanged(edbee::TextBufferChange)), this, SLOT(onTextAboutToBeChanged(edbee::TextBufferChange)));
             disconnect(oldDocumentRef, SIGNAL(textChanged(edbee::TextBufferChange, QString)), this, SLOT(onTextChanged(edbee::TextBufferChange, QString)));
             disconnect(textDocumentRef_->lineDataManager(), SIGNAL(lineDataChanged(size_t,size_t,size_t)), this, SLOT(onLineDataChanged(size_t,size_t,size_t)));
         }
@@ -153,7 +164,9 @@ void TextEditorController::setTextDocument(TextDocument* doc)
 
         textDocumentRef_->textUndoStack()->registerContoller(this);
 
+        connect(textDocumentRef_, SIGNAL(textAboutToBeChanged(edbee::TextBufferChange)), this, SLOT(onTextAboutToBeChanged(edbee::TextBufferChange)));
         connect(textDocumentRef_, SIGNAL(textChanged(edbee::TextBufferChange,QString)), this, SLOT(onTextChanged(edbee::TextBufferChange,QString)));
+        updateOldTextRequired();
         connect(textDocumentRef_->lineDataManager(), SIGNAL(lineDataChanged(size_t,size_t,size_t)), this, SLOT(onLineDataChanged(size_t,size_t,size_t)));
 
         // force an repaint when the grammar is changed
@@ -190,6 +203,24 @@ TextEditorController::AutoScrollToCaret TextEditorController::autoScrollToCaret(
 }
 
 
+/// Keeps the view at the end of the document when the text changes, for following a growing file (see TextDocumentFollower)
+/// @param followEnd true to scroll to the end of the document after every change
+void TextEditorController::setFollowEnd(bool followEnd)
+{
+    followEnd_ = followEnd;
+    if (followEnd_ && widgetRef_) {
+        scrollOffsetVisible(textDocumentRef_->length());
+    }
+}
+
+
+/// Returns true if the view is kept at the end of the document
+bool TextEditorController::followEnd() const
+{
+    return followEnd_;
+}
+
+
 /// This method return true if the text-editor has focus
 bool TextEditorController::hasFocus()
 {
@@ -363,12 +394,23 @@ DynamicVariables* TextEditorController::dynamicVariables() const
 //==========================================================================================
 
 
+/// This slot is called before a piece of text is replaced
+void TextEditorController::onTextAboutToBeChanged(edbee::TextBufferChange change)
+{
+    Q_UNUSED(change)
+    updateOldTextRequired();
+}
+
+
 /// This slot is placed if a piece of text is replaced
 void TextEditorController::onTextChanged(edbee::TextBufferChange change, QString oldText)
 {
     /// TODO: improve this:
     if( widgetRef_) {
         widget()->updateGeometryComponents();
+        if (followEnd_) {
+            scrollOffsetVisible(textDocumentRef_->length());
+        }
         notifyStateChange();
 
         AccessibleTextEditorWidget::notifyTextChangeEvent(widget(), &change, oldText);
@@ -376,6 +418,19 @@ void TextEditorController::onTextChanged(edbee::TextBufferChange change, QString
 }
 
 
+/// The accessibility events require the old text of a change. Copying the old text is expensive,
+/// so it's only requested from the textbuffer when accessibility is active.
+/// Accessibility can be activated at any moment, that's why this is checked before every change
+/// (the textbuffer copies the old text after the textAboutToBeChanged signal).
+void TextEditorController::updateOldTextRequired()
+{
+    if (!oldTextBufferRef_ && widgetRef_ && QAccessible::isActive()) {
+        oldTextBufferRef_ = textDocumentRef_->buffer();
+        oldTextBufferRef_->acquireOldText();
+    }
+}
+
+
 /// the old selection has been changed
 /// @param oldRangeSet the old range set of the change
 void TextEditorController::onSelectionChanged(TextRangeSet* oldRangeSet)
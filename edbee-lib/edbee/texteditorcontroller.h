@@ -7,6 +7,7 @@
 
 #include <QObject>
 #include <QIcon>
+#include <QPointer>
 
 #include "edbee/models/textbuffer.h"
 #include "models/texteditorconfig.h"
@@ -59,6 +60,9 @@ public:
     void setAutoScrollToCaret(AutoScrollToCaret autoScroll);
     virtual AutoScrollToCaret autoScrollToCaret() const;
 
+    void setFollowEnd(bool followEnd);
+    bool followEnd() const;
+
     bool hasFocus();
     QAction* createUnconnectedAction(const QString& command, const QString& text, const QIcon& icon = QIcon(), QObject* owner = nullptr);
     QAction* createAction(const QString& command, const QString& text , const QIcon& icon=QIcon(), QObject* owner = nullptr);
@@ -99,6 +103,7 @@ signals:
 
 public slots:
 
+    void onTextAboutToBeChanged(edbee::TextBufferChange change);
     void onTextChanged(edbee::TextBufferChange change, QString oldText = QString());
     void onSelectionChanged(edbee::TextRangeSet *oldRangeSet);
     void onLineDataChanged(size_t line, size_t length, size_t newLength);
@@ -155,6 +160,7 @@ public slots:
 
 
 private:
+    void updateOldTextRequired();
 
     TextEditorWidget* widgetRef_;             ///< A reference to the text editor widget
     TextDocument* textDocument_;              ///< The text document (only filled when owned)
@@ -172,6 +178,8 @@ private:
     TextSearcher* textSearcher_;              ///< The text-searcher
 
     AutoScrollToCaret autoScrollToCaret_;     ///< This flags tells the editor to automatically scroll to the caret
+    bool followEnd_;                          ///< Is the view kept at the end of the document when the text changes?
+    QPointer<TextBuffer> oldTextBufferRef_;   ///< The buffer of which the old text of changes is acquired (for accessibility)
 
 
     // extra highlight text
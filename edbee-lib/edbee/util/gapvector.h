@@ -270,6 +270,30 @@ public:
     }
 
 
+    /// Returns a direct pointer to the given range of items, as a single continuous block.
+    /// The gap is only moved when it's inside the range, to the nearest side of the range.
+    /// So the number of moved items is never larger than the length of the range.
+    /// This pointer is only valid as long as the buffer doesn't change
+    const T* rangeData(Tsize offset, Tsize length) {
+        Q_ASSERT(offset + length <= this->length());
+        if (offset < gapBegin_ && gapBegin_ < offset + length) {
+            if (gapBegin_ - offset <= offset + length - gapBegin_) {
+                moveGapTo(offset);
+            } else {
+                moveGapTo(offset + length);
+            }
+        }
+        return offset < gapBegin_ ? items_ + offset : items_ + offset + gapSize();
+    }
+
+
+    /// Returns a pointer to the items before the gap (there are gapBegin() items)
+    const T* firstPartData() const { return items_; }
+
+    /// Returns a pointer to the items after the gap (there are length() - gapBegin() items)
+    const T* secondPartData() const { return items_ + gapEnd_; }
+
+
     //// moves the gap to the given position
     //// Warning when the gap is moved after the length the gap shrinks
     void moveGapTo(Tsize offset) {
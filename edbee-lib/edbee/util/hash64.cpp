@@ -0,0 +1,97 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "hash64.h"
+
+#include <cstring>
+
+#include <QChar>
+#include <QtEndian>
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Mixes a word into the hash
+static inline quint64 mix(quint64 hash, quint64 word)
+{
+    hash = (hash ^ word) * 1099511628211ull;
+    return hash ^ (hash >> 32);
+}
+
+
+/// Constructs an empty hash
+Hash64::Hash64()
+    : hash_(14695981039346656037ull)
+    , pendingLength_(0)
+{
+}
+
+
+/// Adds the given bytes to the hash
+/// @param data the data to add
+/// @param length the number of bytes
+void Hash64::add(const char* data, size_t length)
+{
+    while (pendingLength_ > 0 && length > 0) {
+        pending_[pendingLength_++] = *data++;
+        --length;
+        if (pendingLength_ == 8) {
+            addWord(qFromLittleEndian<quint64>(pending_));
+            pendingLength_ = 0;
+        }
+    }
+    for (; length >= 8; data += 8, length -= 8) {
+        addWord(qFromLittleEndian<quint64>(data));
+    }
+    std::memcpy(pending_ + pendingLength_, data, length);
+    pendingLength_ += length;
+}
+
+
+/// Adds the UTF-16 code units of the given characters (in the byte order of the system)
+/// @param data the characters to add
+/// @param length the number of characters
+void Hash64::add(const QChar* data, size_t length)
+{
+    add(reinterpret_cast<const char*>(data), length * sizeof(QChar));
+}
+
+
+/// Adds a 64 bit value (as 8 little endian bytes)
+void Hash64::add(quint64 value)
+{
+    char bytes[8];
+    qToLittleEndian<quint64>(value, bytes);
+    add(bytes, 8);
+}
+
+
+/// Returns the hash of all added data
+quint64 Hash64::result() const
+{
+    if (pendingLength_ == 0) { return hash_; }
+    char word[8] = {};
+    std::memcpy(word, pending_, pendingLength_);
+    return mix(hash_, qFromLittleEndian<quint64>(word));
+}
+
+
+/// Returns the hash of the given bytes
+quint64 Hash64::hash(const char* data, size_t length)
+{
+    Hash64 hash;
+    hash.add(data, length);
+    return hash.result();
+}
+
+
+/// Adds a complete word to the hash
+void Hash64::addWord(quint64 word)
+{
+    hash_ = mix(hash_, word);
+}
+
+
+} // edbee
@@ -0,0 +1,39 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QtGlobal>
+
+class QChar;
+
+namespace edbee {
+
+
+/// A fast (non cryptographic) 64 bit hash, used for the checksums and content hashes of the cache files.
+///
+/// The data is processed in little endian words of 8 bytes, a partial last word is padded with zeros.
+/// Adding the data in parts gives the same result as adding it at once.
+class EDBEE_EXPORT Hash64 {
+public:
+    Hash64();
+
+    void add(const char* data, size_t length);
+    void add(const QChar* data, size_t length);
+    void add(quint64 value);
+    quint64 result() const;
+
+    static quint64 hash(const char* data, size_t length);
+
+private:
+    void addWord(quint64 word);
+
+    quint64 hash_;              ///< The current hash
+    char pending_[8];           ///< The bytes of an incomplete word
+    size_t pendingLength_;      ///< The number of pending bytes
+};
+
+
+} // edbee
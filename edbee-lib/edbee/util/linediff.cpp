@@ -0,0 +1,381 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "linediff.h"
+
+#include <QChar>
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/util/hash64.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDBEE_LINEDIFF_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+#if defined(EDBEE_LINEDIFF_SSE2)
+
+/// Returns the index of the lowest bit set. The mask may not be 0
+static inline size_t lowestBit(quint32 mask)
+{
+    Q_ASSERT(mask);
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctz(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<size_t>(index);
+#else
+    size_t index = 0;
+    while (!(mask & 1u)) { mask >>= 1; ++index; }
+    return index;
+#endif
+}
+
+
+/// Returns the index of the highest bit set. The mask may not be 0
+static inline size_t highestBit(quint32 mask)
+{
+    Q_ASSERT(mask);
+#if defined(__GNUC__)
+    return static_cast<size_t>(31 - __builtin_clz(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return static_cast<size_t>(index);
+#else
+    size_t index = 0;
+    while (mask >>= 1) { ++index; }
+    return index;
+#endif
+}
+
+
+/// Returns a mask with 2 bits for every different character of the 8 characters at a and b
+static inline quint32 differenceMask(const QChar* a, const QChar* b)
+{
+    __m128i equal = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    return static_cast<quint32>(_mm_movemask_epi8(equal)) ^ 0xffffu;
+}
+
+#endif
+
+
+/// The linear space Myers diff of two lists of line hashes.
+/// The middle snake of a range is found by searching from both ends at the same time, after which both halves
+/// are diffed recursively. The edits are added in order of the lines
+class MyersLineDiff {
+public:
+    MyersLineDiff(const quint64* oldLines, const quint64* newLines, size_t maxCost, QVector<LineDiff::Edit>& edits)
+        : oldLines_(oldLines)
+        , newLines_(newLines)
+        , maxCost_(static_cast<ptrdiff_t>(qMax(maxCost, static_cast<size_t>(1))))
+        , edits_(edits)
+    {
+    }
+
+
+    /// Diffs the given range of old lines with the given range of new lines
+    void diff(size_t oldBegin, size_t oldEnd, size_t newBegin, size_t newEnd)
+    {
+        // skip the common lines at the start and the end
+        while (oldBegin < oldEnd && newBegin < newEnd && oldLines_[oldBegin] == newLines_[newBegin]) {
+            ++oldBegin;
+            ++newBegin;
+        }
+        while (oldBegin < oldEnd && newBegin < newEnd && oldLines_[oldEnd - 1] == newLines_[newEnd - 1]) {
+            --oldEnd;
+            --newEnd;
+        }
+        if (oldBegin == oldEnd || newBegin == newEnd) {
+            addEdit(oldBegin, oldEnd, newBegin, newEnd);
+            return;
+        }
+
+        size_t oldSplit = 0, newSplit = 0;
+        if (findMiddleSnake(oldBegin, oldEnd, newBegin, newEnd, oldSplit, newSplit)) {
+            diff(oldBegin, oldSplit, newBegin, newSplit);
+            diff(oldSplit, oldEnd, newSplit, newEnd);
+        } else {
+            addEdit(oldBegin, oldEnd, newBegin, newEnd);
+        }
+    }
+
+private:
+
+    /// Searches the point where the forward and the backward search paths overlap
+    /// @return false if the point isn't found within the maximum cost, or when it doesn't split the ranges
+    bool findMiddleSnake(size_t oldBegin, size_t oldEnd, size_t newBegin, size_t newEnd, size_t& oldSplit, size_t& newSplit)
+    {
+        const quint64* a = oldLines_ + oldBegin;
+        const quint64* b = newLines_ + newBegin;
+        ptrdiff_t n = static_cast<ptrdiff_t>(oldEnd - oldBegin);
+        ptrdiff_t m = static_cast<ptrdiff_t>(newEnd - newBegin);
+        ptrdiff_t maxD = qMin((n + m + 1) / 2, maxCost_);
+        ptrdiff_t vOffset = maxD;
+        ptrdiff_t vLength = 2 * maxD + 2;
+        ptrdiff_t delta = n - m;
+        bool front = (delta % 2) != 0;      // with an odd delta the forward path reaches the overlap first
+
+        forward_.fill(-1, static_cast<qsizetype>(vLength));
+        backward_.fill(-1, static_cast<qsizetype>(vLength));
+        ptrdiff_t* v1 = forward_.data();
+        ptrdiff_t* v2 = backward_.data();
+        v1[vOffset + 1] = 0;
+        v2[vOffset + 1] = 0;
+
+        // the diagonals that ran off the edge of the grid are skipped
+        ptrdiff_t k1Start = 0, k1End = 0, k2Start = 0, k2End = 0;
+        for (ptrdiff_t d = 0; d < maxD; ++d) {
+            for (ptrdiff_t k1 = -d + k1Start; k1 <= d - k1End; k1 += 2) {
+                ptrdiff_t k1Offset = vOffset + k1;
+                ptrdiff_t x1 = (k1 == -d || (k1 != d && v1[k1Offset - 1] < v1[k1Offset + 1])) ? v1[k1Offset + 1] : v1[k1Offset - 1] + 1;
+                ptrdiff_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a[x1] == b[y1]) {
+                    ++x1;
+                    ++y1;
+                }
+                v1[k1Offset] = x1;
+                if (x1 > n) {
+                    k1End += 2;
+                } else if (y1 > m) {
+                    k1Start += 2;
+                } else if (front) {
+                    ptrdiff_t k2Offset = vOffset + delta - k1;
+                    if (k2Offset >= 0 && k2Offset < vLength && v2[k2Offset] != -1 && x1 >= n - v2[k2Offset]) {
+                        return split(oldBegin, newBegin, n, m, x1, y1, oldSplit, newSplit);
+                    }
+                }
+            }
+
+            for (ptrdiff_t k2 = -d + k2Start; k2 <= d - k2End; k2 += 2) {
+                ptrdiff_t k2Offset = vOffset + k2;
+                ptrdiff_t x2 = (k2 == -d || (k2 != d && v2[k2Offset - 1] < v2[k2Offset + 1])) ? v2[k2Offset + 1] : v2[k2Offset - 1] + 1;
+                ptrdiff_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) {
+                    ++x2;
+                    ++y2;
+                }
+                v2[k2Offset] = x2;
+                if (x2 > n) {
+                    k2End += 2;
+                } else if (y2 > m) {
+                    k2Start += 2;
+                } else if (!front) {
+                    ptrdiff_t k1Offset = vOffset + delta - k2;
+                    if (k1Offset >= 0 && k1Offset < vLength && v1[k1Offset] != -1) {
+                        ptrdiff_t x1 = v1[k1Offset];
+                        ptrdiff_t y1 = x1 - (k1Offset - vOffset);
+                        if (x1 >= n - x2) {
+                            return split(oldBegin, newBegin, n, m, x1, y1, oldSplit, newSplit);
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+
+    /// Converts the split point to line numbers. A split point at one of the corners doesn't split the ranges
+    static bool split(size_t oldBegin, size_t newBegin, ptrdiff_t n, ptrdiff_t m, ptrdiff_t x, ptrdiff_t y, size_t& oldSplit, size_t& newSplit)
+    {
+        if ((x == 0 && y == 0) || (x == n && y == m)) { return false; }
+        oldSplit = oldBegin + static_cast<size_t>(x);
+        newSplit = newBegin + static_cast<size_t>(y);
+        return true;
+    }
+
+
+    /// Adds an edit, which is merged with the previous edit when they are adjacent
+    void addEdit(size_t oldBegin, size_t oldEnd, size_t newBegin, size_t newEnd)
+    {
+        if (oldBegin == oldEnd && newBegin == newEnd) { return; }
+        if (!edits_.isEmpty()) {
+            LineDiff::Edit& last = edits_.last();
+            if (last.oldLine + last.oldLineCount == oldBegin && last.newLine + last.newLineCount == newBegin) {
+                last.oldLineCount += oldEnd - oldBegin;
+                last.newLineCount += newEnd - newBegin;
+                return;
+            }
+        }
+        LineDiff::Edit edit = { oldBegin, oldEnd - oldBegin, newBegin, newEnd - newBegin };
+        edits_.append(edit);
+    }
+
+
+    const quint64* oldLines_;               ///< The hashes of the old lines
+    const quint64* newLines_;               ///< The hashes of the new lines
+    ptrdiff_t maxCost_;                     ///< The maximum number of steps searched per range
+    QVector<LineDiff::Edit>& edits_;        ///< The resulting edits
+    QVector<ptrdiff_t> forward_;            ///< The furthest reaching forward paths per diagonal
+    QVector<ptrdiff_t> backward_;           ///< The furthest reaching backward paths per diagonal
+};
+
+
+/// Returns the edits that convert the old lines into the new lines
+/// @param oldLines the hashes of the old lines
+/// @param oldLineCount the number of old lines
+/// @param newLines the hashes of the new lines
+/// @param newLineCount the number of new lines
+/// @param maxCost the maximum number of steps searched before a block of lines is reported as a single replacement
+/// @return the edits sorted by line
+QVector<LineDiff::Edit> LineDiff::diff(const quint64* oldLines, size_t oldLineCount, const quint64* newLines, size_t newLineCount, size_t maxCost)
+{
+    QVector<Edit> result;
+    MyersLineDiff(oldLines, newLines, maxCost, result).diff(0, oldLineCount, 0, newLineCount);
+    return result;
+}
+
+
+/// Returns the line edits that convert the text of the old buffer into the text of the new buffer.
+/// Only the lines between the common start and end of the texts are hashed and compared
+/// @param oldBuffer the buffer with the old text
+/// @param newBuffer the buffer with the new text
+/// @param maxCost the maximum number of steps searched before a block of lines is reported as a single replacement
+/// @return the edits sorted by line
+QVector<LineDiff::Edit> LineDiff::diff(TextBuffer* oldBuffer, TextBuffer* newBuffer, size_t maxCost)
+{
+    size_t oldLength = oldBuffer->length();
+    size_t newLength = newBuffer->length();
+    size_t prefix = commonPrefixLength(oldBuffer, newBuffer);
+    if (prefix == oldLength && prefix == newLength) { return QVector<Edit>(); }
+
+    // the lines before the first different line are equal, the suffix may not overlap with these lines
+    size_t firstLine = oldBuffer->lineFromOffset(prefix);
+    size_t firstLineOffset = oldBuffer->offsetFromLine(firstLine);
+    size_t suffix = commonSuffixLength(oldBuffer, newBuffer, qMin(oldLength, newLength) - firstLineOffset);
+
+    // the lines after the line with the first character of the suffix are equal
+    size_t oldEndLine = oldBuffer->lineFromOffset(oldLength - suffix) + 1;
+    size_t endLineCount = oldBuffer->lineCount() - oldEndLine;
+    size_t newEndLine = newBuffer->lineCount() - endLineCount;
+    Q_ASSERT(firstLine < oldEndLine && firstLine < newEndLine);
+
+    QVector<quint64> oldHashes = lineHashes(oldBuffer, firstLine, oldEndLine);
+    QVector<quint64> newHashes = lineHashes(newBuffer, firstLine, newEndLine);
+    QVector<Edit> result = diff(oldHashes.constData(), static_cast<size_t>(oldHashes.size()), newHashes.constData(), static_cast<size_t>(newHashes.size()), maxCost);
+    for (Edit& edit : result) {
+        edit.oldLine += firstLine;
+        edit.newLine += firstLine;
+    }
+    return result;
+}
+
+
+/// Returns the hashes of the given lines (including the newline)
+/// @param buffer the buffer with the lines
+/// @param beginLine the first line
+/// @param endLine the line after the last line
+QVector<quint64> LineDiff::lineHashes(TextBuffer* buffer, size_t beginLine, size_t endLine)
+{
+    QVector<quint64> result;
+    result.reserve(static_cast<qsizetype>(endLine - beginLine));
+    for (size_t line = beginLine; line < endLine; ++line) {
+        QStringView view = buffer->lineView(line);
+        Hash64 hash;
+        hash.add(view.data(), static_cast<size_t>(view.size()));
+        result.append(hash.result());
+    }
+    return result;
+}
+
+
+/// Returns the number of equal characters at the start of a and b
+/// @param a the first characters
+/// @param b the second characters
+/// @param length the number of characters of a and b
+size_t LineDiff::commonPrefixLength(const QChar* a, const QChar* b, size_t length)
+{
+    size_t result = 0;
+#if defined(EDBEE_LINEDIFF_SSE2)
+    for (; result + 8 <= length; result += 8) {
+        quint32 mask = differenceMask(a + result, b + result);
+        if (mask) { return result + lowestBit(mask) / 2; }
+    }
+#endif
+    while (result < length && a[result] == b[result]) { ++result; }
+    return result;
+}
+
+
+/// Returns the number of equal characters at the end of a and b
+/// @param a the first characters
+/// @param b the second characters
+/// @param length the number of characters of a and b
+size_t LineDiff::commonSuffixLength(const QChar* a, const QChar* b, size_t length)
+{
+    size_t result = 0;
+#if defined(EDBEE_LINEDIFF_SSE2)
+    for (; result + 8 <= length; result += 8) {
+        size_t blockOffset = length - result - 8;
+        quint32 mask = differenceMask(a + blockOffset, b + blockOffset);
+        if (mask) { return result + 7 - highestBit(mask) / 2; }
+    }
+#endif
+    while (result < length && a[length - result - 1] == b[length - result - 1]) { ++result; }
+    return result;
+}
+
+
+/// Returns the number of equal characters at the start of both buffers
+size_t LineDiff::commonPrefixLength(TextBuffer* a, TextBuffer* b)
+{
+    size_t length = qMin(a->length(), b->length());
+    QVector<TextBufferSpan> aSpans = a->spans(0, length);
+    QVector<TextBufferSpan> bSpans = b->spans(0, length);
+    qsizetype aIndex = 0, bIndex = 0;
+    size_t result = 0;
+    while (result < length) {
+        const TextBufferSpan& aSpan = aSpans.at(aIndex);
+        const TextBufferSpan& bSpan = bSpans.at(bIndex);
+        size_t aPos = result - aSpan.offset;
+        size_t bPos = result - bSpan.offset;
+        size_t count = qMin(aSpan.length - aPos, bSpan.length - bPos);
+        size_t common = commonPrefixLength(aSpan.data + aPos, bSpan.data + bPos, count);
+        result += common;
+        if (common < count) { break; }
+        if (aPos + count == aSpan.length) { ++aIndex; }
+        if (bPos + count == bSpan.length) { ++bIndex; }
+    }
+    return result;
+}
+
+
+/// Returns the number of equal characters at the end of both buffers
+/// @param maxLength the maximum number of characters to compare
+size_t LineDiff::commonSuffixLength(TextBuffer* a, TextBuffer* b, size_t maxLength)
+{
+    size_t aLength = a->length();
+    size_t bLength = b->length();
+    maxLength = qMin(maxLength, qMin(aLength, bLength));
+    QVector<TextBufferSpan> aSpans = a->spans(aLength - maxLength, maxLength);
+    QVector<TextBufferSpan> bSpans = b->spans(bLength - maxLength, maxLength);
+    qsizetype aIndex = aSpans.size() - 1, bIndex = bSpans.size() - 1;
+    size_t result = 0;
+    while (result < maxLength) {
+        const TextBufferSpan& aSpan = aSpans.at(aIndex);
+        const TextBufferSpan& bSpan = bSpans.at(bIndex);
+        // the number of characters of the spans before the compared end
+        size_t aEnd = aLength - result - aSpan.offset;
+        size_t bEnd = bLength - result - bSpan.offset;
+        size_t count = qMin(aEnd, bEnd);
+        size_t common = commonSuffixLength(aSpan.data + aEnd - count, bSpan.data + bEnd - count, count);
+        result += common;
+        if (common < count) { break; }
+        if (aEnd == count) { --aIndex; }
+        if (bEnd == count) { --bIndex; }
+    }
+    return result;
+}
+
+
+} // edbee
@@ -0,0 +1,53 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QVector>
+#include <QtGlobal>
+
+class QChar;
+
+namespace edbee {
+
+class TextBuffer;
+
+
+/// Computes the differences between two texts, as a list of replaced line blocks.
+///
+/// The lines are compared by their hashes with the linear space variant of the Myers diff algorithm.
+/// The cost of the algorithm grows with the number of differences, when it exceeds the maximum cost
+/// the remaining block is reported as a single replacement.
+///
+/// Before hashing the lines of two textbuffers, the common start and end of the texts are skipped.
+/// These are compared 8 characters at a time with SSE2 (on x86), so the cost of comparing two texts
+/// with a few changes mostly depends on the number of changed lines.
+class EDBEE_EXPORT LineDiff {
+public:
+
+    /// A block of lines of the old text that's replaced by a block of lines of the new text
+    struct Edit {
+        size_t oldLine;             ///< The first replaced line of the old text
+        size_t oldLineCount;        ///< The number of replaced lines (0 for an insert)
+        size_t newLine;             ///< The first line of the new text
+        size_t newLineCount;        ///< The number of new lines (0 for a delete)
+    };
+
+    /// The default maximum number of edit steps
+    static const size_t DefaultMaxCost = 4096;
+
+    static QVector<Edit> diff(const quint64* oldLines, size_t oldLineCount, const quint64* newLines, size_t newLineCount, size_t maxCost = DefaultMaxCost);
+    static QVector<Edit> diff(TextBuffer* oldBuffer, TextBuffer* newBuffer, size_t maxCost = DefaultMaxCost);
+
+    static QVector<quint64> lineHashes(TextBuffer* buffer, size_t beginLine, size_t endLine);
+
+    static size_t commonPrefixLength(const QChar* a, const QChar* b, size_t length);
+    static size_t commonSuffixLength(const QChar* a, const QChar* b, size_t length);
+    static size_t commonPrefixLength(TextBuffer* a, TextBuffer* b);
+    static size_t commonSuffixLength(TextBuffer* a, TextBuffer* b, size_t maxLength);
+};
+
+
+} // edbee
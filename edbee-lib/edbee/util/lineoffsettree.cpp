@@ -0,0 +1,439 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "lineoffsettree.h"
+
+#include <QVector>
+
+#include "edbee/models/textbuffer.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const size_t MaxBlockSize = 256;        ///< The maximum number of line lengths in a single node
+
+
+/// A node of the line offset tree. A node contains a block of line lengths
+/// and the totals of the subtree
+class LineOffsetTreeNode
+{
+public:
+    LineOffsetTreeNode(const QVector<size_t>& lengths, quint32 priority)
+        : left_(nullptr)
+        , right_(nullptr)
+        , lengths_(lengths)
+        , priority_(priority)
+    {
+        update();
+    }
+
+    ~LineOffsetTreeNode()
+    {
+        delete left_;
+        delete right_;
+    }
+
+    /// Recalculates the totals of this subtree
+    void update()
+    {
+        lineCount_ = static_cast<size_t>(lengths_.size());
+        charCount_ = 0;
+        for (size_t len : lengths_) { charCount_ += len; }
+        if (left_) {
+            lineCount_ += left_->lineCount_;
+            charCount_ += left_->charCount_;
+        }
+        if (right_) {
+            lineCount_ += right_->lineCount_;
+            charCount_ += right_->charCount_;
+        }
+    }
+
+    LineOffsetTreeNode* left_;      ///< The left subtree
+    LineOffsetTreeNode* right_;     ///< The right subtree
+    QVector<size_t> lengths_;       ///< The line lengths of this node
+    quint32 priority_;              ///< The (heap ordered) treap priority
+
+    size_t lineCount_;              ///< The number of line lengths in this subtree
+    size_t charCount_;              ///< The sum of the line lengths in this subtree
+};
+
+
+/// Returns a pseudo random priority for a new node (xorshift32)
+/// @param seed the state of the random generator of the tree
+static quint32 nextPriority(quint32& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+
+/// Convenient method to return the line count of a possible empty subtree
+static inline size_t nodeLineCount(const LineOffsetTreeNode* node)
+{
+    return node ? node->lineCount_ : 0;
+}
+
+
+/// Convenient method to return the character count of a possible empty subtree
+static inline size_t nodeCharCount(const LineOffsetTreeNode* node)
+{
+    return node ? node->charCount_ : 0;
+}
+
+
+/// Joins two trees. All lines of a are placed before the lines of b
+static LineOffsetTreeNode* mergeNodes(LineOffsetTreeNode* a, LineOffsetTreeNode* b)
+{
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority_ > b->priority_) {
+        a->right_ = mergeNodes(a->right_, b);
+        a->update();
+        return a;
+    }
+    b->left_ = mergeNodes(a, b->left_);
+    b->update();
+    return b;
+}
+
+
+/// Splits the tree after the given number of line lengths. A block is split when required
+/// @param node the tree to split
+/// @param index the number of line lengths that should end up in the left tree
+/// @param left (out) the tree with the first index line lengths
+/// @param right (out) the tree with the remaining line lengths
+static void splitNode(LineOffsetTreeNode* node, size_t index, LineOffsetTreeNode*& left, LineOffsetTreeNode*& right)
+{
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+
+    size_t leftCount = nodeLineCount(node->left_);
+    size_t blockCount = static_cast<size_t>(node->lengths_.size());
+    if (index <= leftCount) {
+        splitNode(node->left_, index, left, node->left_);
+        node->update();
+        right = node;
+    } else if (index >= leftCount + blockCount) {
+        splitNode(node->right_, index - leftCount - blockCount, node->right_, right);
+        node->update();
+        left = node;
+    } else {
+        // split the block itself. The right part gets the same priority, which keeps both trees valid
+        qsizetype blockIndex = static_cast<qsizetype>(index - leftCount);
+        LineOffsetTreeNode* rightNode = new LineOffsetTreeNode(node->lengths_.mid(blockIndex), node->priority_);
+        rightNode->right_ = node->right_;
+        rightNode->update();
+        node->lengths_.resize(blockIndex);
+        node->right_ = nullptr;
+        node->update();
+        left = node;
+        right = rightNode;
+    }
+}
+
+
+/// Removes the first node of the tree. The removed node is returned (without children)
+static LineOffsetTreeNode* takeFirstNode(LineOffsetTreeNode*& node)
+{
+    if (!node) return nullptr;
+    if (node->left_) {
+        LineOffsetTreeNode* result = takeFirstNode(node->left_);
+        node->update();
+        return result;
+    }
+    LineOffsetTreeNode* result = node;
+    node = node->right_;
+    result->right_ = nullptr;
+    return result;
+}
+
+
+/// Removes the last node of the tree. The removed node is returned (without children)
+static LineOffsetTreeNode* takeLastNode(LineOffsetTreeNode*& node)
+{
+    if (!node) return nullptr;
+    if (node->right_) {
+        LineOffsetTreeNode* result = takeLastNode(node->right_);
+        node->update();
+        return result;
+    }
+    LineOffsetTreeNode* result = node;
+    node = node->left_;
+    result->left_ = nullptr;
+    return result;
+}
+
+
+/// Builds a balanced tree with blocks of (almost) equal size for the given lengths
+/// A parent always gets a priority at least as high as its children, to keep the heap order
+static LineOffsetTreeNode* buildNodes(const QVector<size_t>& lengths, size_t blockBegin, size_t blockEnd, size_t blockCount, quint32& seed)
+{
+    if (blockBegin >= blockEnd) return nullptr;
+    size_t total = static_cast<size_t>(lengths.size());
+    size_t middle = blockBegin + (blockEnd - blockBegin) / 2;
+    size_t begin = total * middle / blockCount;
+    size_t end = total * (middle + 1) / blockCount;
+
+    LineOffsetTreeNode* left = buildNodes(lengths, blockBegin, middle, blockCount, seed);
+    LineOffsetTreeNode* right = buildNodes(lengths, middle + 1, blockEnd, blockCount, seed);
+    quint32 priority = nextPriority(seed);
+    if (left) { priority = qMax(priority, left->priority_); }
+    if (right) { priority = qMax(priority, right->priority_); }
+
+    LineOffsetTreeNode* node = new LineOffsetTreeNode(lengths.mid(static_cast<qsizetype>(begin), static_cast<qsizetype>(end - begin)), priority);
+    node->left_ = left;
+    node->right_ = right;
+    node->update();
+    return node;
+}
+
+
+/// Builds a balanced tree for the given lengths
+static LineOffsetTreeNode* makeNodes(const QVector<size_t>& lengths, quint32& seed)
+{
+    if (lengths.isEmpty()) return nullptr;
+    size_t blockCount = (static_cast<size_t>(lengths.size()) + MaxBlockSize - 1) / MaxBlockSize;
+    return buildNodes(lengths, 0, blockCount, blockCount, seed);
+}
+
+
+//=====================================================
+
+
+/// Constructs a line offset tree with a single line
+LineOffsetTree::LineOffsetTree()
+    : root_(nullptr)
+    , seed_(2463534242u)
+{
+}
+
+
+/// Destroys all nodes
+LineOffsetTree::~LineOffsetTree()
+{
+    delete root_;
+}
+
+
+/// Applies the given change to the line offsets
+void LineOffsetTree::applyChange(TextBufferChange change)
+{
+    ptrdiff_t offsetDelta = static_cast<ptrdiff_t>(change.newTextLength()) - static_cast<ptrdiff_t>(change.length());
+
+    // I assume it is save to cast a size_t to ptrdiff_t
+    if (sizeof(size_t) == sizeof(ptrdiff_t)) {
+        const ptrdiff_t* offsets = reinterpret_cast<const ptrdiff_t*>(change.newLineOffsets().constData());
+        applyChange(change.line(), change.lineCount(), change.newLineCount(), offsets, offsetDelta);
+    } else {
+        QVector<ptrdiff_t> offsets;
+        offsets.reserve(static_cast<qsizetype>(change.newLineCount()));
+        for (size_t offset : change.newLineOffsets()) {
+            offsets.append(static_cast<ptrdiff_t>(offset));
+        }
+        applyChange(change.line(), change.lineCount(), change.newLineCount(), offsets.constData(), offsetDelta);
+    }
+}
+
+
+/// applies the change from a TextChangeData
+/// @param line the line-index this change is for
+/// @param removeLineCount the number of lines to remove at line
+/// @param addLineCount the new number of lines to add
+/// @param newOffsets the new offets that are inserted at the line location (realy offsets! no delta applied!)
+/// @param offsetDelta the offset delta applied in this change. (difference in offset between the replaced texts)
+void LineOffsetTree::applyChange(size_t line, size_t removeLineCount, size_t addLineCount, const ptrdiff_t* newOffsets, ptrdiff_t offsetDelta)
+{
+    Q_ASSERT(line + removeLineCount < length());
+
+    size_t nextLine = line + removeLineCount + 1;
+    QVector<size_t> lengths;
+    lengths.reserve(static_cast<qsizetype>(addLineCount + 1));
+    size_t lastOffset = at(line);
+    for (size_t i = 0; i < addLineCount; ++i) {
+        size_t offset = static_cast<size_t>(newOffsets[i]);
+        Q_ASSERT(lastOffset < offset);
+        lengths.append(offset - lastOffset);
+        lastOffset = offset;
+    }
+    size_t removeCount = removeLineCount;
+    if (nextLine < length()) {
+        size_t nextOffset = static_cast<size_t>(static_cast<ptrdiff_t>(at(nextLine)) + offsetDelta);
+        Q_ASSERT(lastOffset < nextOffset);
+        lengths.append(nextOffset - lastOffset);
+        ++removeCount;
+    }
+    replaceLengths(line, removeCount, lengths.constData(), static_cast<size_t>(lengths.size()));
+}
+
+
+/// this method returns the line offset at the given line offset
+size_t LineOffsetTree::at(size_t idx) const
+{
+    Q_ASSERT(idx < length());
+
+    // sum all line lengths before the given line
+    size_t result = 0;
+    const LineOffsetTreeNode* node = root_;
+    while (node && idx > 0) {
+        size_t leftCount = nodeLineCount(node->left_);
+        if (idx <= leftCount) {
+            node = node->left_;
+            continue;
+        }
+        result += nodeCharCount(node->left_);
+        idx -= leftCount;
+
+        size_t blockCount = static_cast<size_t>(node->lengths_.size());
+        size_t count = qMin(idx, blockCount);
+        const size_t* lengths = node->lengths_.constData();
+        for (size_t i = 0; i < count; ++i) { result += lengths[i]; }
+        idx -= count;
+        node = node->right_;
+    }
+    return result;
+}
+
+
+/// Returns the number of lines
+size_t LineOffsetTree::length() const
+{
+    return nodeLineCount(root_) + 1;
+}
+
+
+/// this method searches the line from the given offset
+size_t LineOffsetTree::findLineFromOffset(size_t offset) const
+{
+    size_t line = 0;
+    const LineOffsetTreeNode* node = root_;
+    while (node) {
+        size_t leftChars = nodeCharCount(node->left_);
+        if (offset < leftChars) {
+            node = node->left_;
+            continue;
+        }
+        offset -= leftChars;
+        line += nodeLineCount(node->left_);
+
+        for (size_t len : node->lengths_) {
+            if (offset < len) return line;
+            offset -= len;
+            ++line;
+        }
+        node = node->right_;
+    }
+    return line;
+}
+
+
+/// This method appends an offset to the end of the list
+void LineOffsetTree::appendOffset(size_t offset)
+{
+    size_t lastOffset = nodeCharCount(root_);
+    Q_ASSERT(lastOffset < offset);
+    size_t len = offset - lastOffset;
+    replaceLengths(length() - 1, 0, &len, 1);
+}
+
+
+/// Removes all lines, only line 0 remains
+void LineOffsetTree::clear()
+{
+    delete root_;
+    root_ = nullptr;
+}
+
+
+/// Returns the number of blocks (nodes) in the tree
+size_t LineOffsetTree::blockCount() const
+{
+    size_t result = 0;
+    QVector<const LineOffsetTreeNode*> stack;
+    if (root_) stack.append(root_);
+    while (!stack.isEmpty()) {
+        const LineOffsetTreeNode* node = stack.takeLast();
+        ++result;
+        if (node->left_) stack.append(node->left_);
+        if (node->right_) stack.append(node->right_);
+    }
+    return result;
+}
+
+
+/// This method returns the unitTestString representation => 0,2,6,7
+QString LineOffsetTree::toUnitTestString() const
+{
+    QString s;
+    for (size_t i = 0, cnt = length(); i < cnt; ++i) {
+        if (i != 0) { s.append(","); }
+        s.append(QStringLiteral("%1").arg(at(i)));
+    }
+    return s;
+}
+
+
+/// Asserts the tree is valid. (Heap order, correct totals and no empty blocks)
+void LineOffsetTree::assertValid() const
+{
+    QVector<const LineOffsetTreeNode*> stack;
+    if (root_) stack.append(root_);
+    while (!stack.isEmpty()) {
+        const LineOffsetTreeNode* node = stack.takeLast();
+        Q_ASSERT(!node->lengths_.isEmpty());
+        size_t lineCount = static_cast<size_t>(node->lengths_.size()) + nodeLineCount(node->left_) + nodeLineCount(node->right_);
+        size_t charCount = nodeCharCount(node->left_) + nodeCharCount(node->right_);
+        for (size_t len : node->lengths_) {
+            Q_ASSERT(len > 0);
+            charCount += len;
+        }
+        Q_ASSERT(lineCount == node->lineCount_);
+        Q_ASSERT(charCount == node->charCount_);
+        Q_ASSERT(!node->left_ || node->left_->priority_ <= node->priority_);
+        Q_ASSERT(!node->right_ || node->right_->priority_ <= node->priority_);
+        Q_UNUSED(lineCount);
+        Q_UNUSED(charCount);
+        if (node->left_) stack.append(node->left_);
+        if (node->right_) stack.append(node->right_);
+    }
+}
+
+
+/// Replaces the given line lengths with the new line lengths.
+/// The blocks next to the change are joined with the new lengths, so small blocks don't accumulate
+/// @param index the index of the first line length to replace
+/// @param count the number of line lengths to replace
+/// @param lengths the new line lengths
+/// @param lengthCount the number of new line lengths
+void LineOffsetTree::replaceLengths(size_t index, size_t count, const size_t* lengths, size_t lengthCount)
+{
+    Q_ASSERT(index + count <= nodeLineCount(root_));
+
+    LineOffsetTreeNode* left = nullptr;
+    LineOffsetTreeNode* middle = nullptr;
+    LineOffsetTreeNode* right = nullptr;
+    splitNode(root_, index, left, middle);
+    splitNode(middle, count, middle, right);
+    delete middle;
+
+    // join the neighbouring blocks with the new lengths
+    LineOffsetTreeNode* leftBlock = takeLastNode(left);
+    LineOffsetTreeNode* rightBlock = takeFirstNode(right);
+    QVector<size_t> joined;
+    joined.reserve(static_cast<qsizetype>(lengthCount) + (leftBlock ? leftBlock->lengths_.size() : 0) + (rightBlock ? rightBlock->lengths_.size() : 0));
+    if (leftBlock) joined += leftBlock->lengths_;
+    for (size_t i = 0; i < lengthCount; ++i) { joined.append(lengths[i]); }
+    if (rightBlock) joined += rightBlock->lengths_;
+    delete leftBlock;
+    delete rightBlock;
+
+    root_ = mergeNodes(mergeNodes(left, makeNodes(joined, seed_)), right);
+}
+
+
+} // edbee
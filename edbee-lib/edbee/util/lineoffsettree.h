@@ -0,0 +1,56 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QString>
+
+namespace edbee {
+
+class LineOffsetTreeNode;
+class TextBufferChange;
+
+
+/// This class stores the line offsets in a balanced tree (a treap).
+/// It has the same interface as the LineOffsetVector.
+///
+/// The tree doesn't store the offsets, but the line lengths (the distance between two line starts).
+/// Every node contains a block of line lengths and the line count and character count of its subtree.
+/// Because all offsets are relative, a change only modifies the lines that are touched by the change.
+/// Changing, offset => line and line => offset are all O(log n), regardless of the location of the previous change.
+///
+/// The line offset pointed at by each index is the first character in the given line.
+class EDBEE_EXPORT LineOffsetTree {
+public:
+    LineOffsetTree();
+    virtual ~LineOffsetTree();
+
+    void applyChange(TextBufferChange change);
+    void applyChange(size_t line, size_t lineCount, size_t newLineCount, const ptrdiff_t* newLineOffsets, ptrdiff_t offsetDelta);
+
+    size_t at(size_t idx) const;
+    size_t length() const;
+
+    size_t findLineFromOffset(size_t offset) const;
+
+    void appendOffset(size_t offset);
+    void clear();
+
+    size_t blockCount() const;
+
+public:
+    QString toUnitTestString() const;
+    void assertValid() const;
+
+private:
+    void replaceLengths(size_t index, size_t count, const size_t* lengths, size_t lengthCount);
+
+    LineOffsetTreeNode* root_;      ///< The root of the tree with the line lengths (nullptr when there's 1 line)
+    quint32 seed_;                  ///< The state of the random generator used for the node priorities
+
+    Q_DISABLE_COPY(LineOffsetTree)
+};
+
+} // edbee
@@ -0,0 +1,256 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "newlinescanner.h"
+
+#include <QChar>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDBEE_NEWLINESCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled with a function target attribute, so the library itself doesn't require AVX2
+#if defined(EDBEE_NEWLINESCANNER_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDBEE_NEWLINESCANNER_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Returns the number of bits set in the given mask
+static inline size_t popCount(quint32 mask)
+{
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_popcount(mask));
+#else
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    return static_cast<size_t>((((mask + (mask >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+#endif
+}
+
+
+/// Returns the index of the lowest bit set. The mask may not be 0
+static inline size_t lowestBit(quint32 mask)
+{
+    Q_ASSERT(mask);
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctz(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<size_t>(index);
+#else
+    size_t index = 0;
+    while (!(mask & 1u)) { mask >>= 1; ++index; }
+    return index;
+#endif
+}
+
+
+#if defined(EDBEE_NEWLINESCANNER_SSE2)
+
+static const size_t BlockSize = 16;     ///< The number of characters compared at once
+
+
+/// Returns a mask with a bit for every newline in the 16 characters at data
+static inline quint32 newlineMask(const QChar* data)
+{
+    const __m128i newline = _mm_set1_epi16('\n');
+    __m128i lo = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), newline);
+    __m128i hi = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 8)), newline);
+    return static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(lo, hi)));
+}
+
+
+/// Returns a mask with a bit for every newline in the 16 bytes at data
+static inline quint32 newlineMask(const char* data)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    return static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), newline)));
+}
+
+#endif
+
+
+#if defined(EDBEE_NEWLINESCANNER_AVX2)
+
+static const size_t Avx2BlockSize = 32;     ///< The number of characters compared at once with AVX2
+
+
+/// Returns a mask with a bit for every newline in the 32 characters at data
+__attribute__((target("avx2")))
+static inline quint32 newlineMaskAvx2(const QChar* data)
+{
+    const __m256i newline = _mm256_set1_epi16('\n');
+    __m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), newline);
+    __m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 16)), newline);
+    // packing works per 128 bit lane, the permute restores the character order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+    return static_cast<quint32>(_mm256_movemask_epi8(packed));
+}
+
+
+/// Counts the newlines in the complete AVX2 blocks. Returns the number of characters scanned
+__attribute__((target("avx2")))
+static size_t countNewlinesAvx2(const QChar* data, size_t length, size_t& count)
+{
+    size_t i = 0;
+    for (; i + Avx2BlockSize <= length; i += Avx2BlockSize) {
+        count += popCount(newlineMaskAvx2(data + i));
+    }
+    return i;
+}
+
+
+/// Stores the newline offsets in the complete AVX2 blocks. Returns the number of characters scanned
+__attribute__((target("avx2")))
+static size_t storeNewlineOffsetsAvx2(const QChar* data, size_t length, size_t offset, size_t*& target)
+{
+    size_t i = 0;
+    for (; i + Avx2BlockSize <= length; i += Avx2BlockSize) {
+        for (quint32 mask = newlineMaskAvx2(data + i); mask; mask &= mask - 1) {
+            *target++ = offset + i + lowestBit(mask) + 1;
+        }
+    }
+    return i;
+}
+
+#endif
+
+
+/// Counts the newlines, starting at the given index
+template<typename T>
+static size_t countNewlinesFrom(const T* data, size_t length, size_t i, size_t count)
+{
+#if defined(EDBEE_NEWLINESCANNER_SSE2)
+    for (; i + BlockSize <= length; i += BlockSize) {
+        count += popCount(newlineMask(data + i));
+    }
+#endif
+    for (; i < length; ++i) {
+        if (data[i] == '\n') { ++count; }
+    }
+    return count;
+}
+
+
+/// Returns the offset directly after the given newline (1 based) or std::string::npos if it isn't found
+template<typename T>
+static size_t offsetAfterNewlineImpl(const T* data, size_t length, size_t newline)
+{
+    Q_ASSERT(newline > 0);
+    size_t i = 0;
+#if defined(EDBEE_NEWLINESCANNER_SSE2)
+    for (; i + BlockSize <= length; i += BlockSize) {
+        quint32 mask = newlineMask(data + i);
+        size_t count = popCount(mask);
+        if (count < newline) {
+            newline -= count;
+            continue;
+        }
+        while (--newline) { mask &= mask - 1; }
+        return i + lowestBit(mask) + 1;
+    }
+#endif
+    for (; i < length; ++i) {
+        if (data[i] == '\n' && --newline == 0) {
+            return i + 1;
+        }
+    }
+    return std::string::npos;
+}
+
+
+/// Counts the number of newlines in the given text
+size_t NewlineScanner::countNewlines(const QChar* data, size_t length)
+{
+    size_t count = 0;
+    size_t i = 0;
+#if defined(EDBEE_NEWLINESCANNER_AVX2)
+    if (isAvx2Supported()) {
+        i = countNewlinesAvx2(data, length, count);
+    }
+#endif
+    return countNewlinesFrom(data, length, i, count);
+}
+
+
+/// Counts the number of newlines in the given latin1 text
+size_t NewlineScanner::countNewlines(const char* data, size_t length)
+{
+    return countNewlinesFrom(data, length, 0, 0);
+}
+
+
+/// Appends the offsets of the lines that start in the given text (the offset after every newline)
+/// The vector is resized once, after counting the newlines.
+/// @param data the text to scan
+/// @param length the length of the text
+/// @param offset the offset of the text in the document, this is added to every line offset
+/// @param offsets the vector the offsets are appended to
+void NewlineScanner::appendNewlineOffsets(const QChar* data, size_t length, size_t offset, QVector<size_t>& offsets)
+{
+    size_t count = countNewlines(data, length);
+    if (!count) return;
+
+    qsizetype oldSize = offsets.size();
+    offsets.resize(oldSize + static_cast<qsizetype>(count));
+    size_t* target = offsets.data() + oldSize;
+
+    size_t i = 0;
+#if defined(EDBEE_NEWLINESCANNER_AVX2)
+    if (isAvx2Supported()) {
+        i = storeNewlineOffsetsAvx2(data, length, offset, target);
+    }
+#endif
+#if defined(EDBEE_NEWLINESCANNER_SSE2)
+    for (; i + BlockSize <= length; i += BlockSize) {
+        for (quint32 mask = newlineMask(data + i); mask; mask &= mask - 1) {
+            *target++ = offset + i + lowestBit(mask) + 1;
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        if (data[i] == '\n') {
+            *target++ = offset + i + 1;    // +1 because it points to the start of the next line
+        }
+    }
+    Q_ASSERT(target == offsets.data() + offsets.size());
+}
+
+
+/// Returns the offset directly after the given newline (1 based) or std::string::npos if it isn't found
+size_t NewlineScanner::offsetAfterNewline(const QChar* data, size_t length, size_t newline)
+{
+    return offsetAfterNewlineImpl(data, length, newline);
+}
+
+
+/// Returns the offset directly after the given newline (1 based) in the given latin1 text
+size_t NewlineScanner::offsetAfterNewline(const char* data, size_t length, size_t newline)
+{
+    return offsetAfterNewlineImpl(data, length, newline);
+}
+
+
+/// Returns true if the AVX2 code path is used on this cpu
+bool NewlineScanner::isAvx2Supported()
+{
+#if defined(EDBEE_NEWLINESCANNER_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+
+} // edbee
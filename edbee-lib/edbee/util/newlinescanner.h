@@ -0,0 +1,34 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QVector>
+
+class QChar;
+
+namespace edbee {
+
+
+/// Finds and counts newline ('\n') characters in text buffers.
+///
+/// On x86 the data is compared 16 characters at a time with SSE2, or 32 characters at a time
+/// with AVX2 when the cpu supports it (checked at runtime). Other platforms use a scalar loop.
+/// The char variants are for latin1 data.
+class EDBEE_EXPORT NewlineScanner {
+public:
+    static size_t countNewlines(const QChar* data, size_t length);
+    static size_t countNewlines(const char* data, size_t length);
+
+    static void appendNewlineOffsets(const QChar* data, size_t length, size_t offset, QVector<size_t>& offsets);
+
+    static size_t offsetAfterNewline(const QChar* data, size_t length, size_t newline);
+    static size_t offsetAfterNewline(const char* data, size_t length, size_t newline);
+
+    static bool isAvx2Supported();
+};
+
+
+} // edbee
@@ -44,6 +44,8 @@ private:
     QString pattern_;           ///< The original regexp-pattern
     QString line_;              ///< The current line
     const QChar* lineRef_;      ///< A reference to the given line
+    OnigOptionType options_;    ///< The compile options
+    OnigSyntaxType* syntax_;    ///< The syntax of the pattern
 
     /// clears the error message
     void clearError() { error_.clear(); }
@@ -84,27 +86,40 @@ public:
         , pattern_(pattern)
         , lineRef_(nullptr)
     {
-        const QChar* patternChars = pattern.constData();
+        syntax_ = &OnigSyntaxRuby; // ONIG_SYNTAX_DEFAULT
+        if( syntax == RegExp::SyntaxFixedString ) { syntax_ = &OnigSyntaxASIS; }
 
-        OnigSyntaxType* onigSyntax = &OnigSyntaxRuby; // ONIG_SYNTAX_DEFAULT
-        if( syntax == RegExp::SyntaxFixedString ) { onigSyntax = &OnigSyntaxASIS; }
+        options_ = ONIG_OPTION_NONE|ONIG_OPTION_CAPTURE_GROUP;
+        if( !caseSensitive ) { options_ = options_ | ONIG_OPTION_IGNORECASE;}
 
-        OnigOptionType onigOptions = ONIG_OPTION_NONE|ONIG_OPTION_CAPTURE_GROUP;
-        if( !caseSensitive ) { onigOptions = onigOptions | ONIG_OPTION_IGNORECASE;}
+        int result = compile(&reg_, &einfo_);
+        valid_ = result == ONIG_NORMAL;
+        fillError( result );
+    }
 
-        int result = onig_new(
-            &reg_,
+
+    /// Compiles the pattern to an oniguruma regex
+    /// @param reg (out) the compiled regex, the caller is the owner
+    /// @param einfo (out) the error information
+    /// @return the oniguruma result code (ONIG_NORMAL on success)
+    int compile(regex_t** reg, OnigErrorInfo* einfo) const
+    {
+        const QChar* patternChars = pattern_.constData();
+        return onig_new(
+            reg,
             (OnigUChar*)patternChars,
-            (OnigUChar*)(patternChars + pattern.length()),
-            onigOptions,
+            (OnigUChar*)(patternChars + pattern_.length()),
+            options_,
             ONIG_ENCODING_UTF16_LE,
-            onigSyntax,
-            &einfo_);
-        valid_ = result == ONIG_NORMAL;
-        fillError( result );
+            syntax_,
+            einfo);
     }
 
 
+    /// returns the compiled regex (nullptr if the pattern isn't valid)
+    regex_t* regex() const { return reg_; }
+
+
     /// destructs the regular expression engine
     virtual ~OnigRegExpEngine()
     {
@@ -344,7 +359,7 @@ public:
     /// @return the index of the given match or std::string::npos if no match was found
     virtual size_t indexIn(const QChar* str, ptrdiff_t offset, size_t length) override
     {
-        QString realString(str + offset, static_cast<qsizetype>(length));
+        QString realString(str, static_cast<qsizetype>(length));
         int result = reg_->indexIn(realString, static_cast<int>(offset));
         if (result < 0) return std::string::npos;
         return static_cast<size_t>(result);
@@ -370,7 +385,7 @@ public:
     /// @return the index of the given match or std::string::npos if no match was found
     virtual size_t lastIndexIn(const QChar* str, ptrdiff_t offset, size_t length) override
     {
-        QString realString(str+offset, static_cast<qsizetype>(length));
+        QString realString(str, static_cast<qsizetype>(length));
         int result = reg_->lastIndexIn(realString, static_cast<int>(offset));
         if (result < 0) return std::string::npos;
         return static_cast<size_t>(result);
@@ -412,6 +427,89 @@ public:
 //====================================================================================================================
 
 
+/// The oniguruma regset of the RegExpScanner.
+/// The regset refers to the compiled regexes of the expressions, a grammar rule that's part of several contexts
+/// is compiled only once. Oniguruma doesn't change a regex while searching, the regset has its own match regions.
+class RegExpScannerEngine
+{
+public:
+    OnigRegSet* set_;                   ///< The regset (nullptr when the scanner is invalid or empty)
+    QVector<qsizetype> indices_;        ///< The index of the original expression of every regex in the set
+    qsizetype matchedIndex_;            ///< The index of the last matched expression
+    bool valid_;                        ///< Are all expressions oniguruma expressions?
+    bool offsetDependent_;              ///< Does a pattern depend on the search offset? (\G)
+
+
+    /// Creates a regset with the compiled regexes of the given expressions
+    /// @param regExps the expressions to search
+    RegExpScannerEngine(const QVector<RegExp*>& regExps)
+        : set_(nullptr)
+        , matchedIndex_(-1)
+        , valid_(true)
+        , offsetDependent_(false)
+    {
+        QVector<regex_t*> regs;
+        for (qsizetype i = 0, cnt = regExps.size(); i < cnt; ++i) {
+            OnigRegExpEngine* engine = dynamic_cast<OnigRegExpEngine*>(regExps.at(i)->d_);
+            if (!engine) {
+                valid_ = false;
+                break;
+            }
+            if (!engine->isValid()) { continue; }
+
+            regs.append(engine->regex());
+            indices_.append(i);
+            offsetDependent_ = offsetDependent_ || engine->pattern().contains(QStringLiteral("\\G"));
+        }
+
+        if (valid_ && !regs.isEmpty()) {
+            int result = onig_regset_new(&set_, static_cast<int>(regs.size()), regs.data());
+            if (result == ONIG_NORMAL) { return; }
+            set_ = nullptr;
+            valid_ = false;
+        }
+        indices_.clear();
+    }
+
+
+    /// frees the regset. The regexes are owned by the expressions, they are removed from the set first
+    ~RegExpScannerEngine()
+    {
+        if (!set_) { return; }
+        for (int i = onig_regset_number_of_regex(set_) - 1; i >= 0; --i) {
+            onig_regset_replace(set_, i, nullptr);
+        }
+        onig_regset_free(set_);
+    }
+
+
+    /// Searches the first match of all expressions
+    /// @param charPtr the pointer to the string data
+    /// @param offset the offset to start searching
+    /// @param length the length of the string data
+    /// @return the position or std::string::npos if no match
+    size_t indexIn(const QChar* charPtr, size_t offset, size_t length)
+    {
+        matchedIndex_ = -1;
+        if (!set_) { return std::string::npos; }
+
+        OnigUChar* stringStart  = (OnigUChar*)charPtr;
+        OnigUChar* stringEnd    = (OnigUChar*)(charPtr+length);
+        OnigUChar* stringOffset = (OnigUChar*)(charPtr+offset);
+        int matchPos = 0;
+        int result = onig_regset_search(set_, stringStart, stringEnd, stringOffset, stringEnd, ONIG_REGSET_POSITION_LEAD, ONIG_OPTION_NONE, &matchPos);
+        if (result < 0) { return std::string::npos; }   // ONIG_MISMATCH or an error
+
+        Q_ASSERT(matchPos % 2 == 0);
+        matchedIndex_ = indices_.at(result);
+        return static_cast<size_t>(matchPos) >> 1;
+    }
+};
+
+
+//====================================================================================================================
+
+
 /// Constructs the regular expression matcher
 /// @param pattern the pattern of the regular expression
 /// @param caseSensitive should the match be case sensitive
@@ -565,4 +663,56 @@ QString RegExp::cap(size_t nth) const
 }
 
 
+//====================================================================================================================
+
+
+/// Constructs the scanner
+/// @param regExps the expressions to search. The scanner uses their compiled regexes, they must outlive the scanner
+RegExpScanner::RegExpScanner(const QVector<RegExp*>& regExps)
+    : d_(new RegExpScannerEngine(regExps))
+{
+}
+
+
+/// destructs the scanner
+RegExpScanner::~RegExpScanner()
+{
+    delete d_;
+}
+
+
+/// returns true if all expressions can be scanned (all expressions use the oniguruma engine)
+bool RegExpScanner::isValid() const
+{
+    return d_->valid_;
+}
+
+
+/// returns true if the result of a search depends on the search offset (a pattern contains \G).
+/// Otherwise the result of a search is also the result for every offset up to the found position
+bool RegExpScanner::isOffsetDependent() const
+{
+    return d_->offsetDependent_;
+}
+
+
+/// Searches the first match of all expressions in the given string
+/// @param str the pointer to the string
+/// @param offset the offset to start searching
+/// @param length the length of the supplied string
+/// @return the position of the first match (std::string::npos if not found)
+size_t RegExpScanner::indexIn(const QChar* str, size_t offset, size_t length)
+{
+    return d_->indexIn(str, offset, length);
+}
+
+
+/// Returns the index of the expression that matched in the last search (-1 if there was no match).
+/// The expression itself doesn't contain the match, search it at the found position for the captures
+qsizetype RegExpScanner::matchedIndex() const
+{
+    return d_->matchedIndex_;
+}
+
+
 } // edbee
@@ -6,9 +6,12 @@
 #include "edbee/exports.h"
 
 #include <QString>
+#include <QVector>
 
 namespace edbee {
 
+class RegExpScannerEngine;
+
 /// The minimal engine we currently require for handling regexpt.
 /// It may grow in the future
 class EDBEE_EXPORT RegExpEngine {
@@ -96,6 +99,30 @@ public:
 
 private:
     RegExpEngine* d_;       ///< The private data member
+
+    friend class RegExpScannerEngine;
+};
+
+
+/// Searches a list of regular expressions at once, the text is scanned once instead of once per expression.
+/// The result is the first match in the text, on the same position the first expression in the list wins.
+///
+/// Scanning is only supported for the oniguruma engine (with an oniguruma regset, which refers to the compiled
+/// expressions, so they must outlive the scanner). The scanner is invalid when one of the expressions uses another engine.
+/// Invalid expressions are skipped, like they never match.
+class EDBEE_EXPORT RegExpScanner {
+public:
+    RegExpScanner(const QVector<RegExp*>& regExps);
+    virtual ~RegExpScanner();
+
+    bool isValid() const;
+    bool isOffsetDependent() const;
+
+    size_t indexIn(const QChar* str, size_t offset, size_t length);
+    qsizetype matchedIndex() const;
+
+private:
+    RegExpScannerEngine* d_;    ///< The private data member
 };
 
 } // edbee
@@ -3,13 +3,281 @@
 
 #include "textcodec.h"
 
+#include <cstring>
+
 #include <QTextCodec>
 #include <QApplication>
 
+#include "edbee/util/unicodetranscoder.h"
+
 #include "edbee/debug.h"
 
 namespace edbee {
 
+static const int MibUtf8 = 106;         ///< The MIB enum of UTF-8
+static const int MibUtf16LE = 1014;     ///< The MIB enum of UTF-16LE
+static const ushort ByteOrderMark = 0xFEFF;
+
+
+/// Removes the byte order mark at the given position of the decoded text (when it's there)
+/// @return true if the first character has been decoded (and the header is handled)
+static bool removeByteOrderMark(QString& target, qsizetype position, bool stripHeader)
+{
+    if (target.length() <= position) return false;
+    if (stripHeader && target.at(position).unicode() == ByteOrderMark) {
+        target.remove(position, 1);
+    }
+    return true;
+}
+
+
+/// The native UTF-8 decoder
+class Utf8TextDecoder : public TextDecoder
+{
+public:
+    Utf8TextDecoder(bool stripHeader)
+        : stripHeader_(stripHeader)
+        , headerDone_(false)
+        , pendingLength_(0)
+    {
+    }
+
+    virtual void toUnicode(const char* data, int length, QString& target)
+    {
+        qsizetype oldSize = target.size();
+        target.resize(oldSize + length + pendingLength_);
+        QChar* out = target.data() + oldSize;
+        size_t written = 0;
+        size_t consumed = 0;
+
+        // complete the incomplete sequence of the previous block
+        if (pendingLength_) {
+            int extra = qMin(length, 4);
+            std::memcpy(pending_ + pendingLength_, data, static_cast<size_t>(extra));
+            written = UnicodeTranscoder::decodeUtf8(pending_, static_cast<size_t>(pendingLength_ + extra), out, &consumed);
+            if (consumed == 0) {
+                // still incomplete, the complete block is part of the sequence
+                pendingLength_ += extra;
+                length = 0;
+            } else {
+                data += static_cast<int>(consumed) - pendingLength_;
+                length -= static_cast<int>(consumed) - pendingLength_;
+                pendingLength_ = 0;
+            }
+        }
+
+        written += UnicodeTranscoder::decodeUtf8(data, static_cast<size_t>(length), out + written, &consumed);
+
+        // remember the incomplete sequence at the end
+        pendingLength_ += length - static_cast<int>(consumed);
+        std::memcpy(pending_, data + consumed, static_cast<size_t>(length) - consumed);
+
+        target.resize(oldSize + static_cast<qsizetype>(written));
+        if (!headerDone_) { headerDone_ = removeByteOrderMark(target, oldSize, stripHeader_); }
+    }
+
+private:
+    bool stripHeader_;      ///< Should the byte order mark be removed?
+    bool headerDone_;       ///< Is the start of the data decoded?
+    char pending_[8];       ///< The bytes of the incomplete sequence at the end of the previous block
+    int pendingLength_;     ///< The number of pending bytes
+};
+
+
+/// The native UTF-8 encoder
+class Utf8TextEncoder : public TextEncoder
+{
+public:
+    Utf8TextEncoder(bool writeHeader)
+        : writeHeader_(writeHeader)
+        , pendingHighSurrogate_(0)
+    {
+    }
+
+    virtual void fromUnicode(const QChar* data, int length, QByteArray& target)
+    {
+        qsizetype oldSize = target.size();
+        target.resize(oldSize + 3 * (length + 2));
+        char* out = target.data() + oldSize;
+        size_t written = 0;
+        size_t consumed = 0;
+
+        if (writeHeader_) {
+            out[written++] = static_cast<char>(0xEF);
+            out[written++] = static_cast<char>(0xBB);
+            out[written++] = static_cast<char>(0xBF);
+            writeHeader_ = false;
+        }
+
+        // complete the surrogate pair of the previous block
+        if (pendingHighSurrogate_ && length > 0) {
+            QChar pair[2] = { QChar(pendingHighSurrogate_), data[0] };
+            written += UnicodeTranscoder::encodeUtf8(pair, 2, out + written, &consumed);
+            data += consumed - 1;
+            length -= static_cast<int>(consumed) - 1;
+            pendingHighSurrogate_ = 0;
+        }
+
+        written += UnicodeTranscoder::encodeUtf8(data, static_cast<size_t>(length), out + written, &consumed);
+        if (consumed < static_cast<size_t>(length)) {
+            pendingHighSurrogate_ = data[consumed].unicode();
+        }
+        target.resize(oldSize + static_cast<qsizetype>(written));
+    }
+
+    /// A high surrogate at the end of the stream is never completed, it's written as U+FFFD (like an invalid sequence is decoded)
+    virtual void flush(QByteArray& target)
+    {
+        if (pendingHighSurrogate_) {
+            target.append("\xEF\xBF\xBD");
+            pendingHighSurrogate_ = 0;
+        }
+    }
+
+private:
+    bool writeHeader_;              ///< Should a byte order mark be written?
+    ushort pendingHighSurrogate_;   ///< The high surrogate at the end of the previous block
+};
+
+
+/// The native UTF-16LE decoder
+class Utf16LETextDecoder : public TextDecoder
+{
+public:
+    Utf16LETextDecoder(bool stripHeader)
+        : stripHeader_(stripHeader)
+        , headerDone_(false)
+        , hasPendingByte_(false)
+        , pendingByte_(0)
+    {
+    }
+
+    virtual void toUnicode(const char* data, int length, QString& target)
+    {
+        qsizetype oldSize = target.size();
+        target.resize(oldSize + length / 2 + 1);
+        QChar* out = target.data() + oldSize;
+        size_t written = 0;
+
+        // complete the character of the previous block
+        if (hasPendingByte_ && length > 0) {
+            out[written++] = QChar(static_cast<ushort>(static_cast<uchar>(pendingByte_) | static_cast<uchar>(data[0]) << 8));
+            ++data;
+            --length;
+            hasPendingByte_ = false;
+        }
+
+        size_t count = static_cast<size_t>(length / 2);
+        UnicodeTranscoder::decodeUtf16LE(data, count, out + written);
+        written += count;
+        if (length & 1) {
+            pendingByte_ = data[length - 1];
+            hasPendingByte_ = true;
+        }
+
+        target.resize(oldSize + static_cast<qsizetype>(written));
+        if (!headerDone_) { headerDone_ = removeByteOrderMark(target, oldSize, stripHeader_); }
+    }
+
+private:
+    bool stripHeader_;      ///< Should the byte order mark be removed?
+    bool headerDone_;       ///< Is the start of the data decoded?
+    bool hasPendingByte_;   ///< Is there a byte remaining of the previous block?
+    char pendingByte_;      ///< The remaining byte
+};
+
+
+/// The native UTF-16LE encoder
+class Utf16LETextEncoder : public TextEncoder
+{
+public:
+    Utf16LETextEncoder(bool writeHeader)
+        : writeHeader_(writeHeader)
+    {
+    }
+
+    virtual void fromUnicode(const QChar* data, int length, QByteArray& target)
+    {
+        qsizetype oldSize = target.size();
+        if (writeHeader_) {
+            target.append(static_cast<char>(0xFF));
+            target.append(static_cast<char>(0xFE));
+            writeHeader_ = false;
+            oldSize += 2;
+        }
+        target.resize(oldSize + 2 * length);
+        UnicodeTranscoder::encodeUtf16LE(data, static_cast<size_t>(length), target.data() + oldSize);
+    }
+
+private:
+    bool writeHeader_;      ///< Should a byte order mark be written?
+};
+
+
+/// A decoder that uses the Qt decoder
+class QtTextDecoder : public TextDecoder
+{
+public:
+    QtTextDecoder(QTextDecoder* decoder) : decoder_(decoder) {}
+    virtual ~QtTextDecoder() { delete decoder_; }
+
+    virtual void toUnicode(const char* data, int length, QString& target)
+    {
+        target.append(decoder_->toUnicode(data, length));
+    }
+
+private:
+    QTextDecoder* decoder_;     ///< The Qt decoder
+};
+
+
+/// An encoder that uses the Qt encoder
+class QtTextEncoder : public TextEncoder
+{
+public:
+    QtTextEncoder(QTextEncoder* encoder) : encoder_(encoder) {}
+    virtual ~QtTextEncoder() { delete encoder_; }
+
+    virtual void fromUnicode(const QChar* data, int length, QByteArray& target)
+    {
+        target.append(encoder_->fromUnicode(data, length));
+    }
+
+private:
+    QTextEncoder* encoder_;     ///< The Qt encoder
+};
+
+
+//----------------------------------------------------------
+
+
+/// Decodes the given bytes
+QString TextDecoder::toUnicode(const char* data, int length)
+{
+    QString result;
+    toUnicode(data, length, result);
+    return result;
+}
+
+
+/// Encodes the given characters
+QByteArray TextEncoder::fromUnicode(const QChar* data, int length)
+{
+    QByteArray result;
+    fromUnicode(data, length, result);
+    return result;
+}
+
+
+/// Encodes the given text
+QByteArray TextEncoder::fromUnicode(const QString& text)
+{
+    return fromUnicode(text.constData(), static_cast<int>(text.length()));
+}
+
+
+//----------------------------------------------------------
+
 /// The codecmanager constructs
 /// This method registeres all codecs available in Qt
 TextCodecManager::TextCodecManager()
@@ -103,4 +371,32 @@ QTextDecoder* TextCodec::makeDecoder()
 }
 
 
+/// Creates a decoder. UTF-8 and UTF-16LE use a native decoder, the other encodings a QTextDecoder
+/// @param extraFlags flags added to the flags of this codec (for example IgnoreHeader, for decoding data after the start of a file)
+TextDecoder* TextCodec::makeTextDecoder(QTextCodec::ConversionFlags extraFlags)
+{
+    QTextCodec::ConversionFlags flags = flags_ | extraFlags;
+    bool stripHeader = !(flags & QTextCodec::IgnoreHeader);
+    switch (codec()->mibEnum()) {
+        case MibUtf8: return new Utf8TextDecoder(stripHeader);
+        case MibUtf16LE: return new Utf16LETextDecoder(stripHeader);
+        default: return new QtTextDecoder(codec()->makeDecoder(flags));
+    }
+}
+
+
+/// Creates an encoder. UTF-8 and UTF-16LE use a native encoder, the other encodings a QTextEncoder
+/// @param extraFlags flags added to the flags of this codec
+TextEncoder* TextCodec::makeTextEncoder(QTextCodec::ConversionFlags extraFlags)
+{
+    QTextCodec::ConversionFlags flags = flags_ | extraFlags;
+    bool writeHeader = !(flags & QTextCodec::IgnoreHeader);
+    switch (codec()->mibEnum()) {
+        case MibUtf8: return new Utf8TextEncoder(writeHeader);
+        case MibUtf16LE: return new Utf16LETextEncoder(writeHeader);
+        default: return new QtTextEncoder(codec()->makeEncoder(flags));
+    }
+}
+
+
 } // edbee
@@ -33,8 +33,39 @@ private:
 };
 
 
+/// A streaming decoder, created with TextCodec::makeTextDecoder.
+/// An incomplete character at the end of a block is remembered and completed by the next block
+class EDBEE_EXPORT TextDecoder {
+public:
+    virtual ~TextDecoder() {}
+
+    /// Decodes the given bytes and appends the text to the target
+    virtual void toUnicode(const char* data, int length, QString& target) = 0;
+    QString toUnicode(const char* data, int length);
+};
+
+
+/// A streaming encoder, created with TextCodec::makeTextEncoder.
+/// A high surrogate at the end of a block is remembered and completed by the next block,
+/// flush should be called at the end of the stream to write a remaining high surrogate
+class EDBEE_EXPORT TextEncoder {
+public:
+    virtual ~TextEncoder() {}
+
+    /// Encodes the given characters and appends the bytes to the target
+    virtual void fromUnicode(const QChar* data, int length, QByteArray& target) = 0;
+    /// Appends the bytes of the remembered state to the target, at the end of the stream
+    virtual void flush(QByteArray& target) { Q_UNUSED(target); }
+    QByteArray fromUnicode(const QChar* data, int length);
+    QByteArray fromUnicode(const QString& text);
+};
+
+
 /// Represents a single text codec
 /// The codec has a name and contains methods to create encoders and decoders
+///
+/// The makeTextDecoder and makeTextEncoder methods return a native decoder/encoder for UTF-8 and UTF-16LE,
+/// which is a lot faster than the generic Qt conversion. The other encodings use the QTextCodec.
 class EDBEE_EXPORT TextCodec {
 public:
     TextCodec(const QString& name, const QTextCodec* codec, QTextCodec::ConversionFlags flags);
@@ -42,6 +73,9 @@ public:
     QTextEncoder* makeEncoder();
     QTextDecoder* makeDecoder();
 
+    TextDecoder* makeTextDecoder(QTextCodec::ConversionFlags extraFlags = QTextCodec::DefaultConversion);
+    TextEncoder* makeTextEncoder(QTextCodec::ConversionFlags extraFlags = QTextCodec::DefaultConversion);
+
     QString name() { return name_; }
 
 private:
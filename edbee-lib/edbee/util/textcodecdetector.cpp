@@ -14,6 +14,11 @@ namespace edbee {
 
 static TextCodec* globalPreferedCodecRef_ = 0; ///< The globally prefered codec
 
+static const size_t SampleThreshold = 1024 * 1024;    ///< Buffers up to this size are validated completely
+static const size_t HeadSampleSize = 256 * 1024;      ///< The number of bytes validated at the start of a larger buffer
+static const size_t SampleSize = 16 * 1024;           ///< The number of bytes of the other samples
+static const size_t SampleCount = 32;                 ///< The number of samples after the head
+
 
 static inline TextCodecManager* codecManager() {
     return Edbee::instance()->codecManager();
@@ -108,123 +113,67 @@ void TextCodecDetector::setFallbackCodec(TextCodec* codec)
 /// 0000 0000-0000 007F       0xxxxxxx
 /// 0000 0080-0000 07FF       110xxxxx 10xxxxxx
 /// 0000 0800-0000 FFFF       1110xxxx 10xxxxxx 10xxxxxx
-/// 0001 0000-001F FFFF       11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-/// 0020 0000-03FF FFFF       111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-/// 0400 0000-7FFF FFFF       1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+/// 0001 0000-0010 FFFF       11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
 /// @endcode
 ///
-/// With UTF-8, 0xFE and 0xFF never appear.
+/// With UTF-8, 0xC0, 0xC1 and 0xF5..0xFF never appear. Overlong forms and surrogates are invalid too (RFC 3629).
 ///
 /// @return the QTextCodec that is 'detected'
 TextCodec* TextCodecDetector::detectCodec()
 {
     // if the file has a Byte Order Marker, we can assume the file is in UTF-xx
     // otherwise, the file would not be human readable
+    // (the UTF-32LE bom starts with the UTF-16LE bom, so it's checked first)
     if (hasUTF8Bom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-8 with BOM");
-    if (hasUTF16LEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-16LE with BOM");
-    if (hasUTF16BEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-16BE with BOM");
     if (hasUTF32LEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-32LE with BOM");
     if (hasUTF32BEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-32BE with BOM");
+    if (hasUTF16LEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-16LE with BOM");
+    if (hasUTF16BEBom(bufferRef_,bufferLength_)) return codecManager()->codecForName("UTF-16BE with BOM");
 
-    // if a byte has its most significant bit set, the file is in UTF-8 or in the default encoding
-    // otherwise, the file is in US-ASCII
-    bool highOrderBit = false;
-
-    // if the file is in UTF-8, high order bytes must have a certain value, in order to be valid
-    // if it's not the case, we can assume the encoding is the default encoding of the system
-    bool validU8Char = true;
-
-    // TODO the buffer is not read up to the end, but up to length - 6
-    size_t length = bufferLength_;
-    size_t i = 0;
-    while( i < length - 6 )
-    {
-        char b0 = bufferRef_[i];
-        char b1 = bufferRef_[i + 1];
-        char b2 = bufferRef_[i + 2];
-        char b3 = bufferRef_[i + 3];
-        char b4 = bufferRef_[i + 4];
-        char b5 = bufferRef_[i + 5];
-        if (b0 < 0)
-        {
-            // a high order bit was encountered, thus the encoding is not US-ASCII
-            // it may be either an 8-bit encoding or UTF-8
-            highOrderBit = true;
-
-            // a two-bytes sequence was encoutered
-            if (isTwoBytesSequence(b0))
-            {
-                // there must be one continuation byte of the form 10xxxxxx,
-                // otherwise the following characteris is not a valid UTF-8 construct
-                if (!isContinuationChar(b1))
-                    validU8Char = false;
-                else
-                    i++;
-            }
-            // a three-bytes sequence was encoutered
-            else if (isThreeBytesSequence(b0))
-            {
-                // there must be two continuation bytes of the form 10xxxxxx,
-                // otherwise the following characteris is not a valid UTF-8 construct
-                if (!(isContinuationChar(b1) && isContinuationChar(b2)))
-                    validU8Char = false;
-                else
-                    i += 2;
-            }
-            // a four-bytes sequence was encoutered
-            else if (isFourBytesSequence(b0))
-            {
-                // there must be three continuation bytes of the form 10xxxxxx,
-                // otherwise the following characteris is not a valid UTF-8 construct
-                if (!(isContinuationChar(b1) && isContinuationChar(b2) && isContinuationChar(b3)))
-                    validU8Char = false;
-                else
-                    i += 3;
-            }
-            // a five-bytes sequence was encoutered
-            else if (isFiveBytesSequence(b0))
-            {
-                // there must be four continuation bytes of the form 10xxxxxx,
-                // otherwise the following characteris is not a valid UTF-8 construct
-                if (!(isContinuationChar(b1) && isContinuationChar(b2) && isContinuationChar(b3) && isContinuationChar(b4)))
-                    validU8Char = false;
-                else
-                    i += 4;
-            }
-            // a six-bytes sequence was encoutered
-            else if (isSixBytesSequence(b0))
-            {
-                // there must be five continuation bytes of the form 10xxxxxx,
-                // otherwise the following characteris is not a valid UTF-8 construct
-                if (!(isContinuationChar(b1) && isContinuationChar(b2) && isContinuationChar(b3) && isContinuationChar(b4) && isContinuationChar(b5)))
-                    validU8Char = false;
-                else
-                    i += 5;
-            }
-            else
-                validU8Char = false;
-        }
-        if (!validU8Char) break;
-        i++;
+    switch (validateUtf8Samples(bufferRef_, bufferLength_)) {
+        // if no byte with an high order bit set, the encoding is US-ASCII
+        // (it might have been UTF-7, but this encoding is usually internally used only by mail systems)
+        case Utf8Validator::Ascii:
+            return preferedCodec();
+
+        // if no invalid UTF-8 were encountered, we can assume the encoding is UTF-8,
+        // otherwise the file would not be human readable
+        case Utf8Validator::Utf8:
+            return preferedCodec(); // we sort of assume prefered codec is UTF-8 :P
+
+        // finally, if it's not UTF-8 nor US-ASCII, let's assume the encoding is the default encoding
+        case Utf8Validator::Invalid:
+        default:
+            return fallbackCodec();
     }
+}
 
-    // if no byte with an high order bit set, the encoding is US-ASCII
-    // (it might have been UTF-7, but this encoding is usually internally used only by mail systems)
-    if (!highOrderBit)
-    {
-        return preferedCodec();
-        //return fallbackCodec(); /// This could be US-ASCII
-    }
 
-    // if no invalid UTF-8 were encountered, we can assume the encoding is UTF-8,
-    // otherwise the file would not be human readable
-    if( validU8Char ) {
-//        return QTextCodec::codecForName("UTF-8");
-        return preferedCodec(); // we sort of assume prefered codec is UTF-8 :P
+/// Validates the UTF-8 of the given buffer.
+/// Buffers up to SampleThreshold bytes are validated completely. Of larger buffers only the head
+/// and SampleCount evenly spread samples are validated, so the detection time is bounded for huge buffers.
+/// The buffer and the samples may start and end in the middle of a sequence (the buffer is often the first block of a file)
+/// @param buffer the data to validate
+/// @param length the length of the data
+/// @return the result of the validation
+Utf8Validator::Result TextCodecDetector::validateUtf8Samples(const char* buffer, size_t length)
+{
+    if (length <= SampleThreshold) {
+        return Utf8Validator::validate(buffer, length, true);
     }
 
-    // finally, if it's not UTF-8 nor US-ASCII, let's assume the encoding is the default encoding
-    return fallbackCodec();
+    Utf8Validator::Result result = Utf8Validator::validate(buffer, HeadSampleSize, true);
+    for (size_t i = 1; i <= SampleCount && result != Utf8Validator::Invalid; ++i) {
+        size_t start = HeadSampleSize + (length - HeadSampleSize - SampleSize) / SampleCount * i;
+
+        // a sample starts at a character
+        size_t skip = 0;
+        while (skip < 3 && (static_cast<uchar>(buffer[start]) & 0xC0) == 0x80) { ++start; ++skip; }
+
+        Utf8Validator::Result sampleResult = Utf8Validator::validate(buffer + start, qMin(SampleSize, length - start), true);
+        if (sampleResult != Utf8Validator::Ascii) { result = sampleResult; }
+    }
+    return result;
 }
 
 
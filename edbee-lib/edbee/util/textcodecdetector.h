@@ -5,6 +5,7 @@
 
 #include "edbee/exports.h"
 
+#include "edbee/util/utf8validator.h"
 
 class QByteArray;
 
@@ -25,6 +26,8 @@ class TextCodec;
 /// is wide enough, it's easy to guess.
 ///
 /// A byte buffer of 4KB or 8KB is sufficient to be able to guess the encoding.
+/// The UTF-8 validation is vectorized (see Utf8Validator) and larger buffers are sampled,
+/// so it's also cheap to give the detector a complete file.
 ///
 /// TextCodecDetector detector( QByteArray)  ;
 /// TextCodec encoding = detector.guessEncoding( QByteArray arr, QTextCode fallback );
@@ -62,6 +65,10 @@ public:
 
 protected:
 
+    static Utf8Validator::Result validateUtf8Samples(const char* buffer, size_t length);
+
+    // The byte classification helpers below aren't used by detectCodec anymore (it uses the Utf8Validator)
+
     ///  If the byte has the form 10xxxxx, then it's a continuation byte of a multiple byte character;
     virtual bool isContinuationChar(char b) { return /*-128 <= b && */ b <= -65; }
 
@@ -0,0 +1,608 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textrope.h"
+
+#include "edbee/util/newlinescanner.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+typedef QExplicitlySharedDataPointer<const TextRopeNode> TextRopeNodeRef;
+
+
+/// The text of a single node. When all characters fit in a byte (and the rope is in latin1 mode)
+/// the text is stored as latin1, else it's stored as UTF-16
+class TextRopeChunk
+{
+public:
+    TextRopeChunk() : isLatin1_(false) {}
+
+    /// Creates a chunk for the given data
+    /// @param latin1 when true, the chunk is stored as latin1 if all characters are < 256
+    static TextRopeChunk fromData(const QChar* data, size_t length, bool latin1)
+    {
+        TextRopeChunk result;
+        if (latin1) {
+            for (size_t i = 0; i < length; ++i) {
+                if (data[i].unicode() > 0xff) {
+                    latin1 = false;
+                    break;
+                }
+            }
+        }
+        if (latin1) {
+            result.isLatin1_ = true;
+            result.latin1_.resize(static_cast<qsizetype>(length));
+            char* target = result.latin1_.data();
+            for (size_t i = 0; i < length; ++i) {
+                target[i] = static_cast<char>(data[i].unicode());
+            }
+        } else {
+            result.utf16_ = QString(data, static_cast<qsizetype>(length));
+        }
+        return result;
+    }
+
+    size_t length() const
+    {
+        return static_cast<size_t>(isLatin1_ ? latin1_.length() : utf16_.length());
+    }
+
+    QChar at(size_t offset) const
+    {
+        if (isLatin1_) return QChar(static_cast<uchar>(latin1_.at(static_cast<qsizetype>(offset))));
+        return utf16_.at(static_cast<qsizetype>(offset));
+    }
+
+    /// Copies the given part of the chunk to the target
+    void copy(QChar* target, size_t offset, size_t length) const
+    {
+        if (isLatin1_) {
+            const uchar* source = reinterpret_cast<const uchar*>(latin1_.constData()) + offset;
+            for (size_t i = 0; i < length; ++i) {
+                target[i] = QChar(source[i]);
+            }
+        } else {
+            memcpy(target, utf16_.constData() + offset, sizeof(QChar) * length);
+        }
+    }
+
+    /// Returns a part of this chunk, with the same storage
+    TextRopeChunk mid(size_t offset, size_t length) const
+    {
+        TextRopeChunk result;
+        result.isLatin1_ = isLatin1_;
+        if (isLatin1_) {
+            result.latin1_ = latin1_.mid(static_cast<qsizetype>(offset), static_cast<qsizetype>(length));
+        } else {
+            result.utf16_ = utf16_.mid(static_cast<qsizetype>(offset), static_cast<qsizetype>(length));
+        }
+        return result;
+    }
+
+    QString toString() const
+    {
+        return isLatin1_ ? QString::fromLatin1(latin1_) : utf16_;
+    }
+
+    /// Counts the newlines in the first length characters
+    size_t newlineCount(size_t length) const
+    {
+        if (isLatin1_) return NewlineScanner::countNewlines(latin1_.constData(), length);
+        return NewlineScanner::countNewlines(utf16_.constData(), length);
+    }
+
+    /// Returns the offset after the given newline
+    size_t offsetAfterNewline(size_t newline) const
+    {
+        if (isLatin1_) return NewlineScanner::offsetAfterNewline(latin1_.constData(), length(), newline);
+        return NewlineScanner::offsetAfterNewline(utf16_.constData(), length(), newline);
+    }
+
+    /// Returns the number of bytes used to store the characters
+    size_t byteSize() const
+    {
+        return isLatin1_ ? length() : length() * sizeof(QChar);
+    }
+
+    bool isLatin1() const { return isLatin1_; }
+
+private:
+    QString utf16_;           ///< The text, when it's stored as UTF-16
+    QByteArray latin1_;       ///< The text, when it's stored as latin1
+    bool isLatin1_;           ///< Is the text stored as latin1
+};
+
+
+/// A single (immutable) node of the rope
+/// The node contains a chunk of text and the aggregated information of the subtree
+class TextRopeNode : public QSharedData
+{
+public:
+    TextRopeNode(const TextRopeNodeRef& left, const TextRopeChunk& chunk, size_t chunkNewlineCount, const TextRopeNodeRef& right, quint32 priority)
+        : left_(left)
+        , right_(right)
+        , chunk_(chunk)
+        , chunkNewlineCount_(chunkNewlineCount)
+        , priority_(priority)
+    {
+        length_       = chunk_.length();
+        newlineCount_ = chunkNewlineCount_;
+        chunkCount_   = 1;
+        byteSize_     = chunk_.byteSize();
+        if (left_) {
+            length_       += left_->length_;
+            newlineCount_ += left_->newlineCount_;
+            chunkCount_   += left_->chunkCount_;
+            byteSize_     += left_->byteSize_;
+        }
+        if (right_) {
+            length_       += right_->length_;
+            newlineCount_ += right_->newlineCount_;
+            chunkCount_   += right_->chunkCount_;
+            byteSize_     += right_->byteSize_;
+        }
+    }
+
+    TextRopeNodeRef left_;        ///< The left subtree
+    TextRopeNodeRef right_;       ///< The right subtree
+    TextRopeChunk chunk_;         ///< The text of this node
+    size_t chunkNewlineCount_;    ///< The number of newlines in the chunk of this node
+    quint32 priority_;            ///< The (heap ordered) treap priority
+
+    size_t length_;               ///< The number of characters in this subtree
+    size_t newlineCount_;         ///< The number of newlines in this subtree
+    size_t chunkCount_;           ///< The number of nodes in this subtree
+    size_t byteSize_;             ///< The number of bytes used for the text of this subtree
+};
+
+
+/// Convenient method to return the length of a possible empty subtree
+static inline size_t nodeLength(const TextRopeNodeRef& node)
+{
+    return node ? node->length_ : 0;
+}
+
+
+/// Convenient method to return the newline count of a possible empty subtree
+static inline size_t nodeNewlineCount(const TextRopeNodeRef& node)
+{
+    return node ? node->newlineCount_ : 0;
+}
+
+
+/// Returns a copy of the given node with new children
+static inline TextRopeNodeRef copyNode(const TextRopeNodeRef& node, const TextRopeNodeRef& left, const TextRopeNodeRef& right)
+{
+    return TextRopeNodeRef(new TextRopeNode(left, node->chunk_, node->chunkNewlineCount_, right, node->priority_));
+}
+
+
+/// Joins two trees. All characters of a are placed before the characters of b
+static TextRopeNodeRef mergeNodes(const TextRopeNodeRef& a, const TextRopeNodeRef& b)
+{
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority_ > b->priority_) {
+        return copyNode(a, a->left_, mergeNodes(a->right_, b));
+    }
+    return copyNode(b, mergeNodes(a, b->left_), b->right_);
+}
+
+
+/// Splits the tree at the given character offset
+/// @param node the tree to split
+/// @param offset the number of characters that should end up in the left tree
+/// @param left (out) the tree with the first offset characters
+/// @param right (out) the tree with the remaining characters
+static void splitNode(const TextRopeNodeRef& node, size_t offset, TextRopeNodeRef& left, TextRopeNodeRef& right)
+{
+    if (!node) {
+        left = TextRopeNodeRef();
+        right = TextRopeNodeRef();
+        return;
+    }
+    if (offset == 0) {
+        left = TextRopeNodeRef();
+        right = node;
+        return;
+    }
+    if (offset >= node->length_) {
+        left = node;
+        right = TextRopeNodeRef();
+        return;
+    }
+
+    size_t leftLength = nodeLength(node->left_);
+    size_t chunkLength = node->chunk_.length();
+
+    // split in the left subtree
+    if (offset <= leftLength) {
+        TextRopeNodeRef rightPart;
+        splitNode(node->left_, offset, left, rightPart);
+        right = copyNode(node, rightPart, node->right_);
+
+    // split in the right subtree
+    } else if (offset >= leftLength + chunkLength) {
+        TextRopeNodeRef leftPart;
+        splitNode(node->right_, offset - leftLength - chunkLength, leftPart, right);
+        left = copyNode(node, node->left_, leftPart);
+
+    // split the chunk of this node
+    } else {
+        size_t chunkOffset = offset - leftLength;
+        TextRopeChunk leftChunk = node->chunk_.mid(0, chunkOffset);
+        TextRopeChunk rightChunk = node->chunk_.mid(chunkOffset, chunkLength - chunkOffset);
+        size_t leftChunkNewlineCount = leftChunk.newlineCount(chunkOffset);
+        left = TextRopeNodeRef(new TextRopeNode(node->left_, leftChunk, leftChunkNewlineCount, TextRopeNodeRef(), node->priority_));
+        right = TextRopeNodeRef(new TextRopeNode(TextRopeNodeRef(), rightChunk, node->chunkNewlineCount_ - leftChunkNewlineCount, node->right_, node->priority_));
+    }
+}
+
+
+/// Removes the first chunk of the given (non-empty) tree
+/// @param chunk (out) the removed chunk
+/// @return the tree without the first chunk
+static TextRopeNodeRef takeFirstChunk(const TextRopeNodeRef& node, TextRopeChunk& chunk)
+{
+    if (!node->left_) {
+        chunk = node->chunk_;
+        return node->right_;
+    }
+    return copyNode(node, takeFirstChunk(node->left_, chunk), node->right_);
+}
+
+
+/// Removes the last chunk of the given (non-empty) tree
+/// @param chunk (out) the removed chunk
+/// @return the tree without the last chunk
+static TextRopeNodeRef takeLastChunk(const TextRopeNodeRef& node, TextRopeChunk& chunk)
+{
+    if (!node->right_) {
+        chunk = node->chunk_;
+        return node->left_;
+    }
+    return copyNode(node, node->left_, takeLastChunk(node->right_, chunk));
+}
+
+
+/// Copies the given range of the tree to the target
+static void copyNodeRange(const TextRopeNodeRef& node, QChar* target, size_t offset, size_t length)
+{
+    if (!node || length == 0) return;
+
+    // the left part
+    size_t leftLength = nodeLength(node->left_);
+    if (offset < leftLength) {
+        size_t len = qMin(leftLength - offset, length);
+        copyNodeRange(node->left_, target, offset, len);
+        target += len;
+        offset += len;
+        length -= len;
+    }
+
+    // the chunk
+    size_t chunkLength = node->chunk_.length();
+    if (length > 0 && offset < leftLength + chunkLength) {
+        size_t chunkOffset = offset - leftLength;
+        size_t len = qMin(chunkLength - chunkOffset, length);
+        node->chunk_.copy(target, chunkOffset, len);
+        target += len;
+        offset += len;
+        length -= len;
+    }
+
+    // the right part
+    if (length > 0) {
+        copyNodeRange(node->right_, target, offset - leftLength - chunkLength, length);
+    }
+}
+
+
+/// Returns the depth of the given tree
+static size_t nodeDepth(const TextRopeNodeRef& node)
+{
+    if (!node) return 0;
+    return 1 + qMax(nodeDepth(node->left_), nodeDepth(node->right_));
+}
+
+
+/// Appends the chunks of the given tree seperated with a '|' character (for unit testing)
+static void appendNodeUnitTestString(const TextRopeNodeRef& node, QString& str)
+{
+    if (!node) return;
+    appendNodeUnitTestString(node->left_, str);
+    if (!str.isEmpty()) str.append('|');
+    str.append(node->chunk_.toString());
+    appendNodeUnitTestString(node->right_, str);
+}
+
+
+//=====================================================
+
+
+/// Constructs an empty rope
+/// @param mode the storage mode used for the text chunks
+TextRope::TextRope(StorageMode mode)
+    : root_()
+    , seed_(2463534242u)
+    , storageMode_(mode)
+{
+}
+
+
+/// Constructs a copy of the given rope. The copy shares all nodes with the other rope
+TextRope::TextRope(const TextRope& other)
+    : root_(other.root_)
+    , seed_(other.seed_)
+    , storageMode_(other.storageMode_)
+{
+}
+
+
+/// Assigns the given rope. The nodes are shared
+TextRope& TextRope::operator=(const TextRope& other)
+{
+    root_ = other.root_;
+    seed_ = other.seed_;
+    storageMode_ = other.storageMode_;
+    return *this;
+}
+
+
+TextRope::~TextRope()
+{
+}
+
+
+/// Returns the number of characters in the rope
+size_t TextRope::length() const
+{
+    return nodeLength(root_);
+}
+
+
+/// Returns the total number of newline characters in the rope
+size_t TextRope::newlineCount() const
+{
+    return nodeNewlineCount(root_);
+}
+
+
+/// Returns the number of chunks used to store the text
+size_t TextRope::chunkCount() const
+{
+    return root_ ? root_->chunkCount_ : 0;
+}
+
+
+/// Returns the number of bytes used for storing the characters (excluding the tree overhead)
+size_t TextRope::byteSize() const
+{
+    return root_ ? root_->byteSize_ : 0;
+}
+
+
+/// Changes the storage mode. All existing chunks are converted to the new storage mode
+void TextRope::setStorageMode(StorageMode mode)
+{
+    if (storageMode_ == mode) return;
+    storageMode_ = mode;
+
+    QString text = mid(0, length());
+    root_ = makeChunks(text.constData(), static_cast<size_t>(text.length()));
+}
+
+
+/// Returns the depth of the tree (for testing the balancing)
+size_t TextRope::depth() const
+{
+    return nodeDepth(root_);
+}
+
+
+/// Returns the character at the given offset
+QChar TextRope::at(size_t offset) const
+{
+    Q_ASSERT(offset < length());
+    const TextRopeNode* node = root_.data();
+    while (node) {
+        size_t leftLength = nodeLength(node->left_);
+        if (offset < leftLength) {
+            node = node->left_.data();
+            continue;
+        }
+        offset -= leftLength;
+        size_t chunkLength = node->chunk_.length();
+        if (offset < chunkLength) {
+            return node->chunk_.at(offset);
+        }
+        offset -= chunkLength;
+        node = node->right_.data();
+    }
+    return QChar();
+}
+
+
+/// Returns the text of the given range
+QString TextRope::mid(size_t offset, size_t length) const
+{
+    if (length == 0) return QString();
+    QString result(static_cast<qsizetype>(length), QChar());
+    copyRange(result.data(), offset, length);
+    return result;
+}
+
+
+/// Copies the given range to the target pointer
+/// @param target the target buffer, this buffer should have room for length characters
+/// @param offset the offset of the first character to copy
+/// @param length the number of characters to copy
+void TextRope::copyRange(QChar* target, size_t offset, size_t length) const
+{
+    Q_ASSERT(offset + length <= this->length());
+    copyNodeRange(root_, target, offset, length);
+}
+
+
+/// Replaces the given range with the given data
+/// The text surrounding the edit is rechunked, this way small edits don't fragment the rope
+/// @param offset the offset of the text to replace
+/// @param length the number of characters to replace
+/// @param data the new characters
+/// @param dataLength the number of new characters
+void TextRope::replace(size_t offset, size_t length, const QChar* data, size_t dataLength)
+{
+    Q_ASSERT(offset + length <= this->length());
+    if (length == 0 && dataLength == 0) return;
+
+    TextRopeNodeRef left, rest, removed, right;
+    splitNode(root_, offset, left, rest);
+    splitNode(rest, length, removed, right);
+
+    // take the chunks that surround the edit
+    TextRopeChunk leftChunk, rightChunk;
+    if (left) { left = takeLastChunk(left, leftChunk); }
+    if (right) { right = takeFirstChunk(right, rightChunk); }
+
+    TextRopeNodeRef middle;
+    if (dataLength <= MaxChunkSize * 2) {
+        QString joined(static_cast<qsizetype>(leftChunk.length() + dataLength + rightChunk.length()), QChar());
+        QChar* target = joined.data();
+        leftChunk.copy(target, 0, leftChunk.length());
+        memcpy(target + leftChunk.length(), data, sizeof(QChar) * dataLength);
+        rightChunk.copy(target + leftChunk.length() + dataLength, 0, rightChunk.length());
+        middle = makeChunks(joined.constData(), static_cast<size_t>(joined.length()));
+    } else {
+        QString leftText = leftChunk.toString();
+        QString rightText = rightChunk.toString();
+        middle = makeChunks(leftText.constData(), static_cast<size_t>(leftText.length()));
+        middle = mergeNodes(middle, makeChunks(data, dataLength));
+        middle = mergeNodes(middle, makeChunks(rightText.constData(), static_cast<size_t>(rightText.length())));
+    }
+    root_ = mergeNodes(mergeNodes(left, middle), right);
+}
+
+
+/// Appends the given data to the rope
+void TextRope::append(const QChar* data, size_t dataLength)
+{
+    replace(length(), 0, data, dataLength);
+}
+
+
+/// Removes all text
+void TextRope::clear()
+{
+    root_ = TextRopeNodeRef();
+}
+
+
+/// Returns the line number of the given offset. This equals the number of newlines before the offset
+size_t TextRope::lineFromOffset(size_t offset) const
+{
+    size_t line = 0;
+    const TextRopeNode* node = root_.data();
+    while (node) {
+        size_t leftLength = nodeLength(node->left_);
+        if (offset <= leftLength) {
+            node = node->left_.data();
+            continue;
+        }
+        offset -= leftLength;
+        line += nodeNewlineCount(node->left_);
+
+        size_t chunkLength = node->chunk_.length();
+        if (offset <= chunkLength) {
+            return line + node->chunk_.newlineCount(offset);
+        }
+        offset -= chunkLength;
+        line += node->chunkNewlineCount_;
+        node = node->right_.data();
+    }
+    return line;
+}
+
+
+/// Returns the offset of the first character of the given line.
+/// When the line doesn't exist the length of the rope is returned
+size_t TextRope::offsetFromLine(size_t line) const
+{
+    if (line == 0) return 0;
+    if (line > newlineCount()) return length();
+
+    size_t offset = 0;
+    const TextRopeNode* node = root_.data();
+    while (node) {
+        size_t leftNewlineCount = nodeNewlineCount(node->left_);
+        if (line <= leftNewlineCount) {
+            node = node->left_.data();
+            continue;
+        }
+        line -= leftNewlineCount;
+        offset += nodeLength(node->left_);
+
+        // the line starts in this chunk
+        if (line <= node->chunkNewlineCount_) {
+            size_t chunkOffset = node->chunk_.offsetAfterNewline(line);
+            Q_ASSERT(chunkOffset != std::string::npos);
+            return offset + chunkOffset;
+        }
+        line -= node->chunkNewlineCount_;
+        offset += node->chunk_.length();
+        node = node->right_.data();
+    }
+    return offset;
+}
+
+
+/// Returns all chunks separated with a '|' character (for unit testing)
+QString TextRope::toUnitTestString() const
+{
+    QString result;
+    appendNodeUnitTestString(root_, result);
+    return result;
+}
+
+
+/// Returns a new random node priority (xorshift32)
+quint32 TextRope::nextPriority()
+{
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+
+/// Builds a balanced tree of chunks for the given data
+/// The priority of every node is at least the priority of its children, so the result is a valid treap
+TextRope::NodeRef TextRope::makeChunks(const QChar* data, size_t dataLength)
+{
+    if (dataLength == 0) return NodeRef();
+
+    // divide the data in equally sized chunks
+    size_t chunkCount = (dataLength + MaxChunkSize - 1) / MaxChunkSize;
+    if (chunkCount == 1) {
+        TextRopeChunk chunk = TextRopeChunk::fromData(data, dataLength, storageMode_ == Latin1Storage);
+        return NodeRef(new TextRopeNode(NodeRef(), chunk, NewlineScanner::countNewlines(data, dataLength), NodeRef(), nextPriority()));
+    }
+    size_t middleChunk = chunkCount / 2;
+    size_t chunkBegin = dataLength * middleChunk / chunkCount;
+    size_t chunkEnd = dataLength * (middleChunk + 1) / chunkCount;
+
+    NodeRef left = makeChunks(data, chunkBegin);
+    NodeRef right = makeChunks(data + chunkEnd, dataLength - chunkEnd);
+
+    quint32 priority = nextPriority();
+    if (left && left->priority_ > priority) { priority = left->priority_; }
+    if (right && right->priority_ > priority) { priority = right->priority_; }
+
+    TextRopeChunk chunk = TextRopeChunk::fromData(data + chunkBegin, chunkEnd - chunkBegin, storageMode_ == Latin1Storage);
+    return NodeRef(new TextRopeNode(left, chunk, NewlineScanner::countNewlines(data + chunkBegin, chunkEnd - chunkBegin), right, priority));
+}
+
+
+} // edbee
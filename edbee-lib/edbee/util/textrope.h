@@ -0,0 +1,79 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <QByteArray>
+#include <QChar>
+#include <QExplicitlySharedDataPointer>
+#include <QSharedData>
+#include <QString>
+
+namespace edbee {
+
+class TextRopeNode;
+
+
+/// A rope is a balanced tree of text chunks. Every node stores the total length and the
+/// number of newlines of its subtree, which makes offset, line and edit operations O(log n),
+/// regardless of the distance between two edits.
+///
+/// The tree is a persistent (path-copying) treap. Nodes are never modified after construction,
+/// so copying a rope is O(1) and the copies share their structure. Because of this it is safe
+/// to read a copy of a rope from another thread while the original keeps changing.
+///
+/// In Latin1Storage mode every chunk which only contains characters below 256 is stored with
+/// one byte per character. A chunk is promoted to UTF-16 when a wider character is inserted.
+/// Offsets are always UTF-16 offsets, so no extra offset translation is required.
+class EDBEE_EXPORT TextRope {
+public:
+    /// The maximum number of characters stored in a single chunk
+    static const size_t MaxChunkSize = 2048;
+
+    /// The way the characters of a chunk are stored
+    enum StorageMode {
+        Utf16Storage,         ///< All chunks are stored as UTF-16
+        Latin1Storage         ///< Chunks are stored as latin1 when possible
+    };
+
+    explicit TextRope(StorageMode mode = Utf16Storage);
+    TextRope(const TextRope& other);
+    TextRope& operator=(const TextRope& other);
+    ~TextRope();
+
+    size_t length() const;
+    size_t newlineCount() const;
+    size_t chunkCount() const;
+    size_t depth() const;
+    size_t byteSize() const;
+
+    StorageMode storageMode() const { return storageMode_; }
+    void setStorageMode(StorageMode mode);
+
+    QChar at(size_t offset) const;
+    QString mid(size_t offset, size_t length) const;
+    void copyRange(QChar* target, size_t offset, size_t length) const;
+
+    void replace(size_t offset, size_t length, const QChar* data, size_t dataLength);
+    void append(const QChar* data, size_t dataLength);
+    void clear();
+
+    size_t lineFromOffset(size_t offset) const;
+    size_t offsetFromLine(size_t line) const;
+
+    QString toUnitTestString() const;
+
+private:
+    typedef QExplicitlySharedDataPointer<const TextRopeNode> NodeRef;
+
+    quint32 nextPriority();
+    NodeRef makeChunks(const QChar* data, size_t dataLength);
+
+    NodeRef root_;      ///< The root node of the tree (0 when the rope is empty)
+    quint32 seed_;      ///< The state of the random generator used for the node priorities
+    StorageMode storageMode_;    ///< The storage mode used for new chunks
+};
+
+} // edbee
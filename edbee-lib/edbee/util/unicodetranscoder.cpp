@@ -0,0 +1,215 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "unicodetranscoder.h"
+
+#include <cstring>
+
+#include <QChar>
+#include <QtEndian>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDBEE_UNICODETRANSCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const ushort ReplacementCharacter = 0xFFFD;    ///< The character for invalid UTF-8 sequences
+static const char EncodeReplacement = '?';             ///< The byte for a lone surrogate (like the Qt UTF-8 encoder)
+
+
+/// Decodes UTF-8 to UTF-16.
+/// Every invalid sequence (the maximal invalid subpart, like recommended by the unicode standard) becomes U+FFFD.
+/// The decoding stops before an incomplete sequence at the end of the data.
+/// @param data the UTF-8 data
+/// @param length the number of bytes
+/// @param target the target of the characters, this should have room for length characters
+/// @param consumed the number of bytes decoded (the remaining bytes are an incomplete sequence)
+/// @return the number of characters written to target
+size_t UnicodeTranscoder::decodeUtf8(const char* data, size_t length, QChar* target, size_t* consumed)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    ushort* out = reinterpret_cast<ushort*>(target);
+    size_t i = 0;
+    size_t written = 0;
+
+    while (i < length) {
+#if defined(EDBEE_UNICODETRANSCODER_SSE2)
+        // widen ASCII blocks
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= length) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+            if (_mm_movemask_epi8(block)) break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), _mm_unpacklo_epi8(block, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 8), _mm_unpackhi_epi8(block, zero));
+            i += 16;
+            written += 16;
+        }
+        if (i >= length) break;
+#endif
+        uchar lead = bytes[i];
+        if (lead < 0x80) {
+            out[written++] = lead;
+            ++i;
+            continue;
+        }
+
+        // the valid ranges of the second byte are limited for some lead bytes (RFC 3629)
+        size_t sequenceLength = 0;
+        uint codePoint = 0;
+        uchar low = 0x80;
+        uchar high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            sequenceLength = 2;
+            codePoint = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            sequenceLength = 3;
+            codePoint = lead & 0x0F;
+            if (lead == 0xE0) { low = 0xA0; }
+            else if (lead == 0xED) { high = 0x9F; }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            sequenceLength = 4;
+            codePoint = lead & 0x07;
+            if (lead == 0xF0) { low = 0x90; }
+            else if (lead == 0xF4) { high = 0x8F; }
+        } else {
+            out[written++] = ReplacementCharacter;
+            ++i;
+            continue;
+        }
+
+        size_t k = 1;
+        for (; k < sequenceLength && i + k < length; ++k) {
+            uchar c = bytes[i + k];
+            if (c < low || c > high) break;
+            codePoint = (codePoint << 6) | (c & 0x3F);
+            low = 0x80;
+            high = 0xBF;
+        }
+
+        if (k < sequenceLength) {
+            // an incomplete sequence at the end is kept for the next block
+            if (i + k >= length) break;
+            out[written++] = ReplacementCharacter;
+            i += k;
+            continue;
+        }
+
+        if (codePoint >= 0x10000) {
+            out[written++] = QChar::highSurrogate(codePoint);
+            out[written++] = QChar::lowSurrogate(codePoint);
+        } else {
+            out[written++] = static_cast<ushort>(codePoint);
+        }
+        i += sequenceLength;
+    }
+
+    *consumed = i;
+    return written;
+}
+
+
+/// Encodes UTF-16 to UTF-8.
+/// A lone surrogate is encoded as '?'. The encoding stops before a high surrogate at the end of the data.
+/// @param data the characters to encode
+/// @param length the number of characters
+/// @param target the target of the bytes, this should have room for 3 * length bytes
+/// @param consumed the number of characters encoded
+/// @return the number of bytes written to target
+size_t UnicodeTranscoder::encodeUtf8(const QChar* data, size_t length, char* target, size_t* consumed)
+{
+    const ushort* chars = reinterpret_cast<const ushort*>(data);
+    uchar* out = reinterpret_cast<uchar*>(target);
+    size_t i = 0;
+    size_t written = 0;
+
+    while (i < length) {
+#if defined(EDBEE_UNICODETRANSCODER_SSE2)
+        // narrow ASCII blocks
+        const __m128i nonAsciiMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= length) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars + i + 8));
+            __m128i nonAscii = _mm_and_si128(_mm_or_si128(lo, hi), nonAsciiMask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, zero)) != 0xFFFF) break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), _mm_packus_epi16(lo, hi));
+            i += 16;
+            written += 16;
+        }
+        if (i >= length) break;
+#endif
+        ushort c = chars[i];
+        if (c < 0x80) {
+            out[written++] = static_cast<uchar>(c);
+            ++i;
+        } else if (c < 0x800) {
+            out[written++] = static_cast<uchar>(0xC0 | (c >> 6));
+            out[written++] = static_cast<uchar>(0x80 | (c & 0x3F));
+            ++i;
+        } else if (QChar::isHighSurrogate(c)) {
+            if (i + 1 >= length) break;     // the low surrogate is in the next block
+            ushort next = chars[i + 1];
+            if (QChar::isLowSurrogate(next)) {
+                uint codePoint = QChar::surrogateToUcs4(c, next);
+                out[written++] = static_cast<uchar>(0xF0 | (codePoint >> 18));
+                out[written++] = static_cast<uchar>(0x80 | ((codePoint >> 12) & 0x3F));
+                out[written++] = static_cast<uchar>(0x80 | ((codePoint >> 6) & 0x3F));
+                out[written++] = static_cast<uchar>(0x80 | (codePoint & 0x3F));
+                i += 2;
+            } else {
+                out[written++] = EncodeReplacement;
+                ++i;
+            }
+        } else if (QChar::isLowSurrogate(c)) {
+            out[written++] = EncodeReplacement;
+            ++i;
+        } else {
+            out[written++] = static_cast<uchar>(0xE0 | (c >> 12));
+            out[written++] = static_cast<uchar>(0x80 | ((c >> 6) & 0x3F));
+            out[written++] = static_cast<uchar>(0x80 | (c & 0x3F));
+            ++i;
+        }
+    }
+
+    *consumed = i;
+    return written;
+}
+
+
+/// Decodes UTF-16LE to characters
+/// @param data the bytes
+/// @param length the number of characters (the number of bytes / 2)
+/// @param target the target of the characters
+void UnicodeTranscoder::decodeUtf16LE(const char* data, size_t length, QChar* target)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    std::memcpy(target, data, length * sizeof(QChar));
+#else
+    for (size_t i = 0; i < length; ++i) {
+        target[i] = QChar(qFromLittleEndian<quint16>(data + i * 2));
+    }
+#endif
+}
+
+
+/// Encodes characters to UTF-16LE
+/// @param data the characters
+/// @param length the number of characters
+/// @param target the target of the bytes, this should have room for 2 * length bytes
+void UnicodeTranscoder::encodeUtf16LE(const QChar* data, size_t length, char* target)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    std::memcpy(target, data, length * sizeof(QChar));
+#else
+    for (size_t i = 0; i < length; ++i) {
+        qToLittleEndian<quint16>(data[i].unicode(), target + i * 2);
+    }
+#endif
+}
+
+
+} // edbee
@@ -0,0 +1,33 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <cstddef>
+
+class QChar;
+
+namespace edbee {
+
+
+/// Conversion kernels between UTF-16 (QChar) and UTF-8 / UTF-16LE bytes.
+///
+/// These are the building blocks of the native decoders and encoders of the TextCodec.
+/// The kernels work on complete buffers, the streaming state (incomplete sequences at the end
+/// of a block) is kept by the decoders and encoders.
+///
+/// Runs of ASCII characters are converted 16 characters at a time with SSE2 (when available),
+/// the other characters with a scalar loop. UTF-16LE is copied directly on little endian cpus.
+class EDBEE_EXPORT UnicodeTranscoder {
+public:
+    static size_t decodeUtf8(const char* data, size_t length, QChar* target, size_t* consumed);
+    static size_t encodeUtf8(const QChar* data, size_t length, char* target, size_t* consumed);
+
+    static void decodeUtf16LE(const char* data, size_t length, QChar* target);
+    static void encodeUtf16LE(const QChar* data, size_t length, char* target);
+};
+
+
+} // edbee
@@ -0,0 +1,273 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "utf8validator.h"
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDBEE_UTF8VALIDATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled with a function target attribute, so the library itself doesn't require AVX2
+#if defined(EDBEE_UTF8VALIDATOR_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDBEE_UTF8VALIDATOR_AVX2
+#include <immintrin.h>
+#endif
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Validates the data from the given index (which must be at the start of a character)
+/// @param data the data to validate
+/// @param length the length of the data
+/// @param i the index to start
+/// @param allowTruncatedEnd is an incomplete sequence at the end of the data valid?
+/// @param nonAscii is set to true when a non-ASCII character is found
+/// @return true if the data is valid
+static bool validateFrom(const uchar* data, size_t length, size_t i, bool allowTruncatedEnd, bool& nonAscii)
+{
+    while (i < length) {
+#if defined(EDBEE_UTF8VALIDATOR_SSE2)
+        // skip ASCII blocks
+        while (i + 16 <= length && !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)))) {
+            i += 16;
+        }
+        if (i >= length) break;
+#endif
+        uchar lead = data[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+        nonAscii = true;
+
+        // the valid ranges of the second byte are limited for some lead bytes (RFC 3629)
+        size_t sequenceLength = 0;
+        uchar low = 0x80;
+        uchar high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            sequenceLength = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            sequenceLength = 3;
+            if (lead == 0xE0) { low = 0xA0; }           // overlong
+            else if (lead == 0xED) { high = 0x9F; }     // surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            sequenceLength = 4;
+            if (lead == 0xF0) { low = 0x90; }           // overlong
+            else if (lead == 0xF4) { high = 0x8F; }     // above U+10FFFF
+        } else {
+            return false;
+        }
+
+        for (size_t k = 1; k < sequenceLength; ++k) {
+            if (i + k >= length) { return allowTruncatedEnd; }
+            uchar c = data[i + k];
+            if (c < low || c > high) { return false; }
+            low = 0x80;
+            high = 0xBF;
+        }
+        i += sequenceLength;
+    }
+    return true;
+}
+
+
+#if defined(EDBEE_UTF8VALIDATOR_AVX2)
+
+static const size_t Avx2BlockSize = 32;     ///< The number of bytes validated at once with AVX2
+
+// The error classes of the lookup tables. Every table returns the classes that are possible for
+// a nibble, a pair of bytes is invalid when the intersection of its 3 lookups isn't empty.
+static const char TooShort = 1 << 0;        ///< 11______ 0_______ or 11______ 11______
+static const char TooLong = 1 << 1;         ///< 0_______ 10______
+static const char Overlong3 = 1 << 2;       ///< 11100000 100_____
+static const char TooLarge = 1 << 3;        ///< 11110100 1001____ or 11110100 101_____ or 11110101..11111111 ________
+static const char Surrogate = 1 << 4;       ///< 11101101 101_____
+static const char Overlong2 = 1 << 5;       ///< 1100000_ 10______
+static const char TooLarge1000 = 1 << 6;    ///< 11110101..11111111 1000____
+static const char Overlong4 = 1 << 6;       ///< 11110000 1000____
+static const char TwoConts = static_cast<char>(1 << 7);  ///< 10______ 10______ (valid inside a 3 or 4 byte sequence)
+static const char Carry = TooShort | TooLong | TwoConts;
+
+/// The error classes for the high nibble of the first byte
+static const char byte1HighTable[16] = {
+    TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,     // 0_______ (ASCII)
+    TwoConts, TwoConts, TwoConts, TwoConts,                                     // 10______ (continuation)
+    TooShort | Overlong2,                                                       // 1100____
+    TooShort,                                                                   // 1101____
+    TooShort | Overlong3 | Surrogate,                                           // 1110____
+    TooShort | TooLarge | TooLarge1000 | Overlong4                              // 1111____
+};
+
+/// The error classes for the low nibble of the first byte
+static const char byte1LowTable[16] = {
+    Carry | Overlong3 | Overlong2 | Overlong4,                                  // ____0000
+    Carry | Overlong2,                                                          // ____0001
+    Carry, Carry,                                                               // ____001_
+    Carry | TooLarge,                                                           // ____0100
+    Carry | TooLarge | TooLarge1000,                                            // ____0101
+    Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,           // ____011_
+    Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,           // ____1___
+    Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000 | Surrogate,                                // ____1101
+    Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000
+};
+
+/// The error classes for the high nibble of the second byte
+static const char byte2HighTable[16] = {
+    TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,  // 0_______
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,           // 1000____
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,                           // 1001____
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,                           // 101_____
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+    TooShort, TooShort, TooShort, TooShort                                           // 11______
+};
+
+/// The maximum value of the last bytes of a block, larger values start a sequence that continues in the next block
+static const char incompleteMaxTable[32] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1)
+};
+
+
+/// Returns the table, repeated in both lanes (the shuffle instruction works per 128 bit lane)
+__attribute__((target("avx2")))
+static inline __m256i loadTable(const char* table)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+
+/// Returns the high nibbles of the given bytes
+__attribute__((target("avx2")))
+static inline __m256i highNibbles(__m256i value)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(value, 4), _mm256_set1_epi8(0x0F));
+}
+
+
+/// Returns the input shifted by count bytes, the first bytes are the last bytes of the previous input
+#define EDBEE_UTF8_PREVIOUS(input, previousInput, count) \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previousInput, input, 0x21), 16 - count)
+
+
+/// Validates the complete AVX2 blocks. Returns the number of bytes validated, which is a multiple of the block size.
+/// The caller needs to validate the remaining bytes (an incomplete sequence at the end of the last block isn't reported)
+__attribute__((target("avx2")))
+static size_t validateAvx2(const uchar* data, size_t length, bool& nonAscii, bool& valid)
+{
+    const __m256i byte1High = loadTable(byte1HighTable);
+    const __m256i byte1Low = loadTable(byte1LowTable);
+    const __m256i byte2High = loadTable(byte2HighTable);
+    const __m256i incompleteMax = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(incompleteMaxTable));
+    const __m256i lowNibbleMask = _mm256_set1_epi8(0x0F);
+
+    __m256i previousInput = _mm256_setzero_si256();
+    __m256i previousIncomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + Avx2BlockSize <= length; i += Avx2BlockSize) {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        if (!_mm256_movemask_epi8(input)) {
+            // an ASCII block is only invalid when the previous block ends with an incomplete sequence
+            error = _mm256_or_si256(error, previousIncomplete);
+            previousIncomplete = _mm256_setzero_si256();
+        } else {
+            nonAscii = true;
+
+            // the special cases of every pair of bytes
+            __m256i previous1 = EDBEE_UTF8_PREVIOUS(input, previousInput, 1);
+            __m256i specialCases = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1High, highNibbles(previous1)),
+                    _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(previous1, lowNibbleMask))),
+                _mm256_shuffle_epi8(byte2High, highNibbles(input)));
+
+            // the 3th and 4th byte of a sequence must be continuation bytes (the TwoConts case)
+            __m256i previous2 = EDBEE_UTF8_PREVIOUS(input, previousInput, 2);
+            __m256i previous3 = EDBEE_UTF8_PREVIOUS(input, previousInput, 3);
+            __m256i isThirdByte = _mm256_subs_epu8(previous2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            __m256i isFourthByte = _mm256_subs_epu8(previous3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            __m256i must23 = _mm256_and_si256(_mm256_or_si256(isThirdByte, isFourthByte), _mm256_set1_epi8(static_cast<char>(0x80)));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, specialCases));
+
+            previousIncomplete = _mm256_subs_epu8(input, incompleteMax);
+        }
+        previousInput = input;
+
+        if (!_mm256_testz_si256(error, error)) {
+            valid = false;
+            return i;
+        }
+    }
+    return i;
+}
+
+#undef EDBEE_UTF8_PREVIOUS
+
+#endif
+
+
+/// Validates the given data
+/// @param data the data to validate
+/// @param length the number of bytes
+/// @param allowTruncatedEnd when true an incomplete sequence at the end is valid (for validating a part of a file)
+/// @return the result of the validation
+Utf8Validator::Result Utf8Validator::validate(const char* data, size_t length, bool allowTruncatedEnd)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    bool nonAscii = false;
+    size_t i = 0;
+#if defined(EDBEE_UTF8VALIDATOR_AVX2)
+    if (isAvx2Supported()) {
+        bool valid = true;
+        i = validateAvx2(bytes, length, nonAscii, valid);
+        if (!valid) return Invalid;
+
+        // continue at the start of the last sequence, when it's continued after the validated blocks
+        for (size_t k = 1; k <= 3 && k <= i; ++k) {
+            uchar c = bytes[i - k];
+            if (c < 0x80) break;
+            if (c >= 0xC0) {
+                size_t sequenceLength = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+                if (sequenceLength > k) { i -= k; }
+                break;
+            }
+        }
+    }
+#endif
+    if (!validateFrom(bytes, length, i, allowTruncatedEnd, nonAscii)) return Invalid;
+    return nonAscii ? Utf8 : Ascii;
+}
+
+
+/// Validates the given data without the AVX2 code path (the ASCII blocks are still skipped with SSE2)
+/// @see validate
+Utf8Validator::Result Utf8Validator::validateScalar(const char* data, size_t length, bool allowTruncatedEnd)
+{
+    bool nonAscii = false;
+    if (!validateFrom(reinterpret_cast<const uchar*>(data), length, 0, allowTruncatedEnd, nonAscii)) return Invalid;
+    return nonAscii ? Utf8 : Ascii;
+}
+
+
+/// Returns true if the AVX2 code path is used on this cpu
+bool Utf8Validator::isAvx2Supported()
+{
+#if defined(EDBEE_UTF8VALIDATOR_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+
+} // edbee
@@ -0,0 +1,37 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/exports.h"
+
+#include <cstddef>
+
+namespace edbee {
+
+
+/// Validates UTF-8 data.
+///
+/// A valid sequence is a sequence allowed by RFC 3629: no overlong forms, no surrogates
+/// and no code points above U+10FFFF.
+///
+/// Blocks with only ASCII characters are skipped 16 bytes at a time with SSE2. On cpus with AVX2
+/// (checked at runtime) the multi-byte sequences are validated 32 bytes at a time with the lookup
+/// algorithm of Keiser and Lemire, which classifies every byte by table lookups of its nibbles.
+/// Other platforms use a scalar loop.
+class EDBEE_EXPORT Utf8Validator {
+public:
+    enum Result {
+        Ascii,      ///< The data only contains ASCII characters
+        Utf8,       ///< The data is valid UTF-8 and contains multi-byte sequences
+        Invalid     ///< The data isn't valid UTF-8
+    };
+
+    static Result validate(const char* data, size_t length, bool allowTruncatedEnd = false);
+    static Result validateScalar(const char* data, size_t length, bool allowTruncatedEnd = false);
+
+    static bool isAvx2Supported();
+};
+
+
+} // edbee
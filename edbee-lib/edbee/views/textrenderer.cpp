@@ -17,6 +17,7 @@
 #include "edbee/models/textdocument.h"
 #include "edbee/models/texteditorconfig.h"
 #include "edbee/models/textlexer.h"
+#include "edbee/models/textlexerscheduler.h"
 #include "edbee/views/textlayout.h"
 #include "edbee/views/textselection.h"
 #include "edbee/views/texttheme.h"
@@ -45,10 +46,13 @@ TextRenderer::TextRenderer(TextEditorController* controller)
     , startLine_(0)
     , endLine_(0)
     , placeHolderDocument_(nullptr)
+    , lexerScheduler_(nullptr)
 {
     connect(controller, SIGNAL(textDocumentChanged(edbee::TextDocument*,edbee::TextDocument*)), this, SLOT(textDocumentChanged(edbee::TextDocument*,edbee::TextDocument*)));
     textThemeStyler_ = new TextThemeStyler(controller);
     placeHolderDocument_ = new CharTextDocument();
+    lexerScheduler_ = new TextLexerScheduler(this);
+    connect(lexerScheduler_, SIGNAL(lexed(size_t,size_t)), this, SLOT(lexerSchedulerLexed(size_t,size_t)));
 }
 
 
@@ -454,20 +458,23 @@ void TextRenderer::renderBegin(const QRect& rect)
     startOffset_ = doc->offsetFromLine(startLine_);
     endOffset_   = doc->offsetFromLine(endLine_ + 1);
 
+    /// TODO: move this lexing stuff to the controller
+    // prepare the style, lines that aren't lexed in time are lexed in the background (and rendered without style)
+    // the complete viewport is requested, a repaint of a few lines shouldn't change the range that's being lexed
+    if (textDocument()->textLexer()) {
+        //PROF_BEGIN_NAMED("lexer")
+        size_t viewportEndLine = qMin(rawLineIndexForYpos(qMax(viewportY() + viewportHeight(), 0)) + 1, lineCount - 1);
+        size_t lexEndOffset = doc->offsetFromLine(qMax(endLine_, viewportEndLine) + 1);
+        lexerScheduler_->requestRange(textDocument(), startOffset_, lexEndOffset);
+        //PROF_END
+    }
+
     // Make sure  the cache-data is filled
     //PROF_BEGIN_NAMED("layouts")
     for (size_t line = startLine_; line <= endLine_; ++line) {
         textLayoutForLine(line);  // make sure the cache is filled
     }
     //PROF_END
-
-    /// TODO: move this lexing stuff to the controller
-    // prepare the style
-    if (textDocument()->textLexer()) {
-        //PROF_BEGIN_NAMED("lexer")
-        textDocument()->textLexer()->lexRange(startOffset_, endOffset_);
-        //PROF_END
-    }
 }
 
 /// This method starts rendering
@@ -602,6 +609,7 @@ void TextRenderer::textDocumentChanged(edbee::TextDocument *oldDocument, edbee::
         disconnect(oldDocument, nullptr, this, nullptr);
     }
     reset();
+    lexerScheduler_->cancel();
 
     // connect with the new dpcument
     connect(newDocument, SIGNAL(textChanged(edbee::TextBufferChange,QString)), this, SLOT(textChanged(edbee::TextBufferChange,QString)));
@@ -641,6 +649,18 @@ void TextRenderer::lastScopedOffsetChanged(size_t previousOffset, size_t newOffs
 }
 
 
+/// A background slice of the lexer scheduler has lexed the given range, repaints the visible lines of this range
+void TextRenderer::lexerSchedulerLexed(size_t previousOffset, size_t lastScopedOffset)
+{
+    TextDocument* doc = textDocument();
+    size_t beginLine = qMax(doc->lineFromOffset(previousOffset), firstVisibleLine());
+    size_t endLine = qMin(doc->lineFromOffset(lastScopedOffset), rawLineIndexForYpos(qMax(viewportY() + viewportHeight(), 0)));
+    if (beginLine <= endLine) {
+        textWidget()->updateLine(beginLine, endLine - beginLine + 1);
+    }
+}
+
+
 /// Invalidates the QTextLayout caches
 void TextRenderer::invalidateTextLayoutCaches(size_t fromLine)
 {
@@ -28,6 +28,7 @@ class TextSelection;
 class TextTheme;
 class TextThemeStyler;
 class TextLayout;
+class TextLexerScheduler;
 
 /// A class for rendering the text
 /// TODO: Currently this class is also used for positioning text. This probably should be moved in a class of its own
@@ -103,6 +104,8 @@ public:
     size_t startLine() { return startLine_; }      ///< This method is valid only while rendering!
     size_t endLine() { return endLine_; }          ///< This method is valid only while rendering!
 
+    TextLexerScheduler* lexerScheduler() { return lexerScheduler_; }
+
 private:
     void updateWidthCacheForRange(int offset, int length);
 
@@ -112,6 +115,7 @@ protected slots:
     void textChanged(edbee::TextBufferChange change, QString oldText = QString());
 
     void lastScopedOffsetChanged(size_t previousOffset, size_t newOffset);
+    void lexerSchedulerLexed(size_t previousOffset, size_t lastScopedOffset);
 
 public slots:
 
@@ -143,6 +147,7 @@ private:
     size_t endLine_;           ///< The last line that needs rendering
 
     TextDocument* placeHolderDocument_;
+    TextLexerScheduler* lexerScheduler_;    ///< Lexes the lines that aren't lexed in time in the background
 };
 
 } // edbee
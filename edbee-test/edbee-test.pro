@@ -50,7 +50,25 @@ SOURCES += \
   edbee/util/rangesetlineiteratortest.cpp \
   edbee/models/dynamicvariablestest.cpp \
   edbee/util/rangelineiteratortest.cpp \
-  edbee/views/textthememanagertest.cpp
+  edbee/views/textthememanagertest.cpp \
+  edbee/models/ropetextbuffertest.cpp \
+  edbee/util/textropetest.cpp \
+  edbee/models/mappedtextbuffertest.cpp \
+  edbee/util/newlinescannertest.cpp \
+  edbee/util/lineoffsettreetest.cpp \
+  edbee/models/textbuffersnapshottest.cpp \
+  edbee/io/textdocumentloadertest.cpp \
+  edbee/util/utf8validatortest.cpp \
+  edbee/util/unicodetranscodertest.cpp \
+  edbee/io/textdocumentsavertest.cpp \
+  edbee/io/textdocumentjournaltest.cpp \
+  edbee/io/textdocumentsessionsnapshottest.cpp \
+  edbee/io/textlexercachetest.cpp \
+  edbee/util/linedifftest.cpp \
+  edbee/io/textdocumentfollowertest.cpp \
+  edbee/models/textlexerschedulertest.cpp \
+  edbee/util/hash64test.cpp \
+  edbee/testhelpers.cpp
 
 HEADERS += \
 	edbee/commands/replaceselectioncommandtest.h \
@@ -79,7 +97,25 @@ HEADERS += \
   edbee/util/rangesetlineiteratortest.h \
   edbee/models/dynamicvariablestest.h \
   edbee/util/rangelineiteratortest.h \
-  edbee/views/textthememanagertest.h
+  edbee/views/textthememanagertest.h \
+  edbee/models/ropetextbuffertest.h \
+  edbee/util/textropetest.h \
+  edbee/models/mappedtextbuffertest.h \
+  edbee/util/newlinescannertest.h \
+  edbee/util/lineoffsettreetest.h \
+  edbee/models/textbuffersnapshottest.h \
+  edbee/io/textdocumentloadertest.h \
+  edbee/util/utf8validatortest.h \
+  edbee/util/unicodetranscodertest.h \
+  edbee/io/textdocumentsavertest.h \
+  edbee/io/textdocumentjournaltest.h \
+  edbee/io/textdocumentsessionsnapshottest.h \
+  edbee/io/textlexercachetest.h \
+  edbee/util/linedifftest.h \
+  edbee/io/textdocumentfollowertest.h \
+  edbee/models/textlexerschedulertest.h \
+  edbee/util/hash64test.h \
+  edbee/testhelpers.h
 
 ##OTHER_FILES += ../edbee-data/config/*
 ##OTHER_FILES += ../edbee-data/keymaps/*
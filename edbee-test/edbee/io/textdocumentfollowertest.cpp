@@ -0,0 +1,197 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentfollowertest.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+
+#include "edbee/io/textdocumentfollower.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/models/textundostack.h"
+#include "edbee/testhelpers.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Appends the given data to the file
+static void appendToFile(const QString& fileName, const QByteArray& data)
+{
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly | QIODevice::Append);
+    file.write(data);
+    file.close();
+}
+
+
+/// Tests appending the data written to the file, with characters and line endings split over multiple reads
+void TextDocumentFollowerTest::testFollow()
+{
+    QTemporaryFile file;
+    file.open();
+    QString fileName = file.fileName();
+    writeFile(fileName, "line 1\n");
+
+    CharTextDocument doc;
+    doc.setText(QStringLiteral("line 1\n"));
+    qsizetype undoSize = doc.textUndoStack()->size();
+
+    TextDocumentFollower follower(&doc);
+    testTrue( follower.follow(fileName) );
+    testTrue( follower.isFollowing() );
+    testEqual( follower.position(), 7 );
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("line 1\n") );
+
+    // the second byte of the UTF-8 character is written later
+    appendToFile(fileName, "line 2\r\nli\xc3");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("line 1\nline 2\nli") );
+
+    // the "\r\n" is split over two reads
+    appendToFile(fileName, "\xa9\r");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("line 1\nline 2\nli\u00e9") );
+    appendToFile(fileName, "\nend");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("line 1\nline 2\nli\u00e9\nend") );
+    testEqual( follower.position(), 24 );
+
+    // the appended text isn't recorded by the undo stack
+    testEqual( doc.textUndoStack()->size(), undoSize );
+
+    follower.stop();
+    testFalse( follower.isFollowing() );
+    testFalse( follower.poll() );
+}
+
+
+/// Tests following a truncated file, which restarts at the start of the file
+void TextDocumentFollowerTest::testRestart()
+{
+    QTemporaryFile file;
+    file.open();
+    QString fileName = file.fileName();
+    writeFile(fileName, "old line 1\nold line 2\n");
+
+    CharTextDocument doc;
+    doc.setText(QStringLiteral("old line 1\nold line 2\n"));
+    TextDocumentFollower follower(&doc);
+    testTrue( follower.follow(fileName) );
+
+    writeFile(fileName, "new\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("new\n") );
+    testEqual( follower.position(), 4 );
+
+    // a rotated file: the file is moved away, and the new file is already larger than the read position
+    QString rotatedFileName = fileName + QStringLiteral(".1");
+    testTrue( QFile::rename(fileName, rotatedFileName) );
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("new\n") );
+    writeFile(fileName, "rotated line 1\nrotated line 2\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("rotated line 1\nrotated line 2\n") );
+    testEqual( follower.position(), 30 );
+    QFile::remove(rotatedFileName);
+
+    // a missing file
+    TextDocumentFollower missingFollower(&doc);
+    testFalse( missingFollower.follow(fileName + QStringLiteral(".missing")) );
+    testFalse( missingFollower.isFollowing() );
+}
+
+
+/// The undo records of the document stay valid when text is appended, and are cleared when the first lines are removed
+void TextDocumentFollowerTest::testUndo()
+{
+    QTemporaryFile file;
+    file.open();
+    QString fileName = file.fileName();
+    writeFile(fileName, "line 1\nline 2\n");
+
+    CharTextDocument doc;
+    doc.setText(QStringLiteral("line 1\nline 2\n"));
+    TextDocumentFollower follower(&doc);
+    follower.setMaximumLineCount(4);
+    testTrue( follower.follow(fileName) );
+
+    doc.replace(0, 4, QStringLiteral("LINE"));
+    appendToFile(fileName, "line 3\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("LINE 1\nline 2\nline 3\n") );
+    testTrue( doc.textUndoStack()->canUndo() );
+    doc.textUndoStack()->undo();
+    testEqual( doc.text(), QStringLiteral("line 1\nline 2\nline 3\n") );
+
+    // the lines are removed when the document contains more than 4 + 1 lines
+    doc.replace(0, 4, QStringLiteral("LINE"));
+    appendToFile(fileName, "line 4\nline 5\nline 6\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("line 4\nline 5\nline 6\n") );
+    testFalse( doc.textUndoStack()->canUndo() );
+
+    // a restarted file clears the document
+    doc.replace(0, 4, QStringLiteral("LINE"));
+    writeFile(fileName, "new\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("new\n") );
+    testFalse( doc.textUndoStack()->canUndo() );
+}
+
+
+/// Tests the rolling window, which removes the first lines and keeps the scopes of the other lines
+void TextDocumentFollowerTest::testMaximumLineCount()
+{
+    QTemporaryFile file;
+    file.open();
+    QString fileName = file.fileName();
+    QByteArray data("int a;\n/* a\ncomment */ int b;\nint c;\n");
+    writeFile(fileName, data);
+
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.followertest"));
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QString::fromLatin1(data));
+    lexedScopes(&doc);
+
+    TextDocumentFollower follower(&doc);
+    follower.setMaximumLineCount(8);
+    testTrue( follower.follow(fileName) );
+
+    // the lines are removed when the document contains more than 8 + 2 lines
+    appendToFile(fileName, "int d;\n/* e\n");
+    testTrue( follower.poll() );
+    testEqual( doc.lineCount(), 7u );
+    lexedScopes(&doc);
+    appendToFile(fileName, "f */\nint g;\nint h;\nint i;\n");
+    testTrue( follower.poll() );
+    testEqual( doc.lineCount(), 8u );
+    testEqual( doc.text(), QStringLiteral("int c;\nint d;\n/* e\nf */\nint g;\nint h;\nint i;\n") );
+
+    // the scopes of the remaining lines are kept
+    testTrue( doc.scopes()->lastScopedOffset() > 0 );
+    CharTextDocument lexedDoc;
+    lexedDoc.setLanguageGrammar(grammar);
+    lexedDoc.setText(doc.text());
+    testEqual( lexedScopes(&doc), lexedScopes(&lexedDoc) );
+
+    // a comment that started in a removed line starts at the start of the document
+    appendToFile(fileName, "/* j\nk\nl\nm\n");
+    testTrue( follower.poll() );
+    lexedScopes(&doc);
+    appendToFile(fileName, "n */\nint o;\nint p;\nint q;\n");
+    testTrue( follower.poll() );
+    testEqual( doc.text(), QStringLiteral("k\nl\nm\nn */\nint o;\nint p;\nint q;\n") );
+    testEqual( doc.scopes()->scopesAtOffset(0).toString(), QStringLiteral("text.followertest comment.block") );
+
+    follower.stop();
+    delete grammar;
+}
+
+
+} // edbee
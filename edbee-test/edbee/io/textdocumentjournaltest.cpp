@@ -0,0 +1,230 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentjournaltest.h"
+
+#include <QFile>
+
+#include "edbee/io/textdocumentjournal.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/testhelpers.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const char* BaseText = "The first line\nThe second line\n";
+
+
+/// Types the given text at the given offset, a character at a time
+static void typeText(TextDocument* doc, size_t offset, const QString& text)
+{
+    for (int i = 0; i < text.length(); ++i) {
+        doc->replace(offset + static_cast<size_t>(i), 0, QString(text.at(i)));
+    }
+}
+
+
+/// Performs a few edits: typing, backspacing, replacing and deleting
+static void editDocument(TextDocument* doc)
+{
+    typeText(doc, 4, QStringLiteral("very "));
+    typeText(doc, doc->length(), QStringLiteral("A new line, café \U0001F600 "));
+    doc->replace(doc->length() - 3, 3, QString());     // backspace (the typed emoji and space)
+    doc->replace(0, 3, QStringLiteral("A"));
+    doc->replace(20, 5, QString());
+}
+
+
+/// Tests recovering the changes
+void TextDocumentJournalTest::testRecover()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+
+    TextDocumentJournal journal(&doc, fileName);
+    testFalse( journal.hasRecoveryData() );
+    testTrue( journal.start() );
+    testTrue( journal.isActive() );
+    editDocument(&doc);
+    testTrue( journal.flush() );
+    testTrue( journal.hasRecoveryData() );
+
+    // a new document, loaded from the saved file
+    CharTextDocument recoveredDoc;
+    recoveredDoc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal recoveredJournal(&recoveredDoc, fileName);
+    testTrue( recoveredJournal.hasRecoveryData() );
+    testTrue( recoveredJournal.recover() );
+    testEqual( recoveredDoc.text(), doc.text() );
+    journal.stop();
+
+    // the journal is continued after recovering
+    testTrue( recoveredJournal.start() );
+    recoveredDoc.replace(0, 0, QStringLiteral(">> "));
+    recoveredJournal.stop();
+
+    CharTextDocument secondDoc;
+    secondDoc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal secondJournal(&secondDoc, fileName);
+    testTrue( secondJournal.recover() );
+    testEqual( secondDoc.text(), recoveredDoc.text() );
+
+    secondJournal.discard();
+    testFalse( QFile::exists(fileName) );
+}
+
+
+/// A partially written record at the end of the journal (a crash while writing) is ignored
+void TextDocumentJournalTest::testPartialRecord()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal journal(&doc, fileName);
+    testTrue( journal.start() );
+    editDocument(&doc);
+    journal.stop();
+
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly | QIODevice::Append);
+    file.write(QByteArray("\x01\x05\x00\x10partial", 11));
+    file.close();
+
+    CharTextDocument recoveredDoc;
+    recoveredDoc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal recoveredJournal(&recoveredDoc, fileName);
+    testTrue( recoveredJournal.recover() );
+    testEqual( recoveredDoc.text(), doc.text() );
+    recoveredJournal.discard();
+}
+
+
+/// A journal can only be applied to the document it belongs to
+void TextDocumentJournalTest::testWrongBase()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal journal(&doc, fileName);
+    testTrue( journal.start() );
+    editDocument(&doc);
+    journal.stop();
+
+    CharTextDocument otherDoc;
+    otherDoc.setText(QStringLiteral("The first line\nThe other line\n"));
+    TextDocumentJournal otherJournal(&otherDoc, fileName);
+    testFalse( otherJournal.recover() );
+    testFalse( otherJournal.errorString().isEmpty() );
+    testEqual( otherDoc.text(), QStringLiteral("The first line\nThe other line\n") );
+    otherJournal.discard();
+}
+
+
+/// After saving, the journal restarts with the saved document as base
+void TextDocumentJournalTest::testMarkSaved()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal journal(&doc, fileName);
+    testTrue( journal.start() );
+    editDocument(&doc);
+    testTrue( journal.flush() );
+    qint64 editedSize = journal.journalSize();
+
+    QString savedText = doc.text();
+    testTrue( journal.markSaved() );
+    testTrue( journal.journalSize() < editedSize );
+    testFalse( journal.hasRecoveryData() );
+
+    doc.replace(0, 1, QStringLiteral("a"));
+    journal.stop();
+
+    CharTextDocument recoveredDoc;
+    recoveredDoc.setText(savedText);
+    TextDocumentJournal recoveredJournal(&recoveredDoc, fileName);
+    testTrue( recoveredJournal.recover() );
+    testEqual( recoveredDoc.text(), doc.text() );
+    recoveredJournal.discard();
+}
+
+
+/// A large journal is compacted to the complete text, which doesn't need the saved file
+void TextDocumentJournalTest::testCompact()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal journal(&doc, fileName);
+    journal.setCompactSize(1024);
+    testTrue( journal.start() );
+
+    // many separate edits make the journal larger than the document
+    for (int i = 0; i < 200; ++i) {
+        doc.replace(static_cast<size_t>(i % 10), 1, QStringLiteral("xy").left(1 + i % 2));
+        testTrue( journal.flush() );
+    }
+    testTrue( journal.journalSize() < 1024 + 200 );
+
+    // the edits after compaction are appended to the compacted journal
+    typeText(&doc, 0, QStringLiteral("after compaction "));
+    journal.stop();
+
+    CharTextDocument recoveredDoc;
+    recoveredDoc.setText(QStringLiteral("the content of the saved file doesn't matter"));
+    TextDocumentJournal recoveredJournal(&recoveredDoc, fileName);
+    testTrue( recoveredJournal.recover() );
+    testEqual( recoveredDoc.text(), doc.text() );
+    recoveredJournal.discard();
+}
+
+
+/// Tests if a surrogate pair is never split over two records (UTF-8 can't encode half of a pair)
+void TextDocumentJournalTest::testSurrogatePairs()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".journal"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal journal(&doc, fileName);
+    testTrue( journal.start() );
+
+    // a flush between typing the halves of a surrogate pair
+    QString emoji = QStringLiteral("\U0001F600");
+    typeText(&doc, 0, QStringLiteral("ab") + emoji.at(0));
+    testTrue( journal.flush() );
+
+    // the remaining high surrogate isn't written on its own by the next flush
+    qint64 journalSize = journal.journalSize();
+    testTrue( journal.flush() );
+    testEqual( journal.journalSize(), journalSize );
+    typeText(&doc, 3, QString(emoji.at(1)));
+    journal.stop();
+
+    CharTextDocument recoveredDoc;
+    recoveredDoc.setText(QString::fromUtf8(BaseText));
+    TextDocumentJournal recoveredJournal(&recoveredDoc, fileName);
+    testTrue( recoveredJournal.recover() );
+    testEqual( recoveredDoc.text(), doc.text() );
+    recoveredJournal.discard();
+
+    // compaction with a surrogate pair at the end of a chunk (of 1024*1024 characters)
+    testTrue( journal.start() );
+    doc.replace(0, 0, QString(1024 * 1024 - 3, QChar('x')));
+    doc.replace(doc.length(), 0, QString());     // moves the gap to the end
+    testTrue( doc.buffer()->charAt(1024 * 1024 - 1).isHighSurrogate() );
+    testTrue( journal.compact() );
+    journal.stop();
+
+    CharTextDocument compactedDoc;
+    TextDocumentJournal compactedJournal(&compactedDoc, fileName);
+    testTrue( compactedJournal.recover() );
+    testEqual( compactedDoc.length(), doc.length() );
+    testEqual( compactedDoc.buffer()->textPart(1024 * 1024 - 3, 8), doc.buffer()->textPart(1024 * 1024 - 3, 8) );
+    testTrue( compactedDoc.text() == doc.text() );
+    compactedJournal.discard();
+}
+
+
+} // edbee
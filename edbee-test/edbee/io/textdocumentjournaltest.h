@@ -0,0 +1,25 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextDocumentJournalTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testRecover();
+    void testPartialRecord();
+    void testWrongBase();
+    void testMarkSaved();
+    void testCompact();
+    void testSurrogatePairs();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextDocumentJournalTest);
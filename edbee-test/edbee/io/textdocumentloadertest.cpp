@@ -0,0 +1,109 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentloadertest.h"
+
+#include <QBuffer>
+
+#include "edbee/io/textdocumentloader.h"
+#include "edbee/io/textdocumentserializer.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/util/lineending.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Returns test data with multi-byte characters and windows line endings
+static QByteArray loaderTestData()
+{
+    QByteArray data;
+    for (int i = 0; i < 2000; ++i) {
+        data.append(QStringLiteral("Line %1: café € \U0001F600\r\n").arg(i).toUtf8());
+    }
+    return data;
+}
+
+
+/// Tests loading a device, the result should be equal to the serializer result
+void TextDocumentLoaderTest::testLoad()
+{
+    QByteArray data = loaderTestData();
+
+    CharTextDocument serialDoc;
+    TextDocumentSerializer serializer(&serialDoc);
+    QBuffer serialBuffer(&data);
+    testTrue( serializer.load(&serialBuffer) );
+
+    CharTextDocument doc;
+    TextDocumentLoader loader(&doc);
+    loader.setBatchSize(1024);
+
+    int progressCount = 0;
+    qint64 lastLoadedBytes = 0;
+    bool progressIncreasing = true;
+    connect(&loader, &TextDocumentLoader::progress, this, [&](qint64 loadedBytes, qint64 totalBytes) {
+        ++progressCount;
+        progressIncreasing = progressIncreasing && loadedBytes >= lastLoadedBytes && loadedBytes <= totalBytes;
+        lastLoadedBytes = loadedBytes;
+    });
+    int finishedCount = 0;
+    bool finishedSuccess = false;
+    connect(&loader, &TextDocumentLoader::finished, this, [&](bool success) { ++finishedCount; finishedSuccess = success; });
+
+    QBuffer buffer(&data);
+    testTrue( loader.load(&buffer) );
+    testTrue( loader.isLoading() );
+    testFalse( doc.isUndoCollectionEnabled() );
+    testTrue( doc.textLexer()->isSuspended() );
+
+    loader.waitForFinished();
+    testFalse( loader.isLoading() );
+    testEqual( finishedCount, 1 );
+    testTrue( finishedSuccess );
+    testTrue( progressCount > 1 );
+    testTrue( progressIncreasing );
+    testEqual( loader.loadedBytes(), static_cast<qint64>(data.size()) );
+    testEqual( loader.totalBytes(), static_cast<qint64>(data.size()) );
+
+    testEqual( doc.text(), serialDoc.text() );
+    testEqual( doc.lineCount(), serialDoc.lineCount() );
+    testTrue( doc.lineEnding() == LineEnding::windowsType() );
+    testTrue( doc.encoding() == serialDoc.encoding() );
+
+    // the undo collection and the lexer are restored
+    testTrue( doc.isUndoCollectionEnabled() );
+    testFalse( doc.textLexer()->isSuspended() );
+    testFalse( buffer.isOpen() );
+}
+
+
+/// Tests canceling the loader
+void TextDocumentLoaderTest::testCancel()
+{
+    QByteArray data = loaderTestData();
+    CharTextDocument doc;
+    TextDocumentLoader loader(&doc);
+
+    bool finishedSuccess = true;
+    connect(&loader, &TextDocumentLoader::finished, this, [&](bool success) { finishedSuccess = success; });
+
+    QBuffer buffer(&data);
+    testTrue( loader.load(&buffer) );
+    loader.cancel();
+    testFalse( loader.isLoading() );
+    testFalse( finishedSuccess );
+    testFalse( loader.errorString().isEmpty() );
+    testTrue( doc.isUndoCollectionEnabled() );
+    testFalse( doc.textLexer()->isSuspended() );
+
+    // the loader can be reused
+    testTrue( loader.load(&buffer) );
+    loader.waitForFinished();
+    testTrue( finishedSuccess );
+}
+
+
+} // edbee
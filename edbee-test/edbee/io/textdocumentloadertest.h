@@ -0,0 +1,23 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextDocumentLoaderTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testLoad();
+    void testCancel();
+
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextDocumentLoaderTest);
@@ -0,0 +1,135 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentsavertest.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include "edbee/io/textdocumentsaver.h"
+#include "edbee/io/textdocumentserializer.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/util/lineending.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Returns the test text, with multi-byte characters
+static QString saverTestText()
+{
+    QString text;
+    for (int i = 0; i < 2000; ++i) {
+        text.append(QStringLiteral("Line %1: café € \U0001F600\n").arg(i));
+    }
+    return text;
+}
+
+
+/// Tests saving a document, the result should be equal to the serializer result.
+/// Changes of the document during the save aren't saved
+void TextDocumentSaverTest::testSave()
+{
+    CharTextDocument doc;
+    doc.setLineEnding(LineEnding::windowsType());
+    doc.buffer()->setText(saverTestText());
+
+    QByteArray serialData;
+    TextDocumentSerializer serializer(&doc);
+    QBuffer serialBuffer(&serialData);
+    testTrue( serializer.save(&serialBuffer) );
+
+    TextDocumentSaver saver(&doc);
+    int finishedCount = 0;
+    bool finishedSuccess = false;
+    connect(&saver, &TextDocumentSaver::finished, this, [&](bool success) { ++finishedCount; finishedSuccess = success; });
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    quint64 version = doc.buffer()->version();
+    testTrue( saver.save(&buffer) );
+    testTrue( saver.isSaving() );
+    testFalse( saver.save(&buffer) );
+    testEqual( saver.savedVersion(), version );
+
+    doc.buffer()->appendText(QStringLiteral("changed"));
+    saver.waitForFinished();
+
+    testFalse( saver.isSaving() );
+    testEqual( finishedCount, 1 );
+    testTrue( finishedSuccess );
+    testTrue( saver.errorString().isEmpty() );
+    testEqual( data, serialData );
+    testFalse( buffer.isOpen() );
+}
+
+
+/// Tests canceling the saver
+void TextDocumentSaverTest::testCancel()
+{
+    CharTextDocument doc;
+    doc.buffer()->setText(saverTestText());
+    TextDocumentSaver saver(&doc);
+
+    bool finishedSuccess = true;
+    connect(&saver, &TextDocumentSaver::finished, this, [&](bool success) { finishedSuccess = success; });
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    testTrue( saver.save(&buffer) );
+    saver.cancel();
+    testFalse( saver.isSaving() );
+    testFalse( finishedSuccess );
+    testFalse( saver.errorString().isEmpty() );
+
+    // the saver can be reused
+    testTrue( saver.save(&buffer) );
+    saver.waitForFinished();
+    testTrue( finishedSuccess );
+    testEqual( data, saverTestText().toUtf8() );
+
+    // the (queued) finish notification of an earlier save doesn't finish the next save
+    testTrue( saver.save(&buffer) );
+    QMetaObject::invokeMethod(&saver, "threadFinished", Qt::DirectConnection, Q_ARG(quint64, 1));
+    testTrue( saver.isSaving() );
+    saver.waitForFinished();
+    testTrue( finishedSuccess );
+}
+
+
+/// Returns the content of the given file
+static QByteArray readFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) { return QByteArray(); }
+    return file.readAll();
+}
+
+
+/// Tests saving a file by name, a canceled save should leave the file untouched
+void TextDocumentSaverTest::testSaveFile()
+{
+    CharTextDocument doc;
+    doc.buffer()->setText(saverTestText());
+    TextDocumentSaver saver(&doc);
+
+    QTemporaryFile file;
+    file.open();
+    file.write("original");
+    file.close();
+
+    testTrue( saver.save(file.fileName()) );
+    saver.cancel();
+    testFalse( saver.errorString().isEmpty() );
+    testEqual( readFile(file.fileName()), QByteArray("original") );
+
+    testTrue( saver.save(file.fileName()) );
+    saver.waitForFinished();
+    testTrue( saver.errorString().isEmpty() );
+    testEqual( readFile(file.fileName()), saverTestText().toUtf8() );
+}
+
+
+} // edbee
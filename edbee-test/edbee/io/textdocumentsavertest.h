@@ -0,0 +1,22 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextDocumentSaverTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testSave();
+    void testCancel();
+    void testSaveFile();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextDocumentSaverTest);
@@ -0,0 +1,195 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textdocumentsessionsnapshottest.h"
+
+#include <QFile>
+
+#include "edbee/io/textdocumentsessionsnapshot.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/testhelpers.h"
+#include "edbee/util/lineending.h"
+#include "edbee/util/textcodec.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const char* SourceText = "The first line\nThe second line, café \xF0\x9F\x98\x80\n\nThe last line";
+
+
+/// Tests restoring the text, line offsets, encoding and line ending
+void TextDocumentSessionSnapshotTest::testRestore()
+{
+    QString sourceFileName = temporaryFileName(QStringLiteral(".txt"));
+    QString fileName = temporaryFileName(QStringLiteral(".snapshot"));
+    writeFile(sourceFileName, QByteArray(SourceText));
+
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(SourceText));
+    doc.setLineEnding(LineEnding::windowsType());
+    doc.setPersisted(true);
+    doc.replace(0, 3, QStringLiteral("An unsaved"));
+
+    TextDocumentSessionSnapshot snapshot(&doc);
+    testTrue( snapshot.save(fileName, sourceFileName) );
+    testTrue( snapshot.isUpToDate(fileName, sourceFileName) );
+    testFalse( QFile::exists(fileName + QStringLiteral(".tmp")) );
+
+    CharTextDocument restoredDoc;
+    TextDocumentSessionSnapshot restoredSnapshot(&restoredDoc);
+    testTrue( restoredSnapshot.restore(fileName, sourceFileName) );
+    testEqual( restoredDoc.text(), doc.text() );
+    testEqual( restoredDoc.lineCount(), doc.lineCount() );
+    for (size_t line = 0; line < doc.lineCount(); ++line) {
+        testEqual( restoredDoc.offsetFromLine(line), doc.offsetFromLine(line) );
+    }
+    testEqual( restoredDoc.lineFromOffset(restoredDoc.length()), doc.lineCount() - 1 );
+    testEqual( restoredDoc.encoding()->name(), doc.encoding()->name() );
+    testEqual( restoredDoc.lineEnding()->type(), LineEnding::windowsType()->type() );
+    testFalse( restoredDoc.isPersisted() );
+
+    // a document can only be restored once
+    testFalse( restoredSnapshot.restore(fileName, sourceFileName) );
+
+    QFile::remove(fileName);
+    QFile::remove(sourceFileName);
+}
+
+
+/// A snapshot isn't restored when the source file has been changed
+void TextDocumentSessionSnapshotTest::testSourceChanged()
+{
+    QString sourceFileName = temporaryFileName(QStringLiteral(".txt"));
+    QString fileName = temporaryFileName(QStringLiteral(".snapshot"));
+    writeFile(sourceFileName, QByteArray(SourceText));
+
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(SourceText));
+    TextDocumentSessionSnapshot snapshot(&doc);
+    testTrue( snapshot.save(fileName, sourceFileName) );
+
+    writeFile(sourceFileName, QByteArray(SourceText).append("!"));
+    CharTextDocument restoredDoc;
+    TextDocumentSessionSnapshot restoredSnapshot(&restoredDoc);
+    testFalse( restoredSnapshot.isUpToDate(fileName, sourceFileName) );
+    testFalse( restoredSnapshot.restore(fileName, sourceFileName) );
+    testFalse( restoredSnapshot.errorString().isEmpty() );
+    testEqual( restoredDoc.length(), 0 );
+
+    // the snapshot of a new document doesn't have a source file
+    testTrue( snapshot.save(fileName) );
+    testFalse( restoredSnapshot.restore(fileName, sourceFileName) );
+    testTrue( restoredSnapshot.restore(fileName) );
+    testEqual( restoredDoc.text(), doc.text() );
+
+    QFile::remove(fileName);
+    QFile::remove(sourceFileName);
+}
+
+
+/// A damaged snapshot file isn't restored
+void TextDocumentSessionSnapshotTest::testCorrupt()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".snapshot"));
+    CharTextDocument doc;
+    doc.setText(QString::fromUtf8(SourceText));
+    TextDocumentSessionSnapshot snapshot(&doc);
+    testTrue( snapshot.save(fileName) );
+
+    QFile file(fileName);
+    file.open(QIODevice::ReadOnly);
+    QByteArray data = file.readAll();
+    file.close();
+
+    // a changed character
+    QByteArray changed = data;
+    changed[100] = static_cast<char>(changed[100] ^ 0x20);
+    writeFile(fileName, changed);
+    CharTextDocument restoredDoc;
+    TextDocumentSessionSnapshot restoredSnapshot(&restoredDoc);
+    testFalse( restoredSnapshot.restore(fileName) );
+
+    // an incomplete file
+    writeFile(fileName, data.left(data.size() - 8));
+    testFalse( restoredSnapshot.restore(fileName) );
+    testEqual( restoredDoc.length(), 0 );
+
+    // a file with only a header
+    writeFile(fileName, data.left(88));
+    testFalse( restoredSnapshot.restore(fileName) );
+    testEqual( restoredDoc.length(), 0 );
+
+    QFile::remove(fileName);
+}
+
+
+/// The text is written per span around the gap of the buffer, the checksum should be the same for every gap position
+void TextDocumentSessionSnapshotTest::testGapPositions()
+{
+    QString fileName = temporaryFileName(QStringLiteral(".snapshot"));
+    QString text = QStringLiteral("ab\ncde");
+    for (int gap = 0; gap <= text.length(); ++gap) {
+        // inserting the start of the text leaves the gap after it
+        CharTextDocument doc;
+        doc.setText(text.mid(gap));
+        doc.replace(0, 0, text.left(gap));
+        testEqual( doc.text(), text );
+
+        TextDocumentSessionSnapshot snapshot(&doc);
+        testTrue( snapshot.save(fileName) );
+
+        CharTextDocument restoredDoc;
+        TextDocumentSessionSnapshot restoredSnapshot(&restoredDoc);
+        testTrue( restoredSnapshot.restore(fileName) );
+        testEqual( restoredDoc.text(), text );
+    }
+    QFile::remove(fileName);
+}
+
+
+/// Tests restoring the scopes, without lexing the document
+void TextDocumentSessionSnapshotTest::testScopes()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.snapshottest"));
+
+    QString fileName = temporaryFileName(QStringLiteral(".snapshot"));
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QStringLiteral("int a;\n/* a comment\n int */ int b;\n/* an open\ncomment int"));
+    doc.textLexer()->lexRange(0, doc.length());
+
+    TextDocumentSessionSnapshot snapshot(&doc);
+    testTrue( snapshot.save(fileName) );
+
+    CharTextDocument restoredDoc;
+    restoredDoc.setLanguageGrammar(grammar);
+    TextDocumentSessionSnapshot restoredSnapshot(&restoredDoc);
+    testTrue( restoredSnapshot.restore(fileName) );
+    testTrue( restoredSnapshot.scopesRestored() );
+    testEqual( restoredDoc.scopes()->lastScopedOffset(), doc.scopes()->lastScopedOffset() );
+    testEqual( restoredDoc.scopes()->scopesAsStringList().join("\n"), doc.scopes()->scopesAsStringList().join("\n") );
+
+    // the restored scopes can be continued by the lexer
+    doc.replace(doc.length(), 0, QStringLiteral(" */ int c;"));
+    doc.textLexer()->lexRange(0, doc.length());
+    restoredDoc.replace(restoredDoc.length(), 0, QStringLiteral(" */ int c;"));
+    restoredDoc.textLexer()->lexRange(0, restoredDoc.length());
+    testEqual( restoredDoc.scopes()->scopesAsStringList().join("\n"), doc.scopes()->scopesAsStringList().join("\n") );
+
+    // without scopes the document needs to be lexed
+    CharTextDocument plainDoc;
+    TextDocumentSessionSnapshot plainSnapshot(&plainDoc);
+    plainSnapshot.setScopesIncluded(false);
+    testTrue( plainSnapshot.restore(fileName) );
+    testFalse( plainSnapshot.scopesRestored() );
+
+    QFile::remove(fileName);
+    delete grammar;
+}
+
+
+} // edbee
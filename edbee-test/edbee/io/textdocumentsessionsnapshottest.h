@@ -0,0 +1,24 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextDocumentSessionSnapshotTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testRestore();
+    void testSourceChanged();
+    void testCorrupt();
+    void testGapPositions();
+    void testScopes();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextDocumentSessionSnapshotTest);
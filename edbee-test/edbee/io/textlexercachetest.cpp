@@ -0,0 +1,149 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textlexercachetest.h"
+
+#include <QDir>
+
+#include "edbee/io/textlexercache.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/testhelpers.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+static const char* SourceText = "int a;\n/* a comment\n int */ int b;\n\nint c; /* an open\ncomment int\n*/ int d;";
+
+
+/// Tests restoring the scopes of an unchanged document
+void TextLexerCacheTest::testUnchanged()
+{
+    QString path = temporaryFileName(QStringLiteral(".lexcache"));
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexercachetest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QString::fromLatin1(SourceText));
+    QString scopes = lexedScopes(&doc);
+
+    TextLexerCache cache(path);
+    testTrue( cache.save(&doc, QStringLiteral("file.txt")) );
+
+    CharTextDocument restoredDoc;
+    restoredDoc.setLanguageGrammar(grammar);
+    restoredDoc.setText(QString::fromLatin1(SourceText));
+    testTrue( cache.restore(&restoredDoc, QStringLiteral("file.txt")) );
+    testEqual( cache.restoredOffset(), restoredDoc.length() );
+    testEqual( restoredDoc.scopes()->lastScopedOffset(), restoredDoc.length() );
+    testEqual( restoredDoc.scopes()->scopesAsStringList().join("\n"), scopes );
+
+    // another key has no entry
+    CharTextDocument otherDoc;
+    otherDoc.setLanguageGrammar(grammar);
+    otherDoc.setText(QString::fromLatin1(SourceText));
+    testFalse( cache.restore(&otherDoc, QStringLiteral("other.txt")) );
+    testEqual( otherDoc.scopes()->lastScopedOffset(), 0u );
+
+    testTrue( cache.remove(&doc, QStringLiteral("file.txt")) );
+    testFalse( cache.restore(&otherDoc, QStringLiteral("file.txt")) );
+
+    QDir(path).removeRecursively();
+    delete grammar;
+}
+
+
+/// Tests restoring the scopes of a changed document, which should only be lexed from the changed line
+void TextLexerCacheTest::testChanged()
+{
+    QString path = temporaryFileName(QStringLiteral(".lexcache"));
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexercachetest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QString::fromLatin1(SourceText));
+    lexedScopes(&doc);
+
+    TextLexerCache cache(path);
+    testTrue( cache.save(&doc, QStringLiteral("file.txt")) );
+
+    // the comment on line 4 is closed, which changes the scopes of the next lines
+    QString changedText = QString::fromLatin1(SourceText).replace(QStringLiteral("an open"), QStringLiteral("closed */ int"));
+    CharTextDocument changedDoc;
+    changedDoc.setLanguageGrammar(grammar);
+    changedDoc.setText(changedText);
+    QString scopes = lexedScopes(&changedDoc);
+
+    CharTextDocument restoredDoc;
+    restoredDoc.setLanguageGrammar(grammar);
+    restoredDoc.setText(changedText);
+    testTrue( cache.restore(&restoredDoc, QStringLiteral("file.txt")) );
+    testEqual( cache.restoredOffset(), restoredDoc.offsetFromLine(4) );
+    testEqual( restoredDoc.scopes()->lastScopedOffset(), restoredDoc.offsetFromLine(4) );
+    testEqual( lexedScopes(&restoredDoc), scopes );
+
+    // a shorter document
+    QString shortText = QString::fromLatin1(SourceText).left(30);
+    CharTextDocument shortDoc;
+    shortDoc.setLanguageGrammar(grammar);
+    shortDoc.setText(shortText);
+    scopes = lexedScopes(&shortDoc);
+
+    CharTextDocument restoredShortDoc;
+    restoredShortDoc.setLanguageGrammar(grammar);
+    restoredShortDoc.setText(shortText);
+    testTrue( cache.restore(&restoredShortDoc, QStringLiteral("file.txt")) );
+    testEqual( cache.restoredOffset(), restoredShortDoc.offsetFromLine(2) );
+    testEqual( lexedScopes(&restoredShortDoc), scopes );
+
+    // nothing is restored when the first line is changed
+    CharTextDocument firstLineDoc;
+    firstLineDoc.setLanguageGrammar(grammar);
+    firstLineDoc.setText(QStringLiteral("/*") + QString::fromLatin1(SourceText));
+    testFalse( cache.restore(&firstLineDoc, QStringLiteral("file.txt")) );
+    testEqual( firstLineDoc.scopes()->lastScopedOffset(), 0u );
+
+    QDir(path).removeRecursively();
+    delete grammar;
+}
+
+
+/// Tests the cache isn't used when the grammar has been changed
+void TextLexerCacheTest::testGrammarChanged()
+{
+    QString path = temporaryFileName(QStringLiteral(".lexcache"));
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexercachetest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QString::fromLatin1(SourceText));
+    lexedScopes(&doc);
+
+    TextLexerCache cache(path);
+    testTrue( cache.save(&doc, QStringLiteral("file.txt")) );
+
+    // another version of the grammar with the same name
+    TextGrammar* changedGrammar = createCommentGrammar(QStringLiteral("text.lexercachetest"), QStringLiteral("char"));
+    CharTextDocument restoredDoc;
+    restoredDoc.setLanguageGrammar(changedGrammar);
+    restoredDoc.setText(QString::fromLatin1(SourceText));
+    testFalse( cache.restore(&restoredDoc, QStringLiteral("file.txt")) );
+    testEqual( restoredDoc.scopes()->lastScopedOffset(), 0u );
+    testTrue( restoredDoc.languageGrammar() == changedGrammar );
+
+    // the entry belongs to the grammar of the document
+    CharTextDocument plainDoc;
+    plainDoc.setText(QString::fromLatin1(SourceText));
+    testFalse( cache.restore(&plainDoc, QStringLiteral("file.txt")) );
+    testEqual( plainDoc.scopes()->lastScopedOffset(), 0u );
+
+    QDir(path).removeRecursively();
+    delete changedGrammar;
+    delete grammar;
+}
+
+
+} // edbee
@@ -0,0 +1,22 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextLexerCacheTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testUnchanged();
+    void testChanged();
+    void testGrammarChanged();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextLexerCacheTest);
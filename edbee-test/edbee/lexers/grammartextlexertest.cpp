@@ -11,6 +11,7 @@
 #include "edbee/models/textgrammar.h"
 #include "edbee/models/textlexer.h"
 #include "edbee/edbee.h"
+#include "edbee/testhelpers.h"
 
 #include "edbee/debug.h"
 
@@ -82,6 +83,204 @@ void GrammarTextLexerTest::testHamlLexer()
 }
 
 
+/// Creates a grammar with nested blocks, a multi-line comment and a heredoc (the end expression uses a capture)
+static TextGrammar* createRelexGrammar()
+{
+    TextGrammar* grammar = new TextGrammar(QStringLiteral("text.relextest"), QStringLiteral("Relex test"));
+    TextGrammarRule* mainRule = TextGrammarRule::createMainRule(grammar, QStringLiteral("text.relextest"));
+    mainRule->giveRule(TextGrammarRule::createMultiLineRegExp(grammar, QStringLiteral("comment.block"), QString(), QStringLiteral("/\\*"), QStringLiteral("\\*/")));
+    mainRule->giveRule(TextGrammarRule::createMultiLineRegExp(grammar, QStringLiteral("string.heredoc"), QString(), QStringLiteral("<<(\\w+)"), QStringLiteral("^\\1\\b")));
+    TextGrammarRule* blockRule = TextGrammarRule::createMultiLineRegExp(grammar, QStringLiteral("meta.block"), QString(), QStringLiteral("\\{"), QStringLiteral("\\}"));
+    blockRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("$self")));
+    mainRule->giveRule(blockRule);
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("keyword"), QStringLiteral("\\bint\\b")));
+    grammar->giveMainRule(mainRule);
+    return grammar;
+}
+
+
+/// Returns a text with the given number of lines
+static QString relexText(int lineCount)
+{
+    static const char* lines[] = { "int a; /* a comment", "int */ int b {", "  int c; <<EOT", "int d", "EOT", "  } int e;", "{ int f }" };
+    QStringList text;
+    for (int i = 0; i < lineCount; ++i) {
+        text.append(QString::fromLatin1(lines[i % 7]));
+    }
+    return text.join("\n");
+}
+
+
+/// Tests a change that doesn't change the state at the end of the line, only requires lexing the changed line
+void GrammarTextLexerTest::testRelexConverges()
+{
+    TextGrammar* grammar = createRelexGrammar();
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(relexText(700));
+    doc.textLexer()->lexRange(0, doc.length());
+
+    // a change in a comment
+    doc.replace(doc.offsetFromLine(7) + 10, 1, QStringLiteral("int"));
+    testEqual( doc.scopes()->lastScopedOffset(), doc.offsetFromLine(7) );
+    doc.textLexer()->lexRange(0, doc.offsetFromLine(8));
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    // inserting lines in a heredoc
+    doc.replace(doc.offsetFromLine(17), 0, QStringLiteral("int x\n/* {\n"));
+    doc.textLexer()->lexRange(0, doc.offsetFromLine(20));
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    // removing lines, including the end of a block and the start of the next block
+    doc.replace(doc.offsetFromLine(33), doc.offsetFromLine(41) - doc.offsetFromLine(33), QString());
+    doc.textLexer()->lexRange(0, doc.offsetFromLine(34));
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    delete grammar;
+}
+
+
+/// Tests a change that changes the state of all following lines
+void GrammarTextLexerTest::testRelexChangedState()
+{
+    TextGrammar* grammar = createRelexGrammar();
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(relexText(700));
+    doc.textLexer()->lexRange(0, doc.length());
+
+    // a heredoc that's never closed
+    doc.replace(0, 0, QStringLiteral("<<END\n"));
+    doc.textLexer()->lexRange(0, doc.offsetFromLine(20));
+    testTrue( doc.scopes()->lastScopedOffset() < doc.length() );
+    doc.textLexer()->lexRange(0, doc.length());
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    // removing the heredoc again, the original state is lexed again
+    doc.replace(0, 6, QString());
+    doc.textLexer()->lexRange(0, doc.length());
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    delete grammar;
+}
+
+
+/// Tests random changes, with and without lexing in between, always give the same result as lexing the new text
+void GrammarTextLexerTest::testRelexRandomChanges()
+{
+    static const char* texts[] = { "", "int", "/*", "*/", "{", "}", "\n", "\n}\n", "<<EOT\n", "\nEOT\n", "x\ny" };
+    TextGrammar* grammar = createRelexGrammar();
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(relexText(200));
+
+    quint32 seed = 1234;
+    auto random = [&seed](size_t max) -> size_t {
+        seed = seed * 1103515245u + 12345u;
+        return max ? (seed >> 8) % max : 0;
+    };
+
+    for (int i = 0; i < 300; ++i) {
+        size_t offset = random(doc.length());
+        size_t length = qMin(random(i % 10 == 0 ? 200 : 6), doc.length() - offset);
+        doc.replace(offset, length, QString::fromLatin1(texts[random(11)]));
+
+        size_t lexOffset = random(4) == 0 ? doc.length() : random(doc.length());
+        doc.textLexer()->lexRange(0, lexOffset);
+
+        if (i % 10 == 0) {
+            doc.textLexer()->lexRange(0, doc.length());
+            testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+            testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+        }
+    }
+
+    delete grammar;
+}
+
+
+/// Tests the reuse of the match positions of the rules in a line
+void GrammarTextLexerTest::testMatchPositionCache()
+{
+    TextGrammar* grammar = new TextGrammar(QStringLiteral("text.cachetest"), QStringLiteral("Cache test"));
+    TextGrammarRule* mainRule = TextGrammarRule::createMainRule(grammar, QStringLiteral("text.cachetest"));
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("string"), QStringLiteral("\"[^\"]*\"")));
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("keyword"), QStringLiteral("\\bint\\b")));
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("prefix"), QStringLiteral("@")));
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("name"), QStringLiteral("\\G\\w+")));
+    grammar->giveMainRule(mainRule);
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+
+    // the keyword in the string is found first, it's searched again after the string
+    doc.setText(QStringLiteral("int a = \"int\"; int b"));
+    doc.textLexer()->lexRange(0, doc.length());
+    testEqual( doc.scopes()->scopesAsStringList().join("|"), QStringLiteral("**|[-]| 0>20:text.cachetest| 0>3:keyword| 8>13:string| 15>18:keyword") );
+
+    // \G only matches at the search offset, so the expression is searched again at every offset
+    doc.setText(QStringLiteral("- @name @ int"));
+    doc.textLexer()->lexRange(0, doc.length());
+    testEqual( doc.scopes()->scopesAsStringList().join("|"), QStringLiteral("**|[-]| 0>13:text.cachetest| 2>3:prefix| 3>7:name| 8>9:prefix| 10>13:keyword") );
+
+    delete grammar;
+}
+
+
+/// Tests the compiled rule contexts, with the includes resolved
+void GrammarTextLexerTest::testRuleContext()
+{
+    TextGrammar* grammar = new TextGrammar(QStringLiteral("text.contexttest"), QStringLiteral("Context test"));
+    TextGrammarRule* mainRule = TextGrammarRule::createMainRule(grammar, QStringLiteral("text.contexttest"));
+    TextGrammarRule* numberRule = TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("number"), QStringLiteral("\\d+"));
+    TextGrammarRule* wordRule = TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("word"), QStringLiteral("\\w+"));
+    TextGrammarRule* blockRule = TextGrammarRule::createMultiLineRegExp(grammar, QStringLiteral("block"), QString(), QStringLiteral("\\("), QStringLiteral("\\)"));
+    TextGrammarRule* valuesRule = TextGrammarRule::createRuleList(grammar);
+    valuesRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#number")));
+    valuesRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#word")));
+    grammar->giveToRepos(QStringLiteral("number"), numberRule);
+    grammar->giveToRepos(QStringLiteral("word"), wordRule);
+    grammar->giveToRepos(QStringLiteral("values"), valuesRule);
+    grammar->giveToRepos(QStringLiteral("alias"), TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#values")));
+    grammar->giveToRepos(QStringLiteral("loop"), TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#loop")));
+
+    blockRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#alias")));
+    blockRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("$self")));
+    mainRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#number")));
+    mainRule->giveRule(blockRule);
+    mainRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#loop")));
+    mainRule->giveRule(TextGrammarRule::createIncludeRule(grammar, QStringLiteral("#unknown")));
+    grammar->giveMainRule(mainRule);
+
+    // the main rule: the unknown and the recursive include are skipped
+    TextGrammarRuleContext* context = grammar->ruleContext(mainRule);
+    testEqual( context->ruleCount(), 2 );
+    testTrue( context->rule(0) == numberRule );
+    testTrue( context->rule(1) == blockRule );
+    testTrue( context->regExp(1) == blockRule->matchRegExp() );
+    testTrue( grammar->ruleContext(mainRule) == context );
+
+    // the block: the included rules in depth first order, without the rules that are already added
+    context = grammar->ruleContext(blockRule);
+    testEqual( context->ruleCount(), 3 );
+    testTrue( context->rule(0) == numberRule );
+    testTrue( context->rule(1) == wordRule );
+    testTrue( context->rule(2) == blockRule );
+
+    // lexing with the contexts
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(QStringLiteral("1 a (2 b (c))"));
+    doc.textLexer()->lexRange(0, doc.length());
+    testEqual( doc.scopes()->scopesAsStringList().join("|"), QStringLiteral("**|[-]| 0>13:text.contexttest| 0>1:number| 4>13:block| 5>6:number| 7>8:word| 9>12:block| 10>11:word") );
+
+    delete grammar;
+}
+
+
 /// creates the main fixture document
 void GrammarTextLexerTest::createFixtureDocument( const QString& data )
 {
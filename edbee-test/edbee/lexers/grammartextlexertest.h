@@ -25,6 +25,11 @@ private slots:
     void clean();
 
     void testHamlLexer();
+    void testRelexConverges();
+    void testRelexChangedState();
+    void testRelexRandomChanges();
+    void testMatchPositionCache();
+    void testRuleContext();
 
 private:
 
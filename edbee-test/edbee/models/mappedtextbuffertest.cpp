@@ -0,0 +1,127 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "mappedtextbuffertest.h"
+
+#include <limits>
+#include <QTemporaryFile>
+
+#include "edbee/models/chardocument/chartextbuffer.h"
+#include "edbee/models/chardocument/mappedtextbuffer.h"
+#include "edbee/util/lineending.h"
+#include "edbee/util/textcodec.h"
+#include "edbee/edbee.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Writes the given data to the temporary file
+static void writeFile(QTemporaryFile& file, const QByteArray& data)
+{
+    file.open();
+    file.write(data);
+    file.close();
+}
+
+
+/// Tests reading an UTF-8 file with multibyte characters and windows line endings, with tiny pages
+void MappedTextBufferTest::testUtf8File()
+{
+    QString line = QString::fromUtf8("r\xC3\xA9sum\xC3\xA9 \xE2\x82\xAC 12\r\n");
+    QString content = line.repeated(50);
+
+    QTemporaryFile file;
+    writeFile(file, content.toUtf8());
+
+    MappedTextBuffer buf;
+    buf.setPageSize(16);
+    testTrue(buf.open(file.fileName(), Edbee::instance()->codecManager()->codecForName("UTF-8")));
+    buf.waitForScan();
+    testTrue(!buf.isScanning());
+    testTrue(buf.pageCount() > 10);
+    testEqual(buf.scannedBytes(), buf.fileSize());
+    testTrue(buf.lineEnding() == LineEnding::windowsType());
+
+    CharTextBuffer expected;
+    expected.setText(content.replace("\r\n", "\n"));
+    testEqual(buf.length(), expected.length());
+    testEqual(buf.text(), expected.text());
+    testEqual(buf.lineCount(), 51);
+    testEqual(buf.lineOffsetsAsString(), expected.lineOffsetsAsString());
+    testEqual(buf.line(3), expected.line(3));
+    testEqual(buf.charAt(10), expected.charAt(10));
+    testEqual(buf.textPart(5, 40), expected.textPart(5, 40));
+}
+
+
+/// Tests reading a latin1 file
+void MappedTextBufferTest::testLatin1File()
+{
+    QTemporaryFile file;
+    writeFile(file, QByteArray("caf\xE9\nna\xEFve\n"));
+
+    MappedTextBuffer buf;
+    testTrue(buf.open(file.fileName(), Edbee::instance()->codecManager()->codecForName("ISO-8859-1")));
+    buf.waitForScan();
+    testEqual(buf.text(), QString::fromUtf8("caf\xC3\xA9\nna\xC3\xAFve\n"));
+    testEqual(buf.lineOffsetsAsString(), "0,5,11");
+}
+
+
+/// An empty file results in an empty buffer
+void MappedTextBufferTest::testEmptyFile()
+{
+    QTemporaryFile file;
+    writeFile(file, QByteArray());
+
+    MappedTextBuffer buf;
+    testTrue(buf.open(file.fileName()));
+    buf.waitForScan();
+    testEqual(buf.length(), 0);
+    testEqual(buf.lineCount(), 1);
+    testTrue(!buf.isScanning());
+}
+
+
+/// Tests if the page cache is limited by its size
+void MappedTextBufferTest::testPageCache()
+{
+    QTemporaryFile file;
+    writeFile(file, QByteArray("abcdefghijklmno\n").repeated(100));
+
+    MappedTextBuffer buf;
+    buf.setPageSize(16);
+    buf.setPageCacheSize(4 * 16 * sizeof(QChar));
+    testTrue(buf.open(file.fileName(), Edbee::instance()->codecManager()->codecForName("UTF-8")));
+    buf.waitForScan();
+    testEqual(buf.pageCount(), 100);
+
+    testEqual(buf.text(), QString("abcdefghijklmno\n").repeated(100));
+    testTrue(buf.cachedPageCount() <= 4);
+    testEqual(buf.charAt(16 * 50 + 2), QChar('c'));
+    testEqual(buf.charAt(16 * 2 + 15), QChar('\n'));
+
+    // a size that doesn't fit in the cost of the cache is limited
+    buf.setPageCacheSize(static_cast<size_t>(3) * 1024 * 1024 * 1024);
+    testEqual(buf.pageCacheSize(), static_cast<size_t>(std::numeric_limits<int>::max()));
+}
+
+
+/// Tests if changes are ignored
+void MappedTextBufferTest::testReadOnly()
+{
+    QTemporaryFile file;
+    writeFile(file, QByteArray("abc\ndef"));
+
+    MappedTextBuffer buf;
+    TextBuffer* textBuf = &buf;
+    testTrue(buf.open(file.fileName(), Edbee::instance()->codecManager()->codecForName("UTF-8")));
+    buf.waitForScan();
+    textBuf->replaceText(0, 2, "xyz");
+    testEqual(textBuf->text(), "abc\ndef");
+    testEqual(textBuf->lineCount(), 2);
+}
+
+
+} // edbee
@@ -0,0 +1,27 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the memory mapped textbuffer
+class MappedTextBufferTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testUtf8File();
+    void testLatin1File();
+    void testEmptyFile();
+    void testPageCache();
+    void testReadOnly();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::MappedTextBufferTest);
@@ -0,0 +1,148 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "ropetextbuffertest.h"
+
+#include "edbee/models/chardocument/chartextbuffer.h"
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/chardocument/ropetextbuffer.h"
+#include "edbee/models/textundostack.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// A small deterministic random generator, so test failures can be reproduced
+static quint32 nextRandom(quint32& seed)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) & 0xffffff;
+}
+
+
+/// Builds a random text with the given length
+static QString randomText(quint32& seed, int length)
+{
+    QString result;
+    for (int i = 0; i < length; ++i) {
+        quint32 r = nextRandom(seed) % 30;
+        result.append(r < 4 ? QChar('\n') : QChar('a' + static_cast<int>(r % 26)));
+    }
+    return result;
+}
+
+
+/// Performs the given number of random edits on the given buffer
+static void randomEdits(TextBuffer* buf, quint32 seed, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        size_t offset = nextRandom(seed) % (buf->length() + 1);
+        size_t length = qMin(static_cast<size_t>(nextRandom(seed) % 8), buf->length() - offset);
+        buf->replaceText(offset, length, randomText(seed, static_cast<int>(nextRandom(seed) % 8)));
+    }
+}
+
+
+/// Tests the basic replace operations and line offsets
+void RopeTextBufferTest::testReplaceText()
+{
+    RopeTextBuffer ropeBuf;
+    TextBuffer* buf = &ropeBuf;
+    buf->appendText("a1\nb2\nc3\n\nd5");
+    testEqual(buf->text(), "a1\nb2\nc3\n\nd5");
+    testEqual(buf->lineOffsetsAsString(), "0,3,6,9,10");
+    testEqual(buf->lineCount(), 5);
+
+    buf->replaceText(1, 4, "X");
+    testEqual(buf->text(), "aX\nc3\n\nd5");
+    testEqual(buf->lineOffsetsAsString(), "0,3,6,7");
+
+    // replacing outside the buffer should append the text
+    buf->replaceText(100, 10, "!");
+    testEqual(buf->text(), "aX\nc3\n\nd5!");
+    testEqual(buf->line(3), "d5!");
+    testEqual(buf->lineFromOffset(100), 3);
+    testEqual(buf->offsetFromLine(10), buf->length());
+}
+
+
+/// Tests the raw append methods and the raw data pointer
+void RopeTextBufferTest::testRawAppend()
+{
+    RopeTextBuffer ropeBuf;
+    TextBuffer* buf = &ropeBuf;
+    buf->appendText("abc\n");
+
+    buf->rawAppendBegin();
+    buf->rawAppend(QChar('d'));
+    QString data("ef\ngh");
+    buf->rawAppend(data.constData(), static_cast<size_t>(data.length()));
+    buf->rawAppendEnd();
+
+    testEqual(buf->text(), "abc\ndef\ngh");
+    testEqual(buf->lineOffsetsAsString(), "0,4,8");
+    testEqual(QString(buf->rawDataPointer(), static_cast<qsizetype>(buf->length())), "abc\ndef\ngh");
+
+    buf->replaceText(0, 1, "X");
+    testEqual(QString(buf->rawDataPointer(), static_cast<qsizetype>(buf->length())), "Xbc\ndef\ngh");
+    testEqual(QString(buf->rangeDataPointer(4, 3), 3), "def");
+
+    // the flattened text is freed at the next change
+    buf->replaceText(0, 1, "Y");
+    testTrue(ropeBuf.rawData_.isNull());
+    testEqual(QString(buf->rangeDataPointer(0, 3), 3), "Ybc");
+}
+
+
+/// Performs the same random edits on a gapvector and the rope buffers. The results should be identical
+void RopeTextBufferTest::testRandomEdits()
+{
+    CharTextBuffer charBuf;
+    RopeTextBuffer ropeBuf;
+
+    quint32 seed = 42;
+    QString initial = randomText(seed, 20000);
+    charBuf.setText(initial);
+    ropeBuf.setText(initial);
+
+    RopeTextBuffer latin1Buf;
+    latin1Buf.setStorageMode(TextRope::Latin1Storage);
+    latin1Buf.setText(initial);
+
+    randomEdits(&charBuf, 1234, 2000);
+    randomEdits(&ropeBuf, 1234, 2000);
+    randomEdits(&latin1Buf, 1234, 2000);
+
+    testEqual(ropeBuf.length(), charBuf.length());
+    testEqual(ropeBuf.text(), charBuf.text());
+    testEqual(ropeBuf.lineCount(), charBuf.lineCount());
+    testEqual(ropeBuf.lineOffsetsAsString(), charBuf.lineOffsetsAsString());
+
+    bool linesEqual = true;
+    for (size_t offset = 0; offset <= charBuf.length(); offset += 7) {
+        if (ropeBuf.lineFromOffset(offset) != charBuf.lineFromOffset(offset)) { linesEqual = false; }
+    }
+    testTrue(linesEqual);
+
+    testEqual(latin1Buf.text(), charBuf.text());
+    testEqual(latin1Buf.lineOffsetsAsString(), charBuf.lineOffsetsAsString());
+    testTrue(latin1Buf.rope().byteSize() < ropeBuf.rope().byteSize());
+}
+
+
+/// Tests if a document works with a rope buffer
+void RopeTextBufferTest::testDocument()
+{
+    CharTextDocument doc(new RopeTextBuffer());
+    doc.setText("Hello\nWorld");
+    doc.replace(5, 1, " ");
+    testEqual(doc.text(), "Hello World");
+    testEqual(doc.lineCount(), 1);
+
+    doc.textUndoStack()->undo();
+    testEqual(doc.text(), "Hello\nWorld");
+    testEqual(doc.lineCount(), 2);
+}
+
+
+} // edbee
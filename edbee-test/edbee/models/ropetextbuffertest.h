@@ -0,0 +1,26 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the rope textbuffer by comparing it with the gapvector textbuffer
+class RopeTextBufferTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testReplaceText();
+    void testRawAppend();
+    void testRandomEdits();
+    void testDocument();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::RopeTextBufferTest);
@@ -0,0 +1,161 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textbuffersnapshottest.h"
+
+#include "edbee/models/chardocument/chartextbuffer.h"
+#include "edbee/models/chardocument/ropetextbuffer.h"
+#include "edbee/models/textbuffersnapshot.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Tests if the snapshots of the char textbuffer don't change when the buffer changes
+void TextBufferSnapshotTest::testCharTextBuffer()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    testEqual(buf->version(), 0u);
+
+    buf->appendText("abc\ndef");
+    buf->replaceText(1, 0, "XY");       // moves the gap to the middle of the text
+    testEqual(buf->version(), 2u);
+
+    TextBufferSnapshot first = buf->snapshot();
+    testEqual(first.version(), 2u);
+    testEqual(first.text(), "aXYbc\ndef");
+    testEqual(first.lineCount(), 2u);
+    testEqual(first.offsetFromLine(1), 6u);
+    testEqual(first.line(0), "aXYbc\n");
+    testEqual(first.lineFromOffset(7), 1u);
+    testEqual(first.charAt(2), QChar('Y'));
+
+    // the changes after the snapshot are applied to the buffer and the next snapshot
+    buf->replaceText(0, 3, "1\n2\n");
+    buf->appendText("!");
+    TextBufferSnapshot second = buf->snapshot();
+    testEqual(buf->text(), "1\n2\nbc\ndef!");
+    testEqual(second.text(), buf->text());
+    testEqual(second.version(), 4u);
+    testEqual(second.lineCount(), 4u);
+    testEqual(second.offsetFromLine(3), 7u);
+
+    // the first snapshot is unchanged
+    testEqual(first.text(), "aXYbc\ndef");
+    testEqual(first.lineCount(), 2u);
+
+    buf->setText("");
+    testEqual(buf->snapshot().length(), 0u);
+    testEqual(second.textPart(4, 2), "bc");
+}
+
+
+/// Tests if raw appending updates the snapshot text
+void TextBufferSnapshotTest::testCharTextBufferRawAppend()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText("abc");
+    TextBufferSnapshot first = buf->snapshot();
+
+    QString data("\ndef");
+    buf->rawAppendBegin();
+    buf->rawAppend(data.constData(), static_cast<size_t>(data.length()));
+    buf->rawAppend(QChar('g'));
+    buf->rawAppendEnd();
+
+    testEqual(buf->snapshot().text(), "abc\ndefg");
+    testEqual(buf->snapshot().lineCount(), 2u);
+    testEqual(first.text(), "abc");
+}
+
+
+/// Tests if the snapshot copy of the char textbuffer is released when no snapshot is in use
+void TextBufferSnapshotTest::testCharTextBufferReleasedSnapshots()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText("abc\ndef");
+    testFalse(charBuf.hasSnapshots());
+
+    TextBufferSnapshot* first = new TextBufferSnapshot(buf->snapshot());
+    TextBufferSnapshot copy = *first;
+    testTrue(charBuf.hasSnapshots());
+    delete first;
+    testTrue(charBuf.hasSnapshots());
+    copy = TextBufferSnapshot();
+    testFalse(charBuf.hasSnapshots());
+
+    // small changes keep the copy up-to-date
+    buf->replaceText(1, 1, "X");
+    testTrue(charBuf.snapshotRopeActive_);
+
+    // the copy is released when the changes since the last snapshot are larger than the text
+    buf->replaceText(0, 7, "aXc\ndef");
+    testFalse(charBuf.snapshotRopeActive_);
+    buf->appendText("\nghi");
+
+    // a new snapshot copies the text again
+    TextBufferSnapshot second = buf->snapshot();
+    testEqual(second.text(), "aXc\ndef\nghi");
+    testEqual(second.lineCount(), 3u);
+
+    // while a snapshot is in use the changes are applied to the copy
+    buf->replaceText(0, 11, "1Xc\ndef\nghi");
+    testTrue(charBuf.snapshotRopeActive_);
+    testEqual(buf->snapshot().text(), "1Xc\ndef\nghi");
+    testEqual(second.text(), "aXc\ndef\nghi");
+}
+
+
+/// Tests taking a snapshot after every change. The copy of the text is kept up-to-date, so it isn't copied again
+void TextBufferSnapshotTest::testCharTextBufferRepeatedSnapshots()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText(QString(1000, QChar('a')));
+
+    quint64 version = buf->snapshot().version();
+    size_t length = buf->length();
+    for (int i = 0; i < 200; ++i) {
+        // no snapshot is in use during the change
+        QString text = i % 3 ? QStringLiteral("x\n") : QStringLiteral("y");
+        buf->replaceText(static_cast<size_t>(i * 7 % 900), 2, text);
+        testFalse(charBuf.hasSnapshots());
+        testTrue(charBuf.snapshotRopeActive_);
+
+        TextBufferSnapshot snapshot = buf->snapshot();
+        testEqual(snapshot.text(), buf->text());
+        testEqual(snapshot.lineCount(), buf->lineCount());
+        testEqual(snapshot.offsetFromLine(snapshot.lineCount() - 1), buf->offsetFromLine(buf->lineCount() - 1));
+        testTrue(snapshot.version() > version);
+        testEqual(snapshot.length(), length - 2 + static_cast<size_t>(text.length()));
+        version = snapshot.version();
+        length = snapshot.length();
+    }
+}
+
+
+/// Tests the snapshots of the rope textbuffer, these share the rope of the buffer
+void TextBufferSnapshotTest::testRopeTextBuffer()
+{
+    RopeTextBuffer ropeBuf;
+    TextBuffer* buf = &ropeBuf;
+    buf->appendText("hello\nworld");
+
+    TextBufferSnapshot snapshot = buf->snapshot();
+    testEqual(snapshot.version(), 1u);
+    testEqual(snapshot.rope().chunkCount(), ropeBuf.rope().chunkCount());
+
+    buf->replaceText(0, 5, "bye");
+    testEqual(buf->version(), 2u);
+    testEqual(buf->text(), "bye\nworld");
+    testEqual(snapshot.text(), "hello\nworld");
+    testEqual(snapshot.offsetFromLine(1), 6u);
+    testEqual(buf->snapshot().offsetFromLine(1), 4u);
+}
+
+
+} // edbee
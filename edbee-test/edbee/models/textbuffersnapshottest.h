@@ -0,0 +1,27 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the immutable textbuffer snapshots
+class TextBufferSnapshotTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testCharTextBuffer();
+    void testCharTextBufferRawAppend();
+    void testCharTextBufferReleasedSnapshots();
+    void testCharTextBufferRepeatedSnapshots();
+    void testRopeTextBuffer();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextBufferSnapshotTest);
@@ -6,6 +6,7 @@
 #include "edbee/models/textbuffer.h"
 #include "edbee/models/chardocument/chartextbuffer.h"
 #include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/chardocument/ropetextbuffer.h"
 
 #include "edbee/debug.h"
 
@@ -248,4 +249,117 @@ void TextBufferTest::testReplaceIssue141()
 }
 
 
+/// Tests the spans and range data of the char textbuffer. These should not move the gap
+void TextBufferTest::testSpans()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText("abcdefgh");
+    buf->replaceText(3, 0, "XY");        // the gap is now located after 'Y'
+    testEqual(buf->text(), "abcXYdefgh");
+
+    QVector<TextBufferSpan> spans = buf->spans(1, 7);
+    testEqual(spans.size(), 2);
+    testEqual(QString(spans[0].data, static_cast<int>(spans[0].length)), "bcXY");
+    testEqual(spans[0].offset, 1);
+    testEqual(QString(spans[1].data, static_cast<int>(spans[1].length)), "def");
+    testEqual(spans[1].offset, 5);
+
+    spans = buf->spans(6, 4);
+    testEqual(spans.size(), 1);
+    testEqual(QString(spans[0].data, static_cast<int>(spans[0].length)), "efgh");
+    testEqual(buf->spans(0, 0).size(), 0);
+
+    testEqual(QString(buf->rangeDataPointer(2, 6), 6), "cXYdef");
+    testEqual(buf->text(), "abcXYdefgh");
+}
+
+
+
+/// Tests the batched replacement of multiple texts
+void TextBufferTest::testReplaceTexts()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText("abc\ndef\nghi");
+    buf->replaceText(5, 0, "");     // move the gap to the middle of the edits
+
+    QVector<TextBufferEdit> edits;
+    edits.append({ 1, 1, "X\nY" });
+    edits.append({ 4, 0, "12" });
+    edits.append({ 6, 3, "" });
+    edits.append({ 10, 1, "ZZ" });
+    testEqual(buf->replacedText(edits), "X\nYc\n12dehZZ");
+
+    // all edits are emitted as a single change, from the first edit to the end of the last edit
+    QStringList changes;
+    connect(buf, &TextBuffer::textChanged, this, [&changes](TextBufferChange change, QString) {
+        changes.append(QStringLiteral("%1:%2:%3").arg(change.offset()).arg(change.length()).arg(change.newTextLength()));
+    });
+    buf->replaceTexts(edits);
+    testEqual(changes.join(","), "1:10:12");
+    testBuffer(buf, "aX\nYc\n12dehZZ", "0,3,6");
+
+    // a single edit and no edits
+    buf->replaceTexts({ { 0, 1, "A" } });
+    testBuffer(buf, "AX\nYc\n12dehZZ", "0,3,6");
+    buf->replaceTexts(QVector<TextBufferEdit>());
+    testEqual(changes.size(), 2);
+}
+
+
+/// Tests the views on the text of the char and rope textbuffer
+void TextBufferTest::testViews()
+{
+    CharTextBuffer charBuf;
+    RopeTextBuffer ropeBuf;
+    QList<TextBuffer*> buffers;
+    buffers << &charBuf << &ropeBuf;
+
+    for (TextBuffer* buf : buffers) {
+        buf->appendText("abc\ndef\n");
+        buf->replaceText(5, 0, "X");        // the gap of the char buffer is now in the second line
+        testEqual(buf->text(), "abc\ndXef\n");
+
+        testEqual(buf->lineView(0).toString(), "abc\n");
+        testEqual(buf->lineView(1).toString(), "dXef\n");
+        testEqual(buf->lineWithoutNewlineView(1).toString(), "dXef");
+        testEqual(buf->lineWithoutNewlineView(2).toString(), "");
+        testEqual(buf->lineView(2).size(), 0);
+        testEqual(buf->textPartView(2, 5).toString(), "c\ndXe");
+        testEqual(buf->text(), "abc\ndXef\n");
+    }
+}
+
+
+/// Tests if the old text is only passed to the textChanged signal when it's required
+void TextBufferTest::testOldTextRequired()
+{
+    CharTextBuffer charBuf;
+    TextBuffer* buf = &charBuf;
+    buf->appendText("abcdef");
+
+    QString lastOldText("<none>");
+    connect(buf, &TextBuffer::textChanged, this, [&lastOldText](TextBufferChange, QString oldText) { lastOldText = oldText; });
+
+    testFalse(buf->isOldTextRequired());
+    buf->replaceText(1, 2, "X");
+    testTrue(lastOldText.isNull());
+
+    // two listeners require the old text, it's required until both are released
+    buf->acquireOldText();
+    buf->acquireOldText();
+    buf->replaceText(2, 2, "");
+    testEqual(lastOldText, "de");
+
+    buf->releaseOldText();
+    testTrue(buf->isOldTextRequired());
+    buf->releaseOldText();
+    testFalse(buf->isOldTextRequired());
+    buf->replaceText(0, 1, "");
+    testTrue(lastOldText.isNull());
+    testEqual(buf->text(), "Xf");
+}
+
+
 } // edbee
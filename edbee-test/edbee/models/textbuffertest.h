@@ -21,6 +21,10 @@ private slots:
     void testFindCharPosWithinRange();
     void testLine();
     void testReplaceIssue141();
+    void testSpans();
+    void testReplaceTexts();
+    void testViews();
+    void testOldTextRequired();
 };
 
 } // edbee
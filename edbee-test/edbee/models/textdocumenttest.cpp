@@ -6,10 +6,12 @@
 #include <QStringList>
 #include <QDebug>
 
+#include "edbee/models/changes/textchange.h"
 #include "edbee/models/chardocument/chartextdocument.h"
 #include "edbee/models/textbuffer.h"
 #include "edbee/models/textlinedata.h"
 #include "edbee/models/textrange.h"
+#include "edbee/models/textundostack.h"
 
 #include "edbee/debug.h"
 
@@ -174,4 +176,66 @@ void TextDocumentTest::testReplaceRangeSet_delete2()
     testEqual( doc.text(), "");
 }
 
+
+
+/// Tests the replacement of a lot of ranges. Every range gets its own change, like a replacement of a few ranges
+void TextDocumentTest::testReplaceRangeSet_manyRanges()
+{
+    CharTextDocument doc;
+    QString text;
+    for (int i = 0; i < 40; ++i) { text.append("ab\n"); }
+    doc.append(text);
+
+    // select every 'b'
+    TextRangeSet ranges(&doc);
+    for (size_t i = 0; i < 40; ++i) { ranges.addRange(i * 3 + 1, i * 3 + 2); }
+
+    // line data and the dynamic ranges (of other views) between the ranges should be kept
+    doc.giveLineData(5, 0, new QStringTextLineData("line5"));
+    DynamicTextRangeSet otherRanges(&doc);
+    otherRanges.addRange(15, 15);
+
+    doc.beginUndoGroup();
+    doc.replaceRangeSet(ranges, QStringLiteral("X,YZ,").split(","));
+    doc.endUndoGroup(0, true);
+    QString expected;
+    for (int i = 0; i < 40; ++i) { expected.append(i % 3 == 0 ? "aX\n" : i % 3 == 1 ? "aYZ\n" : "a\n"); }
+    testEqual(doc.text(), expected);
+    testEqual(doc.lineCount(), 41);
+    testEqual(doc.offsetFromLine(2), 7);
+    testEqual(ranges.range(0).caret(), 2);
+    testEqual(ranges.range(1).caret(), 6);
+    testEqual(ranges.range(2).caret(), 8);
+    testTrue(ranges.range(2).isEmpty());
+
+    QStringTextLineData* data = dynamic_cast<QStringTextLineData*>(doc.getLineData(5, 0));
+    testTrue(data != nullptr);
+    if (data) { testEqual(data->value(), "line5"); }
+    testEqual(otherRanges.rangesAsString(), "16>16");
+
+    // every range has its own change, which only stores the replaced character
+    ChangeGroup* group = dynamic_cast<ChangeGroup*>(doc.textUndoStack()->last());
+    testTrue(group != nullptr);
+    if (group) {
+        testEqual(group->size(), 40);
+        size_t storedLength = 0;
+        for (size_t idx = 0; idx < group->size(); ++idx) {
+            TextChange* change = dynamic_cast<TextChange*>(group->at(idx));
+            if (change) { storedLength += change->storedLength(); }
+        }
+        testEqual(storedLength, 40);
+    }
+    doc.textUndoStack()->undo();
+    testEqual(doc.text(), text);
+    testEqual(otherRanges.rangesAsString(), "15>15");
+    doc.textUndoStack()->redo();
+    testEqual(doc.text(), expected);
+
+    // a sticky selection selects the inserted texts
+    doc.replaceRangeSet(ranges, "Q", true);
+    testEqual(doc.textPart(0, 12), "aXQ\naYZQ\naQ\n");
+    testEqual(ranges.range(1).anchor(), 7);
+    testEqual(ranges.range(1).caret(), 8);
+}
+
 } // edbee
@@ -19,6 +19,7 @@ private slots:
     void testReplaceRangeSet_simpleInsert();
     void testReplaceRangeSet_delete();
     void testReplaceRangeSet_delete2();
+    void testReplaceRangeSet_manyRanges();
 };
 
 } // edbee
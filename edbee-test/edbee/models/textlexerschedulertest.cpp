@@ -0,0 +1,202 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textlexerschedulertest.h"
+
+#include <QElapsedTimer>
+
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/models/textlexer.h"
+#include "edbee/models/textlexerscheduler.h"
+#include "edbee/testhelpers.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Returns a text with the given number of lines, with comments spanning several lines
+static QString sourceText(int lineCount)
+{
+    QString text;
+    for (int i = 0; i < lineCount; ++i) {
+        switch (i % 5) {
+            case 0: text.append(QStringLiteral("int a%1; /* a comment\n").arg(i)); break;
+            case 2: text.append(QStringLiteral("int */ int b%1;\n").arg(i)); break;
+            default: text.append(QStringLiteral("int c%1;\n").arg(i)); break;
+        }
+    }
+    text.append(QStringLiteral("int end;"));
+    return text;
+}
+
+
+/// Tests the lines that aren't lexed by the request are lexed in background slices
+void TextLexerSchedulerTest::testBackgroundLexing()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexerschedulertest"));
+    QString text = sourceText(1000);
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(text);
+
+    TextLexerScheduler scheduler;
+    scheduler.setForegroundDuration(0);
+    scheduler.setSliceDuration(0);
+    scheduler.requestRange(&doc, doc.offsetFromLine(990), doc.length());
+    testEqual( doc.scopes()->lastScopedOffset(), 0u );
+    testTrue( scheduler.isPending() );
+
+    // the first slice lexes a block of lines, the rest is rendered unstyled
+    testTrue( scheduler.lexSlice() );
+    testTrue( doc.scopes()->lastScopedOffset() > 0u );
+    testTrue( doc.scopes()->scopedRangesAtLine(990) == nullptr );
+
+    int slices = 1;
+    while (scheduler.lexSlice()) { ++slices; }
+    testTrue( slices > 1 );
+    testFalse( scheduler.isPending() );
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, text) );
+
+    // lexing in the foreground
+    CharTextDocument foregroundDoc;
+    foregroundDoc.setLanguageGrammar(grammar);
+    foregroundDoc.setText(text);
+    scheduler.setForegroundDuration(60000);
+    scheduler.requestRange(&foregroundDoc, 0, foregroundDoc.length());
+    testFalse( scheduler.isPending() );
+    testEqual( foregroundDoc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, text) );
+
+    delete grammar;
+}
+
+
+/// Tests a change of the text while lexing in the background
+void TextLexerSchedulerTest::testTextChanged()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexerschedulertest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(sourceText(500));
+
+    TextLexerScheduler scheduler;
+    scheduler.setForegroundDuration(0);
+    scheduler.setSliceDuration(0);
+    scheduler.requestRange(&doc, 0, doc.length());
+    testTrue( scheduler.lexSlice() );
+    testTrue( scheduler.lexSlice() );
+
+    // opening a comment at the start changes the scopes of all lexed lines
+    doc.replace(0, 0, QStringLiteral("/* "));
+    testEqual( doc.scopes()->lastScopedOffset(), 0u );
+    testTrue( scheduler.isPending() );
+    while (scheduler.lexSlice()) {}
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+    testEqual( doc.scopes()->scopesAsStringList().join("\n"), lexedScopes(grammar, doc.text()) );
+
+    delete grammar;
+}
+
+
+/// Tests only the last requested range is lexed
+void TextLexerSchedulerTest::testTargetChanged()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexerschedulertest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(sourceText(1000));
+
+    TextLexerScheduler scheduler;
+    scheduler.setForegroundDuration(0);
+    scheduler.setSliceDuration(0);
+    scheduler.requestRange(&doc, doc.offsetFromLine(990), doc.length());
+    testTrue( scheduler.lexSlice() );
+
+    // scrolling back to the start, which has been lexed
+    scheduler.requestRange(&doc, 0, doc.offsetFromLine(10));
+    testFalse( scheduler.isPending() );
+    testFalse( scheduler.lexSlice() );
+    testTrue( doc.scopes()->lastScopedOffset() < doc.offsetFromLine(990) );
+
+    // a cancelled scheduler doesn't lex
+    scheduler.requestRange(&doc, doc.offsetFromLine(990), doc.length());
+    scheduler.cancel();
+    testFalse( scheduler.isPending() );
+    testFalse( scheduler.lexSlice() );
+
+    delete grammar;
+}
+
+
+/// Tests a repeated request of the range that's lexed in the background doesn't lex in the foreground again
+/// (the renderer requests the range again when it repaints the lines of a background slice)
+void TextLexerSchedulerTest::testRepeatedRequest()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexerschedulertest"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(sourceText(1000));
+
+    TextLexerScheduler scheduler;
+    scheduler.setForegroundDuration(0);
+    scheduler.setSliceDuration(0);
+    scheduler.requestRange(&doc, doc.offsetFromLine(990), doc.length());
+    testTrue( scheduler.lexSlice() );
+
+    size_t lastScopedOffset = doc.scopes()->lastScopedOffset();
+    scheduler.setForegroundDuration(60000);
+    scheduler.requestRange(&doc, doc.offsetFromLine(990), doc.length());
+    testEqual( doc.scopes()->lastScopedOffset(), lastScopedOffset );
+    testTrue( scheduler.isPending() );
+
+    // another range is lexed in the foreground
+    scheduler.requestRange(&doc, doc.offsetFromLine(980), doc.offsetFromLine(995));
+    testFalse( scheduler.isPending() );
+    testTrue( doc.scopes()->lastScopedOffset() >= doc.offsetFromLine(995) );
+
+    delete grammar;
+}
+
+
+/// Tests a document with a single long line doesn't block longer than the foreground duration
+void TextLexerSchedulerTest::testLongLine()
+{
+    TextGrammar* grammar = createCommentGrammar(QStringLiteral("text.lexerschedulertest"));
+    QString text = QStringLiteral("int a; /* b */ ").repeated(200000);
+    text.append(QStringLiteral("\nint end;"));
+
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(text);
+
+    TextLexerScheduler scheduler;
+    scheduler.setForegroundDuration(20);
+    scheduler.setSliceDuration(10);
+
+    QElapsedTimer timer;
+    timer.start();
+    scheduler.requestRange(&doc, 0, doc.length());
+    while (scheduler.lexSlice()) {}
+    testTrue( timer.elapsed() < 500 );  // matching the rules on the long line takes seconds
+    testEqual( doc.scopes()->lastScopedOffset(), doc.length() );
+
+    // the long line isn't styled, the line after it is
+    testTrue( doc.scopes()->scopedRangesAtLine(0)->size() <= 1 );
+    CharTextDocument endDoc;
+    endDoc.setLanguageGrammar(grammar);
+    endDoc.setText(QStringLiteral("int end;"));
+    lexedScopes(&endDoc);
+    testEqual( doc.scopes()->scopedRangesAtLine(1)->toString(), endDoc.scopes()->scopedRangesAtLine(0)->toString() );
+
+    delete grammar;
+}
+
+
+} // edbee
@@ -0,0 +1,24 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class TextLexerSchedulerTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testBackgroundLexing();
+    void testTextChanged();
+    void testTargetChanged();
+    void testRepeatedRequest();
+    void testLongLine();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextLexerSchedulerTest);
@@ -164,6 +164,32 @@ void TextSearcherTest::testSelectAll()
 }
 
 
+/// Tests searching a document that's larger than the search window. The window grows until the match is found
+void TextSearcherTest::testFindLargeDocument()
+{
+    CharTextDocument doc;
+    doc.setText(QString(100000, QChar('a')) + QStringLiteral("b test ") + QString(100000, QChar('c')) + QStringLiteral("test"));
+    TextRangeSet ranges(&doc);
+    ranges.addRange(0, 0);
+
+    TextSearcher searcher;
+    searcher.setSearchTerm("test");
+    testTrue( searcher.findNext(&ranges) );
+    testEqual( ranges.rangesAsString(), "100002>100006" );
+    testTrue( searcher.findNext(&ranges) );
+    testEqual( ranges.rangesAsString(), "200007>200011" );
+
+    testTrue( searcher.findPrev(&ranges) );
+    testEqual( ranges.rangesAsString(), "100002>100006" );
+
+    // a match that's longer than the first window
+    searcher.setSyntax(TextSearcher::SyntaxRegExp);
+    searcher.setSearchTerm("a+b");
+    ranges.setRange(0, 0);
+    testEqual( searcher.findNextRange(&ranges).toString(), "0>100001" );
+}
+
+
 /// Creates the basic fixture
 TextDocument* TextSearcherTest::createFixtureDocument()
 {
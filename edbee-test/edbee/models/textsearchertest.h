@@ -31,6 +31,7 @@ private slots:
     void testSelectNext();
     void testSelectPrev();
     void testSelectAll();
+    void testFindLargeDocument();
 
 
 private:
@@ -0,0 +1,71 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "testhelpers.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryFile>
+
+#include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textdocumentscopes.h"
+#include "edbee/models/textgrammar.h"
+#include "edbee/models/textlexer.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Creates a grammar with a multi-line comment and a keyword
+/// @param name the name of the grammar, which is the scope of the main rule
+/// @param keyword the keyword (the scope is "keyword")
+TextGrammar* createCommentGrammar(const QString& name, const QString& keyword)
+{
+    TextGrammar* grammar = new TextGrammar(name, name);
+    TextGrammarRule* mainRule = TextGrammarRule::createMainRule(grammar, name);
+    mainRule->giveRule(TextGrammarRule::createMultiLineRegExp(grammar, QStringLiteral("comment.block"), QString(), QStringLiteral("/\\*"), QStringLiteral("\\*/")));
+    mainRule->giveRule(TextGrammarRule::createSingleLineRegExp(grammar, QStringLiteral("keyword"), QStringLiteral("\\b%1\\b").arg(keyword)));
+    grammar->giveMainRule(mainRule);
+    return grammar;
+}
+
+
+/// Returns the scopes of the document after lexing it completely
+QString lexedScopes(TextDocument* doc)
+{
+    doc->textLexer()->lexRange(0, doc->length());
+    return doc->scopes()->scopesAsStringList().join("\n");
+}
+
+
+/// Returns the scopes of the given text after lexing it completely
+QString lexedScopes(TextGrammar* grammar, const QString& text)
+{
+    CharTextDocument doc;
+    doc.setLanguageGrammar(grammar);
+    doc.setText(text);
+    return lexedScopes(&doc);
+}
+
+
+/// Returns a unique name for a temporary file (the file isn't created)
+QString temporaryFileName(const QString& suffix)
+{
+    QTemporaryFile file;
+    file.open();
+    return file.fileName() + suffix;
+}
+
+
+/// Writes the file, an existing file is replaced
+void writeFile(const QString& fileName, const QByteArray& data)
+{
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(data);
+    file.close();
+}
+
+
+} // edbee
@@ -0,0 +1,23 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace edbee {
+
+class TextDocument;
+class TextGrammar;
+
+// The helpers shared by the tests (grammars, lexing and temporary files)
+
+TextGrammar* createCommentGrammar(const QString& name, const QString& keyword = QStringLiteral("int"));
+QString lexedScopes(TextDocument* doc);
+QString lexedScopes(TextGrammar* grammar, const QString& text);
+
+QString temporaryFileName(const QString& suffix);
+void writeFile(const QString& fileName, const QByteArray& data);
+
+} // edbee
@@ -6,8 +6,11 @@
 #include <QBuffer>
 
 #include "edbee/models/chardocument/chartextdocument.h"
+#include "edbee/models/textbuffersnapshot.h"
 #include "edbee/models/textdocument.h"
+#include "edbee/models/textundostack.h"
 #include "edbee/io/textdocumentserializer.h"
+#include "edbee/util/lineending.h"
 
 #include "edbee/debug.h"
 
@@ -40,4 +43,185 @@ void TextDocumentSerializerTest::testLoad()
 }
 
 
+/// Tests the threaded loader, by comparing it with the result of the serial loader.
+/// The small chunk sizes force chunk boundaries in multi-byte characters and "\r\n" pairs
+void TextDocumentSerializerTest::testLoadThreaded()
+{
+    QByteArray data;
+    for (int i = 0; i < 200; ++i) {
+        data.append(QStringLiteral("Line %1: caf\u00e9 \u20ac \U0001F600\r\nlone\rcr\r\n").arg(i).toUtf8());
+    }
+
+    // the serial result
+    CharTextDocument serialDoc;
+    TextDocumentSerializer serialSerializer(&serialDoc);
+    serialSerializer.setThreadedLoadChunkSize(0);
+    QBuffer serialBuffer(&data);
+    testTrue( serialSerializer.load(&serialBuffer) );
+
+    static const int chunkSizes[] = { 5, 7, 16, 1000 };
+    for (int chunkSize : chunkSizes) {
+        CharTextDocument doc;
+        TextDocumentSerializer serializer(&doc);
+        serializer.setThreadedLoadChunkSize(chunkSize);
+        QBuffer buffer(&data);
+        testTrue( serializer.load(&buffer) );
+        testEqual( doc.text(), serialDoc.text() );
+        testEqual( doc.lineCount(), serialDoc.lineCount() );
+        testTrue( doc.lineEnding() == LineEnding::windowsType() );
+        testTrue( doc.encoding() == serialDoc.encoding() );
+    }
+
+    // a BOM is only removed from the first chunk
+    QByteArray bomData("\xEF\xBB\xBF");
+    bomData.append(data);
+    CharTextDocument bomDoc;
+    TextDocumentSerializer bomSerializer(&bomDoc);
+    bomSerializer.setThreadedLoadChunkSize(16);
+    QBuffer bomBuffer(&bomData);
+    testTrue( bomSerializer.load(&bomBuffer) );
+    testEqual( bomDoc.text(), serialDoc.text() );
+}
+
+
+/// Tests reloading a changed file, which should only replace the changed lines
+void TextDocumentSerializerTest::testReload()
+{
+    QByteArray data("line 1\nline 2\nline 3\nline 4\nline 5\n");
+    CharTextDocument doc;
+    TextDocumentSerializer serializer(&doc);
+    QBuffer buffer(&data);
+    testTrue( serializer.load(&buffer) );
+    qsizetype undoSize = doc.textUndoStack()->size();
+
+    // change a line, remove a line and add a line
+    QByteArray changedData("line 1\nline two\nline 3\nline 5\nline 6\n");
+    QBuffer changedBuffer(&changedData);
+    testTrue( serializer.reload(&changedBuffer) );
+    testEqual( doc.text(), QString::fromLatin1(changedData) );
+    testEqual( doc.lineCount(), 6u );
+    testEqual( doc.textUndoStack()->size(), undoSize + 1 );     // a single undo group
+
+    // the reload can be undone
+    doc.textUndoStack()->undo();
+    testEqual( doc.text(), QString::fromLatin1(data) );
+
+    // an unchanged file doesn't change the document
+    testTrue( serializer.reload(&buffer) );
+    testEqual( doc.text(), QString::fromLatin1(data) );
+
+    // the line ending of the new file is used
+    QByteArray windowsData("line 1\r\nline 2\r\n");
+    QBuffer windowsBuffer(&windowsData);
+    testTrue( serializer.reload(&windowsBuffer) );
+    testEqual( doc.text(), QStringLiteral("line 1\nline 2\n") );
+    testTrue( doc.lineEnding() == LineEnding::windowsType() );
+
+    // a completely different file
+    QByteArray otherData("other");
+    QBuffer otherBuffer(&otherData);
+    testTrue( serializer.reload(&otherBuffer) );
+    testEqual( doc.text(), QStringLiteral("other") );
+}
+
+
+/// Saves the document to a byte array
+static QByteArray saveDocument(TextDocumentSerializer& serializer)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    serializer.save(&buffer);
+    return data;
+}
+
+
+/// Saves the snapshot to a byte array
+static QByteArray saveSnapshot(TextDocumentSerializer& serializer, const TextBufferSnapshot& snapshot, TextCodec* codec, const LineEnding* lineEnding)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    serializer.saveSnapshotWithoutOpening(&buffer, snapshot, codec, lineEnding);
+    return data;
+}
+
+
+/// A filter that skips the lines starting with a '#'
+class SkipCommentFilter : public TextDocumentSerializerFilter {
+public:
+    virtual bool saveLineSelector(TextDocumentSerializer*, size_t, QString& line)
+    {
+        return !line.startsWith('#');
+    }
+};
+
+
+/// Tests saving, with and without translating the line endings
+void TextDocumentSerializerTest::testSave()
+{
+    CharTextDocument doc;
+    TextDocumentSerializer serializer(&doc);
+    doc.buffer()->setText(QStringLiteral("Test,\nWerkt het? \u20ac\nRick!!\n"));
+
+    testEqual( saveDocument(serializer), QByteArray("Test,\nWerkt het? \xE2\x82\xAC\nRick!!\n") );
+
+    doc.setLineEnding(LineEnding::windowsType());
+    testEqual( saveDocument(serializer), QByteArray("Test,\r\nWerkt het? \xE2\x82\xAC\r\nRick!!\r\n") );
+
+    // a large document is saved in multiple blocks
+    QString line = QStringLiteral("Line caf\u00e9 \U0001F600\n");
+    QString text = line.repeated(50000);
+    doc.buffer()->setText(text);
+    QByteArray expected = text.toUtf8().replace("\n", "\r\n");
+    testEqual( saveDocument(serializer), expected );
+
+    // a block size that splits the surrogate pairs and line endings
+    serializer.setSaveBlockSize(3);
+    testEqual( saveDocument(serializer), expected );
+    // a high surrogate at the end of the document isn't dropped
+    doc.buffer()->setText(QStringLiteral("end") + QChar(0xD83D));
+    testEqual( saveDocument(serializer), QByteArray("end\xEF\xBF\xBD") );
+}
+
+
+/// Tests saving with a line filter
+void TextDocumentSerializerTest::testSaveFilter()
+{
+    CharTextDocument doc;
+    TextDocumentSerializer serializer(&doc);
+    SkipCommentFilter filter;
+    serializer.setFilter(&filter);
+    doc.buffer()->setText(QStringLiteral("a\n# comment\nb\n#last"));
+
+    testEqual( saveDocument(serializer), QByteArray("a\nb\n") );
+
+    doc.setLineEnding(LineEnding::windowsType());
+    testEqual( saveDocument(serializer), QByteArray("a\r\nb\r\n") );
+}
+
+
+/// Tests saving a snapshot. The snapshot isn't changed by changes of the document
+void TextDocumentSerializerTest::testSaveSnapshot()
+{
+    CharTextDocument doc;
+    TextDocumentSerializer serializer(&doc);
+    QString text = QStringLiteral("Line caf\u00e9 \U0001F600\n# comment\n").repeated(20000);
+    doc.buffer()->setText(text);
+
+    TextBufferSnapshot snapshot = doc.buffer()->snapshot();
+    doc.buffer()->setText(QStringLiteral("changed"));
+
+    testEqual( saveSnapshot(serializer, snapshot, doc.encoding(), LineEnding::windowsType()), text.toUtf8().replace("\n", "\r\n") );
+    testTrue( serializer.errorString().isEmpty() );
+
+    serializer.setSaveBlockSize(5);
+    testEqual( saveSnapshot(serializer, snapshot, doc.encoding(), LineEnding::windowsType()), text.toUtf8().replace("\n", "\r\n") );
+
+    // with a filter
+    SkipCommentFilter filter;
+    serializer.setFilter(&filter);
+    testEqual( saveSnapshot(serializer, snapshot, doc.encoding(), LineEnding::unixType()), QStringLiteral("Line caf\u00e9 \U0001F600\n").repeated(20000).toUtf8() );
+}
+
+
 } // edbee
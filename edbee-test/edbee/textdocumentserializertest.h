@@ -14,6 +14,11 @@ class TextDocumentSerializerTest : public edbee::test::TestCase
 private slots:
 
     void testLoad();
+    void testLoadThreaded();
+    void testReload();
+    void testSave();
+    void testSaveFilter();
+    void testSaveSnapshot();
 
 };
 
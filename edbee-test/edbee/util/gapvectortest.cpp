@@ -203,4 +203,28 @@ void GapVectorTest::testIssueLineDataVector()
 }
 
 
+/// Tests if rangeData only moves the gap when it's inside the range
+void GapVectorTest::testRangeData()
+{
+    QCharGapVector v("ABCDEFGH", 2);
+    v.moveGapTo(3);
+    testContent(v, "ABC[__>DEFGH");
+
+    // the gap isn't moved for ranges outside the gap
+    testEqual(QString(v.rangeData(0, 3), 3), "ABC");
+    testEqual(QString(v.rangeData(3, 5), 5), "DEFGH");
+    testEqual(QString(v.rangeData(4, 2), 2), "EF");
+    testContent(v, "ABC[__>DEFGH");
+
+    // the gap is moved to the nearest side of the range
+    testEqual(QString(v.rangeData(2, 5), 5), "CDEFG");
+    testContent(v, "AB[__>CDEFGH");
+    testEqual(QString(v.rangeData(0, 3), 3), "ABC");
+    testContent(v, "ABC[__>DEFGH");
+
+    testEqual(v.firstPartData()[2], QChar('C'));
+    testEqual(v.secondPartData()[0], QChar('D'));
+}
+
+
 } // edbee
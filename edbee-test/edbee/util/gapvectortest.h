@@ -24,6 +24,8 @@ private slots:
 
     void testIssueLineDataVector();
 
+    void testRangeData();
+
 };
 
 } // edbee
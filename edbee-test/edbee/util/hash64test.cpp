@@ -0,0 +1,49 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "hash64test.h"
+
+#include "edbee/util/hash64.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+
+/// Adding the data in parts should give the same hash as adding it at once
+void Hash64Test::testSplitAdd()
+{
+    const char* data = "The quick brown fox jumps over the lazy dog";
+    size_t length = 43;
+    quint64 expected = Hash64::hash(data, length);
+
+    // every split in two and three parts
+    for (size_t i = 0; i <= length; ++i) {
+        for (size_t j = i; j <= length; ++j) {
+            Hash64 hash;
+            hash.add(data, i);
+            hash.add(data + i, j - i);
+            hash.add(data + j, length - j);
+            testEqual( hash.result(), expected );
+        }
+    }
+
+    // byte by byte
+    Hash64 hash;
+    for (size_t i = 0; i < length; ++i) {
+        hash.add(data + i, 1);
+    }
+    testEqual( hash.result(), expected );
+}
+
+
+/// Different data should give a different hash
+void Hash64Test::testDifferentData()
+{
+    testTrue( Hash64::hash("abc", 3) != Hash64::hash("abd", 3) );
+    testTrue( Hash64::hash("abcdefgh", 8) != Hash64::hash("abcdefgi", 8) );
+    testTrue( Hash64::hash("abcdefghij", 10) != Hash64::hash("abcdefghik", 10) );
+}
+
+
+} // edbee
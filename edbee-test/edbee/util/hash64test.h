@@ -0,0 +1,24 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the 64 bit hash
+class Hash64Test : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testSplitAdd();
+    void testDifferentData();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::Hash64Test);
@@ -0,0 +1,153 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "linedifftest.h"
+
+#include <QStringList>
+
+#include "edbee/models/chardocument/chartextbuffer.h"
+#include "edbee/util/linediff.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Converts the edits to a string. Every edit has the format "oldLine,oldLineCount>newLine,newLineCount"
+static QString editsAsString(const QVector<LineDiff::Edit>& edits)
+{
+    QStringList result;
+    for (const LineDiff::Edit& edit : edits) {
+        result.append(QStringLiteral("%1,%2>%3,%4").arg(edit.oldLine).arg(edit.oldLineCount).arg(edit.newLine).arg(edit.newLineCount));
+    }
+    return result.join(" ");
+}
+
+
+/// Returns the edits of two lists of line numbers (used as hashes)
+static QString diff(const QVector<quint64>& oldLines, const QVector<quint64>& newLines, size_t maxCost = LineDiff::DefaultMaxCost)
+{
+    return editsAsString(LineDiff::diff(oldLines.constData(), static_cast<size_t>(oldLines.size()), newLines.constData(), static_cast<size_t>(newLines.size()), maxCost));
+}
+
+
+/// Applies the edits to the old lines
+static QVector<quint64> applyEdits(QVector<quint64> lines, const QVector<quint64>& newLines, const QVector<LineDiff::Edit>& edits)
+{
+    for (qsizetype i = edits.size() - 1; i >= 0; --i) {
+        const LineDiff::Edit& edit = edits.at(i);
+        lines.remove(static_cast<qsizetype>(edit.oldLine), static_cast<qsizetype>(edit.oldLineCount));
+        for (size_t j = 0; j < edit.newLineCount; ++j) {
+            lines.insert(static_cast<qsizetype>(edit.oldLine + j), newLines.at(static_cast<qsizetype>(edit.newLine + j)));
+        }
+    }
+    return lines;
+}
+
+
+/// Tests finding the first and last different character, at all positions of the vectorized blocks
+void LineDiffTest::testCommonPrefixSuffix()
+{
+    QString text = QStringLiteral("abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJ");
+    size_t length = static_cast<size_t>(text.length());
+    for (size_t pos = 0; pos < length; ++pos) {
+        QString changed = text;
+        changed[static_cast<qsizetype>(pos)] = QChar(0x0100 | changed.at(static_cast<qsizetype>(pos)).unicode());
+        testEqual( LineDiff::commonPrefixLength(text.constData(), changed.constData(), length), pos );
+        testEqual( LineDiff::commonSuffixLength(text.constData(), changed.constData(), length), length - pos - 1 );
+    }
+    testEqual( LineDiff::commonPrefixLength(text.constData(), text.constData(), length), length );
+    testEqual( LineDiff::commonSuffixLength(text.constData(), text.constData(), length), length );
+
+    // buffers with a gap
+    CharTextBuffer a, b;
+    a.setText(QString(text).remove(10, 1));
+    a.replaceText(10, 0, text.constData() + 10, 1);
+    b.setText(QString(text).remove(30, 1) + QStringLiteral("!"));
+    b.replaceText(30, 0, QStringLiteral("#").constData(), 1);
+    testEqual( LineDiff::commonPrefixLength(&a, &b), 30u );
+    testEqual( LineDiff::commonSuffixLength(&a, &b, length), 0u );
+    b.replaceText(b.length() - 1, 1, text.constData(), 0);
+    testEqual( LineDiff::commonSuffixLength(&a, &b, length), length - 31 );
+    testEqual( LineDiff::commonSuffixLength(&a, &b, 5), 5u );
+}
+
+
+/// Tests the edits of simple changes
+void LineDiffTest::testDiff()
+{
+    QVector<quint64> lines = { 1, 2, 3, 4, 5 };
+    testEqual( diff(lines, lines), QStringLiteral("") );
+    testEqual( diff(lines, { 1, 2, 9, 4, 5 }), QStringLiteral("2,1>2,1") );
+    testEqual( diff(lines, { 1, 2, 4, 5 }), QStringLiteral("2,1>2,0") );
+    testEqual( diff(lines, { 1, 2, 3, 9, 9, 4, 5 }), QStringLiteral("3,0>3,2") );
+    testEqual( diff(lines, { 9, 1, 2, 3, 5, 9 }), QStringLiteral("0,0>0,1 3,1>4,0 5,0>5,1") );
+    testEqual( diff(lines, {}), QStringLiteral("0,5>0,0") );
+    testEqual( diff({}, lines), QStringLiteral("0,0>0,5") );
+
+    // above the maximum cost the changed block is replaced
+    testEqual( diff(lines, { 9, 1, 2, 3, 5, 9 }, 1), QStringLiteral("0,5>0,6") );
+}
+
+
+/// Tests the edits of random changes, by applying them to the old lines
+void LineDiffTest::testRandomDiff()
+{
+    quint32 seed = 42;
+    for (int round = 0; round < 50; ++round) {
+        QVector<quint64> oldLines;
+        for (int i = 0; i < 200; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            oldLines.append((seed >> 8) % 20);
+        }
+        QVector<quint64> newLines = oldLines;
+        for (int i = 0; i < round; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            qsizetype pos = static_cast<qsizetype>((seed >> 8) % static_cast<quint32>(newLines.size()));
+            switch ((seed >> 20) % 3) {
+                case 0: newLines.remove(pos); break;
+                case 1: newLines.insert(pos, 100 + static_cast<quint64>(i)); break;
+                default: newLines[pos] = 200 + static_cast<quint64>(i);
+            }
+        }
+
+        QVector<LineDiff::Edit> edits = LineDiff::diff(oldLines.constData(), static_cast<size_t>(oldLines.size()), newLines.constData(), static_cast<size_t>(newLines.size()));
+        testTrue( applyEdits(oldLines, newLines, edits) == newLines );
+        testTrue( edits.size() <= 2 * round );
+
+        // with a low cost the result is still correct
+        edits = LineDiff::diff(oldLines.constData(), static_cast<size_t>(oldLines.size()), newLines.constData(), static_cast<size_t>(newLines.size()), 2);
+        testTrue( applyEdits(oldLines, newLines, edits) == newLines );
+    }
+}
+
+
+/// Tests the line edits of two buffers
+void LineDiffTest::testBufferDiff()
+{
+    CharTextBuffer oldBuffer, newBuffer;
+    oldBuffer.setText(QStringLiteral("a\nb\nc\nd\ne"));
+
+    newBuffer.setText(QStringLiteral("a\nb\nc\nd\ne"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("") );
+
+    newBuffer.setText(QStringLiteral("a\nB\nc\nd\ne"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("1,1>1,1") );
+
+    newBuffer.setText(QStringLiteral("a\nb\nc\nd\ne\nf"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("4,1>4,2") );
+
+    newBuffer.setText(QStringLiteral("a\nc\nd\ne"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("1,1>1,0") );
+
+    newBuffer.setText(QStringLiteral("x\na\nb\nc\nd\ne"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("0,0>0,1") );
+
+    newBuffer.setText(QStringLiteral("a\nb\nX\nd\nE"));
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("2,1>2,1 4,1>4,1") );
+
+    newBuffer.setText(QString());
+    testEqual( editsAsString(LineDiff::diff(&oldBuffer, &newBuffer)), QStringLiteral("0,5>0,1") );
+}
+
+
+} // edbee
@@ -0,0 +1,26 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the line diff, by applying the edits to the old lines
+class LineDiffTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testCommonPrefixSuffix();
+    void testDiff();
+    void testRandomDiff();
+    void testBufferDiff();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::LineDiffTest);
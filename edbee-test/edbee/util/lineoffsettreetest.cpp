@@ -0,0 +1,142 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "lineoffsettreetest.h"
+
+#include "edbee/models/textbuffer.h"
+#include "edbee/util/lineoffsettree.h"
+#include "edbee/util/lineoffsetvector.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Replaces the text in the given string and applies the change to the tree and the vector
+static void replaceText(LineOffsetTree& tree, LineOffsetVector& vector, QString& text, size_t offset, size_t length, const QString& newText)
+{
+    TextBufferChange change(&vector, offset, length, newText.constData(), static_cast<size_t>(newText.length()));
+    tree.applyChange(change);
+    vector.applyChange(change);
+    text.replace(static_cast<int>(offset), static_cast<int>(length), newText);
+}
+
+
+/// Tests some basic changes
+void LineOffsetTreeTest::testApplyChange()
+{
+    LineOffsetTree tree;
+    LineOffsetVector vector;
+    QString text;
+    testEqual(tree.toUnitTestString(), "0");
+    testEqual(tree.length(), 1);
+
+    replaceText(tree, vector, text, 0, 0, "a\nb\nc\nd\ne");
+    testEqual(tree.toUnitTestString(), "0,2,4,6,8");
+
+    replaceText(tree, vector, text, 3, 0, "\n");
+    testEqual(tree.toUnitTestString(), "0,2,4,5,7,9");
+
+    replaceText(tree, vector, text, 0, 0, "\n");
+    testEqual(tree.toUnitTestString(), "0,1,3,5,6,8,10");
+
+    replaceText(tree, vector, text, 2, 5, "xyz");
+    testEqual(tree.toUnitTestString(), vector.toUnitTestFilledString());
+    testEqual(tree.toUnitTestString(), "0,1,6,8");
+
+    replaceText(tree, vector, text, 0, static_cast<size_t>(text.length()), "");
+    testEqual(tree.toUnitTestString(), "0");
+    tree.assertValid();
+}
+
+
+/// Tests finding the line of an offset
+void LineOffsetTreeTest::testFindLineFromOffset()
+{
+    LineOffsetTree tree;
+    tree.appendOffset(4);
+    testEqual(tree.findLineFromOffset(0), 0);
+    testEqual(tree.findLineFromOffset(3), 0);
+    testEqual(tree.findLineFromOffset(4), 1);
+    testEqual(tree.findLineFromOffset(100), 1);
+
+    tree.appendOffset(5);
+    tree.appendOffset(9);
+    testEqual(tree.toUnitTestString(), "0,4,5,9");
+    testEqual(tree.findLineFromOffset(4), 1);
+    testEqual(tree.findLineFromOffset(5), 2);
+    testEqual(tree.findLineFromOffset(8), 2);
+    testEqual(tree.findLineFromOffset(9), 3);
+}
+
+
+/// Tests appending offsets over multiple blocks
+void LineOffsetTreeTest::testAppendOffset()
+{
+    LineOffsetTree tree;
+    for (size_t i = 1; i < 2000; ++i) {
+        tree.appendOffset(i * 3);
+    }
+    tree.assertValid();
+    testEqual(tree.length(), 2000);
+    testEqual(tree.at(1000), 3000);
+    testEqual(tree.findLineFromOffset(3001), 1000);
+
+    tree.clear();
+    testEqual(tree.length(), 1);
+}
+
+
+/// Performs random changes and compares the results with the line offset vector
+void LineOffsetTreeTest::testRandomChanges()
+{
+    LineOffsetTree tree;
+    LineOffsetVector vector;
+    QString text;
+
+    quint32 seed = 1234;
+    for (int i = 0; i < 2000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        size_t offset = (seed >> 8) % static_cast<size_t>(text.length() + 1);
+        seed = seed * 1103515245u + 12345u;
+        size_t length = qMin(static_cast<size_t>((seed >> 8) % 40), static_cast<size_t>(text.length()) - offset);
+
+        QString newText;
+        seed = seed * 1103515245u + 12345u;
+        for (size_t j = 0, cnt = (seed >> 8) % (i % 100 == 0 ? 3000 : 30); j < cnt; ++j) {
+            seed = seed * 1103515245u + 12345u;
+            newText.append(((seed >> 8) % 3) == 0 ? QChar('\n') : QChar('a'));
+        }
+        replaceText(tree, vector, text, offset, length, newText);
+    }
+    tree.assertValid();
+    testEqual(tree.length(), vector.length());
+    testEqual(tree.toUnitTestString(), vector.toUnitTestFilledString());
+    for (size_t offset = 0, len = static_cast<size_t>(text.length()); offset <= len; ++offset) {
+        if (tree.findLineFromOffset(offset) != vector.findLineFromOffset(offset)) {
+            testEqual(tree.findLineFromOffset(offset), vector.findLineFromOffset(offset));
+            break;
+        }
+    }
+}
+
+
+/// Small edits should not fragment the tree in small blocks
+void LineOffsetTreeTest::testBlockCount()
+{
+    LineOffsetTree tree;
+    LineOffsetVector vector;
+    QString text;
+    replaceText(tree, vector, text, 0, 0, QString("line\n").repeated(10000));
+    size_t blockCount = tree.blockCount();
+    testTrue(blockCount >= 10000 / 256);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        replaceText(tree, vector, text, (i * 7919) % static_cast<size_t>(text.length()), 0, "\n");
+    }
+    tree.assertValid();
+    testEqual(tree.toUnitTestString(), vector.toUnitTestFilledString());
+    testTrue(tree.blockCount() <= blockCount * 3);
+}
+
+
+} // edbee
@@ -0,0 +1,27 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the line offset tree by comparing it with the line offset vector
+class LineOffsetTreeTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testApplyChange();
+    void testFindLineFromOffset();
+    void testAppendOffset();
+    void testRandomChanges();
+    void testBlockCount();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::LineOffsetTreeTest);
@@ -0,0 +1,112 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "newlinescannertest.h"
+
+#include "edbee/util/newlinescanner.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Builds a text of the given length with newlines and characters that only partially match a newline
+static QString scanText(int length)
+{
+    QString result;
+    quint32 seed = 42;
+    for (int i = 0; i < length; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        switch ((seed >> 8) % 6) {
+            case 0: result.append(QChar('\n')); break;
+            case 1: result.append(QChar(0x010A)); break;
+            case 2: result.append(QChar(0x0A00)); break;
+            default: result.append(QChar('a' + static_cast<int>((seed >> 12) % 26)));
+        }
+    }
+    return result;
+}
+
+
+/// Returns the newline offsets found with a simple loop (as comma separated string)
+static QString expectedOffsets(const QString& text, int start, int length, size_t offset)
+{
+    QStringList result;
+    for (int i = start; i < start + length; ++i) {
+        if (text.at(i) == '\n') { result.append(QString::number(offset + static_cast<size_t>(i - start) + 1)); }
+    }
+    return result.join(",");
+}
+
+
+/// Converts the given offsets to a comma separated string
+static QString offsetsAsString(const QVector<size_t>& offsets)
+{
+    QStringList result;
+    for (size_t offset : offsets) { result.append(QString::number(offset)); }
+    return result.join(",");
+}
+
+
+/// Tests counting newlines with all kinds of alignments and lengths
+void NewlineScannerTest::testCountNewlines()
+{
+    testEqual(NewlineScanner::countNewlines(static_cast<const QChar*>(nullptr), 0), 0);
+
+    QString text = scanText(300);
+    for (int start = 0; start < 33; ++start) {
+        for (int length = 0; start + length <= text.length(); length += 7) {
+            testEqual(NewlineScanner::countNewlines(text.constData() + start, static_cast<size_t>(length)), text.mid(start, length).count('\n'));
+        }
+    }
+}
+
+
+/// Tests the line offsets, the offsets are appended to the existing vector
+void NewlineScannerTest::testAppendNewlineOffsets()
+{
+    QString text = scanText(300);
+    for (int start = 0; start < 33; ++start) {
+        for (int length = 0; start + length <= text.length(); length += 13) {
+            QVector<size_t> offsets;
+            NewlineScanner::appendNewlineOffsets(text.constData() + start, static_cast<size_t>(length), 1000, offsets);
+            testEqual(offsetsAsString(offsets), expectedOffsets(text, start, length, 1000));
+        }
+    }
+
+    QVector<size_t> offsets;
+    offsets.append(3);
+    NewlineScanner::appendNewlineOffsets(QString("a\nb\n").constData(), 4, 10, offsets);
+    testEqual(offsetsAsString(offsets), "3,12,14");
+}
+
+
+/// Tests finding the offset after the nth newline
+void NewlineScannerTest::testOffsetAfterNewline()
+{
+    QString text = scanText(300);
+    size_t newline = 0;
+    for (int i = 0; i < text.length(); ++i) {
+        if (text.at(i) == '\n') {
+            ++newline;
+            testEqual(NewlineScanner::offsetAfterNewline(text.constData(), static_cast<size_t>(text.length()), newline), i + 1);
+        }
+    }
+    testEqual(NewlineScanner::offsetAfterNewline(text.constData(), static_cast<size_t>(text.length()), newline + 1), std::string::npos);
+}
+
+
+/// Tests the latin1 variants
+void NewlineScannerTest::testLatin1()
+{
+    QByteArray text = scanText(300).toLatin1();
+    for (int start = 0; start < 17; ++start) {
+        for (int length = 0; start + length <= text.length(); length += 11) {
+            testEqual(NewlineScanner::countNewlines(text.constData() + start, static_cast<size_t>(length)), text.mid(start, length).count('\n'));
+        }
+    }
+    testEqual(NewlineScanner::offsetAfterNewline("abc\ndef\n", 8, 2), 8);
+    testEqual(NewlineScanner::offsetAfterNewline("abc\ndef\n", 8, 3), std::string::npos);
+}
+
+
+} // edbee
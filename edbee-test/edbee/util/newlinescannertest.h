@@ -0,0 +1,26 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the vectorized newline scanner by comparing it with simple loops
+class NewlineScannerTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testCountNewlines();
+    void testAppendNewlineOffsets();
+    void testOffsetAfterNewline();
+    void testLatin1();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::NewlineScannerTest);
@@ -27,4 +27,56 @@ void RegExpTest::testRegExp()
 }
 
 
+/// Tests the scanning of multiple expressions at once
+void RegExpTest::testRegExpScanner()
+{
+    QString text = QStringLiteral("int a = b; // int");
+    QVector<RegExp*> regExps;
+    regExps.append(new RegExp("//.*"));
+    regExps.append(new RegExp("[a-z]+"));
+    regExps.append(new RegExp("\\bint\\b"));
+    regExps.append(new RegExp("(invalid"));
+    regExps.append(new RegExp("="));
+
+    // the scanners refer to the compiled expressions, they are deleted before the expressions
+    {
+        RegExpScanner scanner(regExps);
+        testTrue(scanner.isValid());
+        testFalse(scanner.isOffsetDependent());
+
+        // the first expression wins on the same position, the invalid expression is skipped
+        testEqual(scanner.indexIn(text.constData(), 0, static_cast<size_t>(text.length())), 0);
+        testEqual(scanner.matchedIndex(), 1);
+        testEqual(scanner.indexIn(text.constData(), 3, static_cast<size_t>(text.length())), 4);
+        testEqual(scanner.matchedIndex(), 1);
+        testEqual(scanner.indexIn(text.constData(), 5, static_cast<size_t>(text.length())), 6);
+        testEqual(scanner.matchedIndex(), 4);
+        testEqual(scanner.indexIn(text.constData(), 10, static_cast<size_t>(text.length())), 11);
+        testEqual(scanner.matchedIndex(), 0);
+
+        // no match
+        testEqual(scanner.indexIn(text.constData(), 3, 4), std::string::npos);
+        testEqual(scanner.matchedIndex(), -1);
+
+        // \G depends on the search offset
+        regExps.append(new RegExp("\\G\\s"));
+        RegExpScanner offsetScanner(regExps);
+        testTrue(offsetScanner.isOffsetDependent());
+        testEqual(offsetScanner.indexIn(text.constData(), 3, static_cast<size_t>(text.length())), 3);
+        testEqual(offsetScanner.matchedIndex(), 5);
+
+        // other engines can't be scanned
+        regExps.append(new RegExp("x", true, RegExp::SyntaxDefault, RegExp::EngineQRegExp));
+        RegExpScanner invalidScanner(regExps);
+        testFalse(invalidScanner.isValid());
+    }
+
+    // the expressions are still usable after the scanners have been deleted
+    testEqual(regExps.at(2)->indexIn(text), 0);
+    testEqual(regExps.at(0)->indexIn(text), 11);
+
+    qDeleteAll(regExps);
+}
+
+
 } // edbee
@@ -13,6 +13,7 @@ class RegExpTest  : public edbee::test::TestCase
 private slots:
 
     void testRegExp();
+    void testRegExpScanner();
 
 };
 
@@ -0,0 +1,146 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "textropetest.h"
+
+#include "edbee/util/textrope.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Replaces the given range of the rope with the given string
+static void ropeReplace(TextRope& rope, size_t offset, size_t length, const QString& text)
+{
+    rope.replace(offset, length, text.constData(), static_cast<size_t>(text.length()));
+}
+
+
+/// Tests the basic replace operations
+void TextRopeTest::testReplace()
+{
+    TextRope rope;
+    testEqual(rope.length(), 0);
+    testEqual(rope.chunkCount(), 0);
+
+    ropeReplace(rope, 0, 0, "ABCD");
+    testEqual(rope.mid(0, rope.length()), "ABCD");
+
+    ropeReplace(rope, 2, 0, "xy");
+    testEqual(rope.mid(0, rope.length()), "ABxyCD");
+
+    ropeReplace(rope, 1, 4, "-");
+    testEqual(rope.mid(0, rope.length()), "A-D");
+    testEqual(rope.at(1), QChar('-'));
+    testEqual(rope.mid(1, 2), "-D");
+
+    ropeReplace(rope, 0, 3, "");
+    testEqual(rope.length(), 0);
+    testEqual(rope.chunkCount(), 0);
+}
+
+
+/// Tests if large texts are split in chunks and small edits don't fragment the rope
+void TextRopeTest::testChunking()
+{
+    TextRope rope;
+    QString text(static_cast<qsizetype>(TextRope::MaxChunkSize * 10), QChar('a'));
+    ropeReplace(rope, 0, 0, text);
+    testEqual(rope.length(), TextRope::MaxChunkSize * 10);
+    testEqual(rope.chunkCount(), 10);
+
+    // typing a character per edit, should not create new chunks for every character
+    size_t offset = TextRope::MaxChunkSize * 5 + 13;
+    for (int i = 0; i < 100; ++i) {
+        ropeReplace(rope, offset + static_cast<size_t>(i), 0, "b");
+    }
+    testEqual(rope.length(), TextRope::MaxChunkSize * 10 + 100);
+    testTrue(rope.chunkCount() <= 12);
+    testEqual(rope.mid(offset - 1, 102), QStringLiteral("a%1a").arg(QString(100, QChar('b'))));
+
+    // the tree should stay balanced
+    for (int i = 0; i < 200; ++i) {
+        ropeReplace(rope, rope.length(), 0, text.left(static_cast<qsizetype>(TextRope::MaxChunkSize)));
+    }
+    testTrue(rope.depth() < 40);
+}
+
+
+/// Tests the line calculations
+void TextRopeTest::testLines()
+{
+    TextRope rope;
+    ropeReplace(rope, 0, 0, "a1\nb2\nc3\n\nd5");
+    testEqual(rope.newlineCount(), 4);
+
+    testEqual(rope.lineFromOffset(0), 0);
+    testEqual(rope.lineFromOffset(2), 0);
+    testEqual(rope.lineFromOffset(3), 1);
+    testEqual(rope.lineFromOffset(9), 3);
+    testEqual(rope.lineFromOffset(10), 4);
+    testEqual(rope.lineFromOffset(12), 4);
+
+    testEqual(rope.offsetFromLine(0), 0);
+    testEqual(rope.offsetFromLine(1), 3);
+    testEqual(rope.offsetFromLine(2), 6);
+    testEqual(rope.offsetFromLine(3), 9);
+    testEqual(rope.offsetFromLine(4), 10);
+    testEqual(rope.offsetFromLine(5), 12);
+
+    // lines over multiple chunks
+    TextRope large;
+    QString line = QStringLiteral("%1\n").arg(QString(99, QChar('x')));
+    for (int i = 0; i < 1000; ++i) {
+        ropeReplace(large, large.length(), 0, line);
+    }
+    testTrue(large.chunkCount() > 1);
+    testEqual(large.newlineCount(), 1000);
+    testEqual(large.offsetFromLine(500), 50000);
+    testEqual(large.lineFromOffset(50000), 500);
+    testEqual(large.lineFromOffset(49999), 499);
+}
+
+
+/// A copy of the rope shares the data, but should not change when the original changes
+void TextRopeTest::testSharing()
+{
+    TextRope rope;
+    ropeReplace(rope, 0, 0, "Hello\nWorld");
+
+    TextRope copy(rope);
+    ropeReplace(rope, 5, 1, " ");
+    testEqual(rope.mid(0, rope.length()), "Hello World");
+    testEqual(rope.newlineCount(), 0);
+    testEqual(copy.mid(0, copy.length()), "Hello\nWorld");
+    testEqual(copy.newlineCount(), 1);
+}
+
+
+/// Tests if latin1 chunks are used when possible, and are promoted to UTF-16 when required
+void TextRopeTest::testLatin1Storage()
+{
+    QString text = QString("abcdefghij\n").repeated(10000);
+    TextRope utf16Rope;
+    TextRope latin1Rope(TextRope::Latin1Storage);
+    ropeReplace(utf16Rope, 0, 0, text);
+    ropeReplace(latin1Rope, 0, 0, text);
+
+    testEqual(utf16Rope.byteSize(), text.length() * 2);
+    testEqual(latin1Rope.byteSize(), text.length());
+    testEqual(latin1Rope.mid(0, latin1Rope.length()), text);
+    testEqual(latin1Rope.newlineCount(), 10000);
+
+    // inserting a non latin1 character only promotes the chunk(s) around the insertion
+    ropeReplace(latin1Rope, 5000, 0, QString(QChar(0x20ac)));
+    testEqual(latin1Rope.at(5000), QChar(0x20ac));
+    testEqual(latin1Rope.at(4999), QChar('f'));
+    testTrue(latin1Rope.byteSize() < latin1Rope.length() * 2 * 6 / 10);
+
+    // converting the storage mode keeps the content
+    latin1Rope.setStorageMode(TextRope::Utf16Storage);
+    testEqual(latin1Rope.byteSize(), latin1Rope.length() * 2);
+    testEqual(latin1Rope.mid(4995, 10), QString("bcdef") + QChar(0x20ac) + QString("ghij"));
+}
+
+
+} // edbee
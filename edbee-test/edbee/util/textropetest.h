@@ -0,0 +1,27 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+
+/// Tests the rope text storage
+class TextRopeTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+
+    void testReplace();
+    void testChunking();
+    void testLines();
+    void testSharing();
+    void testLatin1Storage();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::TextRopeTest);
@@ -0,0 +1,172 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "unicodetranscodertest.h"
+
+#include <QByteArray>
+#include <QTextCodec>
+
+#include "edbee/util/textcodec.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// A text with ASCII runs (longer than a vector block) and 2, 3 and 4 byte sequences
+static QString sampleText()
+{
+    return QStringLiteral("The quick brown fox jumps over the lazy dog\ncafé € 100 \U0001F600 naïve 中文 text\n");
+}
+
+
+/// Decodes the bytes in one call
+static QString decode(TextCodec* codec, const QByteArray& bytes)
+{
+    TextDecoder* decoder = codec->makeTextDecoder();
+    QString result = decoder->toUnicode(bytes.constData(), static_cast<int>(bytes.size()));
+    delete decoder;
+    return result;
+}
+
+
+/// Decodes the bytes in two parts, split at the given position
+static QString decodeSplit(TextCodec* codec, const QByteArray& bytes, int split)
+{
+    TextDecoder* decoder = codec->makeTextDecoder();
+    QString result;
+    decoder->toUnicode(bytes.constData(), split, result);
+    decoder->toUnicode(bytes.constData() + split, static_cast<int>(bytes.size()) - split, result);
+    delete decoder;
+    return result;
+}
+
+
+/// Encodes the text in one call
+static QByteArray encode(TextCodec* codec, const QString& text)
+{
+    TextEncoder* encoder = codec->makeTextEncoder();
+    QByteArray result = encoder->fromUnicode(text);
+    delete encoder;
+    return result;
+}
+
+
+/// Tests decoding and encoding valid UTF-8
+void UnicodeTranscoderTest::testUtf8RoundTrip()
+{
+    TextCodec codec(QStringLiteral("UTF-8"), QTextCodec::codecForName("UTF-8"), QTextCodec::IgnoreHeader);
+    QString text = sampleText().repeated(5);
+    QByteArray bytes = text.toUtf8();
+
+    testEqual( encode(&codec, text), bytes );
+    testEqual( decode(&codec, bytes), text );
+    testEqual( decode(&codec, QByteArray()), QString() );
+}
+
+
+/// Every invalid sequence should become a replacement character
+void UnicodeTranscoderTest::testUtf8Invalid()
+{
+    TextCodec codec(QStringLiteral("UTF-8"), QTextCodec::codecForName("UTF-8"), QTextCodec::IgnoreHeader);
+    QString replacement(QChar(0xFFFD));
+
+    testEqual( decode(&codec, "caf\xE9!"), QStringLiteral("caf") + replacement + QStringLiteral("!") );
+    testEqual( decode(&codec, "a\x80" "b"), QStringLiteral("a") + replacement + QStringLiteral("b") );
+    testEqual( decode(&codec, "\xC0\xAF"), replacement + replacement );                // overlong
+    testEqual( decode(&codec, "\xED\xA0\x80"), replacement + replacement + replacement ); // surrogate
+    testEqual( decode(&codec, "\xE2\x82x"), replacement + QStringLiteral("x") );        // maximal subpart
+
+    // an incomplete sequence at the end of the data is kept by the decoder (and never returned)
+    testEqual( decode(&codec, "abc\xE2\x82"), QStringLiteral("abc") );
+
+    // a lone surrogate is encoded as '?'
+    QString lone = QStringLiteral("a") + QChar(0xD800) + QStringLiteral("b");
+    testEqual( encode(&codec, lone), QByteArray("a?b") );
+
+    // a high surrogate at the end of the stream is written as U+FFFD when the encoder is flushed
+    TextEncoder* encoder = codec.makeTextEncoder();
+    QByteArray encoded;
+    encoder->fromUnicode(lone.constData(), 2, encoded);
+    testEqual( encoded, QByteArray("a") );
+    encoder->flush(encoded);
+    testEqual( encoded, QByteArray("a\xEF\xBF\xBD") );
+    encoder->flush(encoded);
+    testEqual( encoded, QByteArray("a\xEF\xBF\xBD") );
+    delete encoder;
+}
+
+
+/// Tests decoding and encoding in blocks, split at every position
+void UnicodeTranscoderTest::testUtf8Streaming()
+{
+    TextCodec codec(QStringLiteral("UTF-8"), QTextCodec::codecForName("UTF-8"), QTextCodec::IgnoreHeader);
+    QString text = sampleText();
+    QByteArray bytes = text.toUtf8();
+
+    for (int split = 0; split <= bytes.size(); ++split) {
+        testEqual( decodeSplit(&codec, bytes, split), text );
+    }
+
+    // a sequence split over three blocks
+    TextDecoder* decoder = codec.makeTextDecoder();
+    QString result;
+    decoder->toUnicode("a\xF0\x9F", 3, result);
+    decoder->toUnicode("\x98", 1, result);
+    decoder->toUnicode("\x80" "b", 2, result);
+    testEqual( result, QStringLiteral("a\U0001F600b") );
+    delete decoder;
+
+    for (int split = 0; split <= text.size(); ++split) {
+        TextEncoder* encoder = codec.makeTextEncoder();
+        QByteArray encoded;
+        encoder->fromUnicode(text.constData(), split, encoded);
+        encoder->fromUnicode(text.constData() + split, static_cast<int>(text.size()) - split, encoded);
+        testEqual( encoded, bytes );
+        delete encoder;
+    }
+}
+
+
+/// The byte order mark should only be handled for codecs with a header
+void UnicodeTranscoderTest::testUtf8ByteOrderMark()
+{
+    TextCodec codec(QStringLiteral("UTF-8"), QTextCodec::codecForName("UTF-8"), QTextCodec::IgnoreHeader);
+    TextCodec bomCodec(QStringLiteral("UTF-8 with BOM"), QTextCodec::codecForName("UTF-8"), QTextCodec::DefaultConversion);
+    QByteArray bytes("\xEF\xBB\xBFtext");
+
+    testEqual( encode(&codec, QStringLiteral("text")), QByteArray("text") );
+    testEqual( encode(&bomCodec, QStringLiteral("text")), bytes );
+    testEqual( decode(&bomCodec, bytes), QStringLiteral("text") );
+    testEqual( decode(&codec, bytes), QString(QChar(0xFEFF)) + QStringLiteral("text") );
+
+    // a byte order mark split over two blocks
+    for (int split = 0; split <= 3; ++split) {
+        testEqual( decodeSplit(&bomCodec, bytes, split), QStringLiteral("text") );
+    }
+
+    // only the first character is a byte order mark
+    TextDecoder* decoder = bomCodec.makeTextDecoder(QTextCodec::IgnoreHeader);
+    testEqual( decoder->toUnicode(bytes.constData(), static_cast<int>(bytes.size())), QString(QChar(0xFEFF)) + QStringLiteral("text") );
+    delete decoder;
+}
+
+
+/// Tests the UTF-16LE conversion
+void UnicodeTranscoderTest::testUtf16LE()
+{
+    TextCodec codec(QStringLiteral("UTF-16LE"), QTextCodec::codecForName("UTF-16LE"), QTextCodec::DefaultConversion);
+    QString text = sampleText();
+    QByteArray bytes("\xFF\xFE", 2);
+    for (int i = 0; i < text.size(); ++i) {
+        bytes.append(static_cast<char>(text.at(i).unicode() & 0xFF));
+        bytes.append(static_cast<char>(text.at(i).unicode() >> 8));
+    }
+
+    testEqual( encode(&codec, text), bytes );
+    for (int split = 0; split <= bytes.size(); ++split) {
+        testEqual( decodeSplit(&codec, bytes, split), text );
+    }
+}
+
+
+} // edbee
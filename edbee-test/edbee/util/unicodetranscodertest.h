@@ -0,0 +1,24 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "edbee/util/test.h"
+
+namespace edbee {
+
+class UnicodeTranscoderTest : public edbee::test::TestCase
+{
+    Q_OBJECT
+
+private slots:
+    void testUtf8RoundTrip();
+    void testUtf8Invalid();
+    void testUtf8Streaming();
+    void testUtf8ByteOrderMark();
+    void testUtf16LE();
+};
+
+} // edbee
+
+DECLARE_TEST(edbee::UnicodeTranscoderTest);
@@ -0,0 +1,114 @@
+// edbee - Copyright (c) 2012-2025 by Rick Blommers and contributors
+// SPDX-License-Identifier: MIT
+
+#include "utf8validatortest.h"
+
+#include <QByteArray>
+
+#include "edbee/util/textcodec.h"
+#include "edbee/util/textcodecdetector.h"
+#include "edbee/util/utf8validator.h"
+
+#include "edbee/debug.h"
+
+namespace edbee {
+
+/// Validates the given bytes, with both code paths. Returns -1 when the code paths have a different result
+static int validate(const QByteArray& bytes, bool allowTruncatedEnd = false)
+{
+    Utf8Validator::Result result = Utf8Validator::validate(bytes.constData(), static_cast<size_t>(bytes.size()), allowTruncatedEnd);
+    Utf8Validator::Result scalarResult = Utf8Validator::validateScalar(bytes.constData(), static_cast<size_t>(bytes.size()), allowTruncatedEnd);
+    return result == scalarResult ? static_cast<int>(result) : -1;
+}
+
+
+/// Tests the validation of single sequences
+void Utf8ValidatorTest::testValidate()
+{
+    testEqual( validate(""), static_cast<int>(Utf8Validator::Ascii) );
+    testEqual( validate("hello"), static_cast<int>(Utf8Validator::Ascii) );
+    testEqual( validate("caf\xC3\xA9"), static_cast<int>(Utf8Validator::Utf8) );
+    testEqual( validate("\xE2\x82\xAC"), static_cast<int>(Utf8Validator::Utf8) );          // euro sign
+    testEqual( validate("\xF0\x9F\x98\x80"), static_cast<int>(Utf8Validator::Utf8) );      // U+1F600
+    testEqual( validate("\xF4\x8F\xBF\xBF"), static_cast<int>(Utf8Validator::Utf8) );      // U+10FFFF
+
+    testEqual( validate("caf\xE9"), static_cast<int>(Utf8Validator::Invalid) );            // latin1
+    testEqual( validate("\x80"), static_cast<int>(Utf8Validator::Invalid) );               // continuation without lead
+    testEqual( validate("\xC0\xAF"), static_cast<int>(Utf8Validator::Invalid) );           // overlong 2 bytes
+    testEqual( validate("\xE0\x80\xAF"), static_cast<int>(Utf8Validator::Invalid) );       // overlong 3 bytes
+    testEqual( validate("\xF0\x80\x80\xAF"), static_cast<int>(Utf8Validator::Invalid) );   // overlong 4 bytes
+    testEqual( validate("\xED\xA0\x80"), static_cast<int>(Utf8Validator::Invalid) );       // surrogate
+    testEqual( validate("\xF4\x90\x80\x80"), static_cast<int>(Utf8Validator::Invalid) );   // above U+10FFFF
+    testEqual( validate("\xF8\x88\x80\x80\x80"), static_cast<int>(Utf8Validator::Invalid) ); // 5 bytes
+    testEqual( validate("\xE2\x82"), static_cast<int>(Utf8Validator::Invalid) );           // incomplete
+    testEqual( validate("\xE2\x82x"), static_cast<int>(Utf8Validator::Invalid) );
+}
+
+
+/// Tests the validation of data that ends in the middle of a sequence
+void Utf8ValidatorTest::testTruncatedEnd()
+{
+    testEqual( validate("abc\xE2\x82", true), static_cast<int>(Utf8Validator::Utf8) );
+    testEqual( validate("abc\xF0\x9F\x98", true), static_cast<int>(Utf8Validator::Utf8) );
+    testEqual( validate("abc\xE2\x82", false), static_cast<int>(Utf8Validator::Invalid) );
+    testEqual( validate("abc\xE0\x80", true), static_cast<int>(Utf8Validator::Invalid) );   // the present bytes are invalid
+}
+
+
+/// Tests every sequence at every position of the vector blocks, surrounded by ASCII and multi-byte text
+void Utf8ValidatorTest::testAlignments()
+{
+    static const char* sequences[] = {
+        "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xE9", "\xC3", "\xE2\x82", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80\x80"
+    };
+    static const int expected[] = {
+        Utf8Validator::Utf8, Utf8Validator::Utf8, Utf8Validator::Utf8, Utf8Validator::Invalid, Utf8Validator::Invalid,
+        Utf8Validator::Invalid, Utf8Validator::Invalid, Utf8Validator::Invalid, Utf8Validator::Invalid
+    };
+    for (int fill = 0; fill < 2; ++fill) {
+        for (size_t s = 0; s < sizeof(sequences) / sizeof(sequences[0]); ++s) {
+            for (int pos = 0; pos < 70; ++pos) {
+                QByteArray bytes;
+                while (bytes.size() + 2 <= pos) { bytes.append(fill ? "\xC3\xA9" : "aa"); }
+                if (bytes.size() < pos) { bytes.append("a"); }
+                bytes.append(sequences[s]);
+                while (bytes.size() < 100) { bytes.append(fill ? "\xE2\x82\xAC" : "b"); }
+                testEqual( validate(bytes), expected[s] );
+            }
+        }
+    }
+}
+
+
+/// Tests the codec detection, including the sampling of large buffers
+void Utf8ValidatorTest::testDetectCodec()
+{
+    QByteArray utf8("caf\xC3\xA9 \xE2\x82\xAC ");
+    TextCodecDetector utf8Detector(&utf8);
+    testEqual( utf8Detector.detectCodec()->name(), QStringLiteral("UTF-8") );
+
+    QByteArray latin1("caf\xE9 ");
+    TextCodecDetector latin1Detector(&latin1);
+    testEqual( latin1Detector.detectCodec()->name(), QStringLiteral("ISO-8859-1") );
+
+    QByteArray shortBuffer("ab");
+    TextCodecDetector shortDetector(&shortBuffer);
+    testEqual( shortDetector.detectCodec()->name(), QStringLiteral("UTF-8") );
+
+    QByteArray utf32Bom("\xFF\xFE\x00\x00" "a\x00\x00\x00", 8);
+    TextCodecDetector utf32Detector(&utf32Bom);
+    testEqual( utf32Detector.detectCodec()->name(), QStringLiteral("UTF-32LE with BOM") );
+
+    // a large buffer is sampled, invalid bytes in a sample are found
+    QByteArray large;
+    while (large.size() < 8 * 1024 * 1024) { large.append("line with \xE2\x82\xAC sign\n"); }
+    TextCodecDetector largeDetector(&large);
+    testEqual( largeDetector.detectCodec()->name(), QStringLiteral("UTF-8") );
+
+    large[large.size() - 100] = static_cast<char>(0xE9);
+    TextCodecDetector largeLatin1Detector(&large);
+    testEqual( largeLatin1Detector.detectCodec()->name(), QStringLiteral("ISO-8859-1") );
+}
+
+
+} // edbee